@@ -0,0 +1,339 @@
+/**
+ * Chess Game - Analysis
+ * Always-on background search of the game position feeding the evaluation
+ * bar, the multi-PV analysis panel, and the best-move hint and threat
+ * highlights.
+ */
+
+#include "analysis.h"
+#include "board.h"
+#include "check.h"
+#include "eval.h"
+#include "history.h"
+#include "multiplayer.h"
+#include "search.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// GLOBAL STATE DEFINITIONS
+//==============================================================================
+
+bool analysisEnabled = false;
+bool hintEnabled = false;
+
+//==============================================================================
+// LOCAL STATE
+//==============================================================================
+
+static Searcher analysisSearcher;
+static bool analysisAvailable = false; // The engine has a table to work with
+static bool searchStarted = false;
+static int searchMultiPv = 0; // Lines the running search reports
+static bool searchThrottled = false; // Running at ANALYSIS_IDLE_NPS
+
+// Position being analyzed; only changed while no search is running
+static ChessPosition analysisRoot;
+static int analysisPly = -1;
+
+// Written by the search thread, read by the game loop
+static pthread_mutex_t snapshotMutex = PTHREAD_MUTEX_INITIALIZER;
+static AnalysisSnapshot latest;
+
+// Pieces of the side to move that can be won, for the analyzed position
+static bool threatened[SQUARE_COUNT];
+
+// Lines found before the moves of the game, sorted by ply. Only plies played
+// with analysis on have one, so the history records stay small.
+static AnalysisSnapshot *alternatives = NULL;
+static int alternativeCount = 0;
+static int alternativeCapacity = 0;
+
+//==============================================================================
+// SEARCH CALLBACK
+//==============================================================================
+
+// Runs on the search thread after every completed iteration
+static void OnAnalysisReport(const SearchReport *report, void *userData) {
+  (void)userData;
+  AnalysisLine lines[ANALYSIS_LINES];
+  int lineCount =
+      report->lineCount < ANALYSIS_LINES ? report->lineCount : ANALYSIS_LINES;
+  int sign = analysisRoot.sideToMove == COLOR_WHITE ? 1 : -1;
+
+  for (int i = 0; i < lineCount; i++) {
+    const SearchLine *source = &report->lines[i];
+    AnalysisLine *line = &lines[i];
+
+    line->move = source->pvLength > 0 ? source->pv[0] : MOVE_NONE;
+    line->score = source->score * sign;
+    line->isMate = IsMateScore(source->score);
+    line->mateIn = line->isMate ? MateInMoves(source->score) * sign : 0;
+
+    // Replay the line on a copy of the root to write it in SAN
+    ChessPosition pos = analysisRoot;
+    int length = 0;
+    line->text[0] = '\0';
+    for (int j = 0; j < source->pvLength && j < ANALYSIS_PV_MOVES &&
+                    length < (int)sizeof(line->text) - MOVE_NOTATION_LEN;
+         j++) {
+      char san[MOVE_NOTATION_LEN];
+      MoveUndo undo;
+      FormatSanMove(&pos, source->pv[j], san);
+      length += snprintf(line->text + length,
+                         sizeof(line->text) - (size_t)length, "%s%s",
+                         j > 0 ? " " : "", san);
+      MakeMove(&pos, source->pv[j], &undo);
+    }
+  }
+
+  pthread_mutex_lock(&snapshotMutex);
+  latest.depth = report->depth;
+  latest.lineCount = lineCount;
+  memcpy(latest.lines, lines, sizeof(AnalysisLine) * (size_t)lineCount);
+  pthread_mutex_unlock(&snapshotMutex);
+}
+
+//==============================================================================
+// SEARCH CONTROL
+//==============================================================================
+
+static void StopAnalysisSearch(void) {
+  if (!searchStarted)
+    return;
+  StopSearch(&analysisSearcher);
+  WaitForSearch(&analysisSearcher, NULL);
+  searchStarted = false;
+}
+
+// The bar and the hint only need the best line, which then gets deeper
+// faster. The search always runs on one thread, and while only the bar
+// needs it, also under a node rate that leaves room for rendering and the
+// network thread.
+static void StartAnalysisSearch(int multiPv, bool throttled) {
+  SearchLimits limits = {0};
+  limits.infinite = true;
+  limits.multiPv = multiPv;
+  limits.nodesPerSecond = throttled ? ANALYSIS_IDLE_NPS : 0;
+  searchMultiPv = multiPv;
+  searchThrottled = throttled;
+  searchStarted =
+      StartSearch(&analysisSearcher, &analysisRoot, NULL, 0, &limits);
+}
+
+//==============================================================================
+// ALTERNATIVES
+//==============================================================================
+
+// Index of the entry for a ply, or where it would be inserted
+static int FindAlternatives(int ply) {
+  int low = 0, high = alternativeCount;
+  while (low < high) {
+    int mid = (low + high) / 2;
+    if (alternatives[mid].ply < ply)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  return low;
+}
+
+// Keep the lines found before a move, so the history panel can show what
+// else was possible. The position's key tells later whether the move at
+// that ply still follows the same position.
+static void KeepAlternatives(void) {
+  AnalysisSnapshot found;
+  pthread_mutex_lock(&snapshotMutex);
+  found = latest;
+  pthread_mutex_unlock(&snapshotMutex);
+  if (found.lineCount == 0)
+    return;
+
+  int index = FindAlternatives(found.ply);
+  if (index == alternativeCount || alternatives[index].ply != found.ply) {
+    if (alternativeCount == alternativeCapacity) {
+      int capacity = alternativeCapacity > 0 ? alternativeCapacity * 2 : 32;
+      AnalysisSnapshot *grown =
+          realloc(alternatives, sizeof(AnalysisSnapshot) * (size_t)capacity);
+      if (grown == NULL)
+        return;
+      alternatives = grown;
+      alternativeCapacity = capacity;
+    }
+    memmove(&alternatives[index + 1], &alternatives[index],
+            sizeof(AnalysisSnapshot) * (size_t)(alternativeCount - index));
+    alternativeCount++;
+  }
+  alternatives[index] = found;
+}
+
+//==============================================================================
+// THREATS
+//==============================================================================
+
+// Mark every piece of the side to move that the opponent attacks with a
+// cheaper piece, or attacks while nothing defends it. Pins are ignored.
+static void FindThreats(const ChessPosition *pos) {
+  memset(threatened, 0, sizeof(threatened));
+  PieceColor us = pos->sideToMove;
+
+  // The opponent's captures, as if it were their turn
+  ChessPosition theirs = *pos;
+  theirs.sideToMove = OPPONENT_COLOR(us);
+  theirs.enPassantSquare = NO_SQUARE;
+  MoveList captures;
+  GenerateCaptures(&theirs, &captures);
+
+  for (int i = 0; i < captures.count; i++) {
+    int from = MOVE_FROM(captures.moves[i]);
+    int to = MOVE_TO(captures.moves[i]);
+    PieceType victim = CODE_TYPE(pos->squares[to]);
+    PieceType attacker = CODE_TYPE(pos->squares[from]);
+    if (victim == PIECE_KING || threatened[to])
+      continue;
+
+    // A king can only take what is not defended
+    bool cheaper = attacker != PIECE_KING &&
+                   PIECE_VALUES[EVAL_MIDGAME][attacker] <
+                       PIECE_VALUES[EVAL_MIDGAME][victim];
+    threatened[to] = cheaper || !IsSquareAttackedBy(pos, to, us);
+  }
+}
+
+//==============================================================================
+// ANALYSIS INTERFACE
+//==============================================================================
+
+void InitAnalysis(void) {
+  InitSearcher(&analysisSearcher, &transpositionTable, 1);
+  analysisSearcher.onReport = OnAnalysisReport;
+  analysisAvailable = transpositionTable.clusters != NULL;
+}
+
+void ShutdownAnalysis(void) {
+  StopAnalysisSearch();
+  free(alternatives);
+  alternatives = NULL;
+  alternativeCount = 0;
+  alternativeCapacity = 0;
+}
+
+void ToggleAnalysis(void) { analysisEnabled = !analysisEnabled; }
+
+void ToggleHint(void) { hintEnabled = !hintEnabled; }
+
+// No engine lines or hints in online games; only the bar stays
+bool IsAnalysisShown(void) { return analysisEnabled && !isMultiplayerGame; }
+
+static bool IsHintShown(void) { return hintEnabled && !isMultiplayerGame; }
+
+// A move from the analysed position, and not a jump to another line that
+// happens to end one ply deeper
+static bool FollowsAnalysedPosition(int ply) {
+  ChessPosition previous;
+  return GetPositionAtPly(ply - 1, &previous) &&
+         previous.key == analysisRoot.key;
+}
+
+// Restart the search when the position changed, and keep it running until
+// the game ends. The table is never cleared here, so what was learned about
+// the previous position carries over.
+static void FollowGame(void) {
+  ChessPosition pos;
+  LoadPositionFromBoard(&pos);
+  int ply = GetMoveCount();
+
+  if (pos.key != analysisRoot.key || ply != analysisPly) {
+    StopAnalysisSearch();
+    if (ply == analysisPly + 1 && IsAnalysisShown() &&
+        FollowsAnalysedPosition(ply))
+      KeepAlternatives();
+
+    analysisRoot = pos;
+    analysisPly = ply;
+    pthread_mutex_lock(&snapshotMutex);
+    memset(&latest, 0, sizeof(latest));
+    latest.key = pos.key;
+    latest.ply = ply;
+    pthread_mutex_unlock(&snapshotMutex);
+    FindThreats(&pos);
+  }
+
+  bool active = analysisAvailable && !IsGameOver();
+  bool helping = IsAnalysisShown() || IsHintShown();
+  int multiPv = IsAnalysisShown() ? ANALYSIS_LINES : 1;
+  if (!active || (searchStarted && (searchMultiPv != multiPv ||
+                                    searchThrottled == helping)))
+    StopAnalysisSearch();
+  if (active && !searchStarted)
+    StartAnalysisSearch(multiPv, !helping);
+}
+
+void UpdateAnalysis(void) {
+  // The promotion choice is still open; the move is not on the board yet
+  if (gameState == GAME_PROMOTING)
+    return;
+  FollowGame();
+}
+
+void SuspendAnalysis(void) { StopAnalysisSearch(); }
+
+void InvalidateAnalysis(void) {
+  // Stop thinking about the old position now; the new one is known once
+  // the promotion piece is chosen
+  if (gameState == GAME_PROMOTING) {
+    StopAnalysisSearch();
+    return;
+  }
+  FollowGame();
+}
+
+bool GetAnalysis(AnalysisSnapshot *snapshot) {
+  pthread_mutex_lock(&snapshotMutex);
+  *snapshot = latest;
+  pthread_mutex_unlock(&snapshotMutex);
+  return snapshot->lineCount > 0;
+}
+
+bool GetMoveAlternatives(int ply, AnalysisSnapshot *snapshot) {
+  int index = FindAlternatives(ply);
+  if (index == alternativeCount || alternatives[index].ply != ply)
+    return false;
+
+  // The game may have taken another way to this ply since
+  ChessPosition pos;
+  if (!GetPositionAtPly(ply, &pos) || pos.key != alternatives[index].key)
+    return false;
+  *snapshot = alternatives[index];
+  return true;
+}
+
+bool GetEvaluation(AnalysisLine *line) {
+  pthread_mutex_lock(&snapshotMutex);
+  bool found = latest.lineCount > 0;
+  if (found)
+    *line = latest.lines[0];
+  pthread_mutex_unlock(&snapshotMutex);
+  return found;
+}
+
+bool GetHintMove(Move *move) {
+  if (!IsHintShown() || IsGameOver())
+    return false;
+  pthread_mutex_lock(&snapshotMutex);
+  *move = latest.lineCount > 0 ? latest.lines[0].move : MOVE_NONE;
+  pthread_mutex_unlock(&snapshotMutex);
+  return *move != MOVE_NONE;
+}
+
+bool IsSquareThreatened(int row, int col) {
+  return IsHintShown() && !IsGameOver() && threatened[row * BOARD_SIZE + col];
+}
+
+void FormatAnalysisScore(const AnalysisLine *line, char *buffer, size_t size) {
+  if (line->isMate)
+    snprintf(buffer, size, "#%d", line->mateIn);
+  else
+    snprintf(buffer, size, "%+.2f", line->score / 100.0);
+}
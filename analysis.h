@@ -0,0 +1,140 @@
+/**
+ * Chess Game - Analysis
+ * Always-on background search of the game position feeding the evaluation
+ * bar, the multi-PV analysis panel, and the best-move hint and threat
+ * highlights.
+ */
+
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include "position.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//==============================================================================
+// ANALYSIS CONSTANTS
+//==============================================================================
+
+#define ANALYSIS_LINES 3      // Best lines shown for each position
+#define ANALYSIS_PV_MOVES 6   // Moves of each line kept as text
+#define ANALYSIS_TEXT_LEN 64
+#define ANALYSIS_IDLE_NPS 150000 // Node rate while only the bar is shown
+
+//==============================================================================
+// ANALYSIS TYPES
+//==============================================================================
+
+// One engine line in display form
+typedef struct {
+  Move move; // First move of the line
+  int score; // Centipawns from white's point of view
+  bool isMate;
+  int mateIn; // Moves to mate, negative when black mates
+  char text[ANALYSIS_TEXT_LEN]; // The line in SAN, e.g. "Nf3 d5 g3"
+} AnalysisLine;
+
+// Latest results for one position
+typedef struct {
+  uint64_t key; // Zobrist key of the analyzed position
+  int ply;      // Moves played before the analyzed position
+  int depth;
+  int lineCount;
+  AnalysisLine lines[ANALYSIS_LINES];
+} AnalysisSnapshot;
+
+//==============================================================================
+// GLOBAL STATE (defined in analysis.c)
+//==============================================================================
+
+extern bool analysisEnabled;
+extern bool hintEnabled;
+
+//==============================================================================
+// ANALYSIS FUNCTIONS
+//==============================================================================
+
+/**
+ * Set up the analysis searcher (call once after the transposition table is
+ * allocated).
+ */
+void InitAnalysis(void);
+
+/**
+ * Stop the background search and release its resources.
+ */
+void ShutdownAnalysis(void);
+
+/**
+ * Turn analysis on or off.
+ */
+void ToggleAnalysis(void);
+
+/**
+ * Turn the best-move hint and threat highlights on or off.
+ */
+void ToggleHint(void);
+
+/**
+ * Check if the analysis panel is shown (it is never shown in online games).
+ */
+bool IsAnalysisShown(void);
+
+/**
+ * Follow the game: restart the search when the position changed, and keep
+ * the lines found before a move for that move. Call once per frame on the
+ * game screen.
+ */
+void UpdateAnalysis(void);
+
+/**
+ * Stop the background search while the game screen is left; the next
+ * UpdateAnalysis resumes it.
+ */
+void SuspendAnalysis(void);
+
+/**
+ * Drop the results for the old position right after a move changed the
+ * board, and restart the search (on the same table) for the new one.
+ */
+void InvalidateAnalysis(void);
+
+/**
+ * Copy the latest results for the current position.
+ * @return false if there is nothing to show yet
+ */
+bool GetAnalysis(AnalysisSnapshot *snapshot);
+
+/**
+ * Copy the lines that were found for the position before a move of the
+ * game, while analysis was on.
+ * @param ply Index of the move in the history
+ * @return false if that position was not analyzed
+ */
+bool GetMoveAlternatives(int ply, AnalysisSnapshot *snapshot);
+
+/**
+ * Get the best line found so far for the current position, for the
+ * evaluation bar. Available in every game, online ones included.
+ * @return false if the first iteration has not finished yet
+ */
+bool GetEvaluation(AnalysisLine *line);
+
+/**
+ * Get the best move found so far for the side to move, while the hint is on.
+ * @return false if there is no hint to show
+ */
+bool GetHintMove(Move *move);
+
+/**
+ * Check if a piece of the side to move can be won: it is attacked by a
+ * cheaper piece, or attacked and undefended. Only set while the hint is on.
+ */
+bool IsSquareThreatened(int row, int col);
+
+/**
+ * Write a line's score for display ("+0.35", "-1.20", "#3", "#-2").
+ */
+void FormatAnalysisScore(const AnalysisLine *line, char *buffer, size_t size);
+
+#endif // ANALYSIS_H
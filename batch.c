@@ -0,0 +1,268 @@
+/**
+ * Chess Game - Batch Analysis
+ * Searches every position of a FEN/EPD file on a pool of worker threads.
+ *
+ * Workers take lines from the shared input one at a time and search them
+ * independently. Results go into a ring of slots indexed by line number and
+ * are written out as soon as every earlier line is done, so the output keeps
+ * the input order without waiting for the whole file. A worker only takes a
+ * new line while it fits in the ring, which bounds memory however far one
+ * slow position falls behind.
+ */
+
+#include "batch.h"
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// BATCH PARAMETERS
+//==============================================================================
+
+#define BATCH_OUTPUT_LENGTH 512
+#define BATCH_SLOTS_PER_WORKER 4
+
+//==============================================================================
+// BATCH STATE
+//==============================================================================
+
+typedef struct {
+  bool ready;
+  bool analyzed; // false for skipped lines, which write nothing
+  uint64_t nodes;
+  char text[BATCH_OUTPUT_LENGTH];
+} BatchSlot;
+
+// Shared by all workers; every field is guarded by the mutex
+typedef struct {
+  FILE *input;
+  FILE *output;
+  SearchLimits limits;
+  pthread_mutex_t mutex;
+  pthread_cond_t slotFreed;
+  BatchSlot *slots;
+  int slotCount;
+  int64_t nextLine;    // Next line to hand out
+  int64_t nextWritten; // Oldest line not yet written
+  bool endOfInput;
+  BatchSummary summary;
+} BatchRun;
+
+// Everything one worker searches with
+typedef struct {
+  BatchRun *run;
+  TranspositionTable table;
+  Searcher searcher;
+  pthread_t thread;
+} BatchWorker;
+
+//==============================================================================
+// INPUT AND OUTPUT
+//==============================================================================
+
+// Read one line; a line too long for the buffer is consumed and returned
+// empty so it counts as skipped
+static bool ReadBatchLine(FILE *input, char *line, size_t size) {
+  if (fgets(line, (int)size, input) == NULL)
+    return false;
+
+  size_t length = strcspn(line, "\r\n");
+  if (line[length] == '\0' && !feof(input)) {
+    int c;
+    while ((c = fgetc(input)) != EOF && c != '\n') {
+    }
+    length = 0;
+  }
+  line[length] = '\0';
+  return true;
+}
+
+// EPD result line: the position's four FEN fields, then the operations
+static void FormatBatchResult(const char *line, const ChessPosition *root,
+                              const SearchReport *report, char *text,
+                              size_t size) {
+  const SearchLine *best = &report->lines[0];
+  char fen[FEN_MAX_LENGTH];
+  char san[MOVE_NOTATION_LEN];
+  ChessPosition pos = *root;
+
+  // Drop the move counters, which EPD leaves out
+  GetPositionFen(root, fen, sizeof(fen));
+  char *field = fen;
+  for (int i = 0; i < 4 && field != NULL; i++)
+    field = strchr(field + 1, ' ');
+  if (field != NULL)
+    *field = '\0';
+
+  FormatSanMove(&pos, best->pv[0], san);
+  int length = snprintf(text, size, "%s bm %s;", fen, san);
+  if (IsMateScore(best->score))
+    length += snprintf(text + length, size - (size_t)length, " dm %d;",
+                       MateInMoves(best->score));
+  else
+    length += snprintf(text + length, size - (size_t)length, " ce %d;",
+                       best->score);
+  length += snprintf(text + length, size - (size_t)length,
+                     " acd %d; acn %llu; pv", report->depth,
+                     (unsigned long long)report->nodes);
+
+  for (int i = 0; i < best->pvLength && i < BATCH_PV_MOVES; i++) {
+    MoveUndo undo;
+    FormatSanMove(&pos, best->pv[i], san);
+    length += snprintf(text + length, size - (size_t)length, " %s", san);
+    MakeMove(&pos, best->pv[i], &undo);
+  }
+  length += snprintf(text + length, size - (size_t)length, ";");
+
+  char id[64];
+  if (GetEpdOperation(line, "id", id, sizeof(id)))
+    snprintf(text + length, size - (size_t)length, " id \"%s\";", id);
+}
+
+// Write every finished slot from the oldest unwritten line on (mutex held)
+static void WriteReadySlots(BatchRun *run) {
+  bool wrote = false;
+  for (;;) {
+    BatchSlot *slot = &run->slots[run->nextWritten % run->slotCount];
+    if (!slot->ready)
+      break;
+
+    if (slot->analyzed) {
+      fprintf(run->output, "%s\n", slot->text);
+      run->summary.positions++;
+      run->summary.nodes += slot->nodes;
+    } else {
+      run->summary.skipped++;
+    }
+    slot->ready = false;
+    run->nextWritten++;
+    wrote = true;
+  }
+
+  if (wrote) {
+    fflush(run->output);
+    pthread_cond_broadcast(&run->slotFreed);
+  }
+}
+
+//==============================================================================
+// WORKERS
+//==============================================================================
+
+static void AnalyzeBatchLine(BatchWorker *worker, const char *line,
+                             BatchSlot *slot) {
+  ChessPosition pos;
+  SearchReport report;
+
+  slot->analyzed = false;
+  if (line[0] == '\0' || line[0] == '#' || !SetPositionFromFen(&pos, line))
+    return;
+  // Mate or stalemate already: there is nothing to search
+  if (!SearchPosition(&worker->searcher, &pos, NULL, 0, &worker->run->limits,
+                      &report))
+    return;
+
+  FormatBatchResult(line, &pos, &report, slot->text, sizeof(slot->text));
+  slot->nodes = report.nodes;
+  slot->analyzed = true;
+}
+
+static void *BatchWorkerMain(void *arg) {
+  BatchWorker *worker = arg;
+  BatchRun *run = worker->run;
+  char line[BATCH_LINE_LENGTH];
+  BatchSlot result;
+
+  pthread_mutex_lock(&run->mutex);
+  for (;;) {
+    while (!run->endOfInput &&
+           run->nextLine - run->nextWritten >= run->slotCount)
+      pthread_cond_wait(&run->slotFreed, &run->mutex);
+    if (run->endOfInput)
+      break;
+    if (!ReadBatchLine(run->input, line, sizeof(line))) {
+      run->endOfInput = true;
+      pthread_cond_broadcast(&run->slotFreed);
+      break;
+    }
+    int64_t index = run->nextLine++;
+    pthread_mutex_unlock(&run->mutex);
+
+    AnalyzeBatchLine(worker, line, &result);
+
+    pthread_mutex_lock(&run->mutex);
+    result.ready = true;
+    run->slots[index % run->slotCount] = result;
+    WriteReadySlots(run);
+  }
+  pthread_mutex_unlock(&run->mutex);
+  return NULL;
+}
+
+//==============================================================================
+// BATCH INTERFACE
+//==============================================================================
+
+bool AnalyzeFile(const char *path, const BatchOptions *options, FILE *output,
+                 BatchSummary *summary) {
+  memset(summary, 0, sizeof(*summary));
+
+  FILE *input = fopen(path, "r");
+  if (input == NULL)
+    return false;
+
+  int workerCount = options->workers;
+  if (workerCount < 1)
+    workerCount = 1;
+  if (workerCount > SEARCH_MAX_THREADS)
+    workerCount = SEARCH_MAX_THREADS;
+
+  BatchRun run = {0};
+  run.input = input;
+  run.output = output;
+  run.limits = options->limits;
+  if (run.limits.depth == 0 && run.limits.nodes == 0 &&
+      run.limits.moveTime == 0)
+    run.limits.depth = BATCH_DEFAULT_DEPTH;
+  run.limits.infinite = false;
+  run.slotCount = workerCount * BATCH_SLOTS_PER_WORKER;
+  run.slots = calloc((size_t)run.slotCount, sizeof(BatchSlot));
+  BatchWorker *workers = calloc((size_t)workerCount, sizeof(BatchWorker));
+  if (run.slots == NULL || workers == NULL) {
+    free(run.slots);
+    free(workers);
+    fclose(input);
+    return false;
+  }
+  pthread_mutex_init(&run.mutex, NULL);
+  pthread_cond_init(&run.slotFreed, NULL);
+
+  int64_t start = GetTimeMilliseconds();
+  int started = 0;
+  for (int i = 0; i < workerCount; i++) {
+    BatchWorker *worker = &workers[started];
+    worker->run = &run;
+    if (!ResizeTranspositionTable(&worker->table, options->hashMb))
+      break;
+    InitSearcher(&worker->searcher, &worker->table, 1);
+    if (pthread_create(&worker->thread, NULL, BatchWorkerMain, worker) != 0) {
+      FreeTranspositionTable(&worker->table);
+      break;
+    }
+    started++;
+  }
+
+  for (int i = 0; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+    FreeTranspositionTable(&workers[i].table);
+  }
+
+  run.summary.timeMs = GetTimeMilliseconds() - start;
+  *summary = run.summary;
+
+  pthread_cond_destroy(&run.slotFreed);
+  pthread_mutex_destroy(&run.mutex);
+  free(workers);
+  free(run.slots);
+  fclose(input);
+  return started > 0;
+}
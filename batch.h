@@ -0,0 +1,53 @@
+/**
+ * Chess Game - Batch Analysis
+ * Searches every position of a FEN/EPD file on a pool of worker threads.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "search.h"
+#include <stdio.h>
+
+//==============================================================================
+// BATCH CONSTANTS
+//==============================================================================
+
+#define BATCH_DEFAULT_DEPTH 12
+#define BATCH_LINE_LENGTH 1024 // Longest input line; longer ones are skipped
+#define BATCH_PV_MOVES 8       // Moves of the principal variation written out
+
+//==============================================================================
+// BATCH TYPES
+//==============================================================================
+
+typedef struct {
+  SearchLimits limits; // Per position; depth BATCH_DEFAULT_DEPTH if all zero
+  int workers;         // Positions searched at once
+  size_t hashMb;       // Transposition table size of each worker
+} BatchOptions;
+
+typedef struct {
+  int positions; // Lines searched
+  int skipped;   // Blank, comment, malformed or finished-game lines
+  uint64_t nodes;
+  int64_t timeMs;
+} BatchSummary;
+
+//==============================================================================
+// BATCH FUNCTIONS
+//==============================================================================
+
+/**
+ * Analyze every position of a FEN or EPD file. Each worker owns its position,
+ * searcher and transposition table, so nothing is shared but the input and
+ * the output. Results are written as EPD lines in input order while the
+ * batch runs:
+ *   <fen fields> bm Nf3; ce 35; acd 12; acn 182344; pv Nf3 d5 g3; id "x";
+ * (a mate is given as "dm <moves>" instead of "ce"; an input "id" is kept).
+ * @return false if the file could not be opened or no worker could start
+ */
+bool AnalyzeFile(const char *path, const BatchOptions *options, FILE *output,
+                 BatchSummary *summary);
+
+#endif // BATCH_H
@@ -26,11 +26,16 @@ Vector2 dragOffset = {0, 0};
 // Promotion move tracking for history recording
 Position promotionFromPos = {-1, -1};
 bool promotionWasCapture = false;
+ChessPosition promotionBefore;
+BoardUndo promotionUndo;
 
 // Cached king positions for optimization
 Position whiteKingPos = {7, 4};
 Position blackKingPos = {0, 4};
 
+// Winner of a tablebase-adjudicated game, COLOR_NONE for a draw
+PieceColor adjudicatedWinner = COLOR_NONE;
+
 //==============================================================================
 // BOARD INITIALIZATION
 //==============================================================================
@@ -59,6 +64,7 @@ void InitBoard(void) {
   enPassantTarget = INVALID_POS;
   enPassantPawn = INVALID_POS;
   gameState = GAME_PLAYING;
+  adjudicatedWinner = COLOR_NONE;
 
   // Reset drag state
   isDragging = false;
@@ -99,3 +105,47 @@ Position FindKing(PieceColor color) {
   // Return cached position for optimization
   return (color == COLOR_WHITE) ? whiteKingPos : blackKingPos;
 }
+
+//==============================================================================
+// POSITION SNAPSHOT
+//==============================================================================
+
+// A side may still castle with a rook if neither it nor the king has moved
+static bool HasCastlingRook(int row, int rookCol, PieceColor color) {
+  Piece king = board[row][4];
+  Piece rook = board[row][rookCol];
+  return king.type == PIECE_KING && king.color == color && !king.hasMoved &&
+         rook.type == PIECE_ROOK && rook.color == color && !rook.hasMoved;
+}
+
+void LoadPositionFromBoard(ChessPosition *pos) {
+  ClearPosition(pos);
+
+  for (int row = 0; row < BOARD_SIZE; row++) {
+    for (int col = 0; col < BOARD_SIZE; col++) {
+      if (board[row][col].type != PIECE_NONE) {
+        PutPiece(pos, SQ(row, col),
+                 PIECE_CODE(board[row][col].type, board[row][col].color));
+      }
+    }
+  }
+
+  pos->sideToMove = currentTurn;
+
+  if (HasCastlingRook(7, 7, COLOR_WHITE))
+    pos->castlingRights |= CASTLE_WHITE_KINGSIDE;
+  if (HasCastlingRook(7, 0, COLOR_WHITE))
+    pos->castlingRights |= CASTLE_WHITE_QUEENSIDE;
+  if (HasCastlingRook(0, 7, COLOR_BLACK))
+    pos->castlingRights |= CASTLE_BLACK_KINGSIDE;
+  if (HasCastlingRook(0, 0, COLOR_BLACK))
+    pos->castlingRights |= CASTLE_BLACK_QUEENSIDE;
+
+  if (enPassantTarget.row != -1)
+    pos->enPassantSquare = SQ(enPassantTarget.row, enPassantTarget.col);
+
+  // The board does not track the fifty-move counter
+  pos->halfmoveClock = 0;
+  pos->fullmoveNumber = GetMoveCount() / 2 + 1;
+  pos->key = ComputePositionKey(pos);
+}
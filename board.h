@@ -6,6 +6,8 @@
 #ifndef BOARD_H
 #define BOARD_H
 
+#include "history.h"
+#include "position.h"
 #include "types.h"
 
 //==============================================================================
@@ -25,8 +27,11 @@ extern Position dragStartPos;
 extern Vector2 dragOffset;
 extern Position promotionFromPos;
 extern bool promotionWasCapture;
+extern ChessPosition promotionBefore; // Position before the pending promotion
+extern BoardUndo promotionUndo;       // Its undo record, until it is recorded
 extern Position whiteKingPos;
 extern Position blackKingPos;
+extern PieceColor adjudicatedWinner;
 
 //==============================================================================
 // BOARD FUNCTIONS
@@ -63,4 +68,10 @@ bool IsAlly(int row, int col, PieceColor color);
  */
 Position FindKing(PieceColor color);
 
+/**
+ * Snapshot the global board into a self-contained position.
+ * Castling rights are derived from the king and rook hasMoved flags.
+ */
+void LoadPositionFromBoard(ChessPosition *pos);
+
 #endif // BOARD_H
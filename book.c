@@ -0,0 +1,164 @@
+/**
+ * Chess Game - Opening Book
+ * Polyglot .bin opening book lookup over a memory-mapped file.
+ */
+
+#include "book.h"
+#include <time.h>
+
+//==============================================================================
+// GLOBAL STATE DEFINITIONS
+//==============================================================================
+
+OpeningBook openingBook = {0};
+
+//==============================================================================
+// ENTRY DECODING
+//==============================================================================
+
+// Polyglot entries are big-endian: key (8), move (2), weight (2), learn (4)
+
+static uint64_t ReadBigEndian64(const unsigned char *p) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++)
+    value = (value << 8) | p[i];
+  return value;
+}
+
+static int ReadBigEndian16(const unsigned char *p) { return (p[0] << 8) | p[1]; }
+
+static uint64_t EntryKey(const OpeningBook *book, size_t index) {
+  return ReadBigEndian64(book->file.data + index * BOOK_ENTRY_SIZE);
+}
+
+// Polyglot move bits: to file (0-2), to rank (3-5), from file (6-8),
+// from rank (9-11), promotion (12-14: none, knight, bishop, rook, queen).
+// Ranks count from white's side; castling is stored as king takes own rook.
+static Move DecodeBookMove(const ChessPosition *pos, int raw) {
+  static const PieceType PROMOTION[8] = {PIECE_NONE,  PIECE_KNIGHT,
+                                         PIECE_BISHOP, PIECE_ROOK,
+                                         PIECE_QUEEN, PIECE_NONE,
+                                         PIECE_NONE,  PIECE_NONE};
+
+  int toCol = raw & 7;
+  int toRow = 7 - ((raw >> 3) & 7);
+  int fromCol = (raw >> 6) & 7;
+  int fromRow = 7 - ((raw >> 9) & 7);
+  PieceType promotion = PROMOTION[(raw >> 12) & 7];
+
+  int from = SQ(fromRow, fromCol);
+  PieceCode piece = pos->squares[from];
+  if (piece == NO_PIECE || CODE_COLOR(piece) != pos->sideToMove)
+    return MOVE_NONE;
+
+  // King onto its own rook from the e-file: castling
+  if (CODE_TYPE(piece) == PIECE_KING && fromCol == 4 && toRow == fromRow) {
+    if (toCol == 7)
+      toCol = 6;
+    else if (toCol == 0)
+      toCol = 2;
+  }
+
+  return MAKE_MOVE(from, SQ(toRow, toCol), promotion);
+}
+
+//==============================================================================
+// BOOK LOADING
+//==============================================================================
+
+bool OpenBook(OpeningBook *book, const char *path) {
+  CloseBook(book);
+
+  if (!MapFile(&book->file, path, MAP_ACCESS_RANDOM))
+    return false;
+
+  if (book->file.size % BOOK_ENTRY_SIZE != 0) {
+    UnmapFile(&book->file);
+    return false;
+  }
+
+  book->entryCount = book->file.size / BOOK_ENTRY_SIZE;
+  book->rngState = (uint32_t)time(NULL) ^ (uint32_t)(uintptr_t)book;
+  if (book->rngState == 0)
+    book->rngState = 0x9E3779B9u;
+  return true;
+}
+
+void CloseBook(OpeningBook *book) {
+  UnmapFile(&book->file);
+  book->entryCount = 0;
+}
+
+bool IsBookOpen(const OpeningBook *book) { return book->file.data != NULL; }
+
+//==============================================================================
+// BOOK LOOKUP
+//==============================================================================
+
+int FindBookMoves(const OpeningBook *book, const ChessPosition *pos,
+                  Move *moves, int *weights, int maxMoves) {
+  if (!IsBookOpen(book))
+    return 0;
+
+  // Binary search for the first entry with this key (entries are sorted)
+  size_t low = 0;
+  size_t high = book->entryCount;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (EntryKey(book, mid) < pos->key)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  int count = 0;
+  for (size_t i = low; i < book->entryCount && count < maxMoves; i++) {
+    const unsigned char *entry = book->file.data + i * BOOK_ENTRY_SIZE;
+    if (ReadBigEndian64(entry) != pos->key)
+      break;
+
+    Move move = DecodeBookMove(pos, ReadBigEndian16(entry + 8));
+    if (move == MOVE_NONE)
+      continue;
+
+    moves[count] = move;
+    if (weights != NULL)
+      weights[count] = ReadBigEndian16(entry + 10);
+    count++;
+  }
+
+  return count;
+}
+
+// Xorshift32: cheap, allocation-free randomness for move selection
+static uint32_t NextRandom(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+Move PickBookMove(OpeningBook *book, const ChessPosition *pos) {
+  Move moves[BOOK_MAX_CANDIDATES];
+  int weights[BOOK_MAX_CANDIDATES];
+  int count = FindBookMoves(book, pos, moves, weights, BOOK_MAX_CANDIDATES);
+
+  uint32_t totalWeight = 0;
+  for (int i = 0; i < count; i++)
+    totalWeight += (uint32_t)weights[i];
+
+  // Weight zero marks moves the book author never wants played
+  if (totalWeight == 0)
+    return MOVE_NONE;
+
+  uint32_t pick = NextRandom(&book->rngState) % totalWeight;
+  for (int i = 0; i < count; i++) {
+    if (pick < (uint32_t)weights[i])
+      return moves[i];
+    pick -= (uint32_t)weights[i];
+  }
+
+  return MOVE_NONE;
+}
@@ -0,0 +1,72 @@
+/**
+ * Chess Game - Opening Book
+ * Polyglot .bin opening book lookup over a memory-mapped file.
+ */
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "mapfile.h"
+#include "position.h"
+
+//==============================================================================
+// BOOK CONSTANTS
+//==============================================================================
+
+#define BOOK_DEFAULT_PATH "book.bin"
+#define BOOK_ENTRY_SIZE 16
+#define BOOK_MAX_CANDIDATES 64
+
+//==============================================================================
+// BOOK TYPES
+//==============================================================================
+
+typedef struct {
+  MappedFile file;
+  size_t entryCount;
+  uint32_t rngState; // Weighted move selection, seeded when the book opens
+} OpeningBook;
+
+//==============================================================================
+// GLOBAL BOOK (defined in book.c)
+//==============================================================================
+
+extern OpeningBook openingBook;
+
+//==============================================================================
+// BOOK FUNCTIONS
+//==============================================================================
+
+/**
+ * Map a Polyglot book. Entries are never copied; lookups binary-search the
+ * mapping, so even very large books cost no heap memory.
+ * @return false if the file is missing or not a whole number of entries
+ */
+bool OpenBook(OpeningBook *book, const char *path);
+
+/**
+ * Unmap the book. Safe to call on a book that failed to open.
+ */
+void CloseBook(OpeningBook *book);
+
+/**
+ * Check if a book is loaded.
+ */
+bool IsBookOpen(const OpeningBook *book);
+
+/**
+ * Collect the book moves stored for a position, in file order.
+ * @param moves Output moves, decoded into this program's move encoding
+ * @param weights Output Polyglot weights (may be NULL)
+ * @return Number of moves written (at most maxMoves)
+ */
+int FindBookMoves(const OpeningBook *book, const ChessPosition *pos,
+                  Move *moves, int *weights, int maxMoves);
+
+/**
+ * Pick a book move at random, proportionally to the stored weights.
+ * @return MOVE_NONE if the position is not in the book
+ */
+Move PickBookMove(OpeningBook *book, const ChessPosition *pos);
+
+#endif // BOOK_H
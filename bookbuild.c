@@ -0,0 +1,250 @@
+/**
+ * Chess Game - Book Builder
+ * Builds a Polyglot opening book from a PGN collection.
+ */
+
+#include "bookbuild.h"
+#include "book.h"
+#include "extsort.h"
+#include "movegen.h"
+#include "search.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes an encoder writes per ply: the position key, then the Polyglot move
+#define BOOKBUILD_PLY_BYTES 10
+
+_Static_assert(BOOKBUILD_MAX_PLIES * BOOKBUILD_PLY_BYTES <= INGEST_ENCODED_MAX,
+               "BOOKBUILD_MAX_PLIES does not fit the encoder output");
+
+//==============================================================================
+// BUILD STATE
+//==============================================================================
+
+// A move played from a position, with the games it was played in
+typedef struct {
+  uint64_t key;
+  uint32_t games;
+  uint32_t score; // 2 per win and 1 per draw of the side that played it
+  uint16_t move;  // Polyglot encoding
+} BookTuple;
+
+typedef struct {
+  const BookBuildOptions *options;
+  BookBuildSummary *summary;
+  FILE *out;
+  bool failed;
+  ExternalSort sort;
+
+  // Output side: the combined moves of the position being written
+  BookTuple moves[MOVE_LIST_CAPACITY];
+  int moveCount;
+} BookBuild;
+
+//==============================================================================
+// REPLAY (worker threads)
+//==============================================================================
+
+// Polyglot move bits: to file, to rank, from file, from rank, promotion.
+// Castling is stored as the king taking its own rook (see book.c).
+static uint16_t EncodeBookMove(const ChessPosition *pos, Move move) {
+  static const int PROMOTION[7] = {
+      [PIECE_KNIGHT] = 1, [PIECE_BISHOP] = 2, [PIECE_ROOK] = 3,
+      [PIECE_QUEEN] = 4};
+
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  int toCol = SQ_COL(to);
+  if (CODE_TYPE(pos->squares[from]) == PIECE_KING &&
+      abs(toCol - SQ_COL(from)) == 2)
+    toCol = toCol == 6 ? 7 : 0;
+
+  return (uint16_t)(toCol | (7 - SQ_ROW(to)) << 3 | SQ_COL(from) << 6 |
+                    (7 - SQ_ROW(from)) << 9 |
+                    PROMOTION[MOVE_PROMOTION(move)] << 12);
+}
+
+// Replay the opening of a game into (key, move) pairs
+static size_t EncodeBookGame(const PgnGame *game, uint8_t *out,
+                             void *context) {
+  const BookBuild *build = context;
+  if (game->result == PGN_RESULT_NONE)
+    return 0;
+
+  ChessPosition pos = game->start;
+  int plies = game->plyCount < build->options->maxPly
+                  ? game->plyCount
+                  : build->options->maxPly;
+  for (int ply = 0; ply < plies; ply++) {
+    uint16_t move = EncodeBookMove(&pos, game->moves[ply]);
+    memcpy(out, &pos.key, sizeof(pos.key));
+    memcpy(out + sizeof(pos.key), &move, sizeof(move));
+    out += BOOKBUILD_PLY_BYTES;
+
+    MoveUndo undo;
+    MakeMove(&pos, game->moves[ply], &undo);
+  }
+  return (size_t)plies * BOOKBUILD_PLY_BYTES;
+}
+
+//==============================================================================
+// TUPLES
+//==============================================================================
+
+static int CompareTuples(const void *a, const void *b) {
+  const BookTuple *x = a, *y = b;
+  if (x->key != y->key)
+    return x->key < y->key ? -1 : 1;
+  return (int)x->move - (int)y->move;
+}
+
+// Tuples of the same move add up
+static void CombineTuples(void *into, const void *tuple) {
+  BookTuple *sum = into;
+  const BookTuple *add = tuple;
+  sum->games += add->games;
+  sum->score += add->score;
+}
+
+// Gather the pairs of a game in input order (one call at a time)
+static bool CollectBookGame(const PgnGame *game, const uint8_t *encoded,
+                            size_t encodedLength, void *context) {
+  BookBuild *build = context;
+  if (!game->valid || encodedLength == 0)
+    return true;
+  build->summary->gamesUsed++;
+
+  PieceColor mover = game->start.sideToMove;
+  for (size_t offset = 0; offset + BOOKBUILD_PLY_BYTES <= encodedLength;
+       offset += BOOKBUILD_PLY_BYTES) {
+    // Opening positions repeat a lot, so most tuples are combined in
+    // memory before a run is spilled
+    BookTuple *tuple = AddSortRecord(&build->sort);
+    if (tuple == NULL)
+      return false;
+    memset(tuple, 0, sizeof(*tuple));
+    memcpy(&tuple->key, encoded + offset, sizeof(tuple->key));
+    memcpy(&tuple->move, encoded + offset + sizeof(tuple->key),
+           sizeof(tuple->move));
+    tuple->games = 1;
+    if (game->result == PGN_RESULT_DRAW)
+      tuple->score = 1;
+    else if ((game->result == PGN_RESULT_WHITE_WINS) ==
+             (mover == COLOR_WHITE))
+      tuple->score = 2;
+    build->summary->tuples++;
+    mover = OPPONENT_COLOR(mover);
+  }
+  return true;
+}
+
+//==============================================================================
+// OUTPUT
+//==============================================================================
+
+static void WriteBigEndian(unsigned char *p, uint64_t value, int bytes) {
+  for (int i = bytes - 1; i >= 0; i--) {
+    p[i] = (unsigned char)(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+// Write a position's moves, best scored first, with 16-bit weights
+static void WritePosition(BookBuild *build) {
+  uint32_t maxScore = 0;
+  for (int i = 0; i < build->moveCount; i++) {
+    if (build->moves[i].score > maxScore)
+      maxScore = build->moves[i].score;
+  }
+
+  bool any = false;
+  for (int i = 0; i < build->moveCount && !build->failed; i++) {
+    int best = i;
+    for (int m = i + 1; m < build->moveCount; m++) {
+      if (build->moves[m].score > build->moves[best].score)
+        best = m;
+    }
+    BookTuple tuple = build->moves[best];
+    build->moves[best] = build->moves[i];
+    if (tuple.score == 0)
+      break;
+
+    uint64_t weight = tuple.score;
+    if (maxScore > UINT16_MAX) {
+      weight = weight * UINT16_MAX / maxScore;
+      weight = weight > 0 ? weight : 1;
+    }
+    unsigned char entry[BOOK_ENTRY_SIZE] = {0};
+    WriteBigEndian(entry, tuple.key, 8);
+    WriteBigEndian(entry + 8, tuple.move, 2);
+    WriteBigEndian(entry + 10, weight, 2);
+    if (fwrite(entry, sizeof(entry), 1, build->out) != 1)
+      build->failed = true;
+    build->summary->entries++;
+    any = true;
+  }
+  if (any)
+    build->summary->positions++;
+  build->moveCount = 0;
+}
+
+// Take the combined tuples in sorted order, a position's moves together
+static bool OutputTuple(const void *record, void *context) {
+  BookBuild *build = context;
+  const BookTuple *tuple = record;
+  if (build->moveCount > 0 && build->moves[0].key != tuple->key)
+    WritePosition(build);
+  if (tuple->games >= build->options->minGames &&
+      build->moveCount < MOVE_LIST_CAPACITY)
+    build->moves[build->moveCount++] = *tuple;
+  return !build->failed;
+}
+
+//==============================================================================
+// BUILDING
+//==============================================================================
+
+bool BuildBookFromPgn(const char *pgnPath, const char *bookPath,
+                      const BookBuildOptions *options,
+                      BookBuildSummary *summary) {
+  memset(summary, 0, sizeof(*summary));
+  BookBuildOptions settings = *options;
+  if (settings.maxPly > BOOKBUILD_MAX_PLIES)
+    settings.maxPly = BOOKBUILD_MAX_PLIES;
+
+  BookBuild build = {0};
+  build.options = &settings;
+  build.summary = summary;
+  bool sorting = InitExternalSort(
+      &build.sort, sizeof(BookTuple),
+      (settings.memoryMb > 0 ? settings.memoryMb : 1) * 1048576, CompareTuples,
+      CombineTuples);
+  int64_t start = GetTimeMilliseconds();
+
+  IngestOptions ingest = {0};
+  ingest.workers = settings.workers;
+  ingest.encoder = EncodeBookGame;
+  ingest.sink = CollectBookGame;
+  ingest.context = &build;
+  bool built = sorting &&
+               IngestPgnFile(pgnPath, &ingest, &summary->ingest) &&
+               !summary->ingest.stopped;
+  if (built)
+    build.out = fopen(bookPath, "wb");
+  built = built && build.out != NULL &&
+          FinishExternalSort(&build.sort, OutputTuple, &build,
+                             &summary->runs);
+  FreeExternalSort(&build.sort);
+  if (built && build.moveCount > 0)
+    WritePosition(&build);
+
+  built = built && !build.failed;
+  if (build.out != NULL && fclose(build.out) != 0)
+    built = false;
+  if (!built && build.out != NULL)
+    remove(bookPath);
+
+  summary->runs = summary->runs > 0 ? summary->runs : 1;
+  summary->timeMs = GetTimeMilliseconds() - start;
+  return built;
+}
@@ -0,0 +1,66 @@
+/**
+ * Chess Game - Book Builder
+ * Builds a Polyglot opening book from a PGN collection.
+ *
+ * The games are replayed on the ingestion workers, each turning its games
+ * into (position key, move) pairs. The pairs are gathered with the game's
+ * result as (key, move, games, score) tuples, where a win scores 2 and a
+ * draw 1 for the side that played the move. The tuples are sorted and
+ * combined in a buffer of bounded size and spilled to temporary files when
+ * it stays full, and the runs are merged into the book, so the whole tuple
+ * set never has to fit in memory.
+ */
+
+#ifndef BOOKBUILD_H
+#define BOOKBUILD_H
+
+#include "ingest.h"
+#include <stdint.h>
+
+//==============================================================================
+// BOOK BUILDER CONSTANTS
+//==============================================================================
+
+#define BOOKBUILD_DEFAULT_PLIES 30
+#define BOOKBUILD_MAX_PLIES 200 // Limited by the bytes an encoder may write
+#define BOOKBUILD_DEFAULT_MIN_GAMES 3
+#define BOOKBUILD_DEFAULT_MEMORY_MB 256
+
+//==============================================================================
+// BOOK BUILDER TYPES
+//==============================================================================
+
+typedef struct {
+  int workers;       // Ingestion workers replaying the games
+  int maxPly;        // Moves after this ply are left out
+  uint32_t minGames; // Moves played in fewer games are left out
+  size_t memoryMb;   // Tuples held in memory before a run is spilled
+} BookBuildOptions;
+
+typedef struct {
+  IngestSummary ingest;
+  uint64_t gamesUsed; // Valid games with a decisive or drawn result
+  uint64_t tuples;    // Moves collected from them
+  uint64_t positions; // Positions in the book
+  uint64_t entries;   // Moves in the book
+  int runs;           // Sorted runs merged
+  int64_t timeMs;
+} BookBuildSummary;
+
+//==============================================================================
+// BOOK BUILDER FUNCTIONS
+//==============================================================================
+
+/**
+ * Write a Polyglot book of the moves played in a PGN file. Each position's
+ * moves are written most successful first, weighted by their score (scaled
+ * down to 16 bits when needed); moves that never scored are left out, as
+ * are games without a result.
+ * @return false if the file could not be read, memory ran out or a write
+ * failed
+ */
+bool BuildBookFromPgn(const char *pgnPath, const char *bookPath,
+                      const BookBuildOptions *options,
+                      BookBuildSummary *summary);
+
+#endif // BOOKBUILD_H
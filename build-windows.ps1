@@ -126,7 +126,9 @@ Write-Host ""
 # -----------------------------------------------------------------------------
 Write-Host "[*] Building chess.exe..." -ForegroundColor Yellow
 
-$Sources = @("main", "board", "moves", "check", "ui", "menu", "history", "constants", "clock", "network", "multiplayer")
+$Sources = @("main", "board", "moves", "check", "ui", "menu", "history", "constants", "clock", "network", "multiplayer",
+             "position", "zobrist", "mapfile", "book", "movegen", "tbprobe",
+             "eval", "evaltables", "tt", "search", "analysis", "pgn", "explorer", "journal", "variation")
 $Objects = @()
 
 foreach ($src in $Sources) {
@@ -6,6 +6,8 @@
 #include "check.h"
 #include "board.h"
 #include "moves.h"
+#include "multiplayer.h"
+#include "tbprobe.h"
 
 //==============================================================================
 // ATTACK DETECTION
@@ -180,6 +182,48 @@ bool HasLegalMoves(PieceColor color) {
   return false;
 }
 
+// Set while the tables of the current position are still being mapped
+static bool adjudicationPending = false;
+
+// End the game early once the tablebases know the result. Skipped online,
+// where both players may not have the same tables.
+static void AdjudicateWithTablebases(void) {
+  adjudicationPending = false;
+  if (isMultiplayerGame || GetTablebaseMaxPieces() == 0)
+    return;
+
+  ChessPosition pos;
+  TablebaseWdl wdl;
+  LoadPositionFromBoard(&pos);
+
+  // Map the tables from one capture away, off the frame; probe once they
+  // are in, from UpdateAdjudication
+  if (CountPieces(&pos) <= GetTablebaseMaxPieces() + 1)
+    PrefetchTablebases(&pos);
+  if (!CanProbeTablebases(&pos))
+    return;
+  if (!AreTablebasesReady(&pos)) {
+    adjudicationPending = true;
+    return;
+  }
+  if (!ProbeWdl(&pos, &wdl))
+    return;
+
+  // The game has no fifty-move rule, so cursed wins and blessed losses are
+  // still decided over the board
+  if (wdl == TB_WIN) {
+    adjudicatedWinner = currentTurn;
+  } else if (wdl == TB_LOSS) {
+    adjudicatedWinner = OPPONENT_COLOR(currentTurn);
+  } else if (wdl == TB_DRAW) {
+    adjudicatedWinner = COLOR_NONE;
+  } else {
+    return;
+  }
+
+  gameState = GAME_ADJUDICATED;
+}
+
 void UpdateGameState(void) {
   bool inCheck = IsInCheck(currentTurn);
   bool hasLegalMoves = HasLegalMoves(currentTurn);
@@ -188,5 +232,17 @@ void UpdateGameState(void) {
     gameState = inCheck ? GAME_CHECKMATE : GAME_STALEMATE;
   } else {
     gameState = inCheck ? GAME_CHECK : GAME_PLAYING;
+    AdjudicateWithTablebases();
   }
 }
+
+void UpdateAdjudication(void) {
+  if (adjudicationPending &&
+      (gameState == GAME_PLAYING || gameState == GAME_CHECK))
+    AdjudicateWithTablebases();
+}
+
+bool IsGameOver(void) {
+  return gameState == GAME_CHECKMATE || gameState == GAME_STALEMATE ||
+         gameState == GAME_TIMEOUT || gameState == GAME_ADJUDICATED;
+}
@@ -35,4 +35,16 @@ bool HasLegalMoves(PieceColor color);
  */
 void UpdateGameState(void);
 
+/**
+ * Finish a tablebase adjudication that was waiting for its tables to be
+ * mapped. Called every frame while the game is on.
+ */
+void UpdateAdjudication(void);
+
+/**
+ * Check if the game has ended (checkmate, stalemate, timeout or
+ * tablebase adjudication).
+ */
+bool IsGameOver(void);
+
 #endif // CHECK_H
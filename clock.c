@@ -4,7 +4,9 @@
  */
 
 #include "clock.h"
+#ifndef CHESS_HEADLESS
 #include "raylib.h"
+#endif
 #include <stdio.h>
 
 //==============================================================================
@@ -27,43 +29,35 @@ void InitClockConfig(void) {
 }
 
 //==============================================================================
-// CLOCK INITIALIZATION
+// CLOCK MECHANICS
 //==============================================================================
 
-void InitClock(void) {
-  float baseTime =
-      (float)(clockConfig.baseMinutes * 60 + clockConfig.baseSeconds);
-
-  gameClock.type = clockConfig.selectedType;
-  gameClock.baseTimeSeconds = baseTime;
-  gameClock.incrementSeconds = (float)clockConfig.incrementSeconds;
-  gameClock.whiteTimeRemaining = baseTime;
-  gameClock.blackTimeRemaining = baseTime;
-  gameClock.delayRemaining = 0.0f;
-  gameClock.moveStartTime = 0.0f;
-  gameClock.isRunning = false;
-  gameClock.whiteFlagged = false;
-  gameClock.blackFlagged = false;
+void SetupClock(ChessClock *clock, ClockType type, float baseSeconds,
+                float incrementSeconds) {
+  clock->type = type;
+  clock->baseTimeSeconds = baseSeconds;
+  clock->incrementSeconds = incrementSeconds;
+  clock->whiteTimeRemaining = baseSeconds;
+  clock->blackTimeRemaining = baseSeconds;
+  clock->delayRemaining = 0.0f;
+  clock->moveStartTime = 0.0f;
+  clock->isRunning = false;
+  clock->whiteFlagged = false;
+  clock->blackFlagged = false;
 }
 
-//==============================================================================
-// CLOCK UPDATE
-//==============================================================================
-
-void UpdateClock(PieceColor currentTurn) {
-  if (!gameClock.isRunning || gameClock.type == CLOCK_NONE) {
+void AdvanceClock(ChessClock *clock, PieceColor currentTurn, float dt) {
+  if (!clock->isRunning || clock->type == CLOCK_NONE) {
     return;
   }
 
-  float dt = GetFrameTime();
-
   // Handle delay-based clocks
-  if (gameClock.type == CLOCK_SIMPLE_DELAY && gameClock.delayRemaining > 0) {
-    gameClock.delayRemaining -= dt;
-    if (gameClock.delayRemaining < 0) {
+  if (clock->type == CLOCK_SIMPLE_DELAY && clock->delayRemaining > 0) {
+    clock->delayRemaining -= dt;
+    if (clock->delayRemaining < 0) {
       // Delay exhausted, start counting from main time
-      dt = -gameClock.delayRemaining;
-      gameClock.delayRemaining = 0;
+      dt = -clock->delayRemaining;
+      clock->delayRemaining = 0;
     } else {
       // Still in delay period, don't decrement main time
       return;
@@ -72,70 +66,62 @@ void UpdateClock(PieceColor currentTurn) {
 
   // Decrement active player's time
   if (currentTurn == COLOR_WHITE) {
-    gameClock.whiteTimeRemaining -= dt;
-    if (gameClock.whiteTimeRemaining <= 0) {
-      gameClock.whiteTimeRemaining = 0;
-      gameClock.whiteFlagged = true;
-      gameClock.isRunning = false;
+    clock->whiteTimeRemaining -= dt;
+    if (clock->whiteTimeRemaining <= 0) {
+      clock->whiteTimeRemaining = 0;
+      clock->whiteFlagged = true;
+      clock->isRunning = false;
     }
   } else if (currentTurn == COLOR_BLACK) {
-    gameClock.blackTimeRemaining -= dt;
-    if (gameClock.blackTimeRemaining <= 0) {
-      gameClock.blackTimeRemaining = 0;
-      gameClock.blackFlagged = true;
-      gameClock.isRunning = false;
+    clock->blackTimeRemaining -= dt;
+    if (clock->blackTimeRemaining <= 0) {
+      clock->blackTimeRemaining = 0;
+      clock->blackFlagged = true;
+      clock->isRunning = false;
     }
   }
 }
 
-//==============================================================================
-// CLOCK SWITCH (after move)
-//==============================================================================
-
-void SwitchClock(PieceColor playerWhoMoved) {
-  if (gameClock.type == CLOCK_NONE) {
-    return;
-  }
-
-  switch (gameClock.type) {
+void PressClock(ChessClock *clock, PieceColor playerWhoMoved) {
+  switch (clock->type) {
   case CLOCK_FISCHER:
     // Add increment to player who just moved
     if (playerWhoMoved == COLOR_WHITE) {
-      gameClock.whiteTimeRemaining += gameClock.incrementSeconds;
+      clock->whiteTimeRemaining += clock->incrementSeconds;
     } else {
-      gameClock.blackTimeRemaining += gameClock.incrementSeconds;
+      clock->blackTimeRemaining += clock->incrementSeconds;
     }
     break;
 
   case CLOCK_SIMPLE_DELAY:
     // Reset delay for the next player
-    gameClock.delayRemaining = gameClock.incrementSeconds;
+    clock->delayRemaining = clock->incrementSeconds;
     break;
 
   case CLOCK_BRONSTEIN: {
     // Add back time used, up to the delay amount
     float currentTime = (playerWhoMoved == COLOR_WHITE)
-                            ? gameClock.whiteTimeRemaining
-                            : gameClock.blackTimeRemaining;
-    float timeUsed = gameClock.moveStartTime - currentTime;
+                            ? clock->whiteTimeRemaining
+                            : clock->blackTimeRemaining;
+    float timeUsed = clock->moveStartTime - currentTime;
 
     // Clamp to increment amount (can't add more than delay)
-    float timeToAdd = (timeUsed > gameClock.incrementSeconds)
-                          ? gameClock.incrementSeconds
+    float timeToAdd = (timeUsed > clock->incrementSeconds)
+                          ? clock->incrementSeconds
                           : timeUsed;
     if (timeToAdd < 0)
       timeToAdd = 0;
 
     if (playerWhoMoved == COLOR_WHITE) {
-      gameClock.whiteTimeRemaining += timeToAdd;
+      clock->whiteTimeRemaining += timeToAdd;
     } else {
-      gameClock.blackTimeRemaining += timeToAdd;
+      clock->blackTimeRemaining += timeToAdd;
     }
 
     // Store opponent's current time for next move's Bronstein calculation
-    gameClock.moveStartTime = (playerWhoMoved == COLOR_WHITE)
-                                  ? gameClock.blackTimeRemaining
-                                  : gameClock.whiteTimeRemaining;
+    clock->moveStartTime = (playerWhoMoved == COLOR_WHITE)
+                               ? clock->blackTimeRemaining
+                               : clock->whiteTimeRemaining;
     break;
   }
 
@@ -147,20 +133,82 @@ void SwitchClock(PieceColor playerWhoMoved) {
   }
 }
 
-//==============================================================================
-// TIMEOUT CHECK
-//==============================================================================
+void StartClockTurn(ChessClock *clock, PieceColor toMove) {
+  if (clock->type == CLOCK_SIMPLE_DELAY) {
+    clock->delayRemaining = clock->incrementSeconds;
+  } else if (clock->type == CLOCK_BRONSTEIN) {
+    clock->moveStartTime = GetClockTime(clock, toMove);
+  }
+}
+
+void RunClock(ChessClock *clock) {
+  if (clock->type != CLOCK_NONE) {
+    clock->isRunning = true;
 
-PieceColor CheckTimeout(void) {
-  if (gameClock.whiteFlagged) {
+    // Initialize delay for delay-based clocks
+    if (clock->type == CLOCK_SIMPLE_DELAY) {
+      clock->delayRemaining = clock->incrementSeconds;
+    }
+
+    // Initialize move start time for Bronstein
+    if (clock->type == CLOCK_BRONSTEIN) {
+      clock->moveStartTime = clock->whiteTimeRemaining;
+    }
+  }
+}
+
+PieceColor GetFlaggedPlayer(const ChessClock *clock) {
+  if (clock->whiteFlagged) {
     return COLOR_WHITE;
   }
-  if (gameClock.blackFlagged) {
+  if (clock->blackFlagged) {
     return COLOR_BLACK;
   }
   return COLOR_NONE;
 }
 
+float GetClockTime(const ChessClock *clock, PieceColor color) {
+  if (color == COLOR_WHITE) {
+    return clock->whiteTimeRemaining;
+  } else if (color == COLOR_BLACK) {
+    return clock->blackTimeRemaining;
+  }
+  return 0.0f;
+}
+
+//==============================================================================
+// GAME CLOCK
+//==============================================================================
+
+void InitClock(void) {
+  float baseTime =
+      (float)(clockConfig.baseMinutes * 60 + clockConfig.baseSeconds);
+  SetupClock(&gameClock, clockConfig.selectedType, baseTime,
+             (float)clockConfig.incrementSeconds);
+}
+
+#ifndef CHESS_HEADLESS
+void UpdateClock(PieceColor currentTurn) {
+  AdvanceClock(&gameClock, currentTurn, GetFrameTime());
+}
+#endif
+
+void SwitchClock(PieceColor playerWhoMoved) {
+  PressClock(&gameClock, playerWhoMoved);
+}
+
+PieceColor CheckTimeout(void) { return GetFlaggedPlayer(&gameClock); }
+
+void StartClock(void) { RunClock(&gameClock); }
+
+void StopClock(void) { gameClock.isRunning = false; }
+
+bool IsClockEnabled(void) { return gameClock.type != CLOCK_NONE; }
+
+float GetPlayerTime(PieceColor color) {
+  return GetClockTime(&gameClock, color);
+}
+
 //==============================================================================
 // TIME FORMATTING
 //==============================================================================
@@ -182,36 +230,3 @@ void FormatTime(float seconds, char *buffer) {
     sprintf(buffer, "%d:%02d", mins, secs);
   }
 }
-
-//==============================================================================
-// CLOCK CONTROL
-//==============================================================================
-
-void StartClock(void) {
-  if (gameClock.type != CLOCK_NONE) {
-    gameClock.isRunning = true;
-
-    // Initialize delay for delay-based clocks
-    if (gameClock.type == CLOCK_SIMPLE_DELAY) {
-      gameClock.delayRemaining = gameClock.incrementSeconds;
-    }
-
-    // Initialize move start time for Bronstein
-    if (gameClock.type == CLOCK_BRONSTEIN) {
-      gameClock.moveStartTime = gameClock.whiteTimeRemaining;
-    }
-  }
-}
-
-void StopClock(void) { gameClock.isRunning = false; }
-
-bool IsClockEnabled(void) { return gameClock.type != CLOCK_NONE; }
-
-float GetPlayerTime(PieceColor color) {
-  if (color == COLOR_WHITE) {
-    return gameClock.whiteTimeRemaining;
-  } else if (color == COLOR_BLACK) {
-    return gameClock.blackTimeRemaining;
-  }
-  return 0.0f;
-}
@@ -56,6 +56,53 @@ typedef struct {
 extern ChessClock gameClock;
 extern ClockConfig clockConfig;
 
+//==============================================================================
+// CLOCK MECHANICS
+//==============================================================================
+// These work on any clock, so several games can keep time at once (e.g.
+// engine matches driving the clock with measured thinking time).
+
+/**
+ * Reset a clock to its starting time, not yet running.
+ */
+void SetupClock(ChessClock *clock, ClockType type, float baseSeconds,
+                float incrementSeconds);
+
+/**
+ * Let time pass on the clock of the player to move.
+ * @param dt Elapsed time in seconds
+ */
+void AdvanceClock(ChessClock *clock, PieceColor currentTurn, float dt);
+
+/**
+ * Apply the increment/delay after a move.
+ * @param playerWhoMoved The color that just completed their move
+ */
+void PressClock(ChessClock *clock, PieceColor playerWhoMoved);
+
+/**
+ * Begin a player's turn without a move by the other, e.g. after switching
+ * to another line: the delay starts over and Bronstein counts from the
+ * player's current time. No increment is added.
+ */
+void StartClockTurn(ChessClock *clock, PieceColor toMove);
+
+/**
+ * Start a clock running.
+ */
+void RunClock(ChessClock *clock);
+
+/**
+ * Check if a player has run out of time on a clock.
+ * @return The flagged color, or COLOR_NONE
+ */
+PieceColor GetFlaggedPlayer(const ChessClock *clock);
+
+/**
+ * Get remaining time on a clock in seconds.
+ */
+float GetClockTime(const ChessClock *clock, PieceColor color);
+
 //==============================================================================
 // CLOCK FUNCTIONS
 //==============================================================================
@@ -71,12 +118,14 @@ void InitClockConfig(void);
  */
 void InitClock(void);
 
+#ifndef CHESS_HEADLESS
 /**
  * Update the clock each frame.
  * Decrements active player's time based on delta time.
  * @param currentTurn The color whose clock should be running
  */
 void UpdateClock(PieceColor currentTurn);
+#endif
 
 /**
  * Switch the clock after a move is made.
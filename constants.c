@@ -15,6 +15,11 @@ const Color COLOR_SELECTED = {255, 255, 0, 100};
 const Color COLOR_CHECK_HIGHLIGHT = {255, 0, 0, 150};
 const Color COLOR_VALID_MOVE = {0, 255, 0, 80};
 const Color COLOR_CAPTURE = {255, 0, 0, 80};
+const Color COLOR_HINT_ARROW = {0, 160, 255, 170};
+const Color COLOR_THREAT = {255, 120, 0, 200};
+const Color COLOR_REVIEW_MOVE = {200, 160, 40, 120};
+const Color COLOR_EVAL_WHITE = {235, 235, 235, 255};
+const Color COLOR_EVAL_BLACK = {20, 20, 20, 255};
 const Color COLOR_BACKGROUND = {40, 40, 40, 255};
 const Color COLOR_OVERLAY_DARK = {0, 0, 0, 150};
 const Color COLOR_OVERLAY_DARKER = {0, 0, 0, 180};
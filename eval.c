@@ -0,0 +1,50 @@
+/**
+ * Chess Game - Evaluation
+ * Static evaluation of a ChessPosition for the search.
+ */
+
+#include "eval.h"
+
+//==============================================================================
+// EVALUATION
+//==============================================================================
+
+static const int PHASE_WEIGHTS[7] = {0,            0,           PHASE_QUEEN,
+                                     PHASE_BISHOP, PHASE_KNIGHT, PHASE_ROOK,
+                                     0};
+
+int GamePhase(const ChessPosition *pos) {
+  int phase = 0;
+  for (int type = PIECE_QUEEN; type <= PIECE_ROOK; type++) {
+    phase += PHASE_WEIGHTS[type] * (pos->pieceCount[COLOR_WHITE][type] +
+                                    pos->pieceCount[COLOR_BLACK][type]);
+  }
+  return phase < PHASE_TOTAL ? phase : PHASE_TOTAL;
+}
+
+int Evaluate(const ChessPosition *pos) {
+  int score[2] = {0, 0}; // Middlegame, endgame; white minus black
+
+  for (int sq = 0; sq < SQUARE_COUNT; sq++) {
+    PieceCode code = pos->squares[sq];
+    if (code == NO_PIECE)
+      continue;
+
+    PieceType type = CODE_TYPE(code);
+    bool white = CODE_COLOR(code) == COLOR_WHITE;
+    int tableSq = white ? sq : sq ^ 56; // Mirror ranks for black
+
+    for (int stage = EVAL_MIDGAME; stage <= EVAL_ENDGAME; stage++) {
+      int value = PIECE_VALUES[stage][type] +
+                  PIECE_SQUARE_TABLES[stage][type][tableSq];
+      score[stage] += white ? value : -value;
+    }
+  }
+
+  int phase = GamePhase(pos);
+  int blended = (score[EVAL_MIDGAME] * phase +
+                 score[EVAL_ENDGAME] * (PHASE_TOTAL - phase)) /
+                PHASE_TOTAL;
+
+  return (pos->sideToMove == COLOR_WHITE) ? blended : -blended;
+}
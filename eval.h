@@ -0,0 +1,50 @@
+/**
+ * Chess Game - Evaluation
+ * Static evaluation of a ChessPosition for the search.
+ */
+
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "position.h"
+
+//==============================================================================
+// EVALUATION CONSTANTS
+//==============================================================================
+
+// Game phase weights: the full phase is reached with all minor and major
+// pieces on the board
+#define PHASE_KNIGHT 1
+#define PHASE_BISHOP 1
+#define PHASE_ROOK 2
+#define PHASE_QUEEN 4
+#define PHASE_TOTAL 24
+
+#define EVAL_MIDGAME 0
+#define EVAL_ENDGAME 1
+
+//==============================================================================
+// EVALUATION TABLES (defined in evaltables.c)
+//==============================================================================
+
+// Piece values and piece-square tables per phase, indexed by PieceType.
+// Tables are laid out from white's side: index 0 is a8, 63 is h1.
+extern const int PIECE_VALUES[2][7];
+extern const int PIECE_SQUARE_TABLES[2][7][SQUARE_COUNT];
+
+//==============================================================================
+// EVALUATION FUNCTIONS
+//==============================================================================
+
+/**
+ * Evaluate a position in centipawns from the side to move's point of view,
+ * tapering between middlegame and endgame tables by the material left.
+ */
+int Evaluate(const ChessPosition *pos);
+
+/**
+ * Game phase from PHASE_TOTAL (opening) down to 0 (pawn endgame).
+ */
+int GamePhase(const ChessPosition *pos);
+
+#endif // EVAL_H
@@ -0,0 +1,147 @@
+/**
+ * Chess Game - Evaluation Tables
+ * Material values and piece-square tables used by eval.c.
+ *
+ * Generated by the tuner ("chess-uci tune", see tune.c). Hand edits are
+ * fine as a starting point for the next tuning run.
+ */
+
+#include "eval.h"
+
+const int PIECE_VALUES[2][7] = {
+    // None, King, Queen, Bishop, Knight, Rook, Pawn
+    {0, 0, 900, 330, 320, 500, 100},
+    {0, 0, 940, 340, 300, 530, 120},
+};
+
+// Indexed [phase][PieceType][square] from white's side: a8 first, h1 last
+// clang-format off
+const int PIECE_SQUARE_TABLES[2][7][SQUARE_COUNT] = {
+  { // Middlegame
+    {0}, // None
+    { // King
+       -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+       -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+       -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+       -30,  -40,  -40,  -50,  -50,  -40,  -40,  -30,
+       -20,  -30,  -30,  -40,  -40,  -30,  -30,  -20,
+       -10,  -20,  -20,  -20,  -20,  -20,  -20,  -10,
+        20,   20,    0,    0,    0,    0,   20,   20,
+        20,   30,   10,    0,    0,   10,   30,   20,
+    },
+    { // Queen
+       -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+       -10,    0,    0,    0,    0,    0,    0,  -10,
+       -10,    0,    5,    5,    5,    5,    0,  -10,
+        -5,    0,    5,    5,    5,    5,    0,   -5,
+         0,    0,    5,    5,    5,    5,    0,   -5,
+       -10,    5,    5,    5,    5,    5,    0,  -10,
+       -10,    0,    5,    0,    0,    0,    0,  -10,
+       -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+    },
+    { // Bishop
+       -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+       -10,    0,    0,    0,    0,    0,    0,  -10,
+       -10,    0,    5,   10,   10,    5,    0,  -10,
+       -10,    5,    5,   10,   10,    5,    5,  -10,
+       -10,    0,   10,   10,   10,   10,    0,  -10,
+       -10,   10,   10,   10,   10,   10,   10,  -10,
+       -10,    5,    0,    0,    0,    0,    5,  -10,
+       -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+    },
+    { // Knight
+       -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+       -40,  -20,    0,    0,    0,    0,  -20,  -40,
+       -30,    0,   10,   15,   15,   10,    0,  -30,
+       -30,    5,   15,   20,   20,   15,    5,  -30,
+       -30,    0,   15,   20,   20,   15,    0,  -30,
+       -30,    5,   10,   15,   15,   10,    5,  -30,
+       -40,  -20,    0,    5,    5,    0,  -20,  -40,
+       -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+    },
+    { // Rook
+         0,    0,    0,    0,    0,    0,    0,    0,
+         5,   10,   10,   10,   10,   10,   10,    5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+         0,    0,    0,    5,    5,    0,    0,    0,
+    },
+    { // Pawn
+         0,    0,    0,    0,    0,    0,    0,    0,
+        50,   50,   50,   50,   50,   50,   50,   50,
+        10,   10,   20,   30,   30,   20,   10,   10,
+         5,    5,   10,   25,   25,   10,    5,    5,
+         0,    0,    0,   20,   20,    0,    0,    0,
+         5,   -5,  -10,    0,    0,  -10,   -5,    5,
+         5,   10,   10,  -20,  -20,   10,   10,    5,
+         0,    0,    0,    0,    0,    0,    0,    0,
+    },
+  },
+  { // Endgame
+    {0}, // None
+    { // King
+       -50,  -40,  -30,  -20,  -20,  -30,  -40,  -50,
+       -30,  -20,  -10,    0,    0,  -10,  -20,  -30,
+       -30,  -10,   20,   30,   30,   20,  -10,  -30,
+       -30,  -10,   30,   40,   40,   30,  -10,  -30,
+       -30,  -10,   30,   40,   40,   30,  -10,  -30,
+       -30,  -10,   20,   30,   30,   20,  -10,  -30,
+       -30,  -30,    0,    0,    0,    0,  -30,  -30,
+       -50,  -30,  -30,  -30,  -30,  -30,  -30,  -50,
+    },
+    { // Queen
+       -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+       -10,    0,    0,    0,    0,    0,    0,  -10,
+       -10,    0,    5,    5,    5,    5,    0,  -10,
+        -5,    0,    5,    5,    5,    5,    0,   -5,
+         0,    0,    5,    5,    5,    5,    0,   -5,
+       -10,    5,    5,    5,    5,    5,    0,  -10,
+       -10,    0,    5,    0,    0,    0,    0,  -10,
+       -20,  -10,  -10,   -5,   -5,  -10,  -10,  -20,
+    },
+    { // Bishop
+       -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+       -10,    0,    0,    0,    0,    0,    0,  -10,
+       -10,    0,    5,   10,   10,    5,    0,  -10,
+       -10,    5,    5,   10,   10,    5,    5,  -10,
+       -10,    0,   10,   10,   10,   10,    0,  -10,
+       -10,   10,   10,   10,   10,   10,   10,  -10,
+       -10,    5,    0,    0,    0,    0,    5,  -10,
+       -20,  -10,  -10,  -10,  -10,  -10,  -10,  -20,
+    },
+    { // Knight
+       -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+       -40,  -20,    0,    0,    0,    0,  -20,  -40,
+       -30,    0,   10,   15,   15,   10,    0,  -30,
+       -30,    5,   15,   20,   20,   15,    5,  -30,
+       -30,    0,   15,   20,   20,   15,    0,  -30,
+       -30,    5,   10,   15,   15,   10,    5,  -30,
+       -40,  -20,    0,    5,    5,    0,  -20,  -40,
+       -50,  -40,  -30,  -30,  -30,  -30,  -40,  -50,
+    },
+    { // Rook
+         0,    0,    0,    0,    0,    0,    0,    0,
+         5,   10,   10,   10,   10,   10,   10,    5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+        -5,    0,    0,    0,    0,    0,    0,   -5,
+         0,    0,    0,    5,    5,    0,    0,    0,
+    },
+    { // Pawn
+         0,    0,    0,    0,    0,    0,    0,    0,
+        50,   50,   50,   50,   50,   50,   50,   50,
+        10,   10,   20,   30,   30,   20,   10,   10,
+         5,    5,   10,   25,   25,   10,    5,    5,
+         0,    0,    0,   20,   20,    0,    0,    0,
+         5,   -5,  -10,    0,    0,  -10,   -5,    5,
+         5,   10,   10,  -20,  -20,   10,   10,    5,
+         0,    0,    0,    0,    0,    0,    0,    0,
+    },
+  },
+};
+// clang-format on
@@ -0,0 +1,206 @@
+/**
+ * Chess Game - Opening Explorer
+ * Move statistics per position over a memory-mapped file.
+ */
+
+#include "explorer.h"
+#include "search.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The structures are the file format; they must have no padding
+_Static_assert(sizeof(ExplorerHeader) == 24, "ExplorerHeader layout");
+_Static_assert(sizeof(ExplorerEntry) == 32, "ExplorerEntry layout");
+
+OpeningExplorer openingExplorer = {0};
+
+//==============================================================================
+// BUILDING
+//==============================================================================
+
+// Moves of one position while its records are read
+typedef struct {
+  ExplorerEntry entries[MOVE_LIST_CAPACITY];
+  uint64_t eloSums[MOVE_LIST_CAPACITY];
+  uint32_t eloCounts[MOVE_LIST_CAPACITY];
+  int count;
+} ExplorerTally;
+
+static void TallyRecord(ExplorerTally *tally, const PosIndexRecord *record,
+                        const GameDbEntry *game) {
+  int m = 0;
+  while (m < tally->count && tally->entries[m].move != record->next)
+    m++;
+  if (m == tally->count) {
+    if (tally->count == MOVE_LIST_CAPACITY)
+      return;
+    memset(&tally->entries[m], 0, sizeof(ExplorerEntry));
+    tally->entries[m].key = record->key;
+    tally->entries[m].move = record->next;
+    tally->eloSums[m] = 0;
+    tally->eloCounts[m] = 0;
+    tally->count++;
+  }
+
+  ExplorerEntry *entry = &tally->entries[m];
+  entry->games++;
+  if (game->result == PGN_RESULT_WHITE_WINS)
+    entry->whiteWins++;
+  else if (game->result == PGN_RESULT_BLACK_WINS)
+    entry->blackWins++;
+  else if (game->result == PGN_RESULT_DRAW)
+    entry->draws++;
+  else
+    entry->unfinished++;
+  if (game->whiteElo > 0) {
+    tally->eloSums[m] += game->whiteElo;
+    tally->eloCounts[m]++;
+  }
+  if (game->blackElo > 0) {
+    tally->eloSums[m] += game->blackElo;
+    tally->eloCounts[m]++;
+  }
+}
+
+// Write a position's moves, most played first
+static bool WriteTally(ExplorerTally *tally, uint32_t minGames, FILE *out,
+                       ExplorerSummary *summary) {
+  bool any = false;
+  for (int i = 0; i < tally->count; i++) {
+    int best = i;
+    for (int m = i + 1; m < tally->count; m++) {
+      if (tally->entries[m].games > tally->entries[best].games)
+        best = m;
+    }
+    ExplorerEntry entry = tally->entries[best];
+    uint64_t eloSum = tally->eloSums[best];
+    uint32_t eloCount = tally->eloCounts[best];
+    tally->entries[best] = tally->entries[i];
+    tally->eloSums[best] = tally->eloSums[i];
+    tally->eloCounts[best] = tally->eloCounts[i];
+
+    if (entry.games < minGames)
+      break;
+    entry.averageElo = eloCount > 0 ? (uint16_t)(eloSum / eloCount) : 0;
+    if (fwrite(&entry, sizeof(entry), 1, out) != 1)
+      return false;
+    summary->entries++;
+    any = true;
+  }
+  if (any)
+    summary->positions++;
+  tally->count = 0;
+  return true;
+}
+
+bool BuildExplorerStats(const PositionIndex *index, const GameDb *db,
+                        const char *path, int maxPly, uint32_t minGames,
+                        ExplorerSummary *summary) {
+  memset(summary, 0, sizeof(*summary));
+  if (index->kind != POSINDEX_POSITION)
+    return false;
+
+  ExplorerTally *tally = malloc(sizeof(ExplorerTally));
+  FILE *out = fopen(path, "wb");
+  int64_t start = GetTimeMilliseconds();
+  ExplorerHeader header = {0};
+  bool built = tally != NULL && out != NULL &&
+               fwrite(&header, sizeof(header), 1, out) == 1;
+
+  // The index is sorted by key, so each position's records are contiguous
+  if (built)
+    tally->count = 0;
+  for (uint64_t i = 0; built && i < index->recordCount; i++) {
+    const PosIndexRecord *record = &index->records[i];
+    if (i > 0 && record->key != index->records[i - 1].key)
+      built = WriteTally(tally, minGames, out, summary);
+    // Records of one game are sorted by ply: a game that repeats the
+    // position counts once, with the move played at its first visit
+    if (i > 0 && record->key == index->records[i - 1].key &&
+        record->game == index->records[i - 1].game)
+      continue;
+    if (record->ply <= maxPly && record->next != MOVE_NONE &&
+        record->game < db->gameCount)
+      TallyRecord(tally, record, &db->entries[record->game]);
+  }
+  if (built)
+    built = WriteTally(tally, minGames, out, summary);
+
+  if (built) {
+    memcpy(header.magic, EXPLORER_MAGIC, sizeof(header.magic));
+    header.version = EXPLORER_VERSION;
+    header.entrySize = sizeof(ExplorerEntry);
+    header.entryCount = summary->entries;
+    built = fseek(out, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(header), 1, out) == 1;
+  }
+  if (out != NULL && fclose(out) != 0)
+    built = false;
+  if (!built && out != NULL)
+    remove(path);
+
+  free(tally);
+  summary->timeMs = GetTimeMilliseconds() - start;
+  return built;
+}
+
+//==============================================================================
+// LOOKUP
+//==============================================================================
+
+bool OpenExplorer(OpeningExplorer *explorer, const char *path) {
+  memset(explorer, 0, sizeof(*explorer));
+  if (!MapFile(&explorer->file, path, MAP_ACCESS_RANDOM))
+    return false;
+
+  const ExplorerHeader *header = (const ExplorerHeader *)explorer->file.data;
+  size_t size = explorer->file.size;
+  if (size < sizeof(*header) ||
+      memcmp(header->magic, EXPLORER_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != EXPLORER_VERSION ||
+      header->entrySize != sizeof(ExplorerEntry) ||
+      header->entryCount !=
+          (size - sizeof(*header)) / sizeof(ExplorerEntry)) {
+    UnmapFile(&explorer->file);
+    return false;
+  }
+
+  explorer->entries =
+      (const ExplorerEntry *)(explorer->file.data + sizeof(*header));
+  explorer->entryCount = header->entryCount;
+  return true;
+}
+
+void CloseExplorer(OpeningExplorer *explorer) {
+  UnmapFile(&explorer->file);
+  explorer->entries = NULL;
+  explorer->entryCount = 0;
+}
+
+bool IsExplorerOpen(const OpeningExplorer *explorer) {
+  return explorer->entries != NULL;
+}
+
+int FindExplorerMoves(const OpeningExplorer *explorer, uint64_t key,
+                      const ExplorerEntry **first) {
+  *first = NULL;
+  if (!IsExplorerOpen(explorer))
+    return 0;
+
+  uint64_t low = 0, high = explorer->entryCount;
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    if (explorer->entries[middle].key < key)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  int count = 0;
+  while (low + (uint64_t)count < explorer->entryCount &&
+         explorer->entries[low + (uint64_t)count].key == key)
+    count++;
+  if (count > 0)
+    *first = &explorer->entries[low];
+  return count;
+}
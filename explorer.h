@@ -0,0 +1,107 @@
+/**
+ * Chess Game - Opening Explorer
+ * Move statistics per position over a memory-mapped file.
+ *
+ * The statistics file lists, for every position reached often enough in a
+ * game database, each move played from it with its number of games, results
+ * and the average rating of the players. Entries are sorted by position key
+ * (Polyglot Zobrist), then by number of games, so the moves of a position
+ * are one binary search away and come most popular first.
+ */
+
+#ifndef EXPLORER_H
+#define EXPLORER_H
+
+#include "gamedb.h"
+#include "mapfile.h"
+#include "posindex.h"
+
+//==============================================================================
+// EXPLORER CONSTANTS
+//==============================================================================
+
+#define EXPLORER_DEFAULT_PATH "explorer.bin"
+#define EXPLORER_MAGIC "CHESSOPX"
+#define EXPLORER_VERSION 3
+#define EXPLORER_DEFAULT_PLIES 30 // Deepest ply counted when building
+#define EXPLORER_DEFAULT_MIN_GAMES 2
+
+//==============================================================================
+// EXPLORER TYPES
+//==============================================================================
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t entrySize;
+  uint64_t entryCount;
+} ExplorerHeader;
+
+typedef struct {
+  uint64_t key;
+  Move move;
+  uint16_t averageElo; // Of the rated players of these games, 0 if none
+  uint32_t games;
+  uint32_t whiteWins;
+  uint32_t draws;
+  uint32_t blackWins;
+  uint32_t unfinished; // Games without a result ("*"), the rest of games
+} ExplorerEntry;
+
+typedef struct {
+  MappedFile file;
+  const ExplorerEntry *entries;
+  uint64_t entryCount;
+} OpeningExplorer;
+
+typedef struct {
+  uint64_t positions;
+  uint64_t entries;
+  int64_t timeMs;
+} ExplorerSummary;
+
+//==============================================================================
+// GLOBAL EXPLORER (defined in explorer.c)
+//==============================================================================
+
+extern OpeningExplorer openingExplorer;
+
+//==============================================================================
+// EXPLORER FUNCTIONS
+//==============================================================================
+
+/**
+ * Write the statistics file from a position index (built by position) and
+ * its game database. Positions after maxPly plies and moves played in fewer
+ * than minGames games are left out.
+ * @return false if the index is not a position index or a write failed
+ */
+bool BuildExplorerStats(const PositionIndex *index, const GameDb *db,
+                        const char *path, int maxPly, uint32_t minGames,
+                        ExplorerSummary *summary);
+
+/**
+ * Map a statistics file. Nothing is read up front.
+ * @return false if the file is missing or not a statistics file
+ */
+bool OpenExplorer(OpeningExplorer *explorer, const char *path);
+
+/**
+ * Unmap the statistics. Safe on a file that failed to open.
+ */
+void CloseExplorer(OpeningExplorer *explorer);
+
+/**
+ * Check if a statistics file is loaded.
+ */
+bool IsExplorerOpen(const OpeningExplorer *explorer);
+
+/**
+ * Find the moves of a position, most played first.
+ * @param first Output pointer to the first entry (into the mapping)
+ * @return Number of entries, 0 if the position is not in the file
+ */
+int FindExplorerMoves(const OpeningExplorer *explorer, uint64_t key,
+                      const ExplorerEntry **first);
+
+#endif // EXPLORER_H
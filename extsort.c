@@ -0,0 +1,217 @@
+/**
+ * Chess Game - External Sort
+ * Sorted runs spilled to temporary files and merged back.
+ */
+
+#include "extsort.h"
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// SORTED RUNS
+//==============================================================================
+
+bool InitExternalSort(ExternalSort *sort, size_t recordSize,
+                      size_t memoryBytes, ExtSortCompare compare,
+                      ExtSortCombine combine) {
+  memset(sort, 0, sizeof(*sort));
+  sort->recordSize = recordSize;
+  sort->compare = compare;
+  sort->combine = combine;
+  sort->capacity = memoryBytes / recordSize > 0 ? memoryBytes / recordSize : 1;
+  sort->buffer = malloc(sort->capacity * recordSize);
+  return sort->buffer != NULL;
+}
+
+// Sort the buffer and fold the records that compare equal
+static void SortBuffer(ExternalSort *sort) {
+  size_t size = sort->recordSize;
+  qsort(sort->buffer, sort->count, size, sort->compare);
+  if (sort->combine == NULL)
+    return;
+
+  size_t count = 0;
+  for (size_t i = 0; i < sort->count; i++) {
+    unsigned char *record = sort->buffer + i * size;
+    unsigned char *last = count > 0 ? sort->buffer + (count - 1) * size : NULL;
+    if (last != NULL && sort->compare(last, record) == 0) {
+      sort->combine(last, record);
+    } else {
+      if (count != i)
+        memcpy(sort->buffer + count * size, record, size);
+      count++;
+    }
+  }
+  sort->count = count;
+}
+
+// Write the sorted buffer to a temporary file
+static bool SpillRun(ExternalSort *sort) {
+  if (sort->runCount == sort->runCapacity) {
+    int capacity = sort->runCapacity > 0 ? sort->runCapacity * 2 : 16;
+    FILE **runs = realloc(sort->runs, (size_t)capacity * sizeof(FILE *));
+    if (runs == NULL)
+      return false;
+    sort->runs = runs;
+    sort->runCapacity = capacity;
+  }
+
+  FILE *file = tmpfile();
+  if (file == NULL)
+    return false;
+  if (fwrite(sort->buffer, sort->recordSize, sort->count, file) !=
+      sort->count) {
+    fclose(file);
+    return false;
+  }
+  rewind(file);
+  sort->runs[sort->runCount++] = file;
+  sort->count = 0;
+  return true;
+}
+
+void *AddSortRecord(ExternalSort *sort) {
+  if (sort->count == sort->capacity) {
+    // Combining may leave room enough to go on without a run
+    SortBuffer(sort);
+    if ((sort->combine == NULL || sort->count > sort->capacity / 2) &&
+        !SpillRun(sort))
+      return NULL;
+  }
+  return sort->buffer + sort->count++ * sort->recordSize;
+}
+
+//==============================================================================
+// OUTPUT
+//==============================================================================
+
+// The record being combined before it is passed on
+typedef struct {
+  ExtSortOutput output;
+  void *context;
+  unsigned char *pending;
+  bool hasPending;
+} SortOutput;
+
+static bool EmitRecord(const ExternalSort *sort, SortOutput *out,
+                       const void *record) {
+  if (sort->combine == NULL)
+    return out->output(record, out->context);
+  if (out->hasPending && sort->compare(out->pending, record) == 0) {
+    sort->combine(out->pending, record);
+    return true;
+  }
+
+  bool passed = !out->hasPending || out->output(out->pending, out->context);
+  memcpy(out->pending, record, sort->recordSize);
+  out->hasPending = true;
+  return passed;
+}
+
+static bool FlushOutput(SortOutput *out) {
+  if (!out->hasPending)
+    return true;
+  out->hasPending = false;
+  return out->output(out->pending, out->context);
+}
+
+// Sift a run down the min-heap of run heads
+static void SiftRun(const ExternalSort *sort, int *heap,
+                    const unsigned char *heads, int count, int at) {
+  size_t size = sort->recordSize;
+  for (;;) {
+    int smallest = at;
+    int left = 2 * at + 1, right = left + 1;
+    if (left < count && sort->compare(heads + heap[left] * size,
+                                      heads + heap[smallest] * size) < 0)
+      smallest = left;
+    if (right < count && sort->compare(heads + heap[right] * size,
+                                       heads + heap[smallest] * size) < 0)
+      smallest = right;
+    if (smallest == at)
+      return;
+    int swap = heap[at];
+    heap[at] = heap[smallest];
+    heap[smallest] = swap;
+    at = smallest;
+  }
+}
+
+// Merge the spilled runs, smallest head first. A run is closed as soon as
+// it is used up, which frees its disk space.
+static bool MergeRuns(ExternalSort *sort, SortOutput *out) {
+  size_t size = sort->recordSize;
+  int *heap = malloc((size_t)sort->runCount * sizeof(int));
+  unsigned char *heads = malloc((size_t)sort->runCount * size);
+  bool merged = heap != NULL && heads != NULL;
+
+  int count = 0;
+  for (int i = 0; merged && i < sort->runCount; i++) {
+    if (fread(heads + i * size, size, 1, sort->runs[i]) == 1) {
+      heap[count++] = i;
+    } else {
+      merged = !ferror(sort->runs[i]);
+      fclose(sort->runs[i]);
+      sort->runs[i] = NULL;
+    }
+  }
+  for (int i = count / 2 - 1; i >= 0; i--)
+    SiftRun(sort, heap, heads, count, i);
+
+  while (merged && count > 0) {
+    int run = heap[0];
+    merged = EmitRecord(sort, out, heads + run * size);
+    if (fread(heads + run * size, size, 1, sort->runs[run]) != 1) {
+      merged = merged && !ferror(sort->runs[run]);
+      fclose(sort->runs[run]);
+      sort->runs[run] = NULL;
+      heap[0] = heap[--count];
+    }
+    SiftRun(sort, heap, heads, count, 0);
+  }
+
+  free(heap);
+  free(heads);
+  return merged;
+}
+
+bool FinishExternalSort(ExternalSort *sort, ExtSortOutput output,
+                        void *context, int *runs) {
+  SortOutput out = {output, context, NULL, false};
+  if (sort->combine != NULL) {
+    out.pending = malloc(sort->recordSize);
+    if (out.pending == NULL)
+      return false;
+  }
+
+  // A single run is written straight from memory
+  SortBuffer(sort);
+  bool finished = true;
+  if (sort->runCount == 0) {
+    *runs = 1;
+    for (size_t i = 0; finished && i < sort->count; i++)
+      finished = EmitRecord(sort, &out, sort->buffer + i * sort->recordSize);
+  } else {
+    finished = sort->count == 0 || SpillRun(sort);
+    *runs = sort->runCount;
+    // The buffer's memory goes back before the merge
+    free(sort->buffer);
+    sort->buffer = NULL;
+    sort->count = 0;
+    finished = finished && MergeRuns(sort, &out);
+  }
+  finished = finished && FlushOutput(&out);
+
+  free(out.pending);
+  return finished;
+}
+
+void FreeExternalSort(ExternalSort *sort) {
+  for (int i = 0; i < sort->runCount; i++) {
+    if (sort->runs[i] != NULL)
+      fclose(sort->runs[i]);
+  }
+  free(sort->runs);
+  free(sort->buffer);
+  memset(sort, 0, sizeof(*sort));
+}
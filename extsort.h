@@ -0,0 +1,77 @@
+/**
+ * Chess Game - External Sort
+ * Sorting fixed-size records that need not fit in memory.
+ *
+ * Records are collected in a buffer of bounded size. A full buffer is
+ * sorted and spilled to a temporary file as a run, and the runs are merged
+ * through a min-heap of their heads when the records are read back. With a
+ * combine hook, records that compare equal are folded into one, both in
+ * the buffer (which is then only spilled when that leaves it more than
+ * half full) and across runs.
+ */
+
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+//==============================================================================
+// EXTERNAL SORT TYPES
+//==============================================================================
+
+typedef int (*ExtSortCompare)(const void *a, const void *b);
+
+// Fold a record into an equal one already kept
+typedef void (*ExtSortCombine)(void *into, const void *record);
+
+// Receives the records in sorted order; false stops the output
+typedef bool (*ExtSortOutput)(const void *record, void *context);
+
+typedef struct {
+  size_t recordSize;
+  ExtSortCompare compare;
+  ExtSortCombine combine; // NULL to keep equal records apart
+
+  unsigned char *buffer; // Records of the run being collected
+  size_t count, capacity;
+  FILE **runs;
+  int runCount, runCapacity;
+} ExternalSort;
+
+//==============================================================================
+// EXTERNAL SORT FUNCTIONS
+//==============================================================================
+
+/**
+ * Set up a sort holding at most memoryBytes of records at a time.
+ * @return false if the buffer could not be allocated
+ */
+bool InitExternalSort(ExternalSort *sort, size_t recordSize,
+                      size_t memoryBytes, ExtSortCompare compare,
+                      ExtSortCombine combine);
+
+/**
+ * Get room for the next record, spilling a run first when the buffer is
+ * full. The caller fills in the record.
+ * @return NULL if a run could not be written
+ */
+void *AddSortRecord(ExternalSort *sort);
+
+/**
+ * Pass every record to output in sorted order, combined when the sort has
+ * a combine hook. The records are merged straight from memory when
+ * nothing was spilled.
+ * @param runs Set to the number of runs merged (1 without spilling)
+ * @return false if a run could not be written or read, or output stopped
+ */
+bool FinishExternalSort(ExternalSort *sort, ExtSortOutput output,
+                        void *context, int *runs);
+
+/**
+ * Release the buffer and any runs still open.
+ */
+void FreeExternalSort(ExternalSort *sort);
+
+#endif // EXTSORT_H
@@ -0,0 +1,447 @@
+/**
+ * Chess Game - Game Database
+ * Compact binary game store with constant-time access over a mapped file.
+ */
+
+#include "gamedb.h"
+#include "movegen.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The structures are the file format; they must have no padding
+_Static_assert(sizeof(GameDbHeader) == 48, "GameDbHeader layout");
+_Static_assert(sizeof(GameDbEntry) == 48, "GameDbEntry layout");
+
+//==============================================================================
+// MOVE PACKING
+//==============================================================================
+
+size_t EncodeGameMoves(const ChessPosition *start, const Move *moves,
+                       int count, uint8_t *out) {
+  ChessPosition pos = *start;
+  for (int ply = 0; ply < count; ply++) {
+    MoveList list;
+    GenerateMoves(&pos, &list);
+    int index = 0;
+    while (index < list.count && list.moves[index] != moves[ply])
+      index++;
+    if (index == list.count)
+      return 0;
+    out[ply] = (uint8_t)index;
+
+    MoveUndo undo;
+    MakeMove(&pos, moves[ply], &undo);
+  }
+  return (size_t)count;
+}
+
+//==============================================================================
+// STRING POOL
+//==============================================================================
+
+static uint32_t HashString(const char *text, size_t length) {
+  uint32_t hash = 2166136261u; // FNV-1a
+  for (size_t i = 0; i < length; i++)
+    hash = (hash ^ (unsigned char)text[i]) * 16777619u;
+  return hash;
+}
+
+static bool GrowStringSlots(GameDbWriter *writer) {
+  size_t count = writer->slotCount > 0 ? writer->slotCount * 2 : 4096;
+  uint32_t *slots = calloc(count, sizeof(uint32_t));
+  if (slots == NULL)
+    return false;
+
+  for (size_t i = 0; i < writer->slotCount; i++) {
+    uint32_t stored = writer->stringSlots[i];
+    if (stored == 0)
+      continue;
+    const char *text = writer->strings + stored - 1;
+    size_t slot = HashString(text, strlen(text)) & (count - 1);
+    while (slots[slot] != 0)
+      slot = (slot + 1) & (count - 1);
+    slots[slot] = stored;
+  }
+  free(writer->stringSlots);
+  writer->stringSlots = slots;
+  writer->slotCount = count;
+  return true;
+}
+
+// Offset of a string in the pool, adding it the first time it is seen
+static uint32_t InternString(GameDbWriter *writer, const char *text,
+                             size_t length) {
+  if (length == 0)
+    return GAMEDB_NO_STRING;
+  if ((writer->stringCount + 1) * 2 > writer->slotCount &&
+      !GrowStringSlots(writer)) {
+    writer->failed = true;
+    return GAMEDB_NO_STRING;
+  }
+
+  size_t mask = writer->slotCount - 1;
+  size_t slot = HashString(text, length) & mask;
+  while (writer->stringSlots[slot] != 0) {
+    const char *stored = writer->strings + writer->stringSlots[slot] - 1;
+    if (strncmp(stored, text, length) == 0 && stored[length] == '\0')
+      return writer->stringSlots[slot] - 1;
+    slot = (slot + 1) & mask;
+  }
+
+  size_t needed = writer->stringsSize + length + 1;
+  if (needed > UINT32_MAX - 1) {
+    writer->failed = true;
+    return GAMEDB_NO_STRING;
+  }
+  if (needed > writer->stringsCapacity) {
+    size_t capacity = writer->stringsCapacity * 2;
+    while (capacity < needed)
+      capacity *= 2;
+    char *grown = realloc(writer->strings, capacity);
+    if (grown == NULL) {
+      writer->failed = true;
+      return GAMEDB_NO_STRING;
+    }
+    writer->strings = grown;
+    writer->stringsCapacity = capacity;
+  }
+
+  uint32_t offset = (uint32_t)writer->stringsSize;
+  memcpy(writer->strings + offset, text, length);
+  writer->strings[offset + length] = '\0';
+  writer->stringsSize = needed;
+  writer->stringSlots[slot] = offset + 1;
+  writer->stringCount++;
+  return offset;
+}
+
+// Tag values are stored unescaped; "?" and "-" mean unknown
+static uint32_t InternTag(GameDbWriter *writer, const PgnGame *game,
+                          const char *name) {
+  PgnText value;
+  if (!FindPgnTag(game, name, &value) ||
+      (value.length == 1 && (value.text[0] == '?' || value.text[0] == '-')))
+    return GAMEDB_NO_STRING;
+
+  char text[256];
+  size_t length = 0;
+  for (int i = 0; i < value.length && length < sizeof(text); i++) {
+    if (value.text[i] == '\\' && i + 1 < value.length)
+      i++;
+    text[length++] = value.text[i];
+  }
+  return InternString(writer, text, length);
+}
+
+// Leading digits of a tag value, 0 if there are none or too many
+static int ParseTagNumber(const PgnGame *game, const char *name) {
+  PgnText value;
+  if (!FindPgnTag(game, name, &value))
+    return 0;
+  int number = 0;
+  for (int i = 0; i < value.length && value.text[i] >= '0' &&
+                  value.text[i] <= '9';
+       i++) {
+    if (i == 4)
+      return 0;
+    number = number * 10 + (value.text[i] - '0');
+  }
+  return number;
+}
+
+// "2024.01.15" as 20240115; "????.??.??" fields count as 0
+static uint32_t ParseDateTag(const PgnGame *game) {
+  PgnText value;
+  if (!FindPgnTag(game, "Date", &value) || value.length != 10)
+    return 0;
+  uint32_t date = 0;
+  static const int FIELD_STARTS[3] = {0, 5, 8};
+  static const int FIELD_LENGTHS[3] = {4, 2, 2};
+  static const uint32_t FIELD_SCALES[3] = {10000, 100, 1};
+  for (int f = 0; f < 3; f++) {
+    uint32_t field = 0;
+    for (int i = 0; i < FIELD_LENGTHS[f]; i++) {
+      char c = value.text[FIELD_STARTS[f] + i];
+      if (c < '0' || c > '9') {
+        field = 0;
+        break;
+      }
+      field = field * 10 + (uint32_t)(c - '0');
+    }
+    date += field * FIELD_SCALES[f];
+  }
+  return date;
+}
+
+//==============================================================================
+// WRITING
+//==============================================================================
+
+static void WriteDb(GameDbWriter *writer, FILE *file, const void *data,
+                    size_t size) {
+  if (size > 0 && fwrite(data, 1, size, file) != size)
+    writer->failed = true;
+}
+
+bool CreateGameDb(GameDbWriter *writer, const char *path) {
+  memset(writer, 0, sizeof(*writer));
+  writer->file = fopen(path, "wb");
+  writer->entries = tmpfile();
+  writer->stringsCapacity = 65536;
+  writer->strings = malloc(writer->stringsCapacity);
+  if (writer->file == NULL || writer->entries == NULL ||
+      writer->strings == NULL) {
+    if (writer->file != NULL)
+      fclose(writer->file);
+    if (writer->entries != NULL)
+      fclose(writer->entries);
+    free(writer->strings);
+    return false;
+  }
+
+  // The pool starts with the empty string at GAMEDB_NO_STRING
+  writer->strings[0] = '\0';
+  writer->stringsSize = 1;
+
+  // Placeholder header, rewritten once the sizes are known
+  GameDbHeader header = {0};
+  WriteDb(writer, writer->file, &header, sizeof(header));
+  writer->offset = sizeof(header);
+  return true;
+}
+
+bool AddGameDbGame(GameDbWriter *writer, const PgnGame *game,
+                   const uint8_t *moves, size_t length) {
+  GameDbEntry entry = {0};
+  entry.movesOffset = writer->offset;
+  entry.event = InternTag(writer, game, "Event");
+  entry.site = InternTag(writer, game, "Site");
+  entry.round = InternTag(writer, game, "Round");
+  entry.white = InternTag(writer, game, "White");
+  entry.black = InternTag(writer, game, "Black");
+  entry.fen = InternTag(writer, game, "FEN");
+  entry.date = ParseDateTag(game);
+  entry.plyCount = (uint16_t)length;
+  entry.whiteElo = (uint16_t)ParseTagNumber(game, "WhiteElo");
+  entry.blackElo = (uint16_t)ParseTagNumber(game, "BlackElo");
+  entry.result = (uint8_t)game->result;
+
+  WriteDb(writer, writer->file, moves, length);
+  WriteDb(writer, writer->entries, &entry, sizeof(entry));
+  writer->offset += length;
+  writer->gameCount++;
+  return !writer->failed;
+}
+
+bool FinishGameDb(GameDbWriter *writer) {
+  // Align the entry table so it can be read in place from the mapping
+  static const uint8_t PADDING[8] = {0};
+  size_t padding = (size_t)((8 - writer->offset % 8) % 8);
+  WriteDb(writer, writer->file, PADDING, padding);
+
+  GameDbHeader header = {0};
+  memcpy(header.magic, GAMEDB_MAGIC, sizeof(header.magic));
+  header.version = GAMEDB_VERSION;
+  header.entrySize = sizeof(GameDbEntry);
+  header.gameCount = writer->gameCount;
+  header.entriesOffset = writer->offset + padding;
+  header.stringsOffset =
+      header.entriesOffset + writer->gameCount * sizeof(GameDbEntry);
+  header.stringsSize = writer->stringsSize;
+
+  // Copy the entries over from the temporary file
+  char buffer[65536];
+  size_t read;
+  rewind(writer->entries);
+  while ((read = fread(buffer, 1, sizeof(buffer), writer->entries)) > 0)
+    WriteDb(writer, writer->file, buffer, read);
+  if (ferror(writer->entries))
+    writer->failed = true;
+
+  WriteDb(writer, writer->file, writer->strings, writer->stringsSize);
+  if (fseek(writer->file, 0, SEEK_SET) != 0)
+    writer->failed = true;
+  WriteDb(writer, writer->file, &header, sizeof(header));
+  if (fclose(writer->file) != 0)
+    writer->failed = true;
+  fclose(writer->entries);
+
+  free(writer->strings);
+  free(writer->stringSlots);
+  return !writer->failed;
+}
+
+//==============================================================================
+// READING
+//==============================================================================
+
+bool OpenGameDb(GameDb *db, const char *path) {
+  memset(db, 0, sizeof(*db));
+  if (!MapFile(&db->file, path, MAP_ACCESS_RANDOM))
+    return false;
+
+  const GameDbHeader *header = (const GameDbHeader *)db->file.data;
+  size_t size = db->file.size;
+  if (size < sizeof(GameDbHeader) ||
+      memcmp(header->magic, GAMEDB_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != GAMEDB_VERSION ||
+      header->entrySize != sizeof(GameDbEntry) ||
+      header->entriesOffset % 8 != 0 || header->entriesOffset > size ||
+      header->gameCount > (size - header->entriesOffset) / sizeof(GameDbEntry) ||
+      header->stringsOffset !=
+          header->entriesOffset + header->gameCount * sizeof(GameDbEntry) ||
+      header->stringsSize == 0 ||
+      header->stringsSize > size - header->stringsOffset ||
+      db->file.data[header->stringsOffset + header->stringsSize - 1] != '\0') {
+    UnmapFile(&db->file);
+    return false;
+  }
+
+  db->header = header;
+  db->entries = (const GameDbEntry *)(db->file.data + header->entriesOffset);
+  db->strings = (const char *)db->file.data + header->stringsOffset;
+  db->gameCount = header->gameCount;
+  return true;
+}
+
+void CloseGameDb(GameDb *db) {
+  UnmapFile(&db->file);
+  db->header = NULL;
+  db->entries = NULL;
+  db->strings = NULL;
+  db->gameCount = 0;
+}
+
+const GameDbEntry *GetGameDbEntry(const GameDb *db, uint64_t index) {
+  return &db->entries[index];
+}
+
+const char *GetGameDbString(const GameDb *db, uint32_t offset) {
+  return offset < db->header->stringsSize ? db->strings + offset : "";
+}
+
+int LoadGameDbGame(const GameDb *db, uint64_t index, ChessPosition *start,
+                   Move *moves) {
+  const GameDbEntry *entry = GetGameDbEntry(db, index);
+  if (entry->plyCount > PGN_MAX_PLIES ||
+      entry->movesOffset + entry->plyCount > db->header->entriesOffset)
+    return -1;
+  if (entry->fen != GAMEDB_NO_STRING
+          ? !SetPositionFromFen(start, GetGameDbString(db, entry->fen))
+          : !SetPositionFromFen(start, STARTING_FEN))
+    return -1;
+
+  const uint8_t *packed = db->file.data + entry->movesOffset;
+  ChessPosition pos = *start;
+  for (int ply = 0; ply < entry->plyCount; ply++) {
+    MoveList list;
+    GenerateMoves(&pos, &list);
+    if (packed[ply] >= list.count)
+      return -1;
+    moves[ply] = list.moves[packed[ply]];
+
+    MoveUndo undo;
+    MakeMove(&pos, moves[ply], &undo);
+  }
+  return entry->plyCount;
+}
+
+//==============================================================================
+// CONVERSION
+//==============================================================================
+
+static size_t EncodeIngestedGame(const PgnGame *game, uint8_t *out,
+                                 void *context) {
+  (void)context;
+  return EncodeGameMoves(&game->start, game->moves, game->plyCount, out);
+}
+
+static bool AddIngestedGame(const PgnGame *game, const uint8_t *encoded,
+                            size_t encodedLength, void *context) {
+  GameDbWriter *writer = context;
+  if (!game->valid || encodedLength != (size_t)game->plyCount)
+    return true; // Left out, counted as invalid by the ingestion
+  return AddGameDbGame(writer, game, encoded, encodedLength);
+}
+
+bool ConvertPgnToGameDb(const char *pgnPath, const char *dbPath, int workers,
+                        IngestSummary *summary) {
+  GameDbWriter writer;
+  if (!CreateGameDb(&writer, dbPath)) {
+    memset(summary, 0, sizeof(*summary));
+    return false;
+  }
+
+  IngestOptions options = {0};
+  options.workers = workers;
+  options.encoder = EncodeIngestedGame;
+  options.sink = AddIngestedGame;
+  options.context = &writer;
+  bool ingested = IngestPgnFile(pgnPath, &options, summary);
+  bool finished = FinishGameDb(&writer);
+  if (!ingested)
+    remove(dbPath);
+  return ingested && finished && !summary->stopped;
+}
+
+// Seven-tag roster, the Elo tags when known, and SetUp/FEN for other starts
+static void WriteGameDbTags(const GameDb *db, const GameDbEntry *entry,
+                            PgnWriter *writer) {
+  char text[32];
+  const char *event = GetGameDbString(db, entry->event);
+  const char *site = GetGameDbString(db, entry->site);
+  const char *round = GetGameDbString(db, entry->round);
+  const char *white = GetGameDbString(db, entry->white);
+  const char *black = GetGameDbString(db, entry->black);
+
+  WritePgnTag(writer, "Event", *event != '\0' ? event : "?");
+  WritePgnTag(writer, "Site", *site != '\0' ? site : "?");
+  char year[12] = "????", month[4] = "??", day[4] = "??";
+  if (entry->date / 10000 > 0)
+    snprintf(year, sizeof(year), "%04u", entry->date / 10000);
+  if (entry->date / 100 % 100 > 0)
+    snprintf(month, sizeof(month), "%02u", entry->date / 100 % 100);
+  if (entry->date % 100 > 0)
+    snprintf(day, sizeof(day), "%02u", entry->date % 100);
+  snprintf(text, sizeof(text), "%s.%s.%s", year, month, day);
+  WritePgnTag(writer, "Date", text);
+  WritePgnTag(writer, "Round", *round != '\0' ? round : "?");
+  WritePgnTag(writer, "White", *white != '\0' ? white : "?");
+  WritePgnTag(writer, "Black", *black != '\0' ? black : "?");
+  WritePgnTag(writer, "Result", GetPgnResultText((PgnResult)entry->result));
+  if (entry->whiteElo > 0) {
+    snprintf(text, sizeof(text), "%u", entry->whiteElo);
+    WritePgnTag(writer, "WhiteElo", text);
+  }
+  if (entry->blackElo > 0) {
+    snprintf(text, sizeof(text), "%u", entry->blackElo);
+    WritePgnTag(writer, "BlackElo", text);
+  }
+  if (entry->fen != GAMEDB_NO_STRING) {
+    WritePgnTag(writer, "SetUp", "1");
+    WritePgnTag(writer, "FEN", GetGameDbString(db, entry->fen));
+  }
+}
+
+bool WriteGameDbPgn(const GameDb *db, PgnWriter *writer) {
+  Move moves[PGN_MAX_PLIES];
+  for (uint64_t i = 0; i < db->gameCount; i++) {
+    ChessPosition pos;
+    int count = LoadGameDbGame(db, i, &pos, moves);
+    if (count < 0)
+      return false;
+
+    const GameDbEntry *entry = GetGameDbEntry(db, i);
+    WriteGameDbTags(db, entry, writer);
+    BeginPgnMovetext(writer, pos.fullmoveNumber, pos.sideToMove);
+    for (int ply = 0; ply < count; ply++) {
+      char san[MOVE_NOTATION_LEN];
+      FormatSanMove(&pos, moves[ply], san);
+      WritePgnMove(writer, san, PGN_NO_CLOCK);
+      MoveUndo undo;
+      MakeMove(&pos, moves[ply], &undo);
+    }
+    EndPgnGame(writer, GetPgnResultText((PgnResult)entry->result));
+  }
+  return FlushPgnWriter(writer);
+}
@@ -0,0 +1,167 @@
+/**
+ * Chess Game - Game Database
+ * Compact binary game store with constant-time access over a mapped file.
+ *
+ * File layout (little-endian):
+ *   header | move streams | entry table | string pool
+ * Each move is stored as one byte: its index in the list GenerateMoves gives
+ * for the position, so a game takes about a byte per ply. The entry table
+ * holds one fixed-size entry per game with its metadata and the offset of
+ * its moves, which makes game i a direct lookup. Names, events and start
+ * FENs are stored once each in the string pool.
+ */
+
+#ifndef GAMEDB_H
+#define GAMEDB_H
+
+#include "ingest.h"
+#include "mapfile.h"
+#include "pgn.h"
+#include "position.h"
+#include <stdint.h>
+#include <stdio.h>
+
+//==============================================================================
+// GAME DATABASE CONSTANTS
+//==============================================================================
+
+#define GAMEDB_MAGIC "CHESSGDB"
+#define GAMEDB_VERSION 1
+#define GAMEDB_NO_STRING 0 // String offset of the empty string
+
+//==============================================================================
+// GAME DATABASE TYPES
+//==============================================================================
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t entrySize;
+  uint64_t gameCount;
+  uint64_t entriesOffset;
+  uint64_t stringsOffset;
+  uint64_t stringsSize;
+} GameDbHeader;
+
+typedef struct {
+  uint64_t movesOffset; // From the start of the file
+  uint32_t event;       // String pool offsets
+  uint32_t site;
+  uint32_t round;
+  uint32_t white;
+  uint32_t black;
+  uint32_t fen;  // Start position, GAMEDB_NO_STRING for the standard one
+  uint32_t date; // YYYYMMDD, unknown parts 0
+  uint16_t plyCount;
+  uint16_t whiteElo; // 0 if unknown
+  uint16_t blackElo;
+  uint8_t result; // PgnResult
+  uint8_t reserved[5];
+} GameDbEntry;
+
+// An open database; everything points into the mapping
+typedef struct {
+  MappedFile file;
+  const GameDbHeader *header;
+  const GameDbEntry *entries;
+  const char *strings;
+  uint64_t gameCount;
+} GameDb;
+
+// Builds a database file one game at a time
+typedef struct {
+  FILE *file;
+  FILE *entries; // Temporary, appended after the moves when done
+  uint64_t offset;
+  uint64_t gameCount;
+  char *strings;
+  size_t stringsSize, stringsCapacity;
+  uint32_t *stringSlots; // Hash set of string offsets + 1, 0 for empty
+  size_t slotCount, stringCount;
+  bool failed;
+} GameDbWriter;
+
+//==============================================================================
+// WRITING FUNCTIONS
+//==============================================================================
+
+/**
+ * Pack a game's moves, one byte each (see the file layout above).
+ * @param out Room for count bytes
+ * @return Bytes written, 0 if a move is not pseudo-legal in its position
+ */
+size_t EncodeGameMoves(const ChessPosition *start, const Move *moves,
+                       int count, uint8_t *out);
+
+/**
+ * Create a database file, replacing any existing one.
+ * @return false if the file could not be created
+ */
+bool CreateGameDb(GameDbWriter *writer, const char *path);
+
+/**
+ * Append a game read from PGN: the seven-tag roster, the Elo tags and FEN
+ * are kept, other tags are dropped.
+ * @param moves The game's moves packed by EncodeGameMoves
+ */
+bool AddGameDbGame(GameDbWriter *writer, const PgnGame *game,
+                   const uint8_t *moves, size_t length);
+
+/**
+ * Write the entry table and string pool and close the file.
+ * @return false if any write failed since the database was created
+ */
+bool FinishGameDb(GameDbWriter *writer);
+
+//==============================================================================
+// READING FUNCTIONS
+//==============================================================================
+
+/**
+ * Map a database. Nothing is read up front, so opening is instant at any
+ * size.
+ * @return false if the file is missing or not a valid database
+ */
+bool OpenGameDb(GameDb *db, const char *path);
+
+/**
+ * Unmap the database. Safe on one that failed to open.
+ */
+void CloseGameDb(GameDb *db);
+
+/**
+ * Metadata of a game, in constant time.
+ */
+const GameDbEntry *GetGameDbEntry(const GameDb *db, uint64_t index);
+
+/**
+ * A string of the pool, e.g. GetGameDbString(db, entry->white).
+ */
+const char *GetGameDbString(const GameDb *db, uint32_t offset);
+
+/**
+ * Decode a game's start position and moves.
+ * @param moves Room for PGN_MAX_PLIES moves
+ * @return Number of moves, or -1 if the stored game is corrupt
+ */
+int LoadGameDbGame(const GameDb *db, uint64_t index, ChessPosition *start,
+                   Move *moves);
+
+//==============================================================================
+// CONVERSION FUNCTIONS
+//==============================================================================
+
+/**
+ * Convert a PGN file with IngestPgnFile on the given number of workers.
+ * Invalid games are counted in the summary and left out.
+ */
+bool ConvertPgnToGameDb(const char *pgnPath, const char *dbPath, int workers,
+                        IngestSummary *summary);
+
+/**
+ * Write every game of a database as PGN.
+ * @return false if a game is corrupt or a write failed
+ */
+bool WriteGameDbPgn(const GameDb *db, PgnWriter *writer);
+
+#endif // GAMEDB_H
@@ -4,281 +4,210 @@
  */
 
 #include "history.h"
+#include "analysis.h"
 #include "board.h"
 #include "check.h"
+#include "clock.h"
+#include "movegen.h"
+#include "multiplayer.h"
+#include "variation.h"
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 //==============================================================================
 // GLOBAL STATE DEFINITIONS
 //==============================================================================
 
-MoveRecord moveHistory[MAX_MOVES];
 int moveCount = 0;
 int historyScrollOffset = 0;
 
+static int redoCount = 0; // Taken back records kept after the last move
+
+static bool gameArchived = false; // The finished game is in the archive
+static long archivedOffset = -1;  // Where this game starts in the archive
+
 //==============================================================================
-// HISTORY MANAGEMENT
+// HISTORY ARENA
 //==============================================================================
 
-void InitMoveHistory(void) {
-  moveCount = 0;
-  historyScrollOffset = 0;
-  memset(moveHistory, 0, sizeof(moveHistory));
-}
+// Chunk i holds plies i * HISTORY_CHUNK_MOVES onwards. Only this directory
+// of pointers is ever reallocated, never the records themselves.
+static MoveRecord **historyChunks = NULL;
+static int chunkCount = 0;
+static int chunkCapacity = 0;
+
+// Make room for one more record; false if memory ran out
+static bool ReserveMoveRecord(void) {
+  if (moveCount < chunkCount * HISTORY_CHUNK_MOVES)
+    return true;
+
+  if (chunkCount == chunkCapacity) {
+    int capacity = chunkCapacity > 0 ? chunkCapacity * 2 : 8;
+    MoveRecord **chunks =
+        realloc(historyChunks, sizeof(MoveRecord *) * (size_t)capacity);
+    if (chunks == NULL)
+      return false;
+    historyChunks = chunks;
+    chunkCapacity = capacity;
+  }
 
-int GetMoveCount(void) { return moveCount; }
+  MoveRecord *chunk = malloc(sizeof(MoveRecord) * HISTORY_CHUNK_MOVES);
+  if (chunk == NULL)
+    return false;
+  historyChunks[chunkCount++] = chunk;
+  return true;
+}
 
 //==============================================================================
-// NOTATION GENERATION
+// POSITION KEYFRAMES
 //==============================================================================
 
-static char ColToFile(int col) { return 'a' + col; }
-
-static char RowToRank(int row) { return '8' - row; }
-
-static char PieceToChar(PieceType type) {
-  switch (type) {
-  case PIECE_KING:
-    return 'K';
-  case PIECE_QUEEN:
-    return 'Q';
-  case PIECE_ROOK:
-    return 'R';
-  case PIECE_BISHOP:
-    return 'B';
-  case PIECE_KNIGHT:
-    return 'N';
-  default:
-    return '\0';
+// The position before every HISTORY_KEYFRAME_PLIES-th move, packed
+typedef struct {
+  PieceCode squares[SQUARE_COUNT];
+  uint8_t sideToMove;
+  uint8_t castlingRights;
+  int8_t enPassantSquare;
+  uint8_t reserved;
+} PositionKeyframe;
+
+// Keyframe i is the position before ply i * HISTORY_KEYFRAME_PLIES. Like the
+// records, a keyframe is only rewritten when its ply is played again.
+static PositionKeyframe *keyframes = NULL;
+static int keyframeCount = 0;
+static int keyframeCapacity = 0;
+
+static void StoreKeyframe(int ply, const ChessPosition *pos) {
+  int index = ply / HISTORY_KEYFRAME_PLIES;
+  keyframeCount = index; // Until this one is stored
+  if (index == keyframeCapacity) {
+    int capacity = keyframeCapacity > 0 ? keyframeCapacity * 2 : 16;
+    PositionKeyframe *grown =
+        realloc(keyframes, sizeof(PositionKeyframe) * (size_t)capacity);
+    if (grown == NULL)
+      return;
+    keyframes = grown;
+    keyframeCapacity = capacity;
   }
+
+  PositionKeyframe *frame = &keyframes[index];
+  memcpy(frame->squares, pos->squares, sizeof(frame->squares));
+  frame->sideToMove = (uint8_t)pos->sideToMove;
+  frame->castlingRights = (uint8_t)pos->castlingRights;
+  frame->enPassantSquare = (int8_t)pos->enPassantSquare;
+  frame->reserved = 0;
+  keyframeCount = index + 1;
 }
-static bool CanPieceReachSquare(int fromRow, int fromCol, int toRow, int toCol,
-                                PieceType type, PieceColor color) {
-  // Check if a piece at (fromRow, fromCol) can legally reach (toRow, toCol)
-  // This must check: movement pattern, path clearance, target not friendly,
-  // and that the move doesn't leave the king in check
-
-  int dRow = toRow - fromRow;
-  int dCol = toCol - fromCol;
-
-  // Target square cannot be occupied by a friendly piece
-  if (board[toRow][toCol].type != PIECE_NONE &&
-      board[toRow][toCol].color == color) {
-    return false;
-  }
 
-  bool patternValid = false;
+//==============================================================================
+// HISTORY MANAGEMENT
+//==============================================================================
 
-  switch (type) {
-  case PIECE_ROOK:
-    // Rook moves horizontally or vertically
-    if (dRow != 0 && dCol != 0)
-      return false;
-    {
-      int stepRow = (dRow == 0) ? 0 : (dRow > 0 ? 1 : -1);
-      int stepCol = (dCol == 0) ? 0 : (dCol > 0 ? 1 : -1);
-      int r = fromRow + stepRow;
-      int c = fromCol + stepCol;
-      while (r != toRow || c != toCol) {
-        if (board[r][c].type != PIECE_NONE)
-          return false;
-        r += stepRow;
-        c += stepCol;
-      }
-    }
-    patternValid = true;
-    break;
+void InitMoveHistory(void) {
+  moveCount = 0;
+  redoCount = 0;
+  historyScrollOffset = 0;
+  gameArchived = false;
+  archivedOffset = -1;
+  ResetVariations();
+}
 
-  case PIECE_KNIGHT:
-    patternValid = (abs(dRow) == 2 && abs(dCol) == 1) ||
-                   (abs(dRow) == 1 && abs(dCol) == 2);
-    break;
+void FreeMoveHistory(void) {
+  for (int i = 0; i < chunkCount; i++)
+    free(historyChunks[i]);
+  free(historyChunks);
+  historyChunks = NULL;
+  chunkCount = 0;
+  chunkCapacity = 0;
+  moveCount = 0;
+  redoCount = 0;
+  free(keyframes);
+  keyframes = NULL;
+  keyframeCount = 0;
+  keyframeCapacity = 0;
+  FreeVariations();
+}
 
-  case PIECE_BISHOP:
-    if (abs(dRow) != abs(dCol))
-      return false;
-    {
-      int stepRow = (dRow > 0) ? 1 : -1;
-      int stepCol = (dCol > 0) ? 1 : -1;
-      int r = fromRow + stepRow;
-      int c = fromCol + stepCol;
-      while (r != toRow || c != toCol) {
-        if (board[r][c].type != PIECE_NONE)
-          return false;
-        r += stepRow;
-        c += stepCol;
-      }
-    }
-    patternValid = true;
-    break;
+MoveRecord *GetMoveRecord(int index) {
+  return &historyChunks[index / HISTORY_CHUNK_MOVES]
+                       [index % HISTORY_CHUNK_MOVES];
+}
 
-  case PIECE_QUEEN:
-    if (dRow == 0 || dCol == 0) {
-      // Rook-like move
-      int stepRow = (dRow == 0) ? 0 : (dRow > 0 ? 1 : -1);
-      int stepCol = (dCol == 0) ? 0 : (dCol > 0 ? 1 : -1);
-      int r = fromRow + stepRow;
-      int c = fromCol + stepCol;
-      while (r != toRow || c != toCol) {
-        if (board[r][c].type != PIECE_NONE)
-          return false;
-        r += stepRow;
-        c += stepCol;
-      }
-      patternValid = true;
-    } else if (abs(dRow) == abs(dCol)) {
-      // Bishop-like move
-      int stepRow = (dRow > 0) ? 1 : -1;
-      int stepCol = (dCol > 0) ? 1 : -1;
-      int r = fromRow + stepRow;
-      int c = fromCol + stepCol;
-      while (r != toRow || c != toCol) {
-        if (board[r][c].type != PIECE_NONE)
-          return false;
-        r += stepRow;
-        c += stepCol;
-      }
-      patternValid = true;
-    }
-    break;
+int GetMoveCount(void) { return moveCount; }
 
-  default:
+bool GetPositionAtPly(int ply, ChessPosition *pos) {
+  if (ply < 0 || ply > moveCount)
     return false;
+  if (ply == moveCount) {
+    LoadPositionFromBoard(pos);
+    return true;
   }
 
-  if (!patternValid)
+  int index = ply / HISTORY_KEYFRAME_PLIES;
+  if (index >= keyframeCount)
     return false;
-
-  // Use WouldBeInCheck from check.c instead of duplicating check detection
-  return !WouldBeInCheck(fromRow, fromCol, toRow, toCol, color);
-}
-
-// Returns: 0 = no disambiguation, 1 = add file, 2 = add rank, 3 = add both
-static int GetDisambiguationType(MoveRecord *move) {
-  PieceType type = move->pieceType;
-  PieceColor color = move->color;
-
-  if (type == PIECE_PAWN || type == PIECE_KING) {
-    return 0;
+  const PositionKeyframe *frame = &keyframes[index];
+  ClearPosition(pos);
+  for (int sq = 0; sq < SQUARE_COUNT; sq++) {
+    if (frame->squares[sq] != NO_PIECE)
+      PutPiece(pos, sq, frame->squares[sq]);
   }
-
-  bool needsFile = false;
-  bool needsRank = false;
-
-  for (int row = 0; row < BOARD_SIZE; row++) {
-    for (int col = 0; col < BOARD_SIZE; col++) {
-      // Skip the original position (now empty) and destination (the moved
-      // piece)
-      if (row == move->fromRow && col == move->fromCol)
-        continue;
-      if (row == move->toRow && col == move->toCol)
-        continue;
-
-      // Check if this is the same type of piece
-      if (board[row][col].type == type && board[row][col].color == color) {
-        // Check if this piece can reach the same target square
-        if (CanPieceReachSquare(row, col, move->toRow, move->toCol, type,
-                                color)) {
-          // Ambiguity exists - determine what disambiguation is needed
-          if (col == move->fromCol) {
-            // Same file - need rank
-            needsRank = true;
-          } else {
-            // Different file - need file
-            needsFile = true;
-          }
-        }
-      }
-    }
+  pos->sideToMove = (PieceColor)frame->sideToMove;
+  pos->castlingRights = frame->castlingRights;
+  pos->enPassantSquare = frame->enPassantSquare;
+  pos->fullmoveNumber = index * HISTORY_KEYFRAME_PLIES / 2 + 1;
+  pos->key = ComputePositionKey(pos);
+
+  // Fewer than HISTORY_KEYFRAME_PLIES moves to replay from the keyframe
+  for (int i = index * HISTORY_KEYFRAME_PLIES; i < ply; i++) {
+    const MoveRecord *move = GetMoveRecord(i);
+    MoveUndo undo;
+    MakeMove(pos,
+             MAKE_MOVE(SQ(move->fromRow, move->fromCol),
+                       SQ(move->toRow, move->toCol),
+                       move->isPromotion ? move->promotedTo : PIECE_NONE),
+             &undo);
   }
-
-  if (needsFile && needsRank) {
-    return 3; // Need both
-  } else if (needsRank) {
-    return 2; // Need rank only
-  } else if (needsFile) {
-    return 1; // Need file only
-  }
-  return 0;
+  return true;
 }
 
-void GenerateMoveNotation(MoveRecord *move) {
-  char *notation = move->notation;
-  int idx = 0;
-
-  // Castling notation
-  if (move->isCastleKingside) {
-    strcpy(notation, "O-O");
-    idx = 3;
-  } else if (move->isCastleQueenside) {
-    strcpy(notation, "O-O-O");
-    idx = 5;
-  } else {
-    // Piece symbol (not for pawns)
-    char pieceChar = PieceToChar(move->pieceType);
-    if (pieceChar != '\0') {
-      notation[idx++] = pieceChar;
-    }
-
-    // Disambiguation for pieces (or file for pawn captures)
-    if (move->pieceType == PIECE_PAWN) {
-      if (move->isCapture) {
-        notation[idx++] = ColToFile(move->fromCol);
-      }
-    } else {
-      int disambig = GetDisambiguationType(move);
-      if (disambig == 3) {
-        // Both file and rank needed
-        notation[idx++] = ColToFile(move->fromCol);
-        notation[idx++] = RowToRank(move->fromRow);
-      } else if (disambig == 2) {
-        // Rank only
-        notation[idx++] = RowToRank(move->fromRow);
-      } else if (disambig == 1) {
-        // File only
-        notation[idx++] = ColToFile(move->fromCol);
-      }
-    }
-
-    // Capture symbol
-    if (move->isCapture) {
-      notation[idx++] = 'x';
-    }
-
-    // Destination square
-    notation[idx++] = ColToFile(move->toCol);
-    notation[idx++] = RowToRank(move->toRow);
-
-    // Promotion
-    if (move->isPromotion) {
-      notation[idx++] = '=';
-      notation[idx++] = PieceToChar(move->promotedTo);
-    }
-  }
+//==============================================================================
+// NOTATION GENERATION
+//==============================================================================
 
-  // Check or checkmate
+// Append "+" or "#" to the SAN body written by RecordMove
+static void WriteCheckSuffix(MoveRecord *move) {
+  int idx = move->notationLength;
   if (move->givesCheckmate) {
-    notation[idx++] = '#';
+    move->notation[idx++] = '#';
   } else if (move->givesCheck) {
-    notation[idx++] = '+';
+    move->notation[idx++] = '+';
   }
-
-  notation[idx] = '\0';
+  move->notation[idx] = '\0';
 }
 
 //==============================================================================
 // MOVE RECORDING
 //==============================================================================
 
-void RecordMove(int fromRow, int fromCol, int toRow, int toCol,
-                PieceType pieceType, PieceColor color, bool isCapture,
-                bool isCastleKingside, bool isCastleQueenside, bool isEnPassant,
-                bool isPromotion, PieceType promotedTo) {
-  if (moveCount >= MAX_MOVES)
+void RecordMove(const ChessPosition *before, int fromRow, int fromCol,
+                int toRow, int toCol, PieceType pieceType, PieceColor color,
+                bool isCapture, bool isCastleKingside, bool isCastleQueenside,
+                bool isEnPassant, bool isPromotion, PieceType promotedTo,
+                const BoardUndo *undo) {
+  if (!ReserveMoveRecord())
     return;
 
-  MoveRecord *move = &moveHistory[moveCount];
+  MoveRecord *move = GetMoveRecord(moveCount);
+  if (moveCount % HISTORY_KEYFRAME_PLIES == 0)
+    StoreKeyframe(moveCount, before);
 
   move->fromRow = fromRow;
   move->fromCol = fromCol;
@@ -295,21 +224,193 @@ void RecordMove(int fromRow, int fromCol, int toRow, int toCol,
   move->promotedTo = promotedTo;
   move->givesCheck = false;
   move->givesCheckmate = false;
+  move->undo = *undo;
+
+  // The SAN body only depends on the position before the move, so it is
+  // written once; only the check mark changes afterwards. The legal moves
+  // are needed just when another piece of the same type could be ambiguous.
+  MoveList legal = {.count = 0};
+  if (pieceType != PIECE_PAWN && pieceType != PIECE_KING &&
+      before->pieceCount[color][pieceType] > 1) {
+    ChessPosition scratch = *before; // Move generation makes and unmakes
+    GenerateLegalMoves(&scratch, &legal);
+  }
+  Move played = MAKE_MOVE(SQ(fromRow, fromCol), SQ(toRow, toCol),
+                          isPromotion ? promotedTo : PIECE_NONE);
+  move->notationLength = FormatSanBody(before, played, &legal, move->notation);
 
-  // Generate notation (will be updated after check status is known)
-  GenerateMoveNotation(move);
-
+  // Side lines are kept for exploring; in play a new move replaces them
+  VariationMovePlayed(played, IsAnalysisShown());
   moveCount++;
+  redoCount = 0;
+}
+
+// The records past moveCount stay in the arena untouched until a new move
+// overwrites them, so both directions are constant time
+MoveRecord *TakeBackMoveRecord(void) {
+  if (moveCount == 0)
+    return NULL;
+  moveCount--;
+  redoCount++;
+  gameArchived = false; // The game may now end differently
+  VariationMoveTakenBack();
+  return GetMoveRecord(moveCount);
+}
+
+MoveRecord *RedoMoveRecord(void) {
+  if (redoCount == 0)
+    return NULL;
+  redoCount--;
+  MoveRecord *move = GetMoveRecord(moveCount++);
+  VariationMovePlayed(MAKE_MOVE(SQ(move->fromRow, move->fromCol),
+                                SQ(move->toRow, move->toCol),
+                                move->isPromotion ? move->promotedTo
+                                                  : PIECE_NONE),
+                      true);
+  return move;
 }
 
 void UpdateLastMoveStatus(bool givesCheck, bool givesCheckmate) {
   if (moveCount == 0)
     return;
 
-  MoveRecord *move = &moveHistory[moveCount - 1];
+  MoveRecord *move = GetMoveRecord(moveCount - 1);
   move->givesCheck = givesCheck;
   move->givesCheckmate = givesCheckmate;
+  move->clockSeconds =
+      IsClockEnabled() ? GetPlayerTime(move->color) : PGN_NO_CLOCK;
+
+  WriteCheckSuffix(move);
+}
+
+//==============================================================================
+// PGN EXPORT
+//==============================================================================
+
+// Result and PGN termination of the game so far
+static void GetGameResult(const char **result, const char **termination) {
+  PieceColor winner = COLOR_NONE;
+  *termination = "normal";
+
+  switch (gameState) {
+  case GAME_CHECKMATE:
+    winner = OPPONENT_COLOR(currentTurn);
+    break;
+  case GAME_STALEMATE:
+    break;
+  case GAME_TIMEOUT:
+    winner = OPPONENT_COLOR(CheckTimeout());
+    *termination = "time forfeit";
+    break;
+  case GAME_ADJUDICATED:
+    winner = adjudicatedWinner;
+    *termination = "adjudication";
+    break;
+  default:
+    *result = "*";
+    *termination = "unterminated";
+    return;
+  }
+
+  *result = winner == COLOR_WHITE   ? "1-0"
+            : winner == COLOR_BLACK ? "0-1"
+                                    : "1/2-1/2";
+}
+
+void WriteGamePgn(PgnWriter *writer) {
+  const char *result;
+  const char *termination;
+  GetGameResult(&result, &termination);
+
+  char text[32];
+  time_t now = time(NULL);
+  strftime(text, sizeof(text), "%Y.%m.%d", localtime(&now));
+  WritePgnTag(writer, "Event", isMultiplayerGame ? "Online game" : "Local game");
+  WritePgnTag(writer, "Site", "?");
+  WritePgnTag(writer, "Date", text);
+  WritePgnTag(writer, "Round", "-");
+  WritePgnTag(writer, "White", "?");
+  WritePgnTag(writer, "Black", "?");
+  WritePgnTag(writer, "Result", result);
+  if (IsClockEnabled())
+    snprintf(text, sizeof(text), "%d+%d", (int)gameClock.baseTimeSeconds,
+             (int)gameClock.incrementSeconds);
+  else
+    snprintf(text, sizeof(text), "-");
+  WritePgnTag(writer, "TimeControl", text);
+  WritePgnTag(writer, "Termination", termination);
+
+  // Games always start from the initial position
+  BeginPgnMovetext(writer, 1, COLOR_WHITE);
+  for (int i = 0; i < moveCount; i++) {
+    const MoveRecord *move = GetMoveRecord(i);
+    WritePgnMove(writer, move->notation, move->clockSeconds);
+  }
+  EndPgnGame(writer, result);
+}
+
+bool ExportGamePgn(const char *path, bool append) {
+  bool toStdout = strcmp(path, "-") == 0;
+  FILE *file = toStdout ? stdout : fopen(path, append ? "a" : "w");
+  if (file == NULL)
+    return false;
+
+  PgnWriter writer;
+  InitPgnWriter(&writer, file);
+  WriteGamePgn(&writer);
+  bool written = FlushPgnWriter(&writer);
+
+  if (!toStdout && fclose(file) != 0)
+    written = false;
+  return written;
+}
+
+static long GetArchiveLength(void) {
+  FILE *file = fopen(PGN_ARCHIVE_PATH, "rb");
+  if (file == NULL)
+    return 0;
+  long length = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+  fclose(file);
+  return length;
+}
+
+static bool CutArchive(long length) {
+#ifdef _WIN32
+  FILE *file = fopen(PGN_ARCHIVE_PATH, "r+b");
+  if (file == NULL)
+    return false;
+  bool cut = _chsize_s(_fileno(file), length) == 0;
+  return fclose(file) == 0 && cut;
+#else
+  return truncate(PGN_ARCHIVE_PATH, (off_t)length) == 0;
+#endif
+}
+
+void ArchiveFinishedGame(void) {
+  if (gameArchived || !IsGameOver())
+    return;
+
+  gameArchived = true;
+  long offset = GetArchiveLength();
+  if (offset < 0) {
+    TraceLog(LOG_WARNING, "Could not read the archive %s", PGN_ARCHIVE_PATH);
+    return;
+  }
+
+  // A game taken back and finished again replaces its earlier ending,
+  // which is still the last game of the archive
+  if (archivedOffset >= 0 && archivedOffset <= offset) {
+    if (!CutArchive(archivedOffset)) {
+      TraceLog(LOG_WARNING, "Could not replace the game in %s",
+               PGN_ARCHIVE_PATH);
+      return;
+    }
+    offset = archivedOffset;
+  }
 
-  // Regenerate notation with check/checkmate symbols
-  GenerateMoveNotation(move);
+  if (ExportGamePgn(PGN_ARCHIVE_PATH, true))
+    archivedOffset = offset;
+  else
+    TraceLog(LOG_WARNING, "Could not archive the game to %s",
+             PGN_ARCHIVE_PATH);
 }
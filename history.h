@@ -6,12 +6,30 @@
 #ifndef HISTORY_H
 #define HISTORY_H
 
+#include "clock.h"
+#include "pgn.h"
+#include "position.h"
 #include "types.h"
 
 //==============================================================================
 // MOVE RECORD STRUCTURE
 //==============================================================================
 
+// Board state a move changes, kept with its record so the move can be taken
+// back (and played again) directly instead of replaying the game
+typedef struct {
+  Piece moved;              // The moving piece as it was, hasMoved included
+  Piece captured;           // What stood on capturedPos, or an empty square
+  Position capturedPos;     // The target, or the pawn taken en passant
+  Piece castlingRook;       // The rook before castling
+  Position enPassantTarget; // En passant state before the move
+  Position enPassantPawn;
+  Position whiteKingPos;
+  Position blackKingPos;
+  ChessClock clockBefore; // Clocks as the move was made
+  ChessClock clockAfter;  // Clocks as the move was taken back, for redo
+} BoardUndo;
+
 typedef struct {
   int fromRow, fromCol;
   int toRow, toCol;
@@ -27,13 +45,17 @@ typedef struct {
   bool givesCheck;
   bool givesCheckmate;
   char notation[MOVE_NOTATION_LEN];
+  int notationLength; // SAN without the check or mate suffix
+  float clockSeconds; // Mover's remaining time after the move, or PGN_NO_CLOCK
+  BoardUndo undo;
 } MoveRecord;
 
 //==============================================================================
 // GLOBAL HISTORY STATE
 //==============================================================================
 
-extern MoveRecord moveHistory[MAX_MOVES];
+// Records live in fixed-size chunks that are never moved or freed until
+// FreeMoveHistory, so pointers to them stay valid while the game grows
 extern int moveCount;
 extern int historyScrollOffset;
 
@@ -42,34 +64,85 @@ extern int historyScrollOffset;
 //==============================================================================
 
 /**
- * Clear move history (call when starting a new game).
+ * Clear move history (call when starting a new game). The chunks already
+ * allocated are kept for the next game.
  */
 void InitMoveHistory(void);
 
+/**
+ * Release the memory of the move history.
+ */
+void FreeMoveHistory(void);
+
+/**
+ * Get a recorded move in constant time.
+ * @param index Ply of the move, from 0 to GetMoveCount() - 1
+ */
+MoveRecord *GetMoveRecord(int index);
+
 /**
  * Record a move after it's executed.
  * pieceType and color must be passed explicitly since the from-square is
- * already empty.
+ * already empty. The notation is written from the position before the move
+ * (left unchanged), without the check mark until UpdateLastMoveStatus.
+ * Any moves kept for redo are dropped.
  */
-void RecordMove(int fromRow, int fromCol, int toRow, int toCol,
-                PieceType pieceType, PieceColor color, bool isCapture,
-                bool isCastleKingside, bool isCastleQueenside, bool isEnPassant,
-                bool isPromotion, PieceType promotedTo);
+void RecordMove(const ChessPosition *before, int fromRow, int fromCol,
+                int toRow, int toCol, PieceType pieceType, PieceColor color,
+                bool isCapture, bool isCastleKingside, bool isCastleQueenside,
+                bool isEnPassant, bool isPromotion, PieceType promotedTo,
+                const BoardUndo *undo);
 
 /**
- * Update the last move's check/checkmate status.
- * Call after UpdateGameState().
+ * Remove the last move from the game, keeping its record for redo.
+ * @return The record, or NULL if no move was played
  */
-void UpdateLastMoveStatus(bool givesCheck, bool givesCheckmate);
+MoveRecord *TakeBackMoveRecord(void);
+
+/**
+ * Put the most recently taken back move back into the game.
+ * @return The record, or NULL if there is nothing to redo
+ */
+MoveRecord *RedoMoveRecord(void);
 
 /**
- * Generate algebraic notation for a move.
+ * Update the last move's check/checkmate status and note the mover's clock.
+ * Call after SwitchClock() and UpdateGameState().
  */
-void GenerateMoveNotation(MoveRecord *move);
+void UpdateLastMoveStatus(bool givesCheck, bool givesCheckmate);
 
 /**
  * Get total number of moves recorded.
  */
 int GetMoveCount(void);
 
+/**
+ * Rebuild the position after a number of moves of the game. A snapshot is
+ * kept every HISTORY_KEYFRAME_PLIES plies, so at most that many moves are
+ * replayed whatever the length of the game.
+ * @param ply From 0 (the start) to GetMoveCount() (the current position)
+ * @return false if the ply is out of range or its snapshot could not be kept
+ */
+bool GetPositionAtPly(int ply, ChessPosition *pos);
+
+/**
+ * Write the current game as PGN: tags, movetext with clock comments when
+ * the clock is on, and the result ("*" while the game goes on).
+ */
+void WriteGamePgn(PgnWriter *writer);
+
+/**
+ * Write the current game to a PGN file, or to stdout for "-".
+ * @param append Add to the end of the file instead of replacing it
+ * @return false if the file could not be written
+ */
+bool ExportGamePgn(const char *path, bool append);
+
+/**
+ * Append the game to PGN_ARCHIVE_PATH once it has ended. Call once per
+ * frame on the game screen; each game is archived only once, and a game
+ * taken back and finished again replaces the copy archived before.
+ */
+void ArchiveFinishedGame(void);
+
 #endif // HISTORY_H
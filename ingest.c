@@ -0,0 +1,429 @@
+/**
+ * Chess Game - PGN Ingestion
+ * Reads very large PGN files on a pool of worker threads.
+ *
+ * The file is mapped once and cut into chunks of about INGEST_CHUNK_BYTES,
+ * each ending where the next game's tags begin. Workers take chunks in
+ * order and read them independently with their own PgnReader, keeping the
+ * games compactly (moves and tag references, no text) in a ring of slots
+ * indexed by chunk number. Finished chunks are handed to the sink as soon
+ * as every earlier chunk is done, as in batch analysis, so the games come
+ * out in file order and memory stays bounded by the ring.
+ */
+
+#include "ingest.h"
+#include "mapfile.h"
+#include "search.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// INGEST PARAMETERS
+//==============================================================================
+
+#define INGEST_SLOTS_PER_WORKER 2
+
+//==============================================================================
+// INGEST STATE
+//==============================================================================
+
+// A game as read from its chunk; tags and moves live in the slot's arrays
+typedef struct {
+  size_t offset; // From the start of the file
+  size_t length;
+  int firstTag;
+  int tagCount;
+  size_t firstMove;
+  int plyCount;
+  int startIndex; // Into the slot's positions, -1 for the standard start
+  size_t firstEncoded;
+  size_t encodedLength;
+  PgnResult result;
+  const char *error; // NULL for a valid game
+} IngestedGame;
+
+// One chunk's games; the arrays are kept and reused by later chunks
+typedef struct {
+  bool ready;
+  bool failed; // Ran out of memory while reading the chunk
+  IngestedGame *games;
+  int gameCount, gameCapacity;
+  PgnText *tags; // Name and value pairs
+  int tagCount, tagCapacity;
+  Move *moves;
+  size_t moveCount, moveCapacity;
+  ChessPosition *positions; // Starts set up by FEN tags
+  int positionCount, positionCapacity;
+  uint8_t *encoded;
+  size_t encodedCount, encodedCapacity;
+} IngestSlot;
+
+// Shared by all workers; every field is guarded by the mutex
+typedef struct {
+  const char *data;
+  size_t size;
+  size_t chunkBytes;
+  IngestEncoder encoder;
+  IngestSink sink;
+  void *context;
+  pthread_mutex_t mutex;
+  pthread_cond_t slotFreed;
+  IngestSlot *slots;
+  int slotCount;
+  size_t nextStart;    // Where the next chunk begins
+  int64_t nextChunk;   // Next chunk to hand out
+  int64_t nextEmitted; // Oldest chunk not yet handed to the sink
+  bool endOfInput;
+  bool stopping; // Stopped by the sink or out of memory
+  bool failed;
+  PgnGame game; // Rebuilt for the sink
+  IngestSummary summary;
+} IngestRun;
+
+typedef struct {
+  IngestRun *run;
+  PgnGame game; // The worker's own position and move buffer
+  pthread_t thread;
+} IngestWorker;
+
+//==============================================================================
+// CHUNKING
+//==============================================================================
+
+// Whether the last non-blank line before a line start is a tag line
+static bool FollowsTag(const char *data, size_t lineStart) {
+  size_t at = lineStart;
+  while (at > 0 && (data[at - 1] == '\n' || data[at - 1] == '\r' ||
+                    data[at - 1] == ' ' || data[at - 1] == '\t'))
+    at--;
+  if (at == 0)
+    return false;
+  while (at > 0 && data[at - 1] != '\n')
+    at--;
+  while (data[at] == ' ' || data[at] == '\t')
+    at++;
+  return data[at] == '[';
+}
+
+// Whether the line before a line start is empty or only spaces
+static bool FollowsBlankLine(const char *data, size_t lineStart) {
+  if (lineStart == 0)
+    return false;
+  size_t at = lineStart - 1; // The newline ending the line before
+  while (at > 0 && (data[at - 1] == '\r' || data[at - 1] == ' ' ||
+                    data[at - 1] == '\t'))
+    at--;
+  return at == 0 || data[at - 1] == '\n';
+}
+
+// [Name "...: a tag rather than text that happens to open with '['
+static bool IsTagLine(const char *data, size_t size, size_t at) {
+  size_t nameStart = ++at;
+  while (at < size && (isalnum((unsigned char)data[at]) || data[at] == '_'))
+    at++;
+  if (at == nameStart || at >= size || data[at] != ' ')
+    return false;
+  while (at < size && data[at] == ' ')
+    at++;
+  return at < size && data[at] == '"';
+}
+
+// Whether an offset is inside a {} comment, from the last brace before it.
+// Comments do not nest, so an open one has no '}' after its '{'; the chunk
+// start is outside any comment and bounds the search.
+static bool InsideComment(const char *data, size_t chunkStart, size_t at) {
+  while (at > chunkStart) {
+    char c = data[--at];
+    if (c == '}')
+      return false;
+    if (c == '{')
+      return true;
+  }
+  return false;
+}
+
+// The first game start at or after an offset: a tag line after a blank line
+// that follows movetext rather than another tag, outside any comment. A
+// wrapped comment line such as "[%clk 0:01:00] }" is never taken for one.
+static size_t FindGameStart(const char *data, size_t size, size_t chunkStart,
+                            size_t from) {
+  size_t at = from;
+  while (at < size) {
+    const char *newline = memchr(data + at, '\n', size - at);
+    if (newline == NULL)
+      return size;
+    at = (size_t)(newline - data) + 1;
+    if (at < size && data[at] == '[' && IsTagLine(data, size, at) &&
+        FollowsBlankLine(data, at) && !FollowsTag(data, at) &&
+        !InsideComment(data, chunkStart, at))
+      return at;
+  }
+  return size;
+}
+
+//==============================================================================
+// READING
+//==============================================================================
+
+// Grow an array to hold at least `needed` elements
+static bool Reserve(void **items, size_t *capacity, size_t needed,
+                    size_t itemSize) {
+  if (needed <= *capacity)
+    return true;
+  size_t grown = *capacity > 0 ? *capacity * 2 : 256;
+  while (grown < needed)
+    grown *= 2;
+  void *resized = realloc(*items, grown * itemSize);
+  if (resized == NULL)
+    return false;
+  *items = resized;
+  *capacity = grown;
+  return true;
+}
+
+static bool ReserveInt(void **items, int *capacity, int needed,
+                       size_t itemSize) {
+  size_t grown = (size_t)*capacity;
+  bool reserved = Reserve(items, &grown, (size_t)needed, itemSize);
+  *capacity = (int)grown;
+  return reserved;
+}
+
+static bool KeepGame(IngestSlot *slot, const PgnGame *game, size_t base,
+                     const IngestRun *run) {
+  PgnText fen;
+  bool custom = FindPgnTag(game, "FEN", &fen);
+  bool encode = run->encoder != NULL && game->valid;
+  if ((encode && !Reserve((void **)&slot->encoded, &slot->encodedCapacity,
+                          slot->encodedCount + INGEST_ENCODED_MAX, 1)) ||
+      !ReserveInt((void **)&slot->games, &slot->gameCapacity,
+                  slot->gameCount + 1, sizeof(IngestedGame)) ||
+      !ReserveInt((void **)&slot->tags, &slot->tagCapacity,
+                  slot->tagCount + 2 * game->tagCount, sizeof(PgnText)) ||
+      !Reserve((void **)&slot->moves, &slot->moveCapacity,
+               slot->moveCount + (size_t)game->plyCount, sizeof(Move)) ||
+      (custom && !ReserveInt((void **)&slot->positions,
+                             &slot->positionCapacity,
+                             slot->positionCount + 1, sizeof(ChessPosition))))
+    return false;
+
+  IngestedGame *kept = &slot->games[slot->gameCount++];
+  kept->offset = base + game->offset;
+  kept->length = game->length;
+  kept->firstTag = slot->tagCount;
+  kept->tagCount = game->tagCount;
+  kept->firstMove = slot->moveCount;
+  kept->plyCount = game->plyCount;
+  kept->startIndex = custom ? slot->positionCount : -1;
+  kept->result = game->result;
+  kept->error = game->error;
+  kept->firstEncoded = slot->encodedCount;
+  kept->encodedLength =
+      encode ? run->encoder(game, slot->encoded + slot->encodedCount,
+                            run->context)
+             : 0;
+  slot->encodedCount += kept->encodedLength;
+
+  for (int i = 0; i < game->tagCount; i++) {
+    slot->tags[slot->tagCount++] = game->tagNames[i];
+    slot->tags[slot->tagCount++] = game->tagValues[i];
+  }
+  memcpy(slot->moves + slot->moveCount, game->moves,
+         (size_t)game->plyCount * sizeof(Move));
+  slot->moveCount += (size_t)game->plyCount;
+  if (custom)
+    slot->positions[slot->positionCount++] = game->start;
+  return true;
+}
+
+static void ReadChunk(IngestWorker *worker, IngestSlot *slot, size_t start,
+                      size_t end) {
+  PgnReader reader;
+  InitPgnReader(&reader, worker->run->data + start, end - start);
+
+  slot->gameCount = 0;
+  slot->tagCount = 0;
+  slot->moveCount = 0;
+  slot->positionCount = 0;
+  slot->encodedCount = 0;
+  slot->failed = false;
+  while (ReadPgnGame(&reader, &worker->game)) {
+    if (!KeepGame(slot, &worker->game, start, worker->run)) {
+      slot->failed = true;
+      return;
+    }
+  }
+}
+
+//==============================================================================
+// IN-ORDER OUTPUT
+//==============================================================================
+
+static void RebuildGame(const IngestSlot *slot, const IngestedGame *kept,
+                        const ChessPosition *standard, PgnGame *game) {
+  game->offset = kept->offset;
+  game->length = kept->length;
+  game->tagCount = kept->tagCount;
+  for (int i = 0; i < kept->tagCount; i++) {
+    game->tagNames[i] = slot->tags[kept->firstTag + 2 * i];
+    game->tagValues[i] = slot->tags[kept->firstTag + 2 * i + 1];
+  }
+  game->start =
+      kept->startIndex >= 0 ? slot->positions[kept->startIndex] : *standard;
+  game->plyCount = kept->plyCount;
+  memcpy(game->moves, slot->moves + kept->firstMove,
+         (size_t)kept->plyCount * sizeof(Move));
+  game->result = kept->result;
+  game->valid = kept->error == NULL;
+  game->error = kept->error;
+}
+
+// Hand every finished chunk from the oldest one on to the sink (mutex held)
+static void EmitReadySlots(IngestRun *run, const ChessPosition *standard) {
+  bool emitted = false;
+  for (;;) {
+    IngestSlot *slot = &run->slots[run->nextEmitted % run->slotCount];
+    if (!slot->ready)
+      break;
+
+    if (slot->failed) {
+      run->failed = true;
+      run->stopping = true;
+    }
+    for (int i = 0; i < slot->gameCount && !run->stopping; i++) {
+      const IngestedGame *kept = &slot->games[i];
+      run->summary.games++;
+      run->summary.plies += (uint64_t)kept->plyCount;
+      if (kept->error != NULL)
+        run->summary.invalid++;
+      if (run->sink != NULL) {
+        RebuildGame(slot, kept, standard, &run->game);
+        if (!run->sink(&run->game, slot->encoded + kept->firstEncoded,
+                       kept->encodedLength, run->context)) {
+          run->summary.stopped = true;
+          run->stopping = true;
+        }
+      }
+    }
+    slot->ready = false;
+    run->nextEmitted++;
+    emitted = true;
+  }
+  if (emitted)
+    pthread_cond_broadcast(&run->slotFreed);
+}
+
+//==============================================================================
+// WORKERS
+//==============================================================================
+
+static void *IngestWorkerMain(void *arg) {
+  IngestWorker *worker = arg;
+  IngestRun *run = worker->run;
+  ChessPosition standard;
+  SetPositionFromFen(&standard, STARTING_FEN);
+
+  pthread_mutex_lock(&run->mutex);
+  for (;;) {
+    while (!run->endOfInput && !run->stopping &&
+           run->nextChunk - run->nextEmitted >= run->slotCount)
+      pthread_cond_wait(&run->slotFreed, &run->mutex);
+    if (run->stopping || run->nextStart >= run->size) {
+      run->endOfInput = true;
+      pthread_cond_broadcast(&run->slotFreed);
+      break;
+    }
+    size_t start = run->nextStart;
+    size_t end = run->size - start > run->chunkBytes
+                     ? FindGameStart(run->data, run->size, start,
+                                     start + run->chunkBytes)
+                     : run->size;
+    run->nextStart = end;
+    int64_t index = run->nextChunk++;
+    IngestSlot *slot = &run->slots[index % run->slotCount];
+    pthread_mutex_unlock(&run->mutex);
+
+    ReadChunk(worker, slot, start, end);
+
+    pthread_mutex_lock(&run->mutex);
+    slot->ready = true;
+    EmitReadySlots(run, &standard);
+  }
+  pthread_mutex_unlock(&run->mutex);
+  return NULL;
+}
+
+//==============================================================================
+// INGEST INTERFACE
+//==============================================================================
+
+bool IngestPgnFile(const char *path, const IngestOptions *options,
+                   IngestSummary *summary) {
+  memset(summary, 0, sizeof(*summary));
+
+  MappedFile file;
+  if (!MapFile(&file, path, MAP_ACCESS_SEQUENTIAL))
+    return false;
+
+  int workerCount = options->workers;
+  if (workerCount < 1)
+    workerCount = 1;
+  if (workerCount > SEARCH_MAX_THREADS)
+    workerCount = SEARCH_MAX_THREADS;
+
+  IngestRun *run = calloc(1, sizeof(IngestRun));
+  IngestWorker *workers = calloc((size_t)workerCount, sizeof(IngestWorker));
+  IngestSlot *slots = calloc((size_t)workerCount * INGEST_SLOTS_PER_WORKER,
+                             sizeof(IngestSlot));
+  if (run == NULL || workers == NULL || slots == NULL) {
+    free(run);
+    free(workers);
+    free(slots);
+    UnmapFile(&file);
+    return false;
+  }
+  run->data = (const char *)file.data;
+  run->size = file.size;
+  run->chunkBytes =
+      options->chunkBytes > 0 ? options->chunkBytes : INGEST_CHUNK_BYTES;
+  run->encoder = options->encoder;
+  run->sink = options->sink;
+  run->context = options->context;
+  run->slots = slots;
+  run->slotCount = workerCount * INGEST_SLOTS_PER_WORKER;
+  pthread_mutex_init(&run->mutex, NULL);
+  pthread_cond_init(&run->slotFreed, NULL);
+
+  int64_t start = GetTimeMilliseconds();
+  int started = 0;
+  for (int i = 0; i < workerCount; i++) {
+    workers[started].run = run;
+    if (pthread_create(&workers[started].thread, NULL, IngestWorkerMain,
+                       &workers[started]) != 0)
+      break;
+    started++;
+  }
+  for (int i = 0; i < started; i++)
+    pthread_join(workers[i].thread, NULL);
+
+  run->summary.bytes = file.size;
+  run->summary.timeMs = GetTimeMilliseconds() - start;
+  *summary = run->summary;
+  bool succeeded = started > 0 && !run->failed;
+
+  for (int i = 0; i < run->slotCount; i++) {
+    free(slots[i].games);
+    free(slots[i].tags);
+    free(slots[i].moves);
+    free(slots[i].positions);
+    free(slots[i].encoded);
+  }
+  pthread_cond_destroy(&run->slotFreed);
+  pthread_mutex_destroy(&run->mutex);
+  free(slots);
+  free(workers);
+  free(run);
+  UnmapFile(&file);
+  return succeeded;
+}
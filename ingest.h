@@ -0,0 +1,78 @@
+/**
+ * Chess Game - PGN Ingestion
+ * Reads very large PGN files on a pool of worker threads.
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include "pgn.h"
+#include <stdint.h>
+
+//==============================================================================
+// INGEST CONSTANTS
+//==============================================================================
+
+#define INGEST_CHUNK_BYTES (4u << 20) // Input parsed by a worker at a time
+#define INGEST_ENCODED_MAX (2 * PGN_MAX_PLIES) // Bytes an encoder may write
+
+//==============================================================================
+// INGEST TYPES
+//==============================================================================
+
+/**
+ * Turns a valid game into bytes on the worker that read it, so costly
+ * per-game work (such as packing the moves) runs in parallel. Called from
+ * several threads at once.
+ * @param out Room for INGEST_ENCODED_MAX bytes
+ * @return Number of bytes written
+ */
+typedef size_t (*IngestEncoder)(const PgnGame *game, uint8_t *out,
+                                void *context);
+
+/**
+ * Receives every game in input order, one call at a time, so it needs no
+ * locking of its own. The game, its tags and the encoded bytes are only
+ * valid during the call.
+ * @param encoded Encoder output (none for invalid games or without encoder)
+ * @return false to stop the ingestion early (e.g. a failed write)
+ */
+typedef bool (*IngestSink)(const PgnGame *game, const uint8_t *encoded,
+                           size_t encodedLength, void *context);
+
+typedef struct {
+  int workers;           // Chunks parsed at once
+  size_t chunkBytes;     // INGEST_CHUNK_BYTES if 0
+  IngestEncoder encoder; // May be NULL
+  IngestSink sink;       // May be NULL to only validate and count
+  void *context;         // Passed to the encoder and the sink
+} IngestOptions;
+
+typedef struct {
+  uint64_t games;
+  uint64_t invalid; // Games with an illegal or unreadable move or a bad FEN
+  uint64_t plies;   // Moves read, those of invalid games up to the error
+  uint64_t bytes;
+  int64_t timeMs;
+  bool stopped; // The sink asked to stop
+} IngestSummary;
+
+//==============================================================================
+// INGEST FUNCTIONS
+//==============================================================================
+
+/**
+ * Read every game of a PGN file with ReadPgnGame. The mapped file is split
+ * into chunks at game boundaries (a tag line after a blank line and
+ * movetext, outside any comment), each worker parses whole chunks with its
+ * own position, and the games are handed to the sink in file order as soon
+ * as every earlier chunk is done. Only a few chunks per worker are held at
+ * once, whatever the size of the file. The games are the ones a single
+ * PgnReader would read from the whole file.
+ * @return false if the file could not be mapped, memory ran out or no worker
+ * could start
+ */
+bool IngestPgnFile(const char *path, const IngestOptions *options,
+                   IngestSummary *summary);
+
+#endif // INGEST_H
@@ -0,0 +1,450 @@
+/**
+ * Chess Game - Game Journal
+ * Crash-safe, append-only record of the local game in progress.
+ */
+
+#include "journal.h"
+#include "board.h"
+#include "check.h"
+#include "clock.h"
+#include "history.h"
+#include "moves.h"
+#include "multiplayer.h"
+#include "raylib.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+//==============================================================================
+// FILE LAYOUT
+//==============================================================================
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+} JournalHeader;
+
+_Static_assert(sizeof(JournalHeader) == 16, "journal header layout");
+_Static_assert(sizeof(JournalRecord) == 32, "journal record layout");
+
+//==============================================================================
+// LOCAL STATE
+//==============================================================================
+
+static char journalPath[512];
+static bool journalRecording = false; // A local game is being journaled
+static bool journalEnded = false;     // The last record is an end record
+
+// Records waiting for the writer, swapped out whole under the lock
+static pthread_mutex_t journalMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t journalWake = PTHREAD_COND_INITIALIZER;
+static JournalRecord *pending = NULL;
+static int pendingCount = 0;
+static int pendingCapacity = 0;
+static bool stopRequested = false;
+
+static pthread_t writerThread;
+static bool writerRunning = false;
+
+//==============================================================================
+// CRC-32
+//==============================================================================
+
+static uint32_t crcTable[256];
+static bool crcTableReady = false;
+
+static void InitCrcTable(void) {
+  if (crcTableReady)
+    return;
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+    crcTable[i] = crc;
+  }
+  crcTableReady = true;
+}
+
+// Everything after the crc field itself
+static uint32_t RecordCrc(const JournalRecord *record) {
+  const uint8_t *bytes = (const uint8_t *)record + sizeof(record->crc);
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < sizeof(*record) - sizeof(record->crc); i++)
+    crc = crcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFu;
+}
+
+//==============================================================================
+// FILE HELPERS
+//==============================================================================
+
+// Push written data through the OS cache to the disk
+static bool SyncFile(FILE *file) {
+  if (fflush(file) != 0)
+    return false;
+#ifdef _WIN32
+  return _commit(_fileno(file)) == 0;
+#else
+  return fsync(fileno(file)) == 0;
+#endif
+}
+
+static bool WriteJournalHeader(FILE *file) {
+  JournalHeader header = {.version = JOURNAL_VERSION,
+                          .recordSize = sizeof(JournalRecord)};
+  memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+  return fwrite(&header, sizeof(header), 1, file) == 1;
+}
+
+static int64_t WallClockMilliseconds(void) {
+  struct timespec now;
+  timespec_get(&now, TIME_UTC);
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+//==============================================================================
+// WRITER THREAD
+//==============================================================================
+
+// A start record begins the file again; everything else is appended
+static void WriteJournalBatch(FILE **file, const JournalRecord *records,
+                              int count) {
+  bool failed = false;
+  for (int i = 0; i < count; i++) {
+    if (records[i].type == JOURNAL_START || *file == NULL) {
+      bool restart = records[i].type == JOURNAL_START;
+      if (*file != NULL)
+        fclose(*file);
+      *file = fopen(journalPath, restart ? "wb" : "ab");
+      if (*file == NULL || (restart && !WriteJournalHeader(*file))) {
+        failed = true;
+        continue;
+      }
+    }
+    if (fwrite(&records[i], sizeof(records[i]), 1, *file) != 1)
+      failed = true;
+  }
+
+  if (*file != NULL && !SyncFile(*file))
+    failed = true;
+  if (failed)
+    TraceLog(LOG_WARNING, "Could not write the game journal %s", journalPath);
+}
+
+// Whatever piled up while the last batch was synced goes out as one batch
+static void *JournalWriterMain(void *arg) {
+  (void)arg;
+  FILE *file = NULL;
+  JournalRecord *batch = NULL;
+  int batchCapacity = 0;
+
+  pthread_mutex_lock(&journalMutex);
+  for (;;) {
+    while (pendingCount == 0 && !stopRequested)
+      pthread_cond_wait(&journalWake, &journalMutex);
+    if (pendingCount == 0)
+      break;
+
+    JournalRecord *records = pending;
+    int count = pendingCount;
+    int capacity = pendingCapacity;
+    pending = batch;
+    pendingCapacity = batchCapacity;
+    pendingCount = 0;
+    batch = records;
+    batchCapacity = capacity;
+    pthread_mutex_unlock(&journalMutex);
+
+    WriteJournalBatch(&file, batch, count);
+
+    pthread_mutex_lock(&journalMutex);
+  }
+  pthread_mutex_unlock(&journalMutex);
+
+  if (file != NULL)
+    fclose(file);
+  free(batch);
+  return NULL;
+}
+
+static void AppendJournalRecords(JournalRecord *records, int count) {
+  journalEnded = records[count - 1].type == JOURNAL_END;
+  if (!writerRunning || !journalRecording || isMultiplayerGame)
+    return;
+
+  int64_t now = WallClockMilliseconds();
+  for (int i = 0; i < count; i++) {
+    records[i].whiteTime = gameClock.whiteTimeRemaining;
+    records[i].blackTime = gameClock.blackTimeRemaining;
+    records[i].delayState = gameClock.type == CLOCK_BRONSTEIN
+                                ? gameClock.moveStartTime
+                                : gameClock.delayRemaining;
+    records[i].timestamp = now;
+    records[i].crc = RecordCrc(&records[i]);
+  }
+
+  pthread_mutex_lock(&journalMutex);
+  if (pendingCount + count > pendingCapacity) {
+    int capacity = pendingCapacity > 0 ? pendingCapacity : 16;
+    while (capacity < pendingCount + count)
+      capacity *= 2;
+    JournalRecord *grown =
+        realloc(pending, sizeof(JournalRecord) * (size_t)capacity);
+    if (grown == NULL) {
+      pthread_mutex_unlock(&journalMutex);
+      TraceLog(LOG_WARNING, "Game journal record dropped: out of memory");
+      return;
+    }
+    pending = grown;
+    pendingCapacity = capacity;
+  }
+  memcpy(&pending[pendingCount], records,
+         sizeof(JournalRecord) * (size_t)count);
+  pendingCount += count;
+  pthread_cond_signal(&journalWake);
+  pthread_mutex_unlock(&journalMutex);
+}
+
+static void AppendJournalRecord(JournalRecord *record) {
+  AppendJournalRecords(record, 1);
+}
+
+bool StartJournal(const char *path) {
+  if (writerRunning)
+    return true;
+  InitCrcTable();
+  snprintf(journalPath, sizeof(journalPath), "%s", path);
+  stopRequested = false;
+  writerRunning =
+      pthread_create(&writerThread, NULL, JournalWriterMain, NULL) == 0;
+  if (!writerRunning)
+    journalRecording = false;
+  return writerRunning;
+}
+
+void StopJournal(void) {
+  if (!writerRunning)
+    return;
+  pthread_mutex_lock(&journalMutex);
+  stopRequested = true;
+  pthread_cond_signal(&journalWake);
+  pthread_mutex_unlock(&journalMutex);
+  pthread_join(writerThread, NULL);
+  writerRunning = false;
+
+  free(pending);
+  pending = NULL;
+  pendingCount = 0;
+  pendingCapacity = 0;
+}
+
+//==============================================================================
+// RECORDING
+//==============================================================================
+
+void JournalGameStart(void) {
+  journalRecording = !isMultiplayerGame;
+
+  JournalRecord record = {.type = JOURNAL_START,
+                          .clockType = (uint8_t)gameClock.type,
+                          .increment = gameClock.incrementSeconds};
+  AppendJournalRecord(&record);
+}
+
+void JournalMove(Move move) {
+  JournalRecord record = {.type = JOURNAL_MOVE, .move = move};
+  AppendJournalRecord(&record);
+}
+
+void JournalTakeBack(void) {
+  JournalRecord record = {.type = JOURNAL_TAKEBACK};
+  AppendJournalRecord(&record);
+}
+
+void JournalRedo(void) {
+  JournalRecord record = {.type = JOURNAL_REDO};
+  AppendJournalRecord(&record);
+}
+
+void JournalLineChange(int takeBacks, const Move *moves, int moveCount) {
+  int count = takeBacks + moveCount;
+  if (count == 0)
+    return;
+  JournalRecord *records = calloc((size_t)count, sizeof(JournalRecord));
+  if (records == NULL) {
+    TraceLog(LOG_WARNING, "Game journal record dropped: out of memory");
+    return;
+  }
+
+  for (int i = 0; i < takeBacks; i++)
+    records[i].type = JOURNAL_TAKEBACK;
+  for (int i = 0; i < moveCount; i++) {
+    records[takeBacks + i].type = JOURNAL_MOVE;
+    records[takeBacks + i].move = moves[i];
+  }
+  AppendJournalRecords(records, count);
+  free(records);
+}
+
+void JournalGameEnd(void) {
+  if (journalEnded)
+    return;
+  JournalRecord record = {.type = JOURNAL_END};
+  AppendJournalRecord(&record);
+}
+
+//==============================================================================
+// RECOVERY
+//==============================================================================
+
+// Apply one record to the game; false if it cannot follow the ones before.
+// The game clock is set up from the start record, so the clock settings of
+// the menu stay as the player left them.
+static bool ReplayJournalRecord(const JournalRecord *record, bool *started,
+                                bool *ended) {
+  if (record->type != JOURNAL_START && !*started)
+    return false;
+  if (record->type != JOURNAL_TAKEBACK && record->type != JOURNAL_START &&
+      *ended)
+    return false; // Only a takeback or a new game follows the end
+
+  switch (record->type) {
+  case JOURNAL_START:
+    InitBoard();
+    SetupClock(&gameClock, (ClockType)record->clockType, record->whiteTime,
+               record->increment);
+    *started = true;
+    break;
+  case JOURNAL_MOVE: {
+    if (IsGameOver())
+      return false;
+    int from = MOVE_FROM(record->move);
+    int to = MOVE_TO(record->move);
+    if (!PlayMove(SQ_ROW(from), SQ_COL(from), SQ_ROW(to), SQ_COL(to),
+                  MOVE_PROMOTION(record->move)) ||
+        gameState == GAME_PROMOTING)
+      return false;
+    break;
+  }
+  case JOURNAL_TAKEBACK:
+    if (!TakeBackMove())
+      return false;
+    break;
+  case JOURNAL_REDO:
+    if (!RedoMove())
+      return false;
+    break;
+  case JOURNAL_END:
+    break;
+  default:
+    return false;
+  }
+
+  *ended = record->type == JOURNAL_END;
+  gameClock.whiteTimeRemaining = record->whiteTime;
+  gameClock.blackTimeRemaining = record->blackTime;
+  if (gameClock.type == CLOCK_BRONSTEIN)
+    gameClock.moveStartTime = record->delayState;
+  else
+    gameClock.delayRemaining = record->delayState;
+  return true;
+}
+
+// Replace the journal with its first length bytes, through a synced copy
+static bool CutJournal(FILE *source, const char *path, long length) {
+  char tempPath[sizeof(journalPath) + 8];
+  snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+  FILE *copy = fopen(tempPath, "wb");
+  if (copy == NULL)
+    return false;
+
+  char buffer[4096];
+  bool ok = fseek(source, 0, SEEK_SET) == 0;
+  while (ok && length > 0) {
+    size_t chunk =
+        length < (long)sizeof(buffer) ? (size_t)length : sizeof(buffer);
+    ok = fread(buffer, 1, chunk, source) == chunk &&
+         fwrite(buffer, 1, chunk, copy) == chunk;
+    length -= (long)chunk;
+  }
+  ok = SyncFile(copy) && ok;
+  ok = fclose(copy) == 0 && ok;
+
+  // Windows will not rename over an existing file
+  if (ok) {
+    fclose(source);
+    remove(path);
+    ok = rename(tempPath, path) == 0;
+    return ok;
+  }
+  remove(tempPath);
+  fclose(source);
+  return false;
+}
+
+bool RecoverJournal(const char *path) {
+  InitCrcTable();
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return false;
+
+  JournalHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != JOURNAL_VERSION ||
+      header.recordSize != sizeof(JournalRecord)) {
+    fclose(file);
+    remove(path);
+    return false;
+  }
+
+  bool started = false;
+  bool ended = false;
+  long validLength = (long)sizeof(header);
+  JournalRecord record;
+  while (fread(&record, sizeof(record), 1, file) == 1) {
+    if (record.crc != RecordCrc(&record) ||
+        !ReplayJournalRecord(&record, &started, &ended))
+      break;
+    validLength += (long)sizeof(record);
+  }
+
+  if (!started || ended || GetMoveCount() == 0 || IsGameOver()) {
+    fclose(file);
+    remove(path);
+    InitBoard();
+    InitClock();
+    return false;
+  }
+
+  // As the clock was after the last record; RunClock would reset the delay
+  gameClock.isRunning = gameClock.type != CLOCK_NONE;
+  journalEnded = false;
+
+  fseek(file, 0, SEEK_END);
+  long fileLength = ftell(file);
+  if (fileLength != validLength) {
+    TraceLog(LOG_WARNING, "Game journal %s: %ld damaged bytes discarded", path,
+             fileLength - validLength);
+    if (!CutJournal(file, path, validLength)) {
+      // Appending after the damage would lose every later record
+      TraceLog(LOG_WARNING, "Could not repair the game journal %s", path);
+      journalRecording = false;
+      return true;
+    }
+  } else {
+    fclose(file);
+  }
+
+  journalRecording = true;
+  return true;
+}
@@ -0,0 +1,113 @@
+/**
+ * Chess Game - Game Journal
+ * Crash-safe, append-only record of the local game in progress.
+ *
+ * Every move, takeback and redo is appended with both clocks and a
+ * timestamp, each record carrying its own CRC-32, and the end of the game
+ * closes the journal with a record of its own. A background thread
+ * writes the records and syncs the file once per batch, so the game loop
+ * never waits on the disk. On startup an unfinished game is replayed from
+ * the journal through the normal move validation; a torn or corrupt tail
+ * ends the replay and is cut off.
+ */
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "position.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+//==============================================================================
+// JOURNAL CONSTANTS
+//==============================================================================
+
+#define JOURNAL_DEFAULT_PATH "game.journal"
+#define JOURNAL_MAGIC "CHESSJNL"
+#define JOURNAL_VERSION 2
+
+//==============================================================================
+// JOURNAL TYPES
+//==============================================================================
+
+typedef enum {
+  JOURNAL_START,    // A new game; the clock settings
+  JOURNAL_MOVE,     // A move played, with the clocks after it
+  JOURNAL_TAKEBACK, // The last move taken back
+  JOURNAL_REDO,     // The last taken back move played again
+  JOURNAL_END       // The game ended, e.g. on time; nothing to recover
+} JournalRecordType;
+
+// Records are written in the machine's byte order: a journal is only ever
+// read back by the installation that wrote it
+typedef struct {
+  uint32_t crc;       // CRC-32 of the rest of the record
+  uint8_t type;       // JournalRecordType
+  uint8_t clockType;  // JOURNAL_START: ClockType
+  uint16_t move;      // JOURNAL_MOVE: the move played
+  float whiteTime;    // Clocks after the change (base time for a start)
+  float blackTime;
+  float increment;    // JOURNAL_START: increment or delay in seconds
+  float delayState;   // Simple delay: delay left; Bronstein: the time the
+                      // side to move had when its turn began
+  int64_t timestamp;  // Wall-clock milliseconds since the Unix epoch
+} JournalRecord;
+
+//==============================================================================
+// JOURNAL FUNCTIONS
+//==============================================================================
+
+/**
+ * Restore the unfinished game in a journal onto the board and the game
+ * clock, which is left running. Records are replayed up to the first one
+ * that is incomplete, fails its CRC or is not legal, and the file is cut
+ * back to them. A journal of a finished game, or one without moves, is
+ * deleted. The clock settings of the menu are left as they are.
+ * @return true if a game in progress was restored
+ */
+bool RecoverJournal(const char *path);
+
+/**
+ * Start the writer thread for the journal at path. When a game was
+ * recovered the journal is appended to; otherwise it is rewritten at the
+ * next JournalGameStart.
+ */
+bool StartJournal(const char *path);
+
+/**
+ * Write out the records still queued and stop the writer thread.
+ */
+void StopJournal(void);
+
+/**
+ * Begin journaling a new local game with the current clock settings.
+ * Multiplayer games are not journaled.
+ */
+void JournalGameStart(void);
+
+/**
+ * Record a move just played, with the clocks after it.
+ */
+void JournalMove(Move move);
+
+/**
+ * Record a takeback or a redo, with the clocks after it.
+ */
+void JournalTakeBack(void);
+void JournalRedo(void);
+
+/**
+ * Record a switch to another line of the game: the takebacks down to the
+ * position both lines share, then the moves of the new line, all with the
+ * clocks after the switch. They are queued at once, so the writer syncs
+ * them as one batch.
+ */
+void JournalLineChange(int takeBacks, const Move *moves, int moveCount);
+
+/**
+ * Record that the game on the board is over, so it is not recovered. Only
+ * the first call counts until the next move, takeback or new game.
+ */
+void JournalGameEnd(void);
+
+#endif // JOURNAL_H
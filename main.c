@@ -8,18 +8,31 @@
  * - Visual highlighting for valid moves and check state
  * - Chess clock with multiple time control modes
  * - P2P multiplayer with NAT traversal
+ * - Polyglot opening book support
+ * - Syzygy endgame tablebase adjudication
+ * - Multi-PV engine analysis with alternatives in the move history
+ * - Evaluation bar from an always-on, throttled background search
+ * - Crash-safe journal that restores an unfinished local game on startup
  */
 
+#include "analysis.h"
 #include "board.h"
+#include "book.h"
 #include "check.h"
 #include "clock.h"
+#include "explorer.h"
+#include "history.h"
+#include "journal.h"
 #include "menu.h"
 #include "moves.h"
 #include "multiplayer.h"
 #include "network.h"
 #include "raylib.h"
+#include "tbprobe.h"
+#include "tt.h"
 #include "types.h"
 #include "ui.h"
+#include <stdlib.h>
 
 int main(void) {
   InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Chess");
@@ -50,11 +63,47 @@ int main(void) {
   InitBoard();
   InitMultiplayer();
 
+  // Optional opening book; the game runs normally without one
+  if (OpenBook(&openingBook, BOOK_DEFAULT_PATH)) {
+    TraceLog(LOG_INFO, "Opening book loaded: %s", BOOK_DEFAULT_PATH);
+  }
+
+  // Optional move statistics for the opening explorer (E)
+  if (OpenExplorer(&openingExplorer, EXPLORER_DEFAULT_PATH)) {
+    TraceLog(LOG_INFO, "Opening explorer loaded: %s", EXPLORER_DEFAULT_PATH);
+  }
+
+  // Optional endgame tablebases; files are only mapped when first probed
+  const char *tablebasePath = getenv(TB_PATH_ENV);
+  int tablebaseCount =
+      InitTablebases(tablebasePath ? tablebasePath : TB_DEFAULT_PATH);
+  if (tablebaseCount > 0) {
+    TraceLog(LOG_INFO, "Tablebases found: %d (up to %d pieces)",
+             tablebaseCount, GetTablebaseMaxPieces());
+  }
+
+  // Engine analysis shares one transposition table
+  if (!ResizeTranspositionTable(&transpositionTable, TT_DEFAULT_MB)) {
+    TraceLog(LOG_WARNING, "Could not allocate the transposition table");
+  }
+
+  // An unfinished local game left by a crash continues where it stopped
+  if (RecoverJournal(JOURNAL_DEFAULT_PATH)) {
+    TraceLog(LOG_INFO, "Unfinished game recovered from %s (%d moves)",
+             JOURNAL_DEFAULT_PATH, GetMoveCount());
+    currentScreen = SCREEN_GAME;
+  }
+  if (!StartJournal(JOURNAL_DEFAULT_PATH)) {
+    TraceLog(LOG_WARNING, "Could not start the game journal");
+  }
+  InitAnalysis();
+
   while (!WindowShouldClose()) {
     // ESC returns to menu (does nothing on title screen)
     // Various screens have their own ESC handling
     if (IsKeyPressed(KEY_ESCAPE) && currentScreen == SCREEN_GAME) {
       StopClock();
+      SuspendAnalysis();
       if (isMultiplayerGame) {
         DisconnectNetwork();
         ResetMultiplayer();
@@ -101,6 +150,8 @@ int main(void) {
       break;
 
     case SCREEN_GAME:
+      UpdateAnalysis();
+
       // Update clock and check for timeout
       if (gameState == GAME_PLAYING || gameState == GAME_CHECK) {
         UpdateClock(currentTurn);
@@ -108,16 +159,22 @@ int main(void) {
         if (flagged != COLOR_NONE) {
           gameState = GAME_TIMEOUT;
         }
+        UpdateAdjudication();
       }
+      ArchiveFinishedGame();
+      if (IsGameOver())
+        JournalGameEnd(); // A lost-on-time game must not come back
 
       if (gameState == GAME_PROMOTING) {
         HandlePromotion();
-      } else if (gameState == GAME_CHECKMATE || gameState == GAME_STALEMATE ||
-                 gameState == GAME_TIMEOUT) {
+      } else if (IsGameOver()) {
         if (IsKeyPressed(KEY_R) && !isMultiplayerGame) {
           InitBoard();
           InitClock();
           StartClock();
+          JournalGameStart();
+        } else if (IsKeyPressed(KEY_Z) && !isMultiplayerGame) {
+          TakeBackMove();
         }
       } else {
         // Only handle input if it's the local player's turn (or local game)
@@ -163,17 +220,18 @@ int main(void) {
       break;
 
     case SCREEN_GAME:
+      DrawEvalBar();
       DrawBoard();
       DrawValidMoves();
       DrawPieces();
+      DrawHint();
       DrawUI();
       DrawClocks();
       DrawMoveHistory();
 
       if (gameState == GAME_PROMOTING) {
         DrawPromotionUI();
-      } else if (gameState == GAME_CHECKMATE || gameState == GAME_STALEMATE ||
-                 gameState == GAME_TIMEOUT) {
+      } else if (IsGameOver() && !IsReviewing()) {
         DrawGameOverScreen();
       }
       break;
@@ -182,8 +240,17 @@ int main(void) {
     EndDrawing();
   }
 
+  ShutdownAnalysis();
+  StopJournal();
+  FreeMoveHistory();
+  FreeTranspositionTable(&transpositionTable);
   ShutdownNetwork();
+  CloseBook(&openingBook);
+  CloseExplorer(&openingExplorer);
+  ShutdownTablebases();
   UnloadPiecesTexture();
+  UnloadUiLayers();
+  UnloadTitleBackground();
   CloseWindow();
   return 0;
 }
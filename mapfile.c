@@ -0,0 +1,110 @@
+/**
+ * Chess Game - Memory-Mapped Files
+ * Read-only file mapping for large data files (books, tablebases).
+ */
+
+#include "mapfile.h"
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//==============================================================================
+// PLATFORM MAPPING
+//==============================================================================
+
+#ifdef _WIN32
+
+bool MapFile(MappedFile *file, const char *path, MapAccessHint hint) {
+  memset(file, 0, sizeof(*file));
+
+  DWORD flags = FILE_ATTRIBUTE_NORMAL;
+  if (hint == MAP_ACCESS_RANDOM)
+    flags |= FILE_FLAG_RANDOM_ACCESS;
+  else if (hint == MAP_ACCESS_SEQUENTIAL)
+    flags |= FILE_FLAG_SEQUENTIAL_SCAN;
+
+  HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, flags, NULL);
+  if (handle == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) {
+    CloseHandle(handle);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mapping == NULL) {
+    CloseHandle(handle);
+    return false;
+  }
+
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == NULL) {
+    CloseHandle(mapping);
+    CloseHandle(handle);
+    return false;
+  }
+
+  file->data = (const unsigned char *)data;
+  file->size = (size_t)size.QuadPart;
+  file->fileHandle = handle;
+  file->mappingHandle = mapping;
+  return true;
+}
+
+void UnmapFile(MappedFile *file) {
+  if (file->data != NULL) {
+    UnmapViewOfFile((void *)file->data);
+    CloseHandle(file->mappingHandle);
+    CloseHandle(file->fileHandle);
+  }
+  memset(file, 0, sizeof(*file));
+}
+
+#else
+
+bool MapFile(MappedFile *file, const char *path, MapAccessHint hint) {
+  memset(file, 0, sizeof(*file));
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (data == MAP_FAILED)
+    return false;
+
+  if (hint == MAP_ACCESS_RANDOM)
+    madvise(data, (size_t)st.st_size, MADV_RANDOM);
+  else if (hint == MAP_ACCESS_SEQUENTIAL)
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+  file->data = (const unsigned char *)data;
+  file->size = (size_t)st.st_size;
+  return true;
+}
+
+void UnmapFile(MappedFile *file) {
+  if (file->data != NULL)
+    munmap((void *)file->data, file->size);
+  memset(file, 0, sizeof(*file));
+}
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * Chess Game - Memory-Mapped Files
+ * Read-only file mapping for large data files (books, tablebases).
+ */
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+//==============================================================================
+// MAPPED FILE TYPES
+//==============================================================================
+
+// How the mapping will be read, passed on to the OS as a paging hint
+typedef enum {
+  MAP_ACCESS_NORMAL = 0,
+  MAP_ACCESS_RANDOM,    // Scattered lookups (binary search, probing)
+  MAP_ACCESS_SEQUENTIAL // One front-to-back pass (imports, scans)
+} MapAccessHint;
+
+typedef struct {
+  const unsigned char *data; // NULL when not mapped
+  size_t size;
+#ifdef _WIN32
+  void *fileHandle;
+  void *mappingHandle;
+#endif
+} MappedFile;
+
+//==============================================================================
+// MAPPED FILE FUNCTIONS
+//==============================================================================
+
+/**
+ * Map a whole file read-only. Pages are loaded lazily by the OS, so mapping
+ * a file of any size costs no heap memory and no up-front reads.
+ * @return false if the file is missing, empty or cannot be mapped
+ */
+bool MapFile(MappedFile *file, const char *path, MapAccessHint hint);
+
+/**
+ * Release a mapping created by MapFile. Safe on an unmapped file.
+ */
+void UnmapFile(MappedFile *file);
+
+#endif // MAPFILE_H
@@ -0,0 +1,341 @@
+/**
+ * Chess Game - Mate Solver
+ * Depth-first proof-number search for forced mates.
+ *
+ * Every node stores a (phi, delta) pair from the point of view of its side
+ * to move: phi is the number of leaves still needed to prove a win for that
+ * side, delta the number needed to refute it. The attacker "wins" by mating
+ * within the remaining plies; the defender wins by surviving them. The search
+ * always descends into the most promising child and only backs up when the
+ * parent's thresholds are exceeded, so it stays depth-first with a small
+ * stack while the table keeps the tree.
+ */
+
+#include "mate.h"
+#include "search.h"
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// SOLVER PARAMETERS
+//==============================================================================
+
+#define MATE_INFINITE 100000000u // Proof numbers saturate here
+#define MATE_BUCKET_SIZE 4
+#define MATE_CHECK_INTERVAL 1024
+
+//==============================================================================
+// HASH TABLE
+//==============================================================================
+
+// The plies left are part of the key: a mate in 3 is no mate in 2
+static uint64_t NodeKey(uint64_t key, int remaining) {
+  return key ^ ((uint64_t)(remaining + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+static MateEntry *FindEntry(MateSolver *solver, uint64_t nodeKey) {
+  size_t index = (size_t)nodeKey & (solver->entryCount - 1) &
+                 ~(size_t)(MATE_BUCKET_SIZE - 1);
+  MateEntry *bucket = &solver->entries[index];
+  for (int i = 0; i < MATE_BUCKET_SIZE; i++) {
+    if (bucket[i].key == nodeKey)
+      return &bucket[i];
+  }
+  return NULL;
+}
+
+static void LookupNode(MateSolver *solver, uint64_t nodeKey, uint32_t *phi,
+                       uint32_t *delta) {
+  MateEntry *entry = FindEntry(solver, nodeKey);
+  if (entry != NULL) {
+    *phi = entry->phi;
+    *delta = entry->delta;
+  } else {
+    *phi = 1;
+    *delta = 1;
+  }
+}
+
+// Replace the entry with the least work behind it
+static void StoreNode(MateSolver *solver, uint64_t nodeKey, uint32_t phi,
+                      uint32_t delta, uint64_t work) {
+  MateEntry *entry = FindEntry(solver, nodeKey);
+  if (entry == NULL) {
+    size_t index = (size_t)nodeKey & (solver->entryCount - 1) &
+                   ~(size_t)(MATE_BUCKET_SIZE - 1);
+    MateEntry *bucket = &solver->entries[index];
+    entry = &bucket[0];
+    for (int i = 1; i < MATE_BUCKET_SIZE; i++) {
+      if (bucket[i].work < entry->work)
+        entry = &bucket[i];
+    }
+  }
+
+  entry->key = nodeKey;
+  entry->phi = phi;
+  entry->delta = delta;
+  entry->work = work > UINT32_MAX ? UINT32_MAX : (uint32_t)work;
+}
+
+bool InitMateSolver(MateSolver *solver, size_t megabytes) {
+  memset(solver, 0, sizeof(*solver));
+
+  size_t count = MATE_BUCKET_SIZE;
+  while (count * 2 * sizeof(MateEntry) <= megabytes * 1024 * 1024)
+    count *= 2;
+
+  solver->entries = calloc(count, sizeof(MateEntry));
+  if (solver->entries == NULL)
+    return false;
+  solver->entryCount = count;
+  return true;
+}
+
+void FreeMateSolver(MateSolver *solver) {
+  free(solver->entries);
+  solver->entries = NULL;
+  solver->entryCount = 0;
+}
+
+void ClearMateSolver(MateSolver *solver) {
+  if (solver->entries != NULL)
+    memset(solver->entries, 0, solver->entryCount * sizeof(MateEntry));
+}
+
+//==============================================================================
+// MOVE GENERATION
+//==============================================================================
+
+// Attacker to move when an odd number of plies is left
+static bool IsAttackerNode(int remaining) { return remaining & 1; }
+
+// Legal moves worth trying here; with one ply left only checks can mate.
+// Child keys are kept so the search loop can read the table without
+// replaying every move.
+static void GenerateNodeMoves(ChessPosition *pos, int remaining,
+                              MoveList *list, uint64_t *childKeys) {
+  MoveList pseudo;
+  GenerateMoves(pos, &pseudo);
+  PieceColor us = pos->sideToMove;
+
+  list->count = 0;
+  for (int i = 0; i < pseudo.count; i++) {
+    MoveUndo undo;
+    MakeMove(pos, pseudo.moves[i], &undo);
+    bool legal = !IsKingInCheck(pos, us);
+    bool keep = legal && (remaining != 1 || IsKingInCheck(pos, pos->sideToMove));
+    if (keep) {
+      childKeys[list->count] = NodeKey(pos->key, remaining - 1);
+      list->moves[list->count++] = pseudo.moves[i];
+    }
+    UnmakeMove(pos, pseudo.moves[i], &undo);
+  }
+}
+
+static bool HasLegalMove(ChessPosition *pos) {
+  MoveList pseudo;
+  GenerateMoves(pos, &pseudo);
+  for (int i = 0; i < pseudo.count; i++) {
+    if (IsMoveLegal(pos, pseudo.moves[i]))
+      return true;
+  }
+  return false;
+}
+
+//==============================================================================
+// SEARCH
+//==============================================================================
+
+static void CheckSolverLimits(MateSolver *solver) {
+  if (solver->nodeLimit && solver->nodes >= solver->nodeLimit)
+    solver->aborted = true;
+  if (solver->deadline && GetTimeMilliseconds() >= solver->deadline)
+    solver->aborted = true;
+  if (solver->stop != NULL && atomic_load(solver->stop))
+    solver->aborted = true;
+}
+
+static uint32_t AddSaturated(uint32_t a, uint32_t b) {
+  uint64_t sum = (uint64_t)a + b;
+  return sum >= MATE_INFINITE ? MATE_INFINITE : (uint32_t)sum;
+}
+
+// Expand a node until its proof numbers reach a threshold
+static void SearchNode(MateSolver *solver, ChessPosition *pos, int remaining,
+                       uint32_t thresholdPhi, uint32_t thresholdDelta) {
+  uint64_t nodeKey = NodeKey(pos->key, remaining);
+  uint64_t startNodes = solver->nodes;
+
+  if (++solver->nodes % MATE_CHECK_INTERVAL == 0)
+    CheckSolverLimits(solver);
+
+  // Defender to move with no plies left: mated or escaped
+  if (remaining == 0) {
+    bool mated = IsKingInCheck(pos, pos->sideToMove) && !HasLegalMove(pos);
+    StoreNode(solver, nodeKey, mated ? MATE_INFINITE : 0,
+              mated ? 0 : MATE_INFINITE, 1);
+    return;
+  }
+
+  MoveList list;
+  uint64_t childKeys[MOVE_LIST_CAPACITY];
+  GenerateNodeMoves(pos, remaining, &list, childKeys);
+
+  if (list.count == 0) {
+    // The attacker has no (checking) move left, or the defender is mated
+    // or stalemated
+    bool won =
+        !IsAttackerNode(remaining) && !IsKingInCheck(pos, pos->sideToMove);
+    StoreNode(solver, nodeKey, won ? 0 : MATE_INFINITE, won ? MATE_INFINITE : 0,
+              1);
+    return;
+  }
+
+  uint32_t phi = 0;
+  uint32_t delta = 0;
+  for (;;) {
+    // Refuting one child proves this node (phi is the cheapest such child);
+    // refuting this node takes proving every child (delta is their sum)
+    int best = -1;
+    uint32_t bestDelta = MATE_INFINITE + 1;
+    uint32_t secondDelta = MATE_INFINITE;
+    uint32_t bestPhi = 0;
+    delta = 0;
+
+    for (int i = 0; i < list.count; i++) {
+      uint32_t childPhi, childDelta;
+      LookupNode(solver, childKeys[i], &childPhi, &childDelta);
+      delta = AddSaturated(delta, childPhi);
+      if (childDelta < bestDelta) {
+        secondDelta = bestDelta;
+        bestDelta = childDelta;
+        bestPhi = childPhi;
+        best = i;
+      } else if (childDelta < secondDelta) {
+        secondDelta = childDelta;
+      }
+    }
+    phi = bestDelta;
+
+    if (phi == 0 || delta == 0 || phi >= thresholdPhi ||
+        delta >= thresholdDelta || solver->aborted)
+      break;
+
+    // Give the child just enough room to overtake the runner-up
+    uint32_t childThresholdPhi =
+        AddSaturated(thresholdDelta - delta, bestPhi);
+    uint32_t childThresholdDelta = AddSaturated(secondDelta, 1);
+    if (childThresholdDelta > thresholdPhi)
+      childThresholdDelta = thresholdPhi;
+
+    MoveUndo undo;
+    MakeMove(pos, list.moves[best], &undo);
+    SearchNode(solver, pos, remaining - 1, childThresholdPhi,
+               childThresholdDelta);
+    UnmakeMove(pos, list.moves[best], &undo);
+  }
+
+  StoreNode(solver, nodeKey, phi, delta, solver->nodes - startNodes);
+}
+
+//==============================================================================
+// SOLUTION EXTRACTION
+//==============================================================================
+
+// Fewest plies (at most limit) in which the table proves a child
+static int ProvenPlies(MateSolver *solver, uint64_t key, int limit,
+                       bool attackerToMove) {
+  for (int plies = attackerToMove ? 1 : 0; plies <= limit; plies += 2) {
+    MateEntry *entry = FindEntry(solver, NodeKey(key, plies));
+    if (entry == NULL)
+      continue;
+    // A proof for the attacker: phi == 0 at its nodes, delta == 0 at the
+    // defender's
+    if ((attackerToMove ? entry->phi : entry->delta) == 0)
+      return plies;
+  }
+  return -1;
+}
+
+// Follow the proof: the attacker takes the quickest mate, the defender
+// the longest resistance
+static void ExtractMateLine(MateSolver *solver, const ChessPosition *root,
+                            int remaining, MateResult *result) {
+  ChessPosition pos = *root;
+  result->pvLength = 0;
+
+  while (remaining > 0 && result->pvLength < 2 * MATE_MAX_MOVES) {
+    bool attacker = IsAttackerNode(remaining);
+    MoveList list;
+    uint64_t childKeys[MOVE_LIST_CAPACITY];
+    GenerateNodeMoves(&pos, remaining, &list, childKeys);
+
+    Move chosen = MOVE_NONE;
+    int chosenPlies = attacker ? remaining : -1;
+    for (int i = 0; i < list.count; i++) {
+      MoveUndo undo;
+      MakeMove(&pos, list.moves[i], &undo);
+      int plies = ProvenPlies(solver, pos.key, remaining - 1, !attacker);
+      UnmakeMove(&pos, list.moves[i], &undo);
+
+      // Every defence is proven, so a missing one was only overwritten;
+      // an attacking move without a proof is no solution
+      if (plies < 0 && attacker)
+        continue;
+      if (plies < 0)
+        plies = remaining - 1;
+      if ((attacker && plies < chosenPlies) ||
+          (!attacker && plies > chosenPlies)) {
+        chosen = list.moves[i];
+        chosenPlies = plies;
+      }
+    }
+
+    if (chosen == MOVE_NONE)
+      return;
+
+    MoveUndo undo;
+    result->pv[result->pvLength++] = chosen;
+    MakeMove(&pos, chosen, &undo);
+    remaining = chosenPlies;
+  }
+}
+
+bool FindMate(MateSolver *solver, const ChessPosition *pos, int maxMoves,
+              uint64_t nodeLimit, int64_t timeLimitMs, MateResult *result) {
+  memset(result, 0, sizeof(*result));
+  if (maxMoves > MATE_MAX_MOVES)
+    maxMoves = MATE_MAX_MOVES;
+
+  int64_t start = GetTimeMilliseconds();
+  solver->nodes = 0;
+  solver->nodeLimit = nodeLimit;
+  solver->deadline = timeLimitMs > 0 ? start + timeLimitMs : 0;
+  solver->aborted = false;
+
+  ChessPosition root = *pos;
+  result->complete = true;
+
+  // Shorter mates first: each length only costs a fraction of the next
+  for (int moves = 1; moves <= maxMoves; moves++) {
+    int plies = 2 * moves - 1;
+    SearchNode(solver, &root, plies, MATE_INFINITE, MATE_INFINITE);
+
+    if (solver->aborted) {
+      result->complete = false;
+      break;
+    }
+
+    uint32_t phi, delta;
+    LookupNode(solver, NodeKey(root.key, plies), &phi, &delta);
+    if (phi == 0) {
+      result->mateIn = moves;
+      ExtractMateLine(solver, &root, plies, result);
+      break;
+    }
+  }
+
+  result->nodes = solver->nodes;
+  result->timeMs = GetTimeMilliseconds() - start;
+  return result->mateIn > 0;
+}
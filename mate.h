@@ -0,0 +1,83 @@
+/**
+ * Chess Game - Mate Solver
+ * Depth-first proof-number search for forced mates.
+ */
+
+#ifndef MATE_H
+#define MATE_H
+
+#include "movegen.h"
+#include <stdatomic.h>
+
+//==============================================================================
+// MATE SOLVER CONSTANTS
+//==============================================================================
+
+#define MATE_MAX_MOVES 32
+#define MATE_DEFAULT_MB 16
+
+//==============================================================================
+// MATE SOLVER TYPES
+//==============================================================================
+
+// Proof and disproof numbers of one node, keyed by position and the plies
+// left, since a proof only holds within its depth
+typedef struct {
+  uint64_t key;
+  uint32_t phi;   // Proof number for the side to move at that node
+  uint32_t delta; // Disproof number for the side to move
+  uint32_t work;  // Nodes spent below it, to keep expensive results
+  uint32_t padding;
+} MateEntry;
+
+typedef struct {
+  MateEntry *entries;
+  size_t entryCount; // Power of two
+  uint64_t nodes;
+  uint64_t nodeLimit; // 0 for no limit
+  int64_t deadline;   // GetTimeMilliseconds() value, 0 for no limit
+  atomic_bool *stop;  // Set by another thread to end the search (may be NULL)
+  bool aborted;
+} MateSolver;
+
+typedef struct {
+  int mateIn;    // Moves to mate, 0 if none was found
+  bool complete; // false if a limit stopped the search before maxMoves
+  uint64_t nodes;
+  int64_t timeMs;
+  int pvLength;
+  Move pv[2 * MATE_MAX_MOVES];
+} MateResult;
+
+//==============================================================================
+// MATE SOLVER FUNCTIONS
+//==============================================================================
+
+/**
+ * Allocate the solver's own hash table.
+ * @return false if the allocation failed
+ */
+bool InitMateSolver(MateSolver *solver, size_t megabytes);
+
+/**
+ * Free the solver's hash table.
+ */
+void FreeMateSolver(MateSolver *solver);
+
+/**
+ * Forget all proofs (they stay valid between positions, so this is only
+ * needed to bound memory use over long batches).
+ */
+void ClearMateSolver(MateSolver *solver);
+
+/**
+ * Look for a forced mate by the side to move in at most maxMoves moves,
+ * trying each length in turn so the shortest mate is reported.
+ * @param nodeLimit Stop after this many nodes (0 for no limit)
+ * @param timeLimitMs Stop after this many milliseconds (0 for no limit)
+ * @return true if a mate was found
+ */
+bool FindMate(MateSolver *solver, const ChessPosition *pos, int maxMoves,
+              uint64_t nodeLimit, int64_t timeLimitMs, MateResult *result);
+
+#endif // MATE_H
@@ -6,6 +6,7 @@
 #include "menu.h"
 #include "board.h"
 #include "clock.h"
+#include "journal.h"
 #include "multiplayer.h"
 #include "network.h"
 #include "ui.h"
@@ -112,8 +113,10 @@ bool DrawMenuButton(int x, int y, int width, int height, const char *text) {
 // TITLE SCREEN
 //==============================================================================
 
-void DrawTitleScreen(void) {
-  // Draw decorative checkerboard pattern (faded) covering full window
+static LayerCache titleLayer = {0}; // Background under the title and menus
+
+// Decorative checkerboard pattern (faded) covering full window
+static void DrawTitleCheckerboard(void) {
   int cols = (WINDOW_WIDTH + TILE_SIZE - 1) / TILE_SIZE;
   int rows = (WINDOW_HEIGHT + TILE_SIZE - 1) / TILE_SIZE;
   for (int row = 0; row < rows; row++) {
@@ -125,6 +128,23 @@ void DrawTitleScreen(void) {
       DrawRectangle(x, y, TILE_SIZE, TILE_SIZE, squareColor);
     }
   }
+}
+
+void UnloadTitleBackground(void) { UnloadLayerCache(&titleLayer); }
+
+void DrawTitleScreen(void) {
+  // The checkerboard is blended over the cleared background once and then
+  // copied, under every menu
+  if (!titleLayer.valid &&
+      BeginLayerCache(&titleLayer, WINDOW_WIDTH, WINDOW_HEIGHT)) {
+    ClearBackground(COLOR_BACKGROUND);
+    DrawTitleCheckerboard();
+    EndLayerCache(&titleLayer);
+  }
+  if (titleLayer.valid)
+    DrawLayerCache(&titleLayer, 0, 0);
+  else
+    DrawTitleCheckerboard();
 
   // Draw floating pieces
   DrawFloatingPieces();
@@ -188,7 +208,7 @@ void DrawOptionsScreen(void) {
 
   // Options panel
   int panelWidth = 350;
-  int panelHeight = 300;
+  int panelHeight = 320;
   int panelX = (WINDOW_WIDTH - panelWidth) / 2;
   int panelY = (WINDOW_HEIGHT - panelHeight) / 2;
 
@@ -216,6 +236,8 @@ void DrawOptionsScreen(void) {
            LIGHTGRAY);
   DrawText("- Press ESC for menu", panelX + 25, panelY + 215, FONT_SIZE_SMALL,
            LIGHTGRAY);
+  DrawText("- Press B for a book move", panelX + 25, panelY + 235,
+           FONT_SIZE_SMALL, LIGHTGRAY);
 
   // Back button
   int buttonWidth = 150;
@@ -464,6 +486,7 @@ void DrawClockSetupScreen(void) {
     InitBoard();
     InitClock();
     StartClock();
+    JournalGameStart();
     currentScreen = SCREEN_GAME;
   }
 }
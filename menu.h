@@ -33,6 +33,11 @@ void UpdateFloatingPieces(void);
  */
 void DrawTitleScreen(void);
 
+/**
+ * Release the cached title screen background.
+ */
+void UnloadTitleBackground(void);
+
 /**
  * Handle title screen input.
  */
@@ -0,0 +1,521 @@
+/**
+ * Chess Game - Move Generation
+ * Move generation over ChessPosition for the engine and tablebase modules.
+ */
+
+#include "movegen.h"
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// DIRECTION TABLES
+//==============================================================================
+
+// Kept local so the engine does not depend on the GUI constants
+static const int STRAIGHT_STEPS[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+static const int DIAGONAL_STEPS[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+static const int KNIGHT_STEPS[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2},
+                                       {1, -2},  {1, 2},  {2, -1},  {2, 1}};
+static const int KING_STEPS[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1},
+                                     {0, 1},   {1, -1}, {1, 0},  {1, 1}};
+
+static bool OnBoard(int row, int col) {
+  return row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE;
+}
+
+//==============================================================================
+// ATTACK DETECTION
+//==============================================================================
+
+static bool SlidingAttack(const ChessPosition *pos, int row, int col,
+                          const int steps[4][2], PieceCode slider,
+                          PieceCode queen) {
+  for (int d = 0; d < 4; d++) {
+    int r = row + steps[d][0];
+    int c = col + steps[d][1];
+    while (OnBoard(r, c)) {
+      PieceCode piece = pos->squares[SQ(r, c)];
+      if (piece != NO_PIECE) {
+        if (piece == slider || piece == queen)
+          return true;
+        break;
+      }
+      r += steps[d][0];
+      c += steps[d][1];
+    }
+  }
+  return false;
+}
+
+bool IsSquareAttackedBy(const ChessPosition *pos, int sq, PieceColor byColor) {
+  int row = SQ_ROW(sq);
+  int col = SQ_COL(sq);
+
+  // Pawns attack towards the opponent: white pawns sit one row below
+  int pawnRow = row + ((byColor == COLOR_WHITE) ? 1 : -1);
+  PieceCode pawn = PIECE_CODE(PIECE_PAWN, byColor);
+  for (int dc = -1; dc <= 1; dc += 2) {
+    if (OnBoard(pawnRow, col + dc) &&
+        pos->squares[SQ(pawnRow, col + dc)] == pawn)
+      return true;
+  }
+
+  PieceCode knight = PIECE_CODE(PIECE_KNIGHT, byColor);
+  for (int i = 0; i < 8; i++) {
+    int r = row + KNIGHT_STEPS[i][0];
+    int c = col + KNIGHT_STEPS[i][1];
+    if (OnBoard(r, c) && pos->squares[SQ(r, c)] == knight)
+      return true;
+  }
+
+  PieceCode king = PIECE_CODE(PIECE_KING, byColor);
+  for (int i = 0; i < 8; i++) {
+    int r = row + KING_STEPS[i][0];
+    int c = col + KING_STEPS[i][1];
+    if (OnBoard(r, c) && pos->squares[SQ(r, c)] == king)
+      return true;
+  }
+
+  PieceCode queen = PIECE_CODE(PIECE_QUEEN, byColor);
+  return SlidingAttack(pos, row, col, STRAIGHT_STEPS,
+                       PIECE_CODE(PIECE_ROOK, byColor), queen) ||
+         SlidingAttack(pos, row, col, DIAGONAL_STEPS,
+                       PIECE_CODE(PIECE_BISHOP, byColor), queen);
+}
+
+bool IsKingInCheck(const ChessPosition *pos, PieceColor color) {
+  int kingSq = pos->kingSquare[color];
+  return kingSq != NO_SQUARE &&
+         IsSquareAttackedBy(pos, kingSq, OPPONENT_COLOR(color));
+}
+
+//==============================================================================
+// PIECE-SPECIFIC GENERATION
+//==============================================================================
+
+static void AddMove(MoveList *list, int from, int to, PieceType promotion) {
+  list->moves[list->count++] = MAKE_MOVE(from, to, promotion);
+}
+
+static void AddPromotions(MoveList *list, int from, int to) {
+  AddMove(list, from, to, PIECE_QUEEN);
+  AddMove(list, from, to, PIECE_ROOK);
+  AddMove(list, from, to, PIECE_BISHOP);
+  AddMove(list, from, to, PIECE_KNIGHT);
+}
+
+static void GeneratePawnMoves(const ChessPosition *pos, MoveList *list,
+                              int from, bool capturesOnly) {
+  PieceColor us = pos->sideToMove;
+  int row = SQ_ROW(from);
+  int col = SQ_COL(from);
+  int direction = (us == COLOR_WHITE) ? -1 : 1;
+  int startRow = (us == COLOR_WHITE) ? 6 : 1;
+  int promotionRow = (us == COLOR_WHITE) ? 0 : 7;
+  int ahead = row + direction;
+
+  // Pushes; promotions count as tactical moves for quiescence
+  int to = SQ(ahead, col);
+  if (pos->squares[to] == NO_PIECE) {
+    if (ahead == promotionRow) {
+      AddPromotions(list, from, to);
+    } else if (!capturesOnly) {
+      AddMove(list, from, to, PIECE_NONE);
+      int twoAhead = SQ(ahead + direction, col);
+      if (row == startRow && pos->squares[twoAhead] == NO_PIECE)
+        AddMove(list, from, twoAhead, PIECE_NONE);
+    }
+  }
+
+  // Captures, en passant included
+  for (int dc = -1; dc <= 1; dc += 2) {
+    if (!OnBoard(ahead, col + dc))
+      continue;
+    to = SQ(ahead, col + dc);
+    PieceCode target = pos->squares[to];
+    bool enemy = target != NO_PIECE && CODE_COLOR(target) != us;
+    if (enemy && ahead == promotionRow)
+      AddPromotions(list, from, to);
+    else if (enemy || to == pos->enPassantSquare)
+      AddMove(list, from, to, PIECE_NONE);
+  }
+}
+
+static void GenerateStepMoves(const ChessPosition *pos, MoveList *list,
+                              int from, const int steps[8][2],
+                              bool capturesOnly) {
+  PieceColor us = pos->sideToMove;
+  for (int i = 0; i < 8; i++) {
+    int r = SQ_ROW(from) + steps[i][0];
+    int c = SQ_COL(from) + steps[i][1];
+    if (!OnBoard(r, c))
+      continue;
+    PieceCode target = pos->squares[SQ(r, c)];
+    if (target == NO_PIECE ? !capturesOnly : CODE_COLOR(target) != us)
+      AddMove(list, from, SQ(r, c), PIECE_NONE);
+  }
+}
+
+static void GenerateSlidingMoves(const ChessPosition *pos, MoveList *list,
+                                 int from, const int steps[4][2],
+                                 bool capturesOnly) {
+  PieceColor us = pos->sideToMove;
+  for (int d = 0; d < 4; d++) {
+    int r = SQ_ROW(from) + steps[d][0];
+    int c = SQ_COL(from) + steps[d][1];
+    while (OnBoard(r, c)) {
+      PieceCode target = pos->squares[SQ(r, c)];
+      if (target != NO_PIECE) {
+        if (CODE_COLOR(target) != us)
+          AddMove(list, from, SQ(r, c), PIECE_NONE);
+        break;
+      }
+      if (!capturesOnly)
+        AddMove(list, from, SQ(r, c), PIECE_NONE);
+      r += steps[d][0];
+      c += steps[d][1];
+    }
+  }
+}
+
+// Castling needs the rights, empty squares between king and rook, and no
+// attack on the king's start, transit and destination squares
+static void GenerateCastling(const ChessPosition *pos, MoveList *list) {
+  PieceColor us = pos->sideToMove;
+  PieceColor them = OPPONENT_COLOR(us);
+  int row = (us == COLOR_WHITE) ? 7 : 0;
+  int kingSide = (us == COLOR_WHITE) ? CASTLE_WHITE_KINGSIDE
+                                     : CASTLE_BLACK_KINGSIDE;
+  int queenSide = (us == COLOR_WHITE) ? CASTLE_WHITE_QUEENSIDE
+                                      : CASTLE_BLACK_QUEENSIDE;
+  int from = SQ(row, 4);
+
+  if (!(pos->castlingRights & (kingSide | queenSide)) ||
+      pos->squares[from] != PIECE_CODE(PIECE_KING, us) ||
+      IsSquareAttackedBy(pos, from, them))
+    return;
+
+  if ((pos->castlingRights & kingSide) &&
+      pos->squares[SQ(row, 5)] == NO_PIECE &&
+      pos->squares[SQ(row, 6)] == NO_PIECE &&
+      !IsSquareAttackedBy(pos, SQ(row, 5), them) &&
+      !IsSquareAttackedBy(pos, SQ(row, 6), them))
+    AddMove(list, from, SQ(row, 6), PIECE_NONE);
+
+  if ((pos->castlingRights & queenSide) &&
+      pos->squares[SQ(row, 3)] == NO_PIECE &&
+      pos->squares[SQ(row, 2)] == NO_PIECE &&
+      pos->squares[SQ(row, 1)] == NO_PIECE &&
+      !IsSquareAttackedBy(pos, SQ(row, 3), them) &&
+      !IsSquareAttackedBy(pos, SQ(row, 2), them))
+    AddMove(list, from, SQ(row, 2), PIECE_NONE);
+}
+
+//==============================================================================
+// MOVE GENERATION
+//==============================================================================
+
+static void GeneratePieceMoves(const ChessPosition *pos, MoveList *list,
+                               int sq, bool capturesOnly) {
+  switch (CODE_TYPE(pos->squares[sq])) {
+  case PIECE_PAWN:
+    GeneratePawnMoves(pos, list, sq, capturesOnly);
+    break;
+  case PIECE_KNIGHT:
+    GenerateStepMoves(pos, list, sq, KNIGHT_STEPS, capturesOnly);
+    break;
+  case PIECE_BISHOP:
+    GenerateSlidingMoves(pos, list, sq, DIAGONAL_STEPS, capturesOnly);
+    break;
+  case PIECE_ROOK:
+    GenerateSlidingMoves(pos, list, sq, STRAIGHT_STEPS, capturesOnly);
+    break;
+  case PIECE_QUEEN:
+    GenerateSlidingMoves(pos, list, sq, STRAIGHT_STEPS, capturesOnly);
+    GenerateSlidingMoves(pos, list, sq, DIAGONAL_STEPS, capturesOnly);
+    break;
+  case PIECE_KING:
+    GenerateStepMoves(pos, list, sq, KING_STEPS, capturesOnly);
+    if (!capturesOnly)
+      GenerateCastling(pos, list);
+    break;
+  default:
+    break;
+  }
+}
+
+static void Generate(const ChessPosition *pos, MoveList *list,
+                     bool capturesOnly) {
+  list->count = 0;
+
+  for (int sq = 0; sq < SQUARE_COUNT; sq++) {
+    PieceCode piece = pos->squares[sq];
+    if (piece != NO_PIECE && CODE_COLOR(piece) == pos->sideToMove)
+      GeneratePieceMoves(pos, list, sq, capturesOnly);
+  }
+}
+
+void GenerateMoves(const ChessPosition *pos, MoveList *list) {
+  Generate(pos, list, false);
+}
+
+void GenerateCaptures(const ChessPosition *pos, MoveList *list) {
+  Generate(pos, list, true);
+}
+
+bool IsMoveLegal(ChessPosition *pos, Move move) {
+  MoveUndo undo;
+  PieceColor us = pos->sideToMove;
+  MakeMove(pos, move, &undo);
+  bool legal = !IsKingInCheck(pos, us);
+  UnmakeMove(pos, move, &undo);
+  return legal;
+}
+
+void GenerateLegalMoves(ChessPosition *pos, MoveList *list) {
+  MoveList pseudo;
+  GenerateMoves(pos, &pseudo);
+
+  list->count = 0;
+  for (int i = 0; i < pseudo.count; i++) {
+    if (IsMoveLegal(pos, pseudo.moves[i]))
+      list->moves[list->count++] = pseudo.moves[i];
+  }
+}
+
+//==============================================================================
+// MOVE TEXT
+//==============================================================================
+
+static const char PROMOTION_CHARS[] = "  qbnr ";
+static const char SAN_PIECE_CHARS[] = " KQBNRP";
+
+void FormatUciMove(Move move, char buffer[UCI_MOVE_LENGTH]) {
+  if (move == MOVE_NONE) {
+    memcpy(buffer, "0000", 5);
+    return;
+  }
+
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  buffer[0] = (char)('a' + SQ_COL(from));
+  buffer[1] = (char)('8' - SQ_ROW(from));
+  buffer[2] = (char)('a' + SQ_COL(to));
+  buffer[3] = (char)('8' - SQ_ROW(to));
+  buffer[4] = (char)(MOVE_PROMOTION(move) != PIECE_NONE
+                         ? PROMOTION_CHARS[MOVE_PROMOTION(move)]
+                         : '\0');
+  buffer[5] = '\0';
+}
+
+Move ParseUciMove(ChessPosition *pos, const char *text) {
+  MoveList list;
+  GenerateLegalMoves(pos, &list);
+
+  for (int i = 0; i < list.count; i++) {
+    char buffer[UCI_MOVE_LENGTH];
+    FormatUciMove(list.moves[i], buffer);
+    size_t length = strlen(buffer);
+    if (strncmp(text, buffer, length) == 0 &&
+        (text[length] == '\0' || text[length] == ' ' || text[length] == '\n' ||
+         text[length] == '\r'))
+      return list.moves[i];
+  }
+
+  return MOVE_NONE;
+}
+
+int FormatSanBody(const ChessPosition *pos, Move move, const MoveList *legal,
+                  char buffer[MOVE_NOTATION_LEN]) {
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  PieceType type = CODE_TYPE(pos->squares[from]);
+  int idx = 0;
+
+  if (type == PIECE_KING && abs(SQ_COL(to) - SQ_COL(from)) == 2) {
+    const char *castle = SQ_COL(to) > SQ_COL(from) ? "O-O" : "O-O-O";
+    strcpy(buffer, castle);
+    idx = (int)strlen(castle);
+  } else {
+    bool capture = pos->squares[to] != NO_PIECE ||
+                   (type == PIECE_PAWN && to == pos->enPassantSquare);
+
+    if (type == PIECE_PAWN) {
+      if (capture)
+        buffer[idx++] = (char)('a' + SQ_COL(from));
+    } else {
+      buffer[idx++] = SAN_PIECE_CHARS[type];
+
+      // Disambiguate against other legal moves of the same piece type
+      bool ambiguous = false, sameFile = false, sameRank = false;
+      for (int i = 0; i < legal->count; i++) {
+        int other = MOVE_FROM(legal->moves[i]);
+        if (other == from || MOVE_TO(legal->moves[i]) != to ||
+            CODE_TYPE(pos->squares[other]) != type)
+          continue;
+        ambiguous = true;
+        if (SQ_COL(other) == SQ_COL(from))
+          sameFile = true;
+        if (SQ_ROW(other) == SQ_ROW(from))
+          sameRank = true;
+      }
+      if (ambiguous && (!sameFile || sameRank))
+        buffer[idx++] = (char)('a' + SQ_COL(from));
+      if (ambiguous && sameFile)
+        buffer[idx++] = (char)('8' - SQ_ROW(from));
+    }
+
+    if (capture)
+      buffer[idx++] = 'x';
+    buffer[idx++] = (char)('a' + SQ_COL(to));
+    buffer[idx++] = (char)('8' - SQ_ROW(to));
+
+    if (MOVE_PROMOTION(move) != PIECE_NONE) {
+      buffer[idx++] = '=';
+      buffer[idx++] = SAN_PIECE_CHARS[MOVE_PROMOTION(move)];
+    }
+  }
+
+  buffer[idx] = '\0';
+  return idx;
+}
+
+void FormatSanMove(ChessPosition *pos, Move move,
+                   char buffer[MOVE_NOTATION_LEN]) {
+  MoveList legal;
+  GenerateLegalMoves(pos, &legal);
+  int idx = FormatSanBody(pos, move, &legal, buffer);
+
+  // Check or checkmate
+  MoveUndo undo;
+  MakeMove(pos, move, &undo);
+  if (IsKingInCheck(pos, pos->sideToMove)) {
+    MoveList replies;
+    GenerateLegalMoves(pos, &replies);
+    buffer[idx++] = replies.count == 0 ? '#' : '+';
+  }
+  UnmakeMove(pos, move, &undo);
+
+  buffer[idx] = '\0';
+}
+
+// Length of a SAN move without check marks, annotations or trailing text
+static size_t SanBodyLength(const char *text) {
+  size_t length = 0;
+  while (text[length] != '\0' && strchr(" \t\r\n;,+#!?", text[length]) == NULL)
+    length++;
+  return length;
+}
+
+static PieceType SanPieceType(char c) {
+  const char *found = c != ' ' && c != '\0' ? strchr(SAN_PIECE_CHARS, c) : NULL;
+  return found != NULL ? (PieceType)(found - SAN_PIECE_CHARS) : PIECE_NONE;
+}
+
+Move ParseSanBody(ChessPosition *pos, const char *text, size_t length) {
+  PieceType type = PIECE_PAWN;
+  PieceType promotion = PIECE_NONE;
+  int fromCol = -1, fromRow = -1, to;
+  MoveList list;
+  list.count = 0;
+
+  // Castling, also written with zeros
+  if (length >= 3 && (text[0] == 'O' || text[0] == '0')) {
+    bool queenside = length >= 5;
+    int from = pos->kingSquare[pos->sideToMove];
+    if (from == NO_SQUARE)
+      return MOVE_NONE;
+    GenerateCastling(pos, &list);
+    to = from + (queenside ? -2 : 2);
+    for (int i = 0; i < list.count; i++) {
+      if (MOVE_FROM(list.moves[i]) == from && MOVE_TO(list.moves[i]) == to &&
+          CODE_TYPE(pos->squares[from]) == PIECE_KING)
+        return IsMoveLegal(pos, list.moves[i]) ? list.moves[i] : MOVE_NONE;
+    }
+    return MOVE_NONE;
+  }
+
+  // Split "Nbxd7", "exd8=Q", "e8Q" into piece, hints, target and promotion
+  size_t start = 0;
+  if (length > 0 && SanPieceType(text[0]) != PIECE_NONE &&
+      text[0] != 'P') {
+    type = SanPieceType(text[0]);
+    start = 1;
+  }
+  if (length > 2 && SanPieceType(text[length - 1]) > PIECE_KING &&
+      SanPieceType(text[length - 1]) < PIECE_PAWN) {
+    promotion = SanPieceType(text[length - 1]);
+    length -= text[length - 2] == '=' ? 2 : 1;
+  }
+  if (length < start + 2)
+    return MOVE_NONE;
+
+  char file = text[length - 2], rank = text[length - 1];
+  if (file < 'a' || file > 'h' || rank < '1' || rank > '8')
+    return MOVE_NONE;
+  to = SQ('8' - rank, file - 'a');
+
+  for (size_t i = start; i < length - 2; i++) {
+    char c = text[i];
+    if (c >= 'a' && c <= 'h')
+      fromCol = c - 'a';
+    else if (c >= '1' && c <= '8')
+      fromRow = '8' - c;
+    else if (c != 'x' && c != ':' && c != '-')
+      return MOVE_NONE;
+  }
+  // A pawn without a file moves straight ahead
+  if (type == PIECE_PAWN && fromCol < 0)
+    fromCol = SQ_COL(to);
+
+  // Moves are generated only for the pieces the text can refer to, and only
+  // those reaching the target are tried for legality, so an import usually
+  // makes and unmakes a single move per ply
+  PieceCode piece = PIECE_CODE(type, pos->sideToMove);
+  for (int sq = 0; sq < SQUARE_COUNT; sq++) {
+    if (pos->squares[sq] == piece &&
+        (fromCol < 0 || SQ_COL(sq) == fromCol) &&
+        (fromRow < 0 || SQ_ROW(sq) == fromRow))
+      GeneratePieceMoves(pos, &list, sq, false);
+  }
+
+  Move found = MOVE_NONE;
+  for (int i = 0; i < list.count; i++) {
+    Move move = list.moves[i];
+    int from = MOVE_FROM(move);
+    if (MOVE_TO(move) != to || MOVE_PROMOTION(move) != promotion ||
+        CODE_TYPE(pos->squares[from]) != type ||
+        (fromCol >= 0 && SQ_COL(from) != fromCol) ||
+        (fromRow >= 0 && SQ_ROW(from) != fromRow) || !IsMoveLegal(pos, move))
+      continue;
+    if (found != MOVE_NONE)
+      return MOVE_NONE; // Ambiguous
+    found = move;
+  }
+  return found;
+}
+
+Move ParseSanMove(ChessPosition *pos, const char *text) {
+  size_t length = SanBodyLength(text);
+  return length > 0 ? ParseSanBody(pos, text, length) : MOVE_NONE;
+}
+
+//==============================================================================
+// PERFT
+//==============================================================================
+
+uint64_t Perft(ChessPosition *pos, int depth) {
+  MoveList list;
+  GenerateLegalMoves(pos, &list);
+  if (depth <= 1)
+    return depth == 1 ? (uint64_t)list.count : 1;
+
+  uint64_t nodes = 0;
+  for (int i = 0; i < list.count; i++) {
+    MoveUndo undo;
+    MakeMove(pos, list.moves[i], &undo);
+    nodes += Perft(pos, depth - 1);
+    UnmakeMove(pos, list.moves[i], &undo);
+  }
+  return nodes;
+}
@@ -0,0 +1,109 @@
+/**
+ * Chess Game - Move Generation
+ * Move generation over ChessPosition for the engine and tablebase modules.
+ */
+
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "position.h"
+
+//==============================================================================
+// MOVE LISTS
+//==============================================================================
+
+// No legal chess position has more than 218 moves
+#define MOVE_LIST_CAPACITY 256
+
+// Long algebraic coordinates as used by UCI, e.g. "e2e4", "e7e8q"
+#define UCI_MOVE_LENGTH 6
+
+typedef struct {
+  Move moves[MOVE_LIST_CAPACITY];
+  int count;
+} MoveList;
+
+//==============================================================================
+// MOVE GENERATION FUNCTIONS
+//==============================================================================
+
+/**
+ * Generate all pseudo-legal moves for the side to move. Castling is only
+ * generated when it is fully legal.
+ */
+void GenerateMoves(const ChessPosition *pos, MoveList *list);
+
+/**
+ * Generate pseudo-legal captures (en passant included) and promotions.
+ */
+void GenerateCaptures(const ChessPosition *pos, MoveList *list);
+
+/**
+ * Generate only the moves that do not leave the mover's king attacked.
+ */
+void GenerateLegalMoves(ChessPosition *pos, MoveList *list);
+
+/**
+ * Check whether a pseudo-legal move leaves the mover's king safe.
+ */
+bool IsMoveLegal(ChessPosition *pos, Move move);
+
+/**
+ * Check if a square is attacked by any piece of the given color.
+ */
+bool IsSquareAttackedBy(const ChessPosition *pos, int sq, PieceColor byColor);
+
+/**
+ * Check if the king of the given color is attacked.
+ */
+bool IsKingInCheck(const ChessPosition *pos, PieceColor color);
+
+/**
+ * Write a move in UCI coordinates ("0000" for MOVE_NONE).
+ */
+void FormatUciMove(Move move, char buffer[UCI_MOVE_LENGTH]);
+
+/**
+ * Parse a UCI coordinate move and match it against the legal moves.
+ * @return MOVE_NONE if the text is not a legal move in this position
+ */
+Move ParseUciMove(ChessPosition *pos, const char *text);
+
+/**
+ * Write a legal move in Standard Algebraic Notation without the check or
+ * mate suffix, disambiguated against the position's legal moves.
+ * @return Length of the text written
+ */
+int FormatSanBody(const ChessPosition *pos, Move move, const MoveList *legal,
+                  char buffer[MOVE_NOTATION_LEN]);
+
+/**
+ * Write a legal move in Standard Algebraic Notation, with disambiguation
+ * and the check or mate suffix ("Nbd7", "exd6", "e8=Q+", "O-O-O#").
+ */
+void FormatSanMove(ChessPosition *pos, Move move,
+                   char buffer[MOVE_NOTATION_LEN]);
+
+/**
+ * Parse the body of a SAN move (no check marks or annotations), given by its
+ * length so it can point into a larger buffer. The piece, target, hints and
+ * promotion are matched against the generated moves directly; only the
+ * moves that fit are checked for legality. Extra disambiguation and a
+ * missing "x" are accepted, as is castling written with zeros.
+ * @return MOVE_NONE if no legal move, or more than one, fits the text
+ */
+Move ParseSanBody(ChessPosition *pos, const char *text, size_t length);
+
+/**
+ * Parse a SAN move and match it against the legal moves. Check marks and
+ * annotations ("+", "#", "!", "?") are optional.
+ * @return MOVE_NONE if the text is not a legal move in this position
+ */
+Move ParseSanMove(ChessPosition *pos, const char *text);
+
+/**
+ * Count leaf nodes of the legal move tree to the given depth.
+ */
+uint64_t Perft(ChessPosition *pos, int depth);
+
+#endif // MOVEGEN_H
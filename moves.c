@@ -4,11 +4,15 @@
  */
 
 #include "moves.h"
+#include "analysis.h"
 #include "board.h"
+#include "book.h"
 #include "check.h"
 #include "clock.h"
 #include "history.h"
+#include "journal.h"
 #include "multiplayer.h"
+#include "variation.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -161,32 +165,20 @@ void CalculateValidMoves(int row, int col) {
 // MOVE EXECUTION
 //==============================================================================
 
-void MovePiece(int toRow, int toCol) {
-  int fromRow = selectedPos.row;
-  int fromCol = selectedPos.col;
+// Play a move on the board: en passant, the castling rook, the en passant
+// state and the king positions included. What it changes goes into undo.
+static void ApplyBoardMove(int fromRow, int fromCol, int toRow, int toCol,
+                           BoardUndo *undo) {
   Piece piece = board[fromRow][fromCol];
 
-  // Determine move properties for history recording
-  bool isCapture = board[toRow][toCol].type != PIECE_NONE;
-  bool isCastleKingside = false;
-  bool isCastleQueenside = false;
-  bool isEnPassantCapture = false;
-
-  // Check for castling
-  if (piece.type == PIECE_KING && abs(toCol - fromCol) == 2) {
-    if (toCol > fromCol) {
-      isCastleKingside = true;
-    } else {
-      isCastleQueenside = true;
-    }
-  }
-
-  // Check for en passant
-  if (piece.type == PIECE_PAWN && toRow == enPassantTarget.row &&
-      toCol == enPassantTarget.col) {
-    isEnPassantCapture = true;
-    isCapture = true;
-  }
+  undo->moved = piece;
+  undo->captured = board[toRow][toCol];
+  undo->capturedPos = (Position){toRow, toCol};
+  undo->castlingRook = EMPTY_SQUARE;
+  undo->enPassantTarget = enPassantTarget;
+  undo->enPassantPawn = enPassantPawn;
+  undo->whiteKingPos = whiteKingPos;
+  undo->blackKingPos = blackKingPos;
 
   // Save and reset en passant state
   Position oldEnPassantTarget = enPassantTarget;
@@ -197,6 +189,8 @@ void MovePiece(int toRow, int toCol) {
   // Handle en passant capture: remove the captured pawn
   if (piece.type == PIECE_PAWN && toRow == oldEnPassantTarget.row &&
       toCol == oldEnPassantTarget.col) {
+    undo->captured = board[oldEnPassantPawn.row][oldEnPassantPawn.col];
+    undo->capturedPos = oldEnPassantPawn;
     board[oldEnPassantPawn.row][oldEnPassantPawn.col] = EMPTY_SQUARE;
   }
 
@@ -204,11 +198,13 @@ void MovePiece(int toRow, int toCol) {
   if (piece.type == PIECE_KING && abs(toCol - fromCol) == 2) {
     if (toCol > fromCol) {
       // Kingside castling - move rook from h-file to f-file
+      undo->castlingRook = board[fromRow][7];
       board[fromRow][5] = board[fromRow][7];
       board[fromRow][5].hasMoved = true;
       board[fromRow][7] = EMPTY_SQUARE;
     } else {
       // Queenside castling - move rook from a-file to d-file
+      undo->castlingRook = board[fromRow][0];
       board[fromRow][3] = board[fromRow][0];
       board[fromRow][3].hasMoved = true;
       board[fromRow][0] = EMPTY_SQUARE;
@@ -234,6 +230,42 @@ void MovePiece(int toRow, int toCol) {
       blackKingPos = (Position){toRow, toCol};
     }
   }
+}
+
+void MovePiece(int toRow, int toCol) {
+  int fromRow = selectedPos.row;
+  int fromCol = selectedPos.col;
+  Piece piece = board[fromRow][fromCol];
+
+  // Position before the move, for its notation
+  ChessPosition before;
+  LoadPositionFromBoard(&before);
+
+  // Determine move properties for history recording
+  bool isCapture = board[toRow][toCol].type != PIECE_NONE;
+  bool isCastleKingside = false;
+  bool isCastleQueenside = false;
+  bool isEnPassantCapture = false;
+
+  // Check for castling
+  if (piece.type == PIECE_KING && abs(toCol - fromCol) == 2) {
+    if (toCol > fromCol) {
+      isCastleKingside = true;
+    } else {
+      isCastleQueenside = true;
+    }
+  }
+
+  // Check for en passant
+  if (piece.type == PIECE_PAWN && toRow == enPassantTarget.row &&
+      toCol == enPassantTarget.col) {
+    isEnPassantCapture = true;
+    isCapture = true;
+  }
+
+  BoardUndo undo;
+  undo.clockBefore = gameClock;
+  ApplyBoardMove(fromRow, fromCol, toRow, toCol, &undo);
 
   // Check for pawn promotion
   if (piece.type == PIECE_PAWN &&
@@ -242,17 +274,20 @@ void MovePiece(int toRow, int toCol) {
     // Save move info for recording after promotion choice
     promotionFromPos = (Position){fromRow, fromCol};
     promotionWasCapture = isCapture;
+    promotionBefore = before;
+    promotionUndo = undo;
     promotionPos = (Position){toRow, toCol};
     gameState = GAME_PROMOTING;
     selectedPos = INVALID_POS;
     ClearValidMoves();
+    InvalidateAnalysis();
     return;
   }
 
   // Record the move for history
-  RecordMove(fromRow, fromCol, toRow, toCol, piece.type, piece.color, isCapture,
-             isCastleKingside, isCastleQueenside, isEnPassantCapture, false,
-             PIECE_NONE);
+  RecordMove(&before, fromRow, fromCol, toRow, toCol, piece.type, piece.color,
+             isCapture, isCastleKingside, isCastleQueenside,
+             isEnPassantCapture, false, PIECE_NONE, &undo);
 
   // Send move to remote player in multiplayer (skip if promotion - sent after
   // choice)
@@ -270,6 +305,247 @@ void MovePiece(int toRow, int toCol) {
   UpdateGameState();
 
   // Update move history with check/checkmate status
-  UpdateLastMoveStatus(gameState == GAME_CHECK || gameState == GAME_CHECKMATE,
-                       gameState == GAME_CHECKMATE);
+  UpdateLastMoveStatus(IsInCheck(currentTurn), gameState == GAME_CHECKMATE);
+  JournalMove(MAKE_MOVE(SQ(fromRow, fromCol), SQ(toRow, toCol), PIECE_NONE));
+
+  // Hints and analysis for the old position are stale from here on
+  InvalidateAnalysis();
+}
+
+//==============================================================================
+// TAKEBACK, REDO AND VARIATIONS
+//==============================================================================
+
+// The board changed outside of normal play: selection and game state start
+// over from the new position
+static void FinishBoardChange(void) {
+  gameState = GAME_PLAYING;
+  adjudicatedWinner = COLOR_NONE;
+  selectedPos = INVALID_POS;
+  isDragging = false;
+  ClearValidMoves();
+  UpdateGameState();
+  InvalidateAnalysis();
+}
+
+// Take the last move off the board, with its turn and clocks
+static bool UndoLastMove(void) {
+  MoveRecord *move = TakeBackMoveRecord();
+  if (move == NULL)
+    return false;
+  BoardUndo *undo = &move->undo;
+  undo->clockAfter = gameClock;
+
+  int row = move->fromRow;
+  board[move->toRow][move->toCol] = EMPTY_SQUARE;
+  board[undo->capturedPos.row][undo->capturedPos.col] = undo->captured;
+  board[row][move->fromCol] = undo->moved;
+  if (move->isCastleKingside) {
+    board[row][7] = undo->castlingRook;
+    board[row][5] = EMPTY_SQUARE;
+  } else if (move->isCastleQueenside) {
+    board[row][0] = undo->castlingRook;
+    board[row][3] = EMPTY_SQUARE;
+  }
+
+  enPassantTarget = undo->enPassantTarget;
+  enPassantPawn = undo->enPassantPawn;
+  whiteKingPos = undo->whiteKingPos;
+  blackKingPos = undo->blackKingPos;
+  gameClock = undo->clockBefore;
+  currentTurn = move->color;
+  return true;
+}
+
+// Back to the position before the move, with its turn and clocks
+bool TakeBackMove(void) {
+  if (gameState == GAME_PROMOTING || !UndoLastMove())
+    return false;
+  FinishBoardChange();
+  JournalTakeBack();
+  return true;
+}
+
+// Play the last taken back move again, with the clocks it was taken back on
+bool RedoMove(void) {
+  if (gameState == GAME_PROMOTING)
+    return false;
+  MoveRecord *move = RedoMoveRecord();
+  if (move == NULL)
+    return false;
+
+  ApplyBoardMove(move->fromRow, move->fromCol, move->toRow, move->toCol,
+                 &move->undo);
+  if (move->isPromotion)
+    board[move->toRow][move->toCol].type = move->promotedTo;
+
+  gameClock = move->undo.clockAfter;
+  currentTurn = OPPONENT_COLOR(move->color);
+  FinishBoardChange();
+  JournalRedo();
+  return true;
+}
+
+// Play a move of a line already in the tree: validated and recorded like
+// any other, but without pressing the clock, restarting the analysis or
+// journaling, which the caller does once for the whole line
+static bool ReplayLineMove(Move move) {
+  int fromRow = SQ_ROW(MOVE_FROM(move));
+  int fromCol = SQ_COL(MOVE_FROM(move));
+  int toRow = SQ_ROW(MOVE_TO(move));
+  int toCol = SQ_COL(MOVE_TO(move));
+  if (!IsAlly(fromRow, fromCol, currentTurn))
+    return false;
+
+  selectedPos = (Position){fromRow, fromCol};
+  ClearValidMoves();
+  CalculateValidMoves(fromRow, fromCol);
+  bool valid = IsValidMove(toRow, toCol);
+  selectedPos = INVALID_POS;
+  ClearValidMoves();
+
+  Piece piece = board[fromRow][fromCol];
+  bool isPromotion = piece.type == PIECE_PAWN && (toRow == 0 || toRow == 7);
+  if (!valid || isPromotion != (MOVE_PROMOTION(move) != PIECE_NONE))
+    return false;
+
+  ChessPosition before;
+  LoadPositionFromBoard(&before);
+  bool isEnPassant = piece.type == PIECE_PAWN &&
+                     toRow == enPassantTarget.row &&
+                     toCol == enPassantTarget.col;
+  bool isCapture = board[toRow][toCol].type != PIECE_NONE || isEnPassant;
+  bool isCastle = piece.type == PIECE_KING && abs(toCol - fromCol) == 2;
+
+  BoardUndo undo;
+  undo.clockBefore = gameClock;
+  ApplyBoardMove(fromRow, fromCol, toRow, toCol, &undo);
+  if (isPromotion)
+    board[toRow][toCol].type = MOVE_PROMOTION(move);
+  RecordMove(&before, fromRow, fromCol, toRow, toCol, piece.type, piece.color,
+             isCapture, isCastle && toCol > fromCol,
+             isCastle && toCol < fromCol, isEnPassant, isPromotion,
+             MOVE_PROMOTION(move), &undo);
+
+  currentTurn = OPPONENT_COLOR(currentTurn);
+  bool inCheck = IsInCheck(currentTurn);
+  UpdateLastMoveStatus(inCheck, inCheck && !HasLegalMoves(currentTurn));
+  return true;
+}
+
+// Switching lines takes no time: the clocks stay as they were at the
+// position both lines share, and the analysis and the journal hear of the
+// switch once
+bool GoToVariation(int node) {
+  if (gameState == GAME_PROMOTING || isMultiplayerGame ||
+      GetVariationNode(node) == NULL)
+    return false;
+  int current = GetCurrentVariation();
+  if (current == VARIATION_NONE)
+    return false;
+
+  int depth = GetVariationDepth(node);
+  int shared = GetVariationDepth(FindCommonVariation(node, current));
+  Move *path = malloc(sizeof(Move) * (size_t)(depth > 0 ? depth : 1));
+  if (path == NULL)
+    return false;
+  GetVariationPath(node, path, depth);
+
+  int takeBacks = 0;
+  while (GetMoveCount() > shared && UndoLastMove())
+    takeBacks++;
+  int played = 0;
+  if (GetMoveCount() == shared) {
+    while (shared + played < depth && ReplayLineMove(path[shared + played]))
+      played++;
+  }
+
+  // The other side is on move now: its turn starts afresh
+  if (played % 2 != 0)
+    StartClockTurn(&gameClock, currentTurn);
+  FinishBoardChange();
+  JournalLineChange(takeBacks, path + shared, played);
+  free(path);
+  return shared + played == depth;
+}
+
+//==============================================================================
+// PROMOTION AND COMPLETE MOVES
+//==============================================================================
+
+void CompletePromotion(PieceType promotedTo) {
+  board[promotionPos.row][promotionPos.col].type = promotedTo;
+
+  // Record the promotion move (pawn promotion)
+  PieceColor pieceColor = board[promotionPos.row][promotionPos.col].color;
+  Move played = MAKE_MOVE(SQ(promotionFromPos.row, promotionFromPos.col),
+                          SQ(promotionPos.row, promotionPos.col), promotedTo);
+  RecordMove(&promotionBefore, promotionFromPos.row, promotionFromPos.col,
+             promotionPos.row, promotionPos.col, PIECE_PAWN, pieceColor,
+             promotionWasCapture, false, false, false, true, promotedTo,
+             &promotionUndo);
+
+  // Send move to remote player in multiplayer (with promotion piece type)
+  HandleLocalMove(promotionFromPos.row, promotionFromPos.col, promotionPos.row,
+                  promotionPos.col, promotedTo);
+
+  // Switch clock before changing turn (applies increment to player who moved)
+  SwitchClock(pieceColor);
+
+  // Switch turns and update game state
+  currentTurn = OPPONENT_COLOR(currentTurn);
+  gameState = GAME_PLAYING;
+  promotionPos = INVALID_POS;
+  promotionFromPos = INVALID_POS;
+  UpdateGameState();
+
+  // Update move history with check/checkmate status
+  UpdateLastMoveStatus(IsInCheck(currentTurn), gameState == GAME_CHECKMATE);
+  JournalMove(played);
+
+  // Hints and analysis for the old position are stale from here on
+  InvalidateAnalysis();
+}
+
+bool PlayMove(int fromRow, int fromCol, int toRow, int toCol,
+              PieceType promotion) {
+  if (!IsValidPosition(fromRow, fromCol) || !IsValidPosition(toRow, toCol) ||
+      !IsAlly(fromRow, fromCol, currentTurn)) {
+    return false;
+  }
+
+  // Select the piece and validate through the normal move generation
+  selectedPos = (Position){fromRow, fromCol};
+  ClearValidMoves();
+  CalculateValidMoves(fromRow, fromCol);
+
+  if (!IsValidMove(toRow, toCol)) {
+    selectedPos = INVALID_POS;
+    ClearValidMoves();
+    return false;
+  }
+
+  MovePiece(toRow, toCol);
+
+  if (gameState == GAME_PROMOTING && promotion != PIECE_NONE) {
+    CompletePromotion(promotion);
+  }
+  return true;
+}
+
+bool PlayBookMove(void) {
+  if (!IsBookOpen(&openingBook))
+    return false;
+
+  ChessPosition pos;
+  LoadPositionFromBoard(&pos);
+
+  Move move = PickBookMove(&openingBook, &pos);
+  if (move == MOVE_NONE)
+    return false;
+
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  return PlayMove(SQ_ROW(from), SQ_COL(from), SQ_ROW(to), SQ_COL(to),
+                  MOVE_PROMOTION(move));
 }
@@ -44,4 +44,50 @@ void AddMoveIfValid(int row, int col, PieceColor color);
  */
 void MovePiece(int toRow, int toCol);
 
+/**
+ * Finish a pending pawn promotion (gameState == GAME_PROMOTING).
+ * Records the move, notifies the remote player and passes the turn.
+ */
+void CompletePromotion(PieceType promotedTo);
+
+/**
+ * Validate and play a complete move for the side to move.
+ * Goes through MovePiece, so history, clock and multiplayer stay in sync.
+ * @param promotion Piece to promote to, or PIECE_NONE to leave the choice
+ *                  pending
+ * @return false if the move is not legal
+ */
+bool PlayMove(int fromRow, int fromCol, int toRow, int toCol,
+              PieceType promotion);
+
+/**
+ * Play a move from the opening book for the side to move.
+ * @return false if no book is loaded or the position is not in it
+ */
+bool PlayBookMove(void);
+
+/**
+ * Take back the last move in constant time from its undo record: the board,
+ * the turn and the clocks are as they were before it. The move is kept for
+ * RedoMove until another move is played.
+ * @return false if there is no move to take back or a promotion is pending
+ */
+bool TakeBackMove(void);
+
+/**
+ * Play the last taken back move again, restoring the clocks it was taken
+ * back with.
+ * @return false if there is no move to redo or a promotion is pending
+ */
+bool RedoMove(void);
+
+/**
+ * Switch the game to another line of the variation tree: take back to
+ * where it leaves the moves on the board, then play it out to the node.
+ * The clocks keep the times of the position both lines share. Local games
+ * only.
+ * @return false if the line could not be reached
+ */
+bool GoToVariation(int node);
+
 #endif // MOVES_H
@@ -114,40 +114,8 @@ void ProcessRemoteMove(int fromRow, int fromCol, int toRow, int toCol,
   // Set flag to prevent sending the move back
   processingRemoteMove = true;
 
-  // Select the piece
-  selectedPos = (Position){fromRow, fromCol};
-  ClearValidMoves();
-  CalculateValidMoves(fromRow, fromCol);
-
-  // Validate and execute the move
-  if (IsValidMove(toRow, toCol)) {
-    // Execute the move
-    MovePiece(toRow, toCol);
-
-    // Handle promotion if needed
-    if (gameState == GAME_PROMOTING && promotionPiece > 0) {
-      // Apply the promotion (turn hasn't switched yet during GAME_PROMOTING)
-      board[toRow][toCol].type = (PieceType)promotionPiece;
-
-      // Record the move with promotion (MovePiece returned early without
-      // recording)
-      PieceColor promoteColor = currentTurn;
-      RecordMove(fromRow, fromCol, toRow, toCol, PIECE_PAWN, promoteColor,
-                 promotionWasCapture, false, false, false, true,
-                 (PieceType)promotionPiece);
-
-      // Complete the turn - switch clock and update state
-      SwitchClock(promoteColor);
-      currentTurn = OPPONENT_COLOR(currentTurn);
-      gameState = GAME_PLAYING;
-      promotionPos = INVALID_POS;
-      promotionFromPos = INVALID_POS;
-      UpdateGameState();
-      UpdateLastMoveStatus(gameState == GAME_CHECK ||
-                               gameState == GAME_CHECKMATE,
-                           gameState == GAME_CHECKMATE);
-    }
-  } else {
+  // Validate and execute the move, applying the promotion if needed
+  if (!PlayMove(fromRow, fromCol, toRow, toCol, (PieceType)promotionPiece)) {
     printf("[Multiplayer] Remote move was invalid!\n");
   }
 
@@ -0,0 +1,385 @@
+/**
+ * Chess Game - PGN
+ * Streaming writer and zero-copy reader for games in Portable Game Notation.
+ */
+
+#include "pgn.h"
+#include "movegen.h"
+#include <string.h>
+
+//==============================================================================
+// BUFFERED OUTPUT
+//==============================================================================
+
+static void WriteBytes(PgnWriter *writer, const char *data, size_t length) {
+  if (writer->used + length > PGN_BUFFER_SIZE)
+    FlushPgnWriter(writer);
+
+  // Only a tag value longer than the whole buffer skips it
+  if (length > PGN_BUFFER_SIZE) {
+    if (fwrite(data, 1, length, writer->out) != length)
+      writer->failed = true;
+    return;
+  }
+  memcpy(writer->buffer + writer->used, data, length);
+  writer->used += length;
+}
+
+static void WriteText(PgnWriter *writer, const char *text) {
+  WriteBytes(writer, text, strlen(text));
+}
+
+// Tokens are never split; a token that does not fit starts a new line
+static void WriteToken(PgnWriter *writer, const char *token) {
+  int length = (int)strlen(token);
+  if (writer->column > 0) {
+    if (writer->column + 1 + length > PGN_LINE_WIDTH) {
+      WriteBytes(writer, "\n", 1);
+      writer->column = 0;
+    } else {
+      WriteBytes(writer, " ", 1);
+      writer->column++;
+    }
+  }
+  WriteBytes(writer, token, (size_t)length);
+  writer->column += length;
+}
+
+bool FlushPgnWriter(PgnWriter *writer) {
+  if (writer->used > 0) {
+    if (fwrite(writer->buffer, 1, writer->used, writer->out) != writer->used)
+      writer->failed = true;
+    writer->used = 0;
+  }
+  if (fflush(writer->out) != 0)
+    writer->failed = true;
+  return !writer->failed;
+}
+
+//==============================================================================
+// GAME OUTPUT
+//==============================================================================
+
+void InitPgnWriter(PgnWriter *writer, FILE *out) {
+  writer->out = out;
+  writer->used = 0;
+  writer->failed = false;
+  writer->column = 0;
+  writer->moveNumber = 1;
+  writer->sideToMove = COLOR_WHITE;
+  writer->needsNumber = true;
+}
+
+void WritePgnTag(PgnWriter *writer, const char *name, const char *value) {
+  WriteBytes(writer, "[", 1);
+  WriteText(writer, name);
+  WriteBytes(writer, " \"", 2);
+  for (const char *c = value; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\')
+      WriteBytes(writer, "\\", 1);
+    WriteBytes(writer, c, 1);
+  }
+  WriteBytes(writer, "\"]\n", 3);
+}
+
+void BeginPgnMovetext(PgnWriter *writer, int fullmoveNumber,
+                      PieceColor sideToMove) {
+  WriteBytes(writer, "\n", 1);
+  writer->column = 0;
+  writer->moveNumber = fullmoveNumber > 0 ? fullmoveNumber : 1;
+  writer->sideToMove = sideToMove;
+  writer->needsNumber = true;
+}
+
+void WritePgnMove(PgnWriter *writer, const char *san, float clockSeconds) {
+  char token[32];
+  if (writer->sideToMove == COLOR_WHITE) {
+    snprintf(token, sizeof(token), "%d.", writer->moveNumber);
+    WriteToken(writer, token);
+  } else if (writer->needsNumber) {
+    snprintf(token, sizeof(token), "%d...", writer->moveNumber);
+    WriteToken(writer, token);
+  }
+  WriteToken(writer, san);
+  writer->needsNumber = false;
+
+  if (clockSeconds >= 0.0f) {
+    // Tenths matter in fast games: h:mm:ss.t
+    int tenths = (int)(clockSeconds * 10.0f);
+    int seconds = tenths / 10;
+    snprintf(token, sizeof(token), "{[%%clk %d:%02d:%02d.%d]}",
+             seconds / 3600, seconds / 60 % 60, seconds % 60, tenths % 10);
+    WriteToken(writer, token);
+    // A move after a comment is numbered again
+    writer->needsNumber = true;
+  }
+
+  if (writer->sideToMove == COLOR_BLACK)
+    writer->moveNumber++;
+  writer->sideToMove = OPPONENT_COLOR(writer->sideToMove);
+}
+
+void EndPgnGame(PgnWriter *writer, const char *result) {
+  WriteToken(writer, result);
+  WriteBytes(writer, "\n\n", 2);
+  writer->column = 0;
+}
+
+const char *GetPgnResultText(PgnResult result) {
+  static const char *TEXT[] = {"*", "1-0", "0-1", "1/2-1/2"};
+  return TEXT[result];
+}
+
+//==============================================================================
+// READER
+//==============================================================================
+
+static bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' ||
+         c == '\v';
+}
+
+// Characters that end a move token
+static bool IsDelimiter(char c) {
+  return IsSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' ||
+         c == '[' || c == ']' || c == ';' || c == '$';
+}
+
+static bool AtEnd(const PgnReader *reader) {
+  return reader->offset >= reader->size;
+}
+
+static char Peek(const PgnReader *reader) {
+  return reader->data[reader->offset];
+}
+
+static void SkipLine(PgnReader *reader) {
+  while (!AtEnd(reader) && Peek(reader) != '\n')
+    reader->offset++;
+}
+
+static void SkipSpace(PgnReader *reader) {
+  while (!AtEnd(reader)) {
+    char c = Peek(reader);
+    if (c == '%' &&
+        (reader->offset == 0 || reader->data[reader->offset - 1] == '\n')) {
+      SkipLine(reader); // Escape line
+    } else if (IsSpace(c)) {
+      reader->offset++;
+    } else {
+      break;
+    }
+  }
+}
+
+static void SkipComment(PgnReader *reader) {
+  const char *end = memchr(reader->data + reader->offset, '}',
+                           reader->size - reader->offset);
+  reader->offset = end != NULL ? (size_t)(end - reader->data) + 1
+                               : reader->size;
+}
+
+// Variations may nest and contain comments with parentheses
+static void SkipVariation(PgnReader *reader) {
+  int depth = 0;
+  while (!AtEnd(reader)) {
+    char c = Peek(reader);
+    if (c == '{') {
+      SkipComment(reader);
+      continue;
+    }
+    if (c == ';') {
+      SkipLine(reader);
+      continue;
+    }
+    reader->offset++;
+    if (c == '(')
+      depth++;
+    else if (c == ')' && --depth == 0)
+      return;
+  }
+}
+
+// Match a result token at the reader's position
+static bool ReadResult(PgnReader *reader, PgnResult *result) {
+  static const struct {
+    const char *text;
+    PgnResult result;
+  } RESULTS[] = {{"1-0", PGN_RESULT_WHITE_WINS},
+                 {"0-1", PGN_RESULT_BLACK_WINS},
+                 {"1/2-1/2", PGN_RESULT_DRAW},
+                 {"*", PGN_RESULT_NONE}};
+
+  size_t left = reader->size - reader->offset;
+  const char *at = reader->data + reader->offset;
+  for (size_t i = 0; i < sizeof(RESULTS) / sizeof(RESULTS[0]); i++) {
+    size_t length = strlen(RESULTS[i].text);
+    if (left >= length && memcmp(at, RESULTS[i].text, length) == 0 &&
+        (left == length || IsDelimiter(at[length]))) {
+      reader->offset += length;
+      *result = RESULTS[i].result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// [Name "Value"]; a malformed tag is skipped up to the end of its line
+static void ReadTag(PgnReader *reader, PgnGame *game) {
+  const char *data = reader->data;
+  size_t size = reader->size;
+  size_t at = reader->offset + 1;
+  while (at < size && IsSpace(data[at]))
+    at++;
+  size_t nameStart = at;
+  while (at < size && !IsSpace(data[at]) && data[at] != '"' && data[at] != ']')
+    at++;
+  size_t nameEnd = at;
+  while (at < size && IsSpace(data[at]) && data[at] != '\n')
+    at++;
+  if (at >= size || data[at] != '"' || nameEnd == nameStart) {
+    SkipLine(reader);
+    return;
+  }
+
+  size_t valueStart = ++at;
+  while (at < size && data[at] != '"' && data[at] != '\n')
+    at += data[at] == '\\' && at + 1 < size ? 2 : 1;
+  size_t valueEnd = at < size ? at : size;
+  while (at < size && data[at] != ']' && data[at] != '\n')
+    at++;
+  reader->offset = at < size && data[at] == ']' ? at + 1 : at;
+
+  PgnText name = {data + nameStart, (int)(nameEnd - nameStart)};
+  PgnText value = {data + valueStart, (int)(valueEnd - valueStart)};
+  if (game->tagCount < PGN_MAX_TAGS) {
+    game->tagNames[game->tagCount] = name;
+    game->tagValues[game->tagCount] = value;
+    game->tagCount++;
+  }
+
+  // The only tag that changes how the moves are read
+  if (name.length == 3 && memcmp(name.text, "FEN", 3) == 0) {
+    char fen[FEN_MAX_LENGTH];
+    int length = value.length < FEN_MAX_LENGTH - 1 ? value.length
+                                                   : FEN_MAX_LENGTH - 1;
+    memcpy(fen, value.text, (size_t)length);
+    fen[length] = '\0';
+    if (!SetPositionFromFen(&game->start, fen)) {
+      game->valid = false;
+      game->error = "bad FEN tag";
+    }
+  }
+}
+
+static void MarkInvalid(PgnGame *game, const char *error) {
+  if (game->valid) {
+    game->valid = false;
+    game->error = error;
+  }
+}
+
+void InitPgnReader(PgnReader *reader, const char *data, size_t size) {
+  reader->data = data;
+  reader->size = size;
+  reader->offset = 0;
+  SetPositionFromFen(&reader->initial, STARTING_FEN);
+
+  // UTF-8 byte order mark
+  if (size >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+    reader->offset = 3;
+}
+
+bool ReadPgnGame(PgnReader *reader, PgnGame *game) {
+  SkipSpace(reader);
+  if (AtEnd(reader))
+    return false;
+
+  game->offset = reader->offset;
+  game->tagCount = 0;
+  game->start = reader->initial;
+  game->plyCount = 0;
+  game->result = PGN_RESULT_NONE;
+  game->valid = true;
+  game->error = NULL;
+
+  ChessPosition pos;
+  bool inMovetext = false;
+
+  while (SkipSpace(reader), !AtEnd(reader)) {
+    char c = Peek(reader);
+
+    if (c == '[') {
+      if (inMovetext)
+        break; // The next game's tags: this one had no result
+      ReadTag(reader, game);
+      continue;
+    }
+    if (!inMovetext) {
+      inMovetext = true;
+      pos = game->start;
+    }
+
+    if (c == '{') {
+      SkipComment(reader);
+    } else if (c == ';') {
+      SkipLine(reader);
+    } else if (c == '(') {
+      SkipVariation(reader);
+    } else if (c == ')' || c == ']' || c == '}') {
+      reader->offset++; // Stray closer
+    } else if (c == '$') {
+      reader->offset++;
+      while (!AtEnd(reader) && Peek(reader) >= '0' && Peek(reader) <= '9')
+        reader->offset++;
+    } else if (ReadResult(reader, &game->result)) {
+      break;
+    } else if (c >= '1' && c <= '9') {
+      // Move number, "12." or "12..."
+      while (!AtEnd(reader) &&
+             ((Peek(reader) >= '0' && Peek(reader) <= '9') ||
+              Peek(reader) == '.'))
+        reader->offset++;
+    } else {
+      // A move: the token up to the next delimiter, annotations stripped
+      const char *token = reader->data + reader->offset;
+      size_t length = 0;
+      while (reader->offset < reader->size && !IsDelimiter(Peek(reader))) {
+        reader->offset++;
+        length++;
+      }
+      while (length > 0 && strchr("+#!?", token[length - 1]) != NULL)
+        length--;
+
+      if (!game->valid || (length == 4 && memcmp(token, "e.p.", 4) == 0))
+        continue;
+      if (game->plyCount == PGN_MAX_PLIES) {
+        MarkInvalid(game, "too many moves");
+        continue;
+      }
+      Move move = length > 0 ? ParseSanBody(&pos, token, length) : MOVE_NONE;
+      if (move == MOVE_NONE) {
+        MarkInvalid(game, "illegal or unreadable move");
+        continue;
+      }
+      MoveUndo undo;
+      MakeMove(&pos, move, &undo);
+      game->moves[game->plyCount++] = move;
+    }
+  }
+
+  game->length = reader->offset - game->offset;
+  return true;
+}
+
+bool FindPgnTag(const PgnGame *game, const char *name, PgnText *value) {
+  int length = (int)strlen(name);
+  for (int i = 0; i < game->tagCount; i++) {
+    if (game->tagNames[i].length == length &&
+        memcmp(game->tagNames[i].text, name, (size_t)length) == 0) {
+      *value = game->tagValues[i];
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,156 @@
+/**
+ * Chess Game - PGN
+ * Streaming writer and zero-copy reader for games in Portable Game Notation.
+ */
+
+#ifndef PGN_H
+#define PGN_H
+
+#include "position.h"
+#include "types.h"
+#include <stddef.h>
+#include <stdio.h>
+
+//==============================================================================
+// PGN CONSTANTS
+//==============================================================================
+
+#define PGN_BUFFER_SIZE 65536
+#define PGN_LINE_WIDTH 79 // Movetext lines stay under the 80 columns of PGN
+#define PGN_NO_CLOCK (-1.0f)
+#define PGN_MAX_TAGS 32
+#define PGN_MAX_PLIES 1024 // Longer games are read as invalid
+
+//==============================================================================
+// PGN TYPES
+//==============================================================================
+
+// Writes any number of games to one stream through a single buffer; nothing
+// is allocated per game or per move
+typedef struct {
+  FILE *out;
+  char buffer[PGN_BUFFER_SIZE];
+  size_t used;
+  bool failed; // A write to the stream came up short
+
+  // Movetext state of the game being written
+  int column;
+  int moveNumber;
+  PieceColor sideToMove;
+  bool needsNumber; // Black's next move needs "n..." in front
+} PgnWriter;
+
+typedef enum {
+  PGN_RESULT_NONE = 0, // "*": unknown or still going on
+  PGN_RESULT_WHITE_WINS,
+  PGN_RESULT_BLACK_WINS,
+  PGN_RESULT_DRAW
+} PgnResult;
+
+// Text inside the input; not null-terminated
+typedef struct {
+  const char *text;
+  int length;
+} PgnText;
+
+// Reads games one after another from a buffer in memory, usually a mapped
+// file. Nothing is copied: tags point into the buffer.
+typedef struct {
+  const char *data;
+  size_t size;
+  size_t offset;
+  ChessPosition initial; // The standard starting position, set up once
+} PgnReader;
+
+typedef struct {
+  size_t offset; // Where the game starts in the input, and its size
+  size_t length;
+
+  int tagCount; // Tags past PGN_MAX_TAGS are skipped
+  PgnText tagNames[PGN_MAX_TAGS];
+  PgnText tagValues[PGN_MAX_TAGS]; // Escapes are left as written
+
+  ChessPosition start; // From the FEN tag, or the standard start
+  int plyCount;
+  Move moves[PGN_MAX_PLIES];
+  PgnResult result;
+
+  bool valid;        // Every move was legal and understood
+  const char *error; // Why the game is invalid, NULL if it is not
+} PgnGame;
+
+//==============================================================================
+// PGN WRITER FUNCTIONS
+//==============================================================================
+
+/**
+ * Start writing to a stream (a file or stdout). The stream stays open and
+ * owned by the caller.
+ */
+void InitPgnWriter(PgnWriter *writer, FILE *out);
+
+/**
+ * Write a tag pair, e.g. [White "Engine A"]. Quotes and backslashes in the
+ * value are escaped. Tags come before the movetext of each game.
+ */
+void WritePgnTag(PgnWriter *writer, const char *name, const char *value);
+
+/**
+ * End the tag section and start the movetext.
+ * @param fullmoveNumber Number of the first move (1 from the start position)
+ * @param sideToMove Color that plays the first move
+ */
+void BeginPgnMovetext(PgnWriter *writer, int fullmoveNumber,
+                      PieceColor sideToMove);
+
+/**
+ * Write the next move in SAN, with its number where needed, wrapping the
+ * line before it would get too long.
+ * @param clockSeconds Mover's remaining time after the move, written as a
+ * [%clk h:mm:ss.t] comment, or PGN_NO_CLOCK
+ */
+void WritePgnMove(PgnWriter *writer, const char *san, float clockSeconds);
+
+/**
+ * Finish the game with its result ("1-0", "0-1", "1/2-1/2" or "*").
+ */
+void EndPgnGame(PgnWriter *writer, const char *result);
+
+/**
+ * Write out everything buffered so far.
+ * @return false if any write failed since the writer was set up
+ */
+bool FlushPgnWriter(PgnWriter *writer);
+
+/**
+ * Text of a result as it ends the movetext ("1-0", "0-1", "1/2-1/2", "*").
+ */
+const char *GetPgnResultText(PgnResult result);
+
+//==============================================================================
+// PGN READER FUNCTIONS
+//==============================================================================
+
+/**
+ * Start reading games from a buffer, e.g. a file mapped with MapFile. The
+ * buffer must stay valid while games read from it are in use.
+ */
+void InitPgnReader(PgnReader *reader, const char *data, size_t size);
+
+/**
+ * Read the next game: its tags, then every move, each resolved against the
+ * position with ParseSanBody. Comments, variations, NAGs and move numbers
+ * are skipped. After an illegal or unreadable move the game is marked
+ * invalid and the rest of its movetext is skipped, so the next game is
+ * still found.
+ * @return false once there are no more games
+ */
+bool ReadPgnGame(PgnReader *reader, PgnGame *game);
+
+/**
+ * Find a tag of a game read by ReadPgnGame.
+ * @return false if the game has no such tag
+ */
+bool FindPgnTag(const PgnGame *game, const char *name, PgnText *value);
+
+#endif // PGN_H
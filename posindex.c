@@ -0,0 +1,323 @@
+/**
+ * Chess Game - Position Index
+ * Finds the games of a game database that reached a position, a material
+ * balance or a pawn structure.
+ */
+
+#include "posindex.h"
+#include "extsort.h"
+#include "search.h"
+#include "zobrist.h"
+#include <stdlib.h>
+#include <string.h>
+
+// The structures are the file format; they must have no padding
+_Static_assert(sizeof(PosIndexHeader) == 32, "PosIndexHeader layout");
+_Static_assert(sizeof(PosIndexRecord) == 16, "PosIndexRecord layout");
+
+//==============================================================================
+// KEYS
+//==============================================================================
+
+// Bit offset of each piece type's count within a side's 20 bits
+static const int SIGNATURE_SHIFTS[7] = {-1, -1, 0, 8, 12, 4, 16};
+static const char SIGNATURE_PIECES[] = "QRBNP";
+static const PieceType SIGNATURE_TYPES[5] = {PIECE_QUEEN, PIECE_ROOK,
+                                             PIECE_BISHOP, PIECE_KNIGHT,
+                                             PIECE_PAWN};
+
+uint64_t MaterialSignature(const ChessPosition *pos) {
+  uint64_t signature = 0;
+  for (int side = 0; side < 2; side++) {
+    PieceColor color = side == 0 ? COLOR_WHITE : COLOR_BLACK;
+    for (int i = 0; i < 5; i++) {
+      PieceType type = SIGNATURE_TYPES[i];
+      uint64_t count = (uint64_t)pos->pieceCount[color][type];
+      signature |= (count > 15 ? 15 : count)
+                   << (side * 20 + SIGNATURE_SHIFTS[type]);
+    }
+  }
+  return signature;
+}
+
+bool ParseMaterialSignature(const char *text, uint64_t *signature) {
+  *signature = 0;
+  int side = 0;
+  if (*text != 'K')
+    return false;
+  for (const char *c = text + 1; *c != '\0'; c++) {
+    if (*c == 'v' && side == 0 && c[1] == 'K') {
+      side = 1;
+      c++;
+      continue;
+    }
+    const char *piece = strchr(SIGNATURE_PIECES, *c);
+    if (piece == NULL)
+      return false;
+    int shift = side * 20 + SIGNATURE_SHIFTS[SIGNATURE_TYPES[piece -
+                                                             SIGNATURE_PIECES]];
+    if (((*signature >> shift) & 15) == 15)
+      return false;
+    *signature += (uint64_t)1 << shift;
+  }
+  return side == 1;
+}
+
+uint64_t PawnStructureKey(const ChessPosition *pos) {
+  uint64_t key = 0;
+  for (int sq = 0; sq < SQUARE_COUNT; sq++) {
+    if (CODE_TYPE(pos->squares[sq]) == PIECE_PAWN)
+      key ^= ZobristPiece(pos->squares[sq], sq);
+  }
+  return key;
+}
+
+uint64_t PositionIndexKey(PosIndexKind kind, const ChessPosition *pos) {
+  switch (kind) {
+  case POSINDEX_MATERIAL:
+    return MaterialSignature(pos);
+  case POSINDEX_PAWNS:
+    return PawnStructureKey(pos);
+  default:
+    return pos->key;
+  }
+}
+
+//==============================================================================
+// BUILD STATE
+//==============================================================================
+
+typedef struct {
+  FILE *out;
+  uint64_t written;
+  uint64_t *fences;
+  size_t fenceCount, fenceCapacity;
+  bool failed;
+  ExternalSort sort;
+} IndexBuild;
+
+//==============================================================================
+// RECORDS
+//==============================================================================
+
+static int CompareRecords(const void *a, const void *b) {
+  const PosIndexRecord *x = a, *y = b;
+  if (x->key != y->key)
+    return x->key < y->key ? -1 : 1;
+  if (x->game != y->game)
+    return x->game < y->game ? -1 : 1;
+  return (int)x->ply - (int)y->ply;
+}
+
+static bool CollectRecord(IndexBuild *build, uint64_t key, uint32_t game,
+                          int ply, Move next) {
+  PosIndexRecord *record = AddSortRecord(&build->sort);
+  if (record == NULL)
+    return false;
+  record->key = key;
+  record->game = game;
+  record->ply = (uint16_t)ply;
+  record->next = next;
+  return true;
+}
+
+//==============================================================================
+// OUTPUT
+//==============================================================================
+
+static bool WriteRecord(const void *data, void *context) {
+  IndexBuild *build = context;
+  const PosIndexRecord *record = data;
+  if (build->written % POSINDEX_FENCE_STRIDE == 0) {
+    if (build->fenceCount == build->fenceCapacity) {
+      size_t capacity =
+          build->fenceCapacity > 0 ? build->fenceCapacity * 2 : 1024;
+      uint64_t *fences = realloc(build->fences, capacity * sizeof(uint64_t));
+      if (fences == NULL) {
+        build->failed = true;
+        return false;
+      }
+      build->fences = fences;
+      build->fenceCapacity = capacity;
+    }
+    build->fences[build->fenceCount++] = record->key;
+  }
+  if (fwrite(record, sizeof(*record), 1, build->out) != 1)
+    build->failed = true;
+  build->written++;
+  return !build->failed;
+}
+
+//==============================================================================
+// BUILDING
+//==============================================================================
+
+static bool CollectGames(IndexBuild *build, const GameDb *db,
+                         PosIndexKind kind) {
+  Move moves[PGN_MAX_PLIES];
+  for (uint64_t game = 0; game < db->gameCount; game++) {
+    ChessPosition pos;
+    int count = LoadGameDbGame(db, game, &pos, moves);
+    if (count < 0)
+      return false;
+
+    uint64_t previous = 0;
+    for (int ply = 0; ply <= count; ply++) {
+      Move next = ply < count ? moves[ply] : MOVE_NONE;
+      uint64_t key = PositionIndexKey(kind, &pos);
+      // Material and pawns never come back, so only changes are listed
+      if ((kind == POSINDEX_POSITION || ply == 0 || key != previous) &&
+          !CollectRecord(build, key, (uint32_t)game, ply, next))
+        return false;
+      previous = key;
+      if (next != MOVE_NONE) {
+        MoveUndo undo;
+        MakeMove(&pos, next, &undo);
+      }
+    }
+  }
+  return true;
+}
+
+bool BuildPositionIndex(const GameDb *db, const char *path, PosIndexKind kind,
+                        size_t memoryMb, PosIndexSummary *summary) {
+  memset(summary, 0, sizeof(*summary));
+  if (db->gameCount > UINT32_MAX)
+    return false;
+
+  IndexBuild build = {0};
+  bool sorting = InitExternalSort(&build.sort, sizeof(PosIndexRecord),
+                                  (memoryMb > 0 ? memoryMb : 1) * 1048576,
+                                  CompareRecords, NULL);
+  build.out = fopen(path, "wb");
+  int64_t start = GetTimeMilliseconds();
+
+  PosIndexHeader header = {0};
+  bool built = sorting && build.out != NULL &&
+               fwrite(&header, sizeof(header), 1, build.out) == 1 &&
+               CollectGames(&build, db, kind) &&
+               FinishExternalSort(&build.sort, WriteRecord, &build,
+                                  &summary->runs);
+  FreeExternalSort(&build.sort);
+
+  if (built && !build.failed) {
+    memcpy(header.magic, POSINDEX_MAGIC, sizeof(header.magic));
+    header.version = POSINDEX_VERSION;
+    header.recordSize = sizeof(PosIndexRecord);
+    header.recordCount = build.written;
+    header.kind = (uint32_t)kind;
+    built = fwrite(build.fences, sizeof(uint64_t), build.fenceCount,
+                   build.out) == build.fenceCount &&
+            fseek(build.out, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(header), 1, build.out) == 1;
+  }
+  built = built && !build.failed;
+  if (build.out != NULL && fclose(build.out) != 0)
+    built = false;
+  if (!built && build.out != NULL)
+    remove(path);
+
+  summary->records = build.written;
+  summary->runs = summary->runs > 0 ? summary->runs : 1;
+  summary->timeMs = GetTimeMilliseconds() - start;
+  free(build.fences);
+  return built;
+}
+
+//==============================================================================
+// LOOKUP
+//==============================================================================
+
+bool OpenPositionIndex(PositionIndex *index, const char *path) {
+  memset(index, 0, sizeof(*index));
+  if (!MapFile(&index->file, path, MAP_ACCESS_RANDOM))
+    return false;
+
+  const PosIndexHeader *header = (const PosIndexHeader *)index->file.data;
+  size_t size = index->file.size;
+  uint64_t count = size >= sizeof(*header) ? header->recordCount : 0;
+  uint64_t fences = (count + POSINDEX_FENCE_STRIDE - 1) / POSINDEX_FENCE_STRIDE;
+  if (size < sizeof(*header) ||
+      memcmp(header->magic, POSINDEX_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != POSINDEX_VERSION ||
+      header->recordSize != sizeof(PosIndexRecord) ||
+      header->kind > POSINDEX_PAWNS ||
+      count > (size - sizeof(*header)) / sizeof(PosIndexRecord) ||
+      size != sizeof(*header) + count * sizeof(PosIndexRecord) +
+                  fences * sizeof(uint64_t)) {
+    UnmapFile(&index->file);
+    return false;
+  }
+
+  index->fences = malloc(fences > 0 ? fences * sizeof(uint64_t) : 1);
+  if (index->fences == NULL) {
+    UnmapFile(&index->file);
+    return false;
+  }
+  index->records =
+      (const PosIndexRecord *)(index->file.data + sizeof(*header));
+  memcpy(index->fences, index->records + count, fences * sizeof(uint64_t));
+  index->recordCount = count;
+  index->fenceCount = fences;
+  index->kind = (PosIndexKind)header->kind;
+  return true;
+}
+
+void ClosePositionIndex(PositionIndex *index) {
+  UnmapFile(&index->file);
+  free(index->fences);
+  index->fences = NULL;
+  index->records = NULL;
+  index->recordCount = 0;
+  index->fenceCount = 0;
+}
+
+// First fence (or record) in [low, high) whose key is above the target, or
+// at least the target when orEqual is set
+static uint64_t SearchFences(const uint64_t *keys, uint64_t low, uint64_t high,
+                             uint64_t key, bool orEqual) {
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    if (keys[middle] < key || (!orEqual && keys[middle] == key))
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+static uint64_t SearchRecords(const PosIndexRecord *records, uint64_t low,
+                              uint64_t high, uint64_t key, bool orEqual) {
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    if (records[middle].key < key ||
+        (!orEqual && records[middle].key == key))
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+uint64_t FindPositionRecords(const PositionIndex *index, uint64_t key,
+                             const PosIndexRecord **first) {
+  *first = NULL;
+  if (index->recordCount == 0)
+    return 0;
+
+  // The records with the key lie between the last fence below it and the
+  // first fence above it
+  uint64_t below = SearchFences(index->fences, 0, index->fenceCount, key, true);
+  uint64_t above =
+      SearchFences(index->fences, below, index->fenceCount, key, false);
+  uint64_t low = below > 0 ? (below - 1) * POSINDEX_FENCE_STRIDE : 0;
+  uint64_t high = above * POSINDEX_FENCE_STRIDE < index->recordCount
+                      ? above * POSINDEX_FENCE_STRIDE
+                      : index->recordCount;
+
+  uint64_t begin = SearchRecords(index->records, low, high, key, true);
+  uint64_t end = SearchRecords(index->records, begin, high, key, false);
+  if (begin < end)
+    *first = &index->records[begin];
+  return end - begin;
+}
@@ -0,0 +1,135 @@
+/**
+ * Chess Game - Position Index
+ * Finds the games of a game database that reached a position, a material
+ * balance or a pawn structure.
+ *
+ * Every position of every game is listed once as a (key, game, ply, next
+ * move) record. An index is keyed by one of: the Zobrist key of the whole
+ * position, the material signature (piece counts per side), or the Zobrist
+ * key of the pawns alone. Material and pawns only change by captures,
+ * promotions and pawn moves, never back, so those indexes list just the
+ * first position of each game with a given key. Records are sorted by key with an external merge sort, so
+ * building needs bounded memory whatever the size of the database, and the
+ * sorted array is then searched in place through a mapping.
+ *
+ * File layout: header | records | fences. The fences are the keys of every
+ * POSINDEX_FENCE_STRIDE-th record, loaded into memory on open, so a lookup
+ * is a binary search over the fences followed by one over a single block of
+ * the mapped records.
+ */
+
+#ifndef POSINDEX_H
+#define POSINDEX_H
+
+#include "gamedb.h"
+#include "mapfile.h"
+#include <stdint.h>
+
+//==============================================================================
+// POSITION INDEX CONSTANTS
+//==============================================================================
+
+#define POSINDEX_MAGIC "CHESSPIX"
+#define POSINDEX_VERSION 2
+#define POSINDEX_FENCE_STRIDE 4096 // Records per fence (a 64 KB block)
+#define POSINDEX_DEFAULT_MEMORY_MB 256
+
+//==============================================================================
+// POSITION INDEX TYPES
+//==============================================================================
+
+typedef enum {
+  POSINDEX_POSITION = 0, // Zobrist key of the position
+  POSINDEX_MATERIAL,     // MaterialSignature
+  POSINDEX_PAWNS         // PawnStructureKey
+} PosIndexKind;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  uint64_t recordCount;
+  uint32_t kind; // PosIndexKind
+  uint32_t reserved;
+} PosIndexHeader;
+
+// A position reached in a game
+typedef struct {
+  uint64_t key;  // Key of the position for the index kind
+  uint32_t game; // Index in the game database
+  uint16_t ply;  // Moves played before the position
+  Move next;     // Move played from it, MOVE_NONE at the end of the game
+} PosIndexRecord;
+
+typedef struct {
+  MappedFile file;
+  PosIndexKind kind;
+  const PosIndexRecord *records;
+  uint64_t recordCount;
+  uint64_t *fences; // Key of every POSINDEX_FENCE_STRIDE-th record
+  uint64_t fenceCount;
+} PositionIndex;
+
+typedef struct {
+  uint64_t records;  // Records written
+  int runs;          // Sorted runs merged
+  int64_t timeMs;
+} PosIndexSummary;
+
+//==============================================================================
+// POSITION INDEX FUNCTIONS
+//==============================================================================
+
+/**
+ * Material signature: the number of queens, rooks, bishops, knights and
+ * pawns of each side, four bits each. Kings are implied.
+ */
+uint64_t MaterialSignature(const ChessPosition *pos);
+
+/**
+ * Parse a material signature such as "KRvKB" or "KRPPvKR" (white first).
+ * @return false if the text is not a signature
+ */
+bool ParseMaterialSignature(const char *text, uint64_t *signature);
+
+/**
+ * Zobrist key of the pawns alone, the same for every position with the same
+ * pawn structure.
+ */
+uint64_t PawnStructureKey(const ChessPosition *pos);
+
+/**
+ * Key of a position in an index of the given kind.
+ */
+uint64_t PositionIndexKey(PosIndexKind kind, const ChessPosition *pos);
+
+/**
+ * Replay every game of a database and write the index of its positions.
+ * Runs of at most memoryMb are sorted in memory and spilled to temporary
+ * files, then merged into the index file.
+ * @return false if the database is corrupt, memory ran out or a write failed
+ */
+bool BuildPositionIndex(const GameDb *db, const char *path, PosIndexKind kind,
+                        size_t memoryMb, PosIndexSummary *summary);
+
+/**
+ * Map an index and load its fences.
+ * @return false if the file is missing or not a valid index
+ */
+bool OpenPositionIndex(PositionIndex *index, const char *path);
+
+/**
+ * Unmap the index and free its fences. Safe on one that failed to open.
+ */
+void ClosePositionIndex(PositionIndex *index);
+
+/**
+ * Find the records of a key (see PositionIndexKey). They are contiguous in
+ * the index, ordered by game and ply.
+ * @param first Output pointer to the first record (into the mapping)
+ * @return Number of records, 0 if the position never occurred
+ */
+uint64_t FindPositionRecords(const PositionIndex *index, uint64_t key,
+                             const PosIndexRecord **first);
+
+#endif // POSINDEX_H
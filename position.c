@@ -0,0 +1,470 @@
+/**
+ * Chess Game - Position Representation
+ * Self-contained board state used by the book and engine modules.
+ */
+
+#include "position.h"
+#include "zobrist.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// POSITION SETUP
+//==============================================================================
+
+void ClearPosition(ChessPosition *pos) {
+  memset(pos, 0, sizeof(*pos));
+  pos->sideToMove = COLOR_WHITE;
+  pos->enPassantSquare = NO_SQUARE;
+  pos->fullmoveNumber = 1;
+  pos->kingSquare[COLOR_WHITE] = NO_SQUARE;
+  pos->kingSquare[COLOR_BLACK] = NO_SQUARE;
+}
+
+void PutPiece(ChessPosition *pos, int sq, PieceCode code) {
+  pos->squares[sq] = code;
+  pos->pieceCount[CODE_COLOR(code)][CODE_TYPE(code)]++;
+  if (CODE_TYPE(code) == PIECE_KING)
+    pos->kingSquare[CODE_COLOR(code)] = sq;
+}
+
+int CountPieces(const ChessPosition *pos) {
+  int total = 0;
+  for (int type = PIECE_KING; type <= PIECE_PAWN; type++)
+    total += pos->pieceCount[COLOR_WHITE][type] +
+             pos->pieceCount[COLOR_BLACK][type];
+  return total;
+}
+
+//==============================================================================
+// FEN
+//==============================================================================
+
+static const char FEN_PIECES[] = " kqbnrp";
+
+static PieceCode PieceFromFenChar(char c) {
+  const char *found = strchr(FEN_PIECES + 1, c | 0x20);
+  if (c == '\0' || found == NULL)
+    return NO_PIECE;
+  PieceColor color = (c >= 'a') ? COLOR_BLACK : COLOR_WHITE;
+  return PIECE_CODE((PieceType)(found - FEN_PIECES), color);
+}
+
+static bool HasPieceAt(const ChessPosition *pos, int row, int col,
+                       PieceType type, PieceColor color) {
+  return pos->squares[SQ(row, col)] == PIECE_CODE(type, color);
+}
+
+static bool ParseFen(ChessPosition *pos, const char *fen) {
+  const char *p = fen;
+  while (*p == ' ')
+    p++;
+
+  // Piece placement, eighth rank first
+  int row = 0;
+  int col = 0;
+  for (; *p != ' ' && *p != '\0'; p++) {
+    if (*p == '/') {
+      if (col != BOARD_SIZE || ++row >= BOARD_SIZE)
+        return false;
+      col = 0;
+    } else if (*p >= '1' && *p <= '8') {
+      col += *p - '0';
+    } else {
+      PieceCode code = PieceFromFenChar(*p);
+      if (code == NO_PIECE || col >= BOARD_SIZE)
+        return false;
+      PutPiece(pos, SQ(row, col++), code);
+    }
+    if (col > BOARD_SIZE)
+      return false;
+  }
+  if (row != BOARD_SIZE - 1 || col != BOARD_SIZE ||
+      pos->pieceCount[COLOR_WHITE][PIECE_KING] != 1 ||
+      pos->pieceCount[COLOR_BLACK][PIECE_KING] != 1)
+    return false;
+
+  // Side to move
+  while (*p == ' ')
+    p++;
+  if (*p == 'w')
+    pos->sideToMove = COLOR_WHITE;
+  else if (*p == 'b')
+    pos->sideToMove = COLOR_BLACK;
+  else
+    return false;
+  p++;
+
+  // Castling rights, kept only with king and rook on their home squares
+  while (*p == ' ')
+    p++;
+  for (; *p != ' ' && *p != '\0'; p++) {
+    if (*p == 'K' && HasPieceAt(pos, 7, 4, PIECE_KING, COLOR_WHITE) &&
+        HasPieceAt(pos, 7, 7, PIECE_ROOK, COLOR_WHITE))
+      pos->castlingRights |= CASTLE_WHITE_KINGSIDE;
+    else if (*p == 'Q' && HasPieceAt(pos, 7, 4, PIECE_KING, COLOR_WHITE) &&
+             HasPieceAt(pos, 7, 0, PIECE_ROOK, COLOR_WHITE))
+      pos->castlingRights |= CASTLE_WHITE_QUEENSIDE;
+    else if (*p == 'k' && HasPieceAt(pos, 0, 4, PIECE_KING, COLOR_BLACK) &&
+             HasPieceAt(pos, 0, 7, PIECE_ROOK, COLOR_BLACK))
+      pos->castlingRights |= CASTLE_BLACK_KINGSIDE;
+    else if (*p == 'q' && HasPieceAt(pos, 0, 4, PIECE_KING, COLOR_BLACK) &&
+             HasPieceAt(pos, 0, 0, PIECE_ROOK, COLOR_BLACK))
+      pos->castlingRights |= CASTLE_BLACK_QUEENSIDE;
+  }
+
+  // En passant square, only on the rank behind a double-pushed pawn
+  while (*p == ' ')
+    p++;
+  if (p[0] >= 'a' && p[0] <= 'h' && (p[1] == '3' || p[1] == '6')) {
+    int epRow = '8' - p[1];
+    if (epRow == ((pos->sideToMove == COLOR_WHITE) ? 2 : 5))
+      pos->enPassantSquare = SQ(epRow, p[0] - 'a');
+    p += 2;
+  } else if (*p == '-') {
+    p++;
+  }
+
+  // Optional move counters
+  char *end;
+  long halfmoves = strtol(p, &end, 10);
+  if (end != p) {
+    pos->halfmoveClock = (int)(halfmoves > 0 ? halfmoves : 0);
+    p = end;
+    long fullmoves = strtol(p, &end, 10);
+    if (end != p && fullmoves > 0)
+      pos->fullmoveNumber = (int)fullmoves;
+  }
+
+  return true;
+}
+
+bool SetPositionFromFen(ChessPosition *pos, const char *fen) {
+  ClearPosition(pos);
+  if (!ParseFen(pos, fen)) {
+    ClearPosition(pos);
+    return false;
+  }
+  pos->key = ComputePositionKey(pos);
+  return true;
+}
+
+bool GetEpdOperation(const char *epd, const char *opcode, char *value,
+                     size_t size) {
+  // Operations follow the four placement, side, castling and en passant
+  // fields
+  const char *p = epd;
+  for (int field = 0; field < 4; field++) {
+    while (*p == ' ' || *p == '\t')
+      p++;
+    while (*p != '\0' && *p != ' ' && *p != '\t')
+      p++;
+  }
+
+  // Skip the move counters of a full FEN
+  for (int field = 0; field < 2; field++) {
+    const char *q = p;
+    while (*q == ' ' || *q == '\t')
+      q++;
+    if (!isdigit((unsigned char)*q))
+      break;
+    while (isdigit((unsigned char)*q))
+      q++;
+    p = q;
+  }
+
+  size_t opcodeLength = strlen(opcode);
+  while (*p != '\0') {
+    while (*p == ' ' || *p == '\t' || *p == ';')
+      p++;
+
+    const char *name = p;
+    while (*p != '\0' && *p != ' ' && *p != '\t' && *p != ';')
+      p++;
+    bool match = ((size_t)(p - name) == opcodeLength &&
+                  strncmp(name, opcode, opcodeLength) == 0);
+
+    // The operands run to the next semicolon outside quotes
+    while (*p == ' ' || *p == '\t')
+      p++;
+    size_t length = 0;
+    bool quoted = false;
+    for (; *p != '\0' && *p != '\n' && *p != '\r' && (quoted || *p != ';');
+         p++) {
+      if (*p == '"') {
+        quoted = !quoted;
+      } else if (match && length + 1 < size) {
+        value[length++] = *p;
+      }
+    }
+    if (match) {
+      while (length > 0 && value[length - 1] == ' ')
+        length--;
+      value[length] = '\0';
+      return true;
+    }
+    if (*p == '\n' || *p == '\r')
+      break;
+  }
+  return false;
+}
+
+void GetPositionFen(const ChessPosition *pos, char *buffer, size_t size) {
+  char fen[FEN_MAX_LENGTH];
+  int length = 0;
+
+  for (int row = 0; row < BOARD_SIZE; row++) {
+    int empty = 0;
+    for (int col = 0; col < BOARD_SIZE; col++) {
+      PieceCode code = pos->squares[SQ(row, col)];
+      if (code == NO_PIECE) {
+        empty++;
+        continue;
+      }
+      if (empty > 0)
+        fen[length++] = (char)('0' + empty);
+      empty = 0;
+      char c = FEN_PIECES[CODE_TYPE(code)];
+      fen[length++] = (CODE_COLOR(code) == COLOR_WHITE) ? (char)(c - 0x20) : c;
+    }
+    if (empty > 0)
+      fen[length++] = (char)('0' + empty);
+    if (row < BOARD_SIZE - 1)
+      fen[length++] = '/';
+  }
+
+  fen[length++] = ' ';
+  fen[length++] = (pos->sideToMove == COLOR_WHITE) ? 'w' : 'b';
+  fen[length++] = ' ';
+
+  if (pos->castlingRights == 0)
+    fen[length++] = '-';
+  if (pos->castlingRights & CASTLE_WHITE_KINGSIDE)
+    fen[length++] = 'K';
+  if (pos->castlingRights & CASTLE_WHITE_QUEENSIDE)
+    fen[length++] = 'Q';
+  if (pos->castlingRights & CASTLE_BLACK_KINGSIDE)
+    fen[length++] = 'k';
+  if (pos->castlingRights & CASTLE_BLACK_QUEENSIDE)
+    fen[length++] = 'q';
+
+  fen[length++] = ' ';
+  if (pos->enPassantSquare == NO_SQUARE) {
+    fen[length++] = '-';
+  } else {
+    fen[length++] = (char)('a' + SQ_COL(pos->enPassantSquare));
+    fen[length++] = (char)('8' - SQ_ROW(pos->enPassantSquare));
+  }
+
+  snprintf(fen + length, sizeof(fen) - length, " %d %d", pos->halfmoveClock,
+           pos->fullmoveNumber);
+  snprintf(buffer, size, "%s", fen);
+}
+
+//==============================================================================
+// HASHING
+//==============================================================================
+
+// True if a pawn of the side to move stands next to the pawn that just moved
+// two squares, i.e. the en passant capture is at least pseudo-legal
+static bool EnPassantCapturable(const ChessPosition *pos) {
+  if (pos->enPassantSquare == NO_SQUARE)
+    return false;
+
+  // The double-pushed pawn sits one row beyond the en passant square
+  int direction = (pos->sideToMove == COLOR_WHITE) ? 1 : -1;
+  int pawnRow = SQ_ROW(pos->enPassantSquare) + direction;
+  int col = SQ_COL(pos->enPassantSquare);
+  PieceCode ownPawn = PIECE_CODE(PIECE_PAWN, pos->sideToMove);
+
+  return (col > 0 && pos->squares[SQ(pawnRow, col - 1)] == ownPawn) ||
+         (col < 7 && pos->squares[SQ(pawnRow, col + 1)] == ownPawn);
+}
+
+uint64_t ComputePositionKey(const ChessPosition *pos) {
+  uint64_t key = 0;
+
+  for (int sq = 0; sq < SQUARE_COUNT; sq++) {
+    if (pos->squares[sq] != NO_PIECE)
+      key ^= ZobristPiece(pos->squares[sq], sq);
+  }
+
+  key ^= ZobristCastling(pos->castlingRights);
+
+  if (EnPassantCapturable(pos))
+    key ^= ZobristEnPassant(SQ_COL(pos->enPassantSquare));
+
+  if (pos->sideToMove == COLOR_WHITE)
+    key ^= ZobristTurn();
+
+  return key;
+}
+
+//==============================================================================
+// MOVE EXECUTION
+//==============================================================================
+
+// Castling rights kept when a move touches a square: moving the king or a
+// rook, or capturing a rook on its home square, clears the matching rights
+static const unsigned char CASTLE_KEEP_MASK[SQUARE_COUNT] = {
+    [SQ(0, 0)] = CASTLE_ALL & ~CASTLE_BLACK_QUEENSIDE,
+    [SQ(0, 4)] = CASTLE_ALL & ~(CASTLE_BLACK_KINGSIDE | CASTLE_BLACK_QUEENSIDE),
+    [SQ(0, 7)] = CASTLE_ALL & ~CASTLE_BLACK_KINGSIDE,
+    [SQ(7, 0)] = CASTLE_ALL & ~CASTLE_WHITE_QUEENSIDE,
+    [SQ(7, 4)] = CASTLE_ALL & ~(CASTLE_WHITE_KINGSIDE | CASTLE_WHITE_QUEENSIDE),
+    [SQ(7, 7)] = CASTLE_ALL & ~CASTLE_WHITE_KINGSIDE,
+};
+
+static int CastleKeepMask(int sq) {
+  return CASTLE_KEEP_MASK[sq] ? CASTLE_KEEP_MASK[sq] : CASTLE_ALL;
+}
+
+void MakeMove(ChessPosition *pos, Move move, MoveUndo *undo) {
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  PieceType promotion = MOVE_PROMOTION(move);
+  PieceCode piece = pos->squares[from];
+  PieceType type = CODE_TYPE(piece);
+  PieceColor us = pos->sideToMove;
+  PieceColor them = OPPONENT_COLOR(us);
+  uint64_t key = pos->key;
+
+  undo->castlingRights = pos->castlingRights;
+  undo->enPassantSquare = pos->enPassantSquare;
+  undo->halfmoveClock = pos->halfmoveClock;
+  undo->key = pos->key;
+
+  // Take out the old en passant and castling contributions
+  if (EnPassantCapturable(pos))
+    key ^= ZobristEnPassant(SQ_COL(pos->enPassantSquare));
+  key ^= ZobristCastling(pos->castlingRights);
+
+  // Remove the captured piece (behind the target square for en passant)
+  int captureSq = to;
+  if (type == PIECE_PAWN && to == pos->enPassantSquare)
+    captureSq = SQ(SQ_ROW(from), SQ_COL(to));
+  PieceCode captured = pos->squares[captureSq];
+  undo->captured = captured;
+  if (captured != NO_PIECE) {
+    pos->squares[captureSq] = NO_PIECE;
+    pos->pieceCount[them][CODE_TYPE(captured)]--;
+    key ^= ZobristPiece(captured, captureSq);
+  }
+
+  // Move the piece, replacing a pawn by its promotion piece
+  PieceCode placed = piece;
+  if (promotion != PIECE_NONE) {
+    placed = PIECE_CODE(promotion, us);
+    pos->pieceCount[us][PIECE_PAWN]--;
+    pos->pieceCount[us][promotion]++;
+  }
+  pos->squares[from] = NO_PIECE;
+  pos->squares[to] = placed;
+  key ^= ZobristPiece(piece, from) ^ ZobristPiece(placed, to);
+
+  // King moves, including the rook hop when castling
+  if (type == PIECE_KING) {
+    pos->kingSquare[us] = to;
+    if (to - from == 2 || from - to == 2) {
+      int row = SQ_ROW(from);
+      int rookFrom = (to > from) ? SQ(row, 7) : SQ(row, 0);
+      int rookTo = (to > from) ? SQ(row, 5) : SQ(row, 3);
+      PieceCode rook = pos->squares[rookFrom];
+      pos->squares[rookFrom] = NO_PIECE;
+      pos->squares[rookTo] = rook;
+      key ^= ZobristPiece(rook, rookFrom) ^ ZobristPiece(rook, rookTo);
+    }
+  }
+
+  pos->castlingRights &= CastleKeepMask(from) & CastleKeepMask(to);
+  key ^= ZobristCastling(pos->castlingRights);
+
+  // A double pawn push leaves an en passant square behind it
+  pos->enPassantSquare = NO_SQUARE;
+  if (type == PIECE_PAWN && (to - from == 16 || from - to == 16))
+    pos->enPassantSquare = (from + to) / 2;
+
+  if (type == PIECE_PAWN || captured != NO_PIECE)
+    pos->halfmoveClock = 0;
+  else
+    pos->halfmoveClock++;
+
+  if (us == COLOR_BLACK)
+    pos->fullmoveNumber++;
+
+  pos->sideToMove = them;
+  key ^= ZobristTurn();
+
+  if (EnPassantCapturable(pos))
+    key ^= ZobristEnPassant(SQ_COL(pos->enPassantSquare));
+
+  pos->key = key;
+}
+
+void UnmakeMove(ChessPosition *pos, Move move, const MoveUndo *undo) {
+  int from = MOVE_FROM(move);
+  int to = MOVE_TO(move);
+  PieceType promotion = MOVE_PROMOTION(move);
+  PieceColor us = OPPONENT_COLOR(pos->sideToMove);
+
+  PieceCode piece = pos->squares[to];
+  if (promotion != PIECE_NONE) {
+    pos->pieceCount[us][promotion]--;
+    pos->pieceCount[us][PIECE_PAWN]++;
+    piece = PIECE_CODE(PIECE_PAWN, us);
+  }
+  pos->squares[from] = piece;
+  pos->squares[to] = NO_PIECE;
+
+  if (undo->captured != NO_PIECE) {
+    int captureSq = to;
+    if (CODE_TYPE(piece) == PIECE_PAWN && to == undo->enPassantSquare)
+      captureSq = SQ(SQ_ROW(from), SQ_COL(to));
+    pos->squares[captureSq] = undo->captured;
+    pos->pieceCount[pos->sideToMove][CODE_TYPE(undo->captured)]++;
+  }
+
+  if (CODE_TYPE(piece) == PIECE_KING) {
+    pos->kingSquare[us] = from;
+    if (to - from == 2 || from - to == 2) {
+      int row = SQ_ROW(from);
+      int rookFrom = (to > from) ? SQ(row, 7) : SQ(row, 0);
+      int rookTo = (to > from) ? SQ(row, 5) : SQ(row, 3);
+      pos->squares[rookFrom] = pos->squares[rookTo];
+      pos->squares[rookTo] = NO_PIECE;
+    }
+  }
+
+  if (us == COLOR_BLACK)
+    pos->fullmoveNumber--;
+
+  pos->sideToMove = us;
+  pos->castlingRights = undo->castlingRights;
+  pos->enPassantSquare = undo->enPassantSquare;
+  pos->halfmoveClock = undo->halfmoveClock;
+  pos->key = undo->key;
+}
+
+void MakeNullMove(ChessPosition *pos, MoveUndo *undo) {
+  undo->captured = NO_PIECE;
+  undo->castlingRights = pos->castlingRights;
+  undo->enPassantSquare = pos->enPassantSquare;
+  undo->halfmoveClock = pos->halfmoveClock;
+  undo->key = pos->key;
+
+  if (EnPassantCapturable(pos))
+    pos->key ^= ZobristEnPassant(SQ_COL(pos->enPassantSquare));
+  pos->enPassantSquare = NO_SQUARE;
+  pos->halfmoveClock++;
+  pos->sideToMove = OPPONENT_COLOR(pos->sideToMove);
+  pos->key ^= ZobristTurn();
+}
+
+void UnmakeNullMove(ChessPosition *pos, const MoveUndo *undo) {
+  pos->sideToMove = OPPONENT_COLOR(pos->sideToMove);
+  pos->enPassantSquare = undo->enPassantSquare;
+  pos->halfmoveClock = undo->halfmoveClock;
+  pos->key = undo->key;
+}
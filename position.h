@@ -0,0 +1,163 @@
+/**
+ * Chess Game - Position Representation
+ * Self-contained board state used by the book and engine modules.
+ */
+
+#ifndef POSITION_H
+#define POSITION_H
+
+#include "types.h"
+#include <stddef.h>
+#include <stdint.h>
+
+//==============================================================================
+// SQUARES
+//==============================================================================
+
+// Squares are numbered row * 8 + col, matching board[row][col] (row 0 is the
+// eighth rank, col 0 is the a-file).
+#define SQUARE_COUNT 64
+#define NO_SQUARE (-1)
+#define SQ(row, col) ((row) * BOARD_SIZE + (col))
+#define SQ_ROW(sq) ((sq) >> 3)
+#define SQ_COL(sq) ((sq) & 7)
+
+//==============================================================================
+// PIECE CODES
+//==============================================================================
+
+// A piece packed into one byte: type in the low three bits, color above.
+// Zero is an empty square (PIECE_NONE, COLOR_NONE).
+typedef unsigned char PieceCode;
+
+#define PIECE_CODE_COUNT 24
+#define NO_PIECE ((PieceCode)0)
+#define PIECE_CODE(type, color) ((PieceCode)((type) | ((color) << 3)))
+#define CODE_TYPE(code) ((PieceType)((code) & 7))
+#define CODE_COLOR(code) ((PieceColor)((code) >> 3))
+
+//==============================================================================
+// CASTLING RIGHTS
+//==============================================================================
+
+#define CASTLE_WHITE_KINGSIDE 1
+#define CASTLE_WHITE_QUEENSIDE 2
+#define CASTLE_BLACK_KINGSIDE 4
+#define CASTLE_BLACK_QUEENSIDE 8
+#define CASTLE_ALL 15
+
+#define STARTING_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define FEN_MAX_LENGTH 92
+
+//==============================================================================
+// MOVES
+//==============================================================================
+
+// A move packed into 16 bits: from square, to square and promotion type.
+// Castling is encoded as the king's two-square move, en passant as the pawn's
+// diagonal move onto the en passant square.
+typedef uint16_t Move;
+
+#define MOVE_NONE ((Move)0)
+#define MAKE_MOVE(from, to, promo)                                             \
+  ((Move)((from) | ((to) << 6) | ((promo) << 12)))
+#define MOVE_FROM(m) ((int)((m) & 63))
+#define MOVE_TO(m) ((int)(((m) >> 6) & 63))
+#define MOVE_PROMOTION(m) ((PieceType)(((m) >> 12) & 7))
+
+//==============================================================================
+// POSITION STATE
+//==============================================================================
+
+typedef struct {
+  PieceCode squares[SQUARE_COUNT];
+  PieceColor sideToMove;
+  int castlingRights;   // CASTLE_* bit mask
+  int enPassantSquare;  // Square behind a pawn that just moved two, or -1
+  int halfmoveClock;    // Plies since the last capture or pawn move
+  int fullmoveNumber;   // Starts at 1, incremented after black moves
+  int kingSquare[3];    // Indexed by PieceColor
+  int pieceCount[3][7]; // Indexed by [PieceColor][PieceType]
+  uint64_t key;         // Polyglot-compatible Zobrist key
+} ChessPosition;
+
+// State MakeMove cannot recompute when the move is taken back
+typedef struct {
+  PieceCode captured;
+  int castlingRights;
+  int enPassantSquare;
+  int halfmoveClock;
+  uint64_t key;
+} MoveUndo;
+
+//==============================================================================
+// POSITION FUNCTIONS
+//==============================================================================
+
+/**
+ * Reset to an empty board with white to move and no rights.
+ */
+void ClearPosition(ChessPosition *pos);
+
+/**
+ * Place a piece on an empty square, keeping king squares and piece counts in
+ * sync. Does not update the key; call ComputePositionKey when setup is done.
+ */
+void PutPiece(ChessPosition *pos, int sq, PieceCode code);
+
+/**
+ * Set up a position from Forsyth-Edwards Notation. The move counters are
+ * optional. Castling rights without the king and rook at home are dropped.
+ * @return false (leaving pos cleared) if the FEN is malformed or a side
+ * does not have exactly one king
+ */
+bool SetPositionFromFen(ChessPosition *pos, const char *fen);
+
+/**
+ * Find the value of an EPD operation, e.g. "bm" in
+ * "<fen fields> bm Qxf7+; id \"puzzle 12\";". Quotes are removed.
+ * @return false if the line has no such operation
+ */
+bool GetEpdOperation(const char *epd, const char *opcode, char *value,
+                     size_t size);
+
+/**
+ * Write the FEN of a position (at most FEN_MAX_LENGTH bytes with the null).
+ */
+void GetPositionFen(const ChessPosition *pos, char *buffer, size_t size);
+
+/**
+ * Compute the Zobrist key of a position from scratch.
+ * En passant only contributes when a pawn of the side to move can actually
+ * capture, as Polyglot specifies.
+ */
+uint64_t ComputePositionKey(const ChessPosition *pos);
+
+/**
+ * Play a pseudo-legal move, updating the key incrementally.
+ * The caller checks legality (the mover's king must not be left attacked).
+ */
+void MakeMove(ChessPosition *pos, Move move, MoveUndo *undo);
+
+/**
+ * Take back a move played with MakeMove.
+ */
+void UnmakeMove(ChessPosition *pos, Move move, const MoveUndo *undo);
+
+/**
+ * Pass the turn without moving (for null-move pruning). Never call it when
+ * the side to move is in check.
+ */
+void MakeNullMove(ChessPosition *pos, MoveUndo *undo);
+
+/**
+ * Take back a null move played with MakeNullMove.
+ */
+void UnmakeNullMove(ChessPosition *pos, const MoveUndo *undo);
+
+/**
+ * Total number of pieces on the board, kings included.
+ */
+int CountPieces(const ChessPosition *pos);
+
+#endif // POSITION_H
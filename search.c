@@ -0,0 +1,966 @@
+/**
+ * Chess Game - Search
+ * Multi-threaded iterative-deepening alpha-beta search.
+ *
+ * Threads share the transposition table and otherwise search independently
+ * ("lazy SMP"); the first thread manages time and reports results.
+ */
+
+#include "search.h"
+#include "eval.h"
+#include "tbprobe.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+//==============================================================================
+// SEARCH PARAMETERS
+//==============================================================================
+
+#define CHECK_INTERVAL 1024 // Nodes between time and stop checks
+#define ASPIRATION_WINDOW 40
+#define ASPIRATION_MIN_DEPTH 5
+#define NULL_MOVE_MIN_DEPTH 3
+#define FUTILITY_MAX_DEPTH 6
+#define FUTILITY_MARGIN 80
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVES 4
+#define MOVE_OVERHEAD_MS 30 // Time kept back for I/O and thread startup
+
+// Move ordering tiers
+#define ORDER_TT_MOVE 4000000
+#define ORDER_CAPTURE 2000000
+#define ORDER_KILLER_1 1000001
+#define ORDER_KILLER_2 1000000
+#define HISTORY_MAX 500000
+
+static const int ORDER_VALUES[7] = {0, 2000, 900, 330, 320, 500, 100};
+
+//==============================================================================
+// SEARCH TYPES
+//==============================================================================
+
+struct SearchShared;
+
+typedef struct {
+  struct SearchShared *shared;
+  int id;
+  pthread_t handle;
+
+  ChessPosition pos;
+  uint64_t keys[SEARCH_HISTORY_KEYS + MAX_PLY]; // Positions before this one
+  int keyCount;
+
+  uint64_t nodes;
+  uint64_t tbHits;
+  atomic_uint_fast64_t publishedNodes;
+  atomic_uint_fast64_t publishedTbHits;
+  int selDepth;
+
+  Move killers[MAX_PLY][2];
+  int history[3][SQUARE_COUNT][SQUARE_COUNT]; // [color][from][to]
+  Move pv[MAX_PLY][MAX_PLY];
+  int pvLength[MAX_PLY];
+
+  MoveList rootMoves; // Lines found so far this iteration come first
+  int multiPv;
+  int pvIndex; // Line being searched; earlier root moves are excluded
+  SearchLine lines[SEARCH_MAX_MULTIPV];
+  SearchReport best; // Last completed iteration
+} SearchThread;
+
+typedef struct SearchShared {
+  Searcher *searcher;
+  const SearchLimits *limits;
+  int64_t startTime;
+  int64_t softDeadline; // Do not start another iteration after this
+  int64_t hardDeadline; // Abort the current iteration at this point
+  SearchThread *threads;
+  int threadCount;
+} SearchShared;
+
+//==============================================================================
+// TIME
+//==============================================================================
+
+int64_t GetTimeMilliseconds(void) {
+#ifdef _WIN32
+  return (int64_t)GetTickCount64();
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
+
+static void SleepMilliseconds(int milliseconds) {
+#ifdef _WIN32
+  Sleep((DWORD)milliseconds);
+#else
+  struct timespec duration = {milliseconds / 1000,
+                              (long)(milliseconds % 1000) * 1000000};
+  nanosleep(&duration, NULL);
+#endif
+}
+
+// Split the remaining clock time into a soft target and a hard cap
+static void PlanTime(SearchShared *shared, PieceColor us) {
+  const SearchLimits *limits = shared->limits;
+  shared->softDeadline = 0;
+  shared->hardDeadline = 0;
+
+  if (limits->moveTime > 0) {
+    int64_t budget = limits->moveTime - MOVE_OVERHEAD_MS;
+    if (budget < 1)
+      budget = 1;
+    shared->softDeadline = shared->hardDeadline = shared->startTime + budget;
+    return;
+  }
+
+  if (limits->time[us] <= 0)
+    return;
+
+  int64_t remaining = limits->time[us] - MOVE_OVERHEAD_MS;
+  if (remaining < 1)
+    remaining = 1;
+
+  int movesToGo = limits->movesToGo > 0 ? limits->movesToGo : 30;
+  if (movesToGo > 40)
+    movesToGo = 40;
+
+  int64_t target = remaining / movesToGo + limits->increment[us] * 3 / 4;
+  int64_t cap = remaining / 2;
+  if (target > cap)
+    target = cap;
+  int64_t hard = target * 4;
+  if (hard > cap)
+    hard = cap;
+
+  shared->softDeadline = shared->startTime + (target > 0 ? target : 1);
+  shared->hardDeadline = shared->startTime + (hard > 0 ? hard : 1);
+}
+
+//==============================================================================
+// SCORE HELPERS
+//==============================================================================
+
+bool IsMateScore(int score) {
+  return score >= SCORE_MATE_IN_MAX || score <= -SCORE_MATE_IN_MAX;
+}
+
+int MateInMoves(int score) {
+  return score > 0 ? (SCORE_MATE - score + 1) / 2 : -(SCORE_MATE + score) / 2;
+}
+
+// Mate and tablebase scores are stored relative to the node, not the root
+static int ScoreToTable(int score, int ply) {
+  if (score >= SCORE_TB_WIN_IN_MAX)
+    return score + ply;
+  if (score <= -SCORE_TB_WIN_IN_MAX)
+    return score - ply;
+  return score;
+}
+
+static int ScoreFromTable(int score, int ply) {
+  if (score >= SCORE_TB_WIN_IN_MAX)
+    return score - ply;
+  if (score <= -SCORE_TB_WIN_IN_MAX)
+    return score + ply;
+  return score;
+}
+
+//==============================================================================
+// NODE BOOKKEEPING
+//==============================================================================
+
+static uint64_t TotalNodes(const SearchShared *shared) {
+  uint64_t nodes = 0;
+  for (int i = 0; i < shared->threadCount; i++)
+    nodes += atomic_load_explicit(&shared->threads[i].publishedNodes,
+                                  memory_order_relaxed);
+  return nodes;
+}
+
+static uint64_t TotalTbHits(const SearchShared *shared) {
+  uint64_t hits = 0;
+  for (int i = 0; i < shared->threadCount; i++)
+    hits += atomic_load_explicit(&shared->threads[i].publishedTbHits,
+                                 memory_order_relaxed);
+  return hits;
+}
+
+static bool ShouldStop(SearchThread *t) {
+  return atomic_load_explicit(&t->shared->searcher->stop,
+                              memory_order_relaxed);
+}
+
+// Sleep while this thread is ahead of its share of the node rate, so a
+// background search leaves the CPU to the rest of the program
+static void Throttle(SearchThread *t, uint64_t nodesPerSecond) {
+  SearchShared *shared = t->shared;
+  uint64_t share = nodesPerSecond / (uint64_t)shared->threadCount;
+  if (share == 0)
+    share = 1;
+  int64_t due = shared->startTime + (int64_t)(t->nodes * 1000 / share);
+  int64_t ahead = due - GetTimeMilliseconds();
+  if (ahead > 0 && !ShouldStop(t))
+    SleepMilliseconds((int)ahead);
+}
+
+// Called every CHECK_INTERVAL nodes; the first thread enforces the limits
+static void CheckLimits(SearchThread *t) {
+  atomic_store_explicit(&t->publishedNodes, t->nodes, memory_order_relaxed);
+  atomic_store_explicit(&t->publishedTbHits, t->tbHits, memory_order_relaxed);
+
+  SearchShared *shared = t->shared;
+  const SearchLimits *limits = shared->limits;
+  if (limits->nodesPerSecond)
+    Throttle(t, limits->nodesPerSecond);
+  if (t->id != 0)
+    return;
+  bool stop = false;
+
+  if (shared->hardDeadline && GetTimeMilliseconds() >= shared->hardDeadline)
+    stop = true;
+  if (limits->nodes && TotalNodes(shared) >= limits->nodes)
+    stop = true;
+
+  if (stop)
+    StopSearch(shared->searcher);
+}
+
+static bool IsRepetition(const SearchThread *t) {
+  const ChessPosition *pos = &t->pos;
+  int oldest = t->keyCount - pos->halfmoveClock;
+  for (int i = t->keyCount - 2; i >= 0 && i >= oldest; i -= 2) {
+    if (t->keys[i] == pos->key)
+      return true;
+  }
+  return false;
+}
+
+static void PushMove(SearchThread *t, Move move, MoveUndo *undo) {
+  t->keys[t->keyCount++] = t->pos.key;
+  MakeMove(&t->pos, move, undo);
+}
+
+static void PopMove(SearchThread *t, Move move, const MoveUndo *undo) {
+  UnmakeMove(&t->pos, move, undo);
+  t->keyCount--;
+}
+
+static bool HasNonPawnMaterial(const ChessPosition *pos, PieceColor color) {
+  const int *count = pos->pieceCount[color];
+  return count[PIECE_QUEEN] + count[PIECE_ROOK] + count[PIECE_BISHOP] +
+             count[PIECE_KNIGHT] >
+         0;
+}
+
+//==============================================================================
+// MOVE ORDERING
+//==============================================================================
+
+static bool IsCaptureMove(const ChessPosition *pos, Move move) {
+  int to = MOVE_TO(move);
+  return pos->squares[to] != NO_PIECE ||
+         (CODE_TYPE(pos->squares[MOVE_FROM(move)]) == PIECE_PAWN &&
+          to == pos->enPassantSquare);
+}
+
+static void ScoreMoves(const SearchThread *t, const MoveList *list,
+                       int *scores, Move ttMove, int ply) {
+  const ChessPosition *pos = &t->pos;
+  for (int i = 0; i < list->count; i++) {
+    Move move = list->moves[i];
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+
+    if (move == ttMove) {
+      scores[i] = ORDER_TT_MOVE;
+    } else if (IsCaptureMove(pos, move) ||
+               MOVE_PROMOTION(move) == PIECE_QUEEN) {
+      // Most valuable victim, least valuable attacker
+      PieceType victim = pos->squares[to] != NO_PIECE
+                             ? CODE_TYPE(pos->squares[to])
+                             : PIECE_PAWN;
+      PieceType attacker = CODE_TYPE(pos->squares[from]);
+      scores[i] = ORDER_CAPTURE + ORDER_VALUES[victim] * 16 -
+                  ORDER_VALUES[attacker] / 16 +
+                  ORDER_VALUES[MOVE_PROMOTION(move)];
+    } else if (move == t->killers[ply][0]) {
+      scores[i] = ORDER_KILLER_1;
+    } else if (move == t->killers[ply][1]) {
+      scores[i] = ORDER_KILLER_2;
+    } else {
+      scores[i] = t->history[pos->sideToMove][from][to];
+    }
+  }
+}
+
+// Selection sort step: bring the best remaining move to index
+static Move PickMove(MoveList *list, int *scores, int index) {
+  int best = index;
+  for (int i = index + 1; i < list->count; i++) {
+    if (scores[i] > scores[best])
+      best = i;
+  }
+  Move move = list->moves[best];
+  int score = scores[best];
+  list->moves[best] = list->moves[index];
+  scores[best] = scores[index];
+  list->moves[index] = move;
+  scores[index] = score;
+  return move;
+}
+
+static void UpdateQuietStats(SearchThread *t, Move move, int depth, int ply) {
+  if (t->killers[ply][0] != move) {
+    t->killers[ply][1] = t->killers[ply][0];
+    t->killers[ply][0] = move;
+  }
+
+  int *entry = &t->history[t->pos.sideToMove][MOVE_FROM(move)][MOVE_TO(move)];
+  *entry += depth * depth;
+  if (*entry > HISTORY_MAX) {
+    // Halve everything so old statistics fade
+    for (int c = 0; c < 3; c++)
+      for (int f = 0; f < SQUARE_COUNT; f++)
+        for (int s = 0; s < SQUARE_COUNT; s++)
+          t->history[c][f][s] /= 2;
+  }
+}
+
+//==============================================================================
+// QUIESCENCE SEARCH
+//==============================================================================
+
+static int Quiescence(SearchThread *t, int alpha, int beta, int ply) {
+  ChessPosition *pos = &t->pos;
+
+  if (++t->nodes % CHECK_INTERVAL == 0)
+    CheckLimits(t);
+  if (ShouldStop(t))
+    return 0;
+
+  if (ply > t->selDepth)
+    t->selDepth = ply;
+
+  bool inCheck = IsKingInCheck(pos, pos->sideToMove);
+  if (ply >= MAX_PLY - 1)
+    return inCheck ? 0 : Evaluate(pos);
+
+  // Standing pat is not allowed in check: every evasion is searched
+  int bestScore = -SCORE_INFINITE;
+  if (!inCheck) {
+    bestScore = Evaluate(pos);
+    if (bestScore >= beta)
+      return bestScore;
+    if (bestScore > alpha)
+      alpha = bestScore;
+  }
+
+  MoveList list;
+  int scores[MOVE_LIST_CAPACITY];
+  if (inCheck)
+    GenerateMoves(pos, &list);
+  else
+    GenerateCaptures(pos, &list);
+  ScoreMoves(t, &list, scores, MOVE_NONE, ply);
+
+  int legalMoves = 0;
+  for (int i = 0; i < list.count; i++) {
+    Move move = PickMove(&list, scores, i);
+    PieceColor us = pos->sideToMove;
+    MoveUndo undo;
+
+    PushMove(t, move, &undo);
+    if (IsKingInCheck(pos, us)) {
+      PopMove(t, move, &undo);
+      continue;
+    }
+    legalMoves++;
+    int score = -Quiescence(t, -beta, -alpha, ply + 1);
+    PopMove(t, move, &undo);
+
+    if (ShouldStop(t))
+      return 0;
+
+    if (score > bestScore) {
+      bestScore = score;
+      if (score > alpha) {
+        alpha = score;
+        if (score >= beta)
+          break;
+      }
+    }
+  }
+
+  if (inCheck && legalMoves == 0)
+    return -SCORE_MATE + ply;
+
+  return bestScore;
+}
+
+//==============================================================================
+// MAIN SEARCH
+//==============================================================================
+
+static int Negamax(SearchThread *t, int alpha, int beta, int depth, int ply,
+                   bool allowNull) {
+  ChessPosition *pos = &t->pos;
+  bool rootNode = (ply == 0);
+  bool pvNode = (beta - alpha > 1);
+
+  t->pvLength[ply] = ply;
+
+  if (depth <= 0)
+    return Quiescence(t, alpha, beta, ply);
+
+  if (++t->nodes % CHECK_INTERVAL == 0)
+    CheckLimits(t);
+  if (ShouldStop(t))
+    return 0;
+
+  if (ply > t->selDepth)
+    t->selDepth = ply;
+
+  if (!rootNode) {
+    if (pos->halfmoveClock >= 100 || IsRepetition(t))
+      return 0;
+    if (ply >= MAX_PLY - 1)
+      return Evaluate(pos);
+
+    // Mate distance pruning: no line here can beat a shorter known mate
+    int mateAlpha = -SCORE_MATE + ply;
+    int mateBeta = SCORE_MATE - ply - 1;
+    if (alpha < mateAlpha)
+      alpha = mateAlpha;
+    if (beta > mateBeta)
+      beta = mateBeta;
+    if (alpha >= beta)
+      return alpha;
+  }
+
+  // Transposition table
+  TTData tt;
+  Move ttMove = MOVE_NONE;
+  bool ttHit = ProbeTranspositionTable(t->shared->searcher->table, pos->key,
+                                       &tt);
+  if (ttHit) {
+    ttMove = tt.move;
+    int ttScore = ScoreFromTable(tt.score, ply);
+    if (!pvNode && tt.depth >= depth &&
+        (tt.bound == TT_BOUND_EXACT ||
+         (tt.bound == TT_BOUND_LOWER && ttScore >= beta) ||
+         (tt.bound == TT_BOUND_UPPER && ttScore <= alpha)))
+      return ttScore;
+  }
+
+  // Endgame tablebases, probed right after captures and pawn moves where
+  // the stored result is exact with respect to the fifty-move rule
+  if (!rootNode && pos->halfmoveClock == 0 && CanProbeTablebases(pos)) {
+    TablebaseWdl wdl;
+    if (ProbeWdl(pos, &wdl)) {
+      t->tbHits++;
+      int score = wdl > TB_DRAW    ? SCORE_TB_WIN - ply
+                  : wdl < TB_DRAW  ? -SCORE_TB_WIN + ply
+                                   : 0;
+      if (wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS)
+        score = 0; // Drawn by the fifty-move rule
+      TTBound bound = score > 0   ? TT_BOUND_LOWER
+                      : score < 0 ? TT_BOUND_UPPER
+                                  : TT_BOUND_EXACT;
+      if (bound == TT_BOUND_EXACT ||
+          (bound == TT_BOUND_LOWER && score >= beta) ||
+          (bound == TT_BOUND_UPPER && score <= alpha)) {
+        StoreTranspositionTable(t->shared->searcher->table, pos->key,
+                                MOVE_NONE, ScoreToTable(score, ply), score,
+                                depth + 6, bound);
+        return score;
+      }
+    }
+  }
+
+  bool inCheck = IsKingInCheck(pos, pos->sideToMove);
+  int staticEval = inCheck ? -SCORE_INFINITE
+                   : ttHit ? tt.eval
+                           : Evaluate(pos);
+
+  if (!pvNode && !inCheck) {
+    // Reverse futility: far enough above beta that a shallow search
+    // is not going to change the verdict
+    if (depth <= FUTILITY_MAX_DEPTH &&
+        staticEval - FUTILITY_MARGIN * depth >= beta &&
+        staticEval < SCORE_TB_WIN_IN_MAX)
+      return staticEval;
+
+    // Null move: if passing still beats beta, a real move will too
+    if (allowNull && depth >= NULL_MOVE_MIN_DEPTH && staticEval >= beta &&
+        HasNonPawnMaterial(pos, pos->sideToMove)) {
+      int reduction = 3 + depth / 4;
+      MoveUndo undo;
+      t->keys[t->keyCount++] = pos->key;
+      MakeNullMove(pos, &undo);
+      int score = -Negamax(t, -beta, -beta + 1, depth - reduction, ply + 1,
+                           false);
+      UnmakeNullMove(pos, &undo);
+      t->keyCount--;
+
+      if (ShouldStop(t))
+        return 0;
+      if (score >= beta)
+        return score >= SCORE_TB_WIN_IN_MAX ? beta : score;
+    }
+  }
+
+  if (inCheck)
+    depth++; // Check extension
+
+  MoveList list;
+  int scores[MOVE_LIST_CAPACITY];
+  if (rootNode) {
+    list.count = t->rootMoves.count - t->pvIndex;
+    memcpy(list.moves, t->rootMoves.moves + t->pvIndex,
+           sizeof(Move) * (size_t)list.count);
+  } else
+    GenerateMoves(pos, &list);
+  ScoreMoves(t, &list, scores, ttMove, ply);
+
+  int originalAlpha = alpha;
+  int bestScore = -SCORE_INFINITE;
+  Move bestMove = MOVE_NONE;
+  int legalMoves = 0;
+
+  for (int i = 0; i < list.count; i++) {
+    Move move = PickMove(&list, scores, i);
+    PieceColor us = pos->sideToMove;
+    bool quiet = !IsCaptureMove(pos, move) && MOVE_PROMOTION(move) == 0;
+    MoveUndo undo;
+
+    PushMove(t, move, &undo);
+    if (IsKingInCheck(pos, us)) {
+      PopMove(t, move, &undo);
+      continue;
+    }
+    legalMoves++;
+
+    bool givesCheck = IsKingInCheck(pos, pos->sideToMove);
+    int score;
+
+    if (legalMoves == 1) {
+      score = -Negamax(t, -beta, -alpha, depth - 1, ply + 1, true);
+    } else {
+      // Late move reductions for quiet moves ordered near the end
+      int reduction = 0;
+      if (depth >= LMR_MIN_DEPTH && legalMoves > LMR_MIN_MOVES && quiet &&
+          !inCheck && !givesCheck) {
+        reduction = 1 + (depth >= 6) + (legalMoves >= 12);
+        if (pvNode)
+          reduction--;
+      }
+
+      // Principal variation search: prove the move is worse with a null
+      // window, re-searching only when it is not
+      score = -Negamax(t, -alpha - 1, -alpha, depth - 1 - reduction, ply + 1,
+                       true);
+      if (score > alpha && reduction > 0)
+        score = -Negamax(t, -alpha - 1, -alpha, depth - 1, ply + 1, true);
+      if (score > alpha && score < beta)
+        score = -Negamax(t, -beta, -alpha, depth - 1, ply + 1, true);
+    }
+
+    PopMove(t, move, &undo);
+
+    if (ShouldStop(t))
+      return 0;
+
+    if (score > bestScore) {
+      bestScore = score;
+      bestMove = move;
+
+      if (score > alpha) {
+        alpha = score;
+
+        // Extend the principal variation with the child's line
+        t->pv[ply][ply] = move;
+        for (int j = ply + 1; j < t->pvLength[ply + 1]; j++)
+          t->pv[ply][j] = t->pv[ply + 1][j];
+        t->pvLength[ply] = t->pvLength[ply + 1];
+
+        if (score >= beta) {
+          if (quiet)
+            UpdateQuietStats(t, move, depth, ply);
+          break;
+        }
+      }
+    }
+  }
+
+  if (legalMoves == 0)
+    return inCheck ? -SCORE_MATE + ply : 0;
+
+  // Later multi-PV lines exclude the best root moves, so their root score
+  // is not the position's value
+  if (!(rootNode && t->pvIndex > 0)) {
+    TTBound bound = bestScore >= beta           ? TT_BOUND_LOWER
+                    : bestScore > originalAlpha ? TT_BOUND_EXACT
+                                                : TT_BOUND_UPPER;
+    StoreTranspositionTable(t->shared->searcher->table, pos->key, bestMove,
+                            ScoreToTable(bestScore, ply),
+                            inCheck ? 0 : staticEval, depth, bound);
+  }
+
+  return bestScore;
+}
+
+//==============================================================================
+// ITERATIVE DEEPENING
+//==============================================================================
+
+// Move a root move to the given index, shifting the ones in between back.
+// The next iteration searches the root moves in this order.
+static void PlaceRootMove(MoveList *rootMoves, int index, Move move) {
+  for (int i = index; i < rootMoves->count; i++) {
+    if (rootMoves->moves[i] == move) {
+      for (int j = i; j > index; j--)
+        rootMoves->moves[j] = rootMoves->moves[j - 1];
+      rootMoves->moves[index] = move;
+      return;
+    }
+  }
+}
+
+// Record the line just searched and keep the lines sorted best first. A
+// later line can outscore an earlier one when the search is unstable.
+static void StoreLine(SearchThread *t, int score) {
+  int index = t->pvIndex;
+  SearchLine *line = &t->lines[index];
+
+  line->score = score;
+  if (t->pvLength[0] > 0) {
+    line->pvLength = t->pvLength[0];
+    memcpy(line->pv, t->pv[0], sizeof(Move) * (size_t)t->pvLength[0]);
+  } else {
+    line->pvLength = 1;
+    line->pv[0] = t->rootMoves.moves[index];
+  }
+  PlaceRootMove(&t->rootMoves, index, line->pv[0]);
+
+  for (int i = index; i > 0 && t->lines[i].score > t->lines[i - 1].score;
+       i--) {
+    SearchLine swap = t->lines[i];
+    t->lines[i] = t->lines[i - 1];
+    t->lines[i - 1] = swap;
+
+    Move move = t->rootMoves.moves[i];
+    t->rootMoves.moves[i] = t->rootMoves.moves[i - 1];
+    t->rootMoves.moves[i - 1] = move;
+  }
+}
+
+static void FillReport(SearchThread *t, int depth, SearchReport *report) {
+  SearchShared *shared = t->shared;
+  atomic_store_explicit(&t->publishedNodes, t->nodes, memory_order_relaxed);
+  atomic_store_explicit(&t->publishedTbHits, t->tbHits, memory_order_relaxed);
+
+  report->depth = depth;
+  report->selDepth = t->selDepth;
+  report->nodes = TotalNodes(shared);
+  report->tbHits = TotalTbHits(shared);
+  report->timeMs = GetTimeMilliseconds() - shared->startTime;
+  report->hashfull = TranspositionTableUsage(shared->searcher->table);
+  report->lineCount = t->multiPv;
+  memcpy(report->lines, t->lines, sizeof(SearchLine) * (size_t)t->multiPv);
+}
+
+// Search one root line with an aspiration window around its previous score
+static int SearchLineAtDepth(SearchThread *t, int depth) {
+  int previous = t->lines[t->pvIndex].score;
+  int delta = ASPIRATION_WINDOW;
+  int alpha = -SCORE_INFINITE;
+  int beta = SCORE_INFINITE;
+  if (depth >= ASPIRATION_MIN_DEPTH) {
+    alpha = previous - delta > -SCORE_INFINITE ? previous - delta
+                                               : -SCORE_INFINITE;
+    beta = previous + delta < SCORE_INFINITE ? previous + delta
+                                             : SCORE_INFINITE;
+  }
+
+  for (;;) {
+    int score = Negamax(t, alpha, beta, depth, 0, false);
+    if (ShouldStop(t))
+      return score;
+
+    // Widen the failing side and search again
+    if (score <= alpha) {
+      beta = (alpha + beta) / 2;
+      alpha = score - delta > -SCORE_INFINITE ? score - delta
+                                              : -SCORE_INFINITE;
+    } else if (score >= beta) {
+      beta = score + delta < SCORE_INFINITE ? score + delta : SCORE_INFINITE;
+    } else {
+      return score;
+    }
+    delta += delta;
+  }
+}
+
+static void IterativeDeepening(SearchThread *t) {
+  SearchShared *shared = t->shared;
+  const SearchLimits *limits = shared->limits;
+  int maxDepth = (limits->depth > 0 && limits->depth < MAX_PLY)
+                     ? limits->depth
+                     : MAX_PLY - 1;
+
+  // Helper threads start one ply deeper half of the time so that the
+  // threads spread over different depths
+  for (int depth = 1 + (t->id & 1); depth <= maxDepth; depth++) {
+    t->selDepth = 0;
+
+    // Each further line searches the root without the moves of the lines
+    // before it; the shared table keeps the repeated subtrees cheap
+    for (t->pvIndex = 0; t->pvIndex < t->multiPv; t->pvIndex++) {
+      int score = SearchLineAtDepth(t, depth);
+      if (ShouldStop(t))
+        break;
+      StoreLine(t, score);
+    }
+
+    if (ShouldStop(t))
+      break;
+
+    // Completed iteration
+    FillReport(t, depth, &t->best);
+
+    if (t->id != 0)
+      continue;
+
+    Searcher *searcher = shared->searcher;
+    if (searcher->onReport != NULL)
+      searcher->onReport(&t->best, searcher->userData);
+
+    // A mate found well within the search horizon will not get shorter
+    int score = t->lines[0].score;
+    if (t->multiPv == 1 && IsMateScore(score) &&
+        depth >= 2 * (SCORE_MATE - abs(score)) + 4)
+      break;
+
+    // A forced move needs no deeper search when playing on a clock
+    bool timed = shared->softDeadline != 0;
+    if (timed && t->rootMoves.count == 1)
+      break;
+    if (timed && GetTimeMilliseconds() >= shared->softDeadline)
+      break;
+  }
+}
+
+static void *SearchThreadMain(void *arg) {
+  IterativeDeepening((SearchThread *)arg);
+  return NULL;
+}
+
+//==============================================================================
+// ROOT SETUP
+//==============================================================================
+
+// With tablebases at the root, only keep the moves that preserve the best
+// tablebase outcome so the search cannot spoil a won ending
+static uint64_t FilterRootMovesWithTablebases(ChessPosition *root,
+                                              MoveList *rootMoves) {
+  int ranks[MOVE_LIST_CAPACITY];
+  if (!CanProbeTablebases(root) ||
+      !RankTablebaseRootMoves(root, rootMoves, ranks))
+    return 0;
+
+  int bestRank = ranks[0];
+  for (int i = 1; i < rootMoves->count; i++) {
+    if (ranks[i] > bestRank)
+      bestRank = ranks[i];
+  }
+
+  int kept = 0;
+  for (int i = 0; i < rootMoves->count; i++) {
+    if (ranks[i] == bestRank)
+      rootMoves->moves[kept++] = rootMoves->moves[i];
+  }
+  uint64_t probed = (uint64_t)rootMoves->count;
+  rootMoves->count = kept;
+  return probed;
+}
+
+static bool RunSearch(Searcher *searcher, const ChessPosition *root,
+                      const uint64_t *history, int historyCount,
+                      const SearchLimits *limits, SearchReport *result) {
+  memset(result, 0, sizeof(*result));
+
+  SearchShared shared = {0};
+  shared.searcher = searcher;
+  shared.limits = limits;
+  shared.startTime = GetTimeMilliseconds();
+  PlanTime(&shared, root->sideToMove);
+
+  ChessPosition rootCopy = *root;
+  MoveList rootMoves;
+  GenerateLegalMoves(&rootCopy, &rootMoves);
+  if (rootMoves.count == 0)
+    return false;
+
+  uint64_t rootTbHits = FilterRootMovesWithTablebases(&rootCopy, &rootMoves);
+
+  int multiPv = limits->multiPv < 1 ? 1 : limits->multiPv;
+  if (multiPv > SEARCH_MAX_MULTIPV)
+    multiPv = SEARCH_MAX_MULTIPV;
+  if (multiPv > rootMoves.count)
+    multiPv = rootMoves.count;
+
+  int threadCount = searcher->threadCount;
+  SearchThread *threads = calloc((size_t)threadCount, sizeof(SearchThread));
+  if (threads == NULL) {
+    threadCount = 1;
+    threads = calloc(1, sizeof(SearchThread));
+    if (threads == NULL)
+      return false;
+  }
+  shared.threads = threads;
+  shared.threadCount = threadCount;
+
+  if (historyCount > SEARCH_HISTORY_KEYS) {
+    history += historyCount - SEARCH_HISTORY_KEYS;
+    historyCount = SEARCH_HISTORY_KEYS;
+  }
+
+  AgeTranspositionTable(searcher->table);
+
+  for (int i = 0; i < threadCount; i++) {
+    SearchThread *t = &threads[i];
+    t->shared = &shared;
+    t->id = i;
+    t->pos = *root;
+    if (history != NULL && historyCount > 0)
+      memcpy(t->keys, history, sizeof(uint64_t) * (size_t)historyCount);
+    t->keyCount = history != NULL ? historyCount : 0;
+    t->rootMoves = rootMoves;
+    t->multiPv = multiPv;
+    t->tbHits = (i == 0) ? rootTbHits : 0;
+    atomic_init(&t->publishedNodes, 0);
+    atomic_init(&t->publishedTbHits, t->tbHits);
+  }
+
+  // Helpers run on their own threads, the first thread on the caller's
+  int started = 1;
+  for (; started < threadCount; started++) {
+    if (pthread_create(&threads[started].handle, NULL, SearchThreadMain,
+                       &threads[started]) != 0)
+      break;
+  }
+  shared.threadCount = started;
+
+  IterativeDeepening(&threads[0]);
+
+  // "go infinite" only ends on an explicit stop, even at maximum depth
+  while (limits->infinite && !atomic_load(&searcher->stop))
+    SleepMilliseconds(1);
+
+  StopSearch(searcher);
+  for (int i = 1; i < started; i++)
+    pthread_join(threads[i].handle, NULL);
+
+  if (threads[0].best.lineCount > 0) {
+    *result = threads[0].best;
+  } else {
+    // Stopped before the first iteration finished
+    result->lineCount = 1;
+    result->lines[0].pv[0] = rootMoves.moves[0];
+    result->lines[0].pvLength = 1;
+  }
+  result->nodes = TotalNodes(&shared);
+  result->tbHits = TotalTbHits(&shared);
+  result->timeMs = GetTimeMilliseconds() - shared.startTime;
+
+  free(threads);
+  return true;
+}
+
+//==============================================================================
+// SEARCHER INTERFACE
+//==============================================================================
+
+void InitSearcher(Searcher *searcher, TranspositionTable *table,
+                  int threadCount) {
+  memset(searcher, 0, sizeof(*searcher));
+  searcher->table = table;
+  searcher->threadCount = threadCount < 1                    ? 1
+                          : threadCount > SEARCH_MAX_THREADS ? SEARCH_MAX_THREADS
+                                                             : threadCount;
+  atomic_init(&searcher->stop, false);
+  atomic_init(&searcher->running, false);
+}
+
+bool SearchPosition(Searcher *searcher, const ChessPosition *root,
+                    const uint64_t *history, int historyCount,
+                    const SearchLimits *limits, SearchReport *result) {
+  atomic_store(&searcher->stop, false);
+  atomic_store(&searcher->running, true);
+  bool found = RunSearch(searcher, root, history, historyCount, limits, result);
+  atomic_store(&searcher->running, false);
+  return found;
+}
+
+static void *BackgroundSearchMain(void *arg) {
+  Searcher *searcher = (Searcher *)arg;
+  RunSearch(searcher, &searcher->root, searcher->history,
+            searcher->historyCount, &searcher->limits, &searcher->result);
+  if (searcher->onFinish != NULL)
+    searcher->onFinish(&searcher->result, searcher->userData);
+  atomic_store(&searcher->running, false);
+  return NULL;
+}
+
+bool StartSearch(Searcher *searcher, const ChessPosition *root,
+                 const uint64_t *history, int historyCount,
+                 const SearchLimits *limits) {
+  WaitForSearch(searcher, NULL);
+
+  if (historyCount > SEARCH_HISTORY_KEYS) {
+    history += historyCount - SEARCH_HISTORY_KEYS;
+    historyCount = SEARCH_HISTORY_KEYS;
+  }
+
+  searcher->root = *root;
+  searcher->historyCount = history != NULL ? historyCount : 0;
+  if (searcher->historyCount > 0)
+    memcpy(searcher->history, history,
+           sizeof(uint64_t) * (size_t)searcher->historyCount);
+  searcher->limits = *limits;
+
+  // Cleared before the thread exists so an early StopSearch is not lost
+  atomic_store(&searcher->stop, false);
+  atomic_store(&searcher->running, true);
+  if (pthread_create(&searcher->thread, NULL, BackgroundSearchMain,
+                     searcher) != 0) {
+    atomic_store(&searcher->running, false);
+    return false;
+  }
+  searcher->threadActive = true;
+  return true;
+}
+
+void StopSearch(Searcher *searcher) { atomic_store(&searcher->stop, true); }
+
+void WaitForSearch(Searcher *searcher, SearchReport *result) {
+  if (searcher->threadActive) {
+    pthread_join(searcher->thread, NULL);
+    searcher->threadActive = false;
+  }
+  if (result != NULL)
+    *result = searcher->result;
+}
+
+bool IsSearchRunning(Searcher *searcher) {
+  return atomic_load(&searcher->running);
+}
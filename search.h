@@ -0,0 +1,150 @@
+/**
+ * Chess Game - Search
+ * Multi-threaded iterative-deepening alpha-beta search.
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "movegen.h"
+#include "tt.h"
+#include <pthread.h>
+#include <stdatomic.h>
+
+//==============================================================================
+// SEARCH CONSTANTS
+//==============================================================================
+
+#define MAX_PLY 128
+#define SEARCH_MAX_THREADS 64
+#define SEARCH_MAX_MULTIPV 8
+#define SEARCH_HISTORY_KEYS 128 // Game positions kept for repetition checks
+
+// Scores are in centipawns; mates and tablebase wins are counted down by
+// their distance from the root
+#define SCORE_INFINITE 32000
+#define SCORE_MATE 31000
+#define SCORE_MATE_IN_MAX (SCORE_MATE - MAX_PLY)
+#define SCORE_TB_WIN 30000
+#define SCORE_TB_WIN_IN_MAX (SCORE_TB_WIN - MAX_PLY)
+
+//==============================================================================
+// SEARCH TYPES
+//==============================================================================
+
+// Limits of one search; zero means "no limit" for every field
+typedef struct {
+  int depth;
+  uint64_t nodes;
+  int64_t moveTime;     // Milliseconds to spend on this move
+  int64_t time[3];      // Remaining clock time in ms, indexed by PieceColor
+  int64_t increment[3]; // Increment per move in ms, indexed by PieceColor
+  int movesToGo;        // Moves until the next time control
+  bool infinite;        // Search until stopped, even after depth is reached
+  int multiPv;          // Best lines to report; 0 or 1 for the best move only
+  uint64_t nodesPerSecond; // Throttle: threads sleep to stay under this rate
+} SearchLimits;
+
+// One principal variation, starting with a distinct root move
+typedef struct {
+  int score; // Side to move's point of view
+  int pvLength;
+  Move pv[MAX_PLY];
+} SearchLine;
+
+// Progress after a completed iteration, and the final result
+typedef struct {
+  int depth;
+  int selDepth;
+  uint64_t nodes;
+  uint64_t tbHits;
+  int64_t timeMs;
+  int hashfull;  // Transposition table usage in permille
+  int lineCount; // At least 1 once a search has returned
+  SearchLine lines[SEARCH_MAX_MULTIPV]; // Best line first
+} SearchReport;
+
+typedef void (*SearchReportCallback)(const SearchReport *report,
+                                     void *userData);
+
+// One search instance: its table, threads, callbacks and stop flag. Several
+// searchers can run at once (each with its own table or sharing one).
+typedef struct {
+  TranspositionTable *table;
+  int threadCount;
+  SearchReportCallback onReport; // After each iteration (may be NULL)
+  SearchReportCallback onFinish; // With the final result (may be NULL)
+  void *userData;
+
+  atomic_bool stop;
+  atomic_bool running;
+
+  // Background search state (StartSearch/WaitForSearch)
+  pthread_t thread;
+  bool threadActive;
+  ChessPosition root;
+  uint64_t history[SEARCH_HISTORY_KEYS];
+  int historyCount;
+  SearchLimits limits;
+  SearchReport result;
+} Searcher;
+
+//==============================================================================
+// SEARCH FUNCTIONS
+//==============================================================================
+
+/**
+ * Set up a searcher using the given table and number of threads.
+ */
+void InitSearcher(Searcher *searcher, TranspositionTable *table,
+                  int threadCount);
+
+/**
+ * Search a position in the calling thread until a limit is hit or
+ * StopSearch is called.
+ * @param history Keys of the game positions before the root, oldest first,
+ * used to detect repetitions (may be NULL)
+ * @return false if the root has no legal moves
+ */
+bool SearchPosition(Searcher *searcher, const ChessPosition *root,
+                    const uint64_t *history, int historyCount,
+                    const SearchLimits *limits, SearchReport *result);
+
+/**
+ * Start a search on a background thread and return immediately. The
+ * onFinish callback runs on that thread when the search ends.
+ * @return false if the thread could not be started
+ */
+bool StartSearch(Searcher *searcher, const ChessPosition *root,
+                 const uint64_t *history, int historyCount,
+                 const SearchLimits *limits);
+
+/**
+ * Ask a running search to stop as soon as possible. Thread-safe.
+ */
+void StopSearch(Searcher *searcher);
+
+/**
+ * Wait for a background search to end and collect its result.
+ * @param result Final report (may be NULL)
+ */
+void WaitForSearch(Searcher *searcher, SearchReport *result);
+
+/**
+ * Check if a search is in progress.
+ */
+bool IsSearchRunning(Searcher *searcher);
+
+/**
+ * Milliseconds from an arbitrary fixed point (monotonic clock).
+ */
+int64_t GetTimeMilliseconds(void);
+
+/**
+ * Check if a score announces a forced mate, and in how many moves
+ * (positive when the side to move mates).
+ */
+bool IsMateScore(int score);
+int MateInMoves(int score);
+
+#endif // SEARCH_H
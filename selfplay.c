@@ -0,0 +1,544 @@
+/**
+ * Chess Game - Self-Play
+ * Engine-vs-engine matches on worker threads, with a sequential probability
+ * ratio test to stop as soon as the result is clear.
+ *
+ * Each worker plays one game at a time with its own pair of searchers and
+ * transposition tables, so workers share nothing but the game counter and
+ * the score. Every game keeps time on its own ChessClock: the searcher gets
+ * the clock's remaining time, and the clock is then advanced by what the
+ * search really took, with the same increment and delay rules as the GUI.
+ */
+
+#include "selfplay.h"
+#include "pgn.h"
+#include "tbprobe.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//==============================================================================
+// MATCH STATE
+//==============================================================================
+
+typedef enum {
+  RESULT_DRAW = 0,
+  RESULT_WHITE_WINS,
+  RESULT_BLACK_WINS
+} GameResult;
+
+typedef struct {
+  GameResult result;
+  const char *reason;
+  int plies;
+  Move moves[SELFPLAY_MAX_PLIES];
+  float clocks[SELFPLAY_MAX_PLIES]; // Mover's time after each move
+} GameOutcome;
+
+// Shared by all workers; the score and counters are guarded by the mutex
+typedef struct {
+  const SelfplayOptions *options;
+  ChessPosition *openings;
+  int openingCount;
+
+  pthread_mutex_t mutex;
+  int nextGame;
+  bool stopped; // Game count reached or SPRT decided
+  SelfplayResult result;
+  int64_t startTime;
+  PgnWriter *pgn; // Set when options->pgn is
+} SelfplayMatch;
+
+typedef struct {
+  SelfplayMatch *match;
+  TranspositionTable tables[2]; // One per engine, as in a real match
+  Searcher searchers[2];
+  pthread_t thread;
+} SelfplayWorker;
+
+//==============================================================================
+// OPTIONS
+//==============================================================================
+
+void InitSelfplayOptions(SelfplayOptions *options) {
+  memset(options, 0, sizeof(*options));
+  for (int i = 0; i < 2; i++) {
+    snprintf(options->engines[i].name, SELFPLAY_NAME_LEN, "%s",
+             i == 0 ? "Engine A" : "Engine B");
+    options->engines[i].hashMb = TT_DEFAULT_MB;
+  }
+  options->clockType = CLOCK_FISCHER;
+  options->baseSeconds = 10.0f;
+  options->incrementSeconds = 0.1f;
+  options->games = 1000;
+  options->workers = 1;
+  options->resignScore = 1000;
+  options->resignMoves = 4;
+  options->sprt = true;
+  options->elo0 = 0.0;
+  options->elo1 = 5.0;
+  options->alpha = 0.05;
+  options->beta = 0.05;
+  options->output = stdout;
+}
+
+//==============================================================================
+// OPENINGS
+//==============================================================================
+
+// Every FEN/EPD line that parses; comments and bad lines are skipped
+static bool LoadOpenings(SelfplayMatch *match, const char *path) {
+  if (path == NULL) {
+    match->openings = malloc(sizeof(ChessPosition));
+    if (match->openings == NULL)
+      return false;
+    SetPositionFromFen(&match->openings[0], STARTING_FEN);
+    match->openingCount = 1;
+    return true;
+  }
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    return false;
+
+  int capacity = 0;
+  char line[1024];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    ChessPosition pos;
+    if (line[0] == '#' || !SetPositionFromFen(&pos, line))
+      continue;
+
+    if (match->openingCount == capacity) {
+      capacity = capacity > 0 ? capacity * 2 : 64;
+      ChessPosition *grown =
+          realloc(match->openings, (size_t)capacity * sizeof(ChessPosition));
+      if (grown == NULL)
+        break;
+      match->openings = grown;
+    }
+    match->openings[match->openingCount++] = pos;
+  }
+  fclose(file);
+  return match->openingCount > 0;
+}
+
+//==============================================================================
+// DRAW RULES
+//==============================================================================
+
+// Neither side can mate: no pawns or major pieces, at most one minor each
+static bool IsInsufficientMaterial(const ChessPosition *pos) {
+  for (PieceColor color = COLOR_WHITE; color <= COLOR_BLACK; color++) {
+    const int *count = pos->pieceCount[color];
+    if (count[PIECE_PAWN] > 0 || count[PIECE_ROOK] > 0 ||
+        count[PIECE_QUEEN] > 0)
+      return false;
+    if (count[PIECE_BISHOP] + count[PIECE_KNIGHT] > 1)
+      return false;
+  }
+  return true;
+}
+
+// Occurrences of the current position since the last irreversible move;
+// keys[] holds every position of the game before the current one
+static int CountRepetitions(const ChessPosition *pos, const uint64_t *keys,
+                            int keyCount) {
+  int count = 1;
+  int oldest = keyCount - pos->halfmoveClock;
+  if (oldest < 0)
+    oldest = 0;
+  for (int i = keyCount - 2; i >= oldest; i -= 2) {
+    if (keys[i] == pos->key)
+      count++;
+  }
+  return count;
+}
+
+// Result from the rules alone, before the side to move plays; false while
+// the game goes on
+static bool AdjudicateByRules(ChessPosition *pos, const uint64_t *keys,
+                              int keyCount, GameOutcome *outcome) {
+  MoveList legal;
+  GenerateLegalMoves(pos, &legal);
+  GameResult moverWins = pos->sideToMove == COLOR_WHITE ? RESULT_WHITE_WINS
+                                                        : RESULT_BLACK_WINS;
+  GameResult moverLoses = pos->sideToMove == COLOR_WHITE ? RESULT_BLACK_WINS
+                                                         : RESULT_WHITE_WINS;
+
+  if (legal.count == 0) {
+    bool mated = IsKingInCheck(pos, pos->sideToMove);
+    outcome->result = mated ? moverLoses : RESULT_DRAW;
+    outcome->reason = mated ? "checkmate" : "stalemate";
+    return true;
+  }
+
+  outcome->result = RESULT_DRAW;
+  if (pos->halfmoveClock >= 100) {
+    outcome->reason = "fifty-move rule";
+    return true;
+  }
+  if (CountRepetitions(pos, keys, keyCount) >= 3) {
+    outcome->reason = "threefold repetition";
+    return true;
+  }
+  if (IsInsufficientMaterial(pos)) {
+    outcome->reason = "insufficient material";
+    return true;
+  }
+  if (keyCount >= SELFPLAY_MAX_PLIES) {
+    outcome->reason = "move limit";
+    return true;
+  }
+
+  // Perfect play is known; cursed wins and blessed losses are draws
+  TablebaseWdl wdl;
+  if (CanProbeTablebases(pos) && ProbeWdl(pos, &wdl)) {
+    outcome->reason = "tablebase";
+    if (wdl == TB_WIN)
+      outcome->result = moverWins;
+    else if (wdl == TB_LOSS)
+      outcome->result = moverLoses;
+    return true;
+  }
+  return false;
+}
+
+//==============================================================================
+// GAMES
+//==============================================================================
+
+static GameOutcome PlayGame(SelfplayWorker *worker,
+                            const ChessPosition *opening,
+                            PieceColor firstEngineColor) {
+  const SelfplayOptions *options = worker->match->options;
+  ChessPosition pos = *opening;
+  uint64_t keys[SELFPLAY_MAX_PLIES + 1];
+  int keyCount = 0;
+  int aheadStreak[3] = {0}; // Consecutive plies each color was winning
+  GameOutcome outcome = {.result = RESULT_DRAW, .reason = ""};
+
+  ChessClock clock;
+  SetupClock(&clock, options->clockType, options->baseSeconds,
+             options->incrementSeconds);
+  RunClock(&clock);
+  for (int i = 0; i < 2; i++)
+    ClearTranspositionTable(&worker->tables[i]);
+
+  while (!AdjudicateByRules(&pos, keys, keyCount, &outcome)) {
+    PieceColor us = pos.sideToMove;
+    PieceColor them = OPPONENT_COLOR(us);
+    int engine = us == firstEngineColor ? 0 : 1;
+    const SelfplayEngine *config = &options->engines[engine];
+
+    SearchLimits limits = {0};
+    limits.depth = config->depth;
+    limits.nodes = config->nodes;
+    if (clock.type != CLOCK_NONE) {
+      for (PieceColor c = COLOR_WHITE; c <= COLOR_BLACK; c++) {
+        limits.time[c] = (int64_t)(GetClockTime(&clock, c) * 1000.0f);
+        if (clock.type != CLOCK_SUDDEN_DEATH)
+          limits.increment[c] = (int64_t)(clock.incrementSeconds * 1000.0f);
+      }
+    }
+
+    // Only positions since the last capture or pawn move can repeat
+    int historyCount = pos.halfmoveClock < keyCount ? pos.halfmoveClock
+                                                    : keyCount;
+    if (historyCount > SEARCH_HISTORY_KEYS)
+      historyCount = SEARCH_HISTORY_KEYS;
+
+    SearchReport report;
+    int64_t start = GetTimeMilliseconds();
+    SearchPosition(&worker->searchers[engine], &pos,
+                   keys + keyCount - historyCount, historyCount, &limits,
+                   &report);
+    int64_t elapsed = GetTimeMilliseconds() - start;
+
+    AdvanceClock(&clock, us, (float)elapsed / 1000.0f);
+    if (GetFlaggedPlayer(&clock) == us) {
+      outcome.result =
+          us == COLOR_WHITE ? RESULT_BLACK_WINS : RESULT_WHITE_WINS;
+      outcome.reason = "time forfeit";
+      break;
+    }
+    PressClock(&clock, us);
+
+    // Resign once one side has been ahead by the margin for long enough
+    // in both engines' eyes
+    int score = us == COLOR_WHITE ? report.lines[0].score
+                                  : -report.lines[0].score;
+    if (options->resignMoves > 0) {
+      aheadStreak[COLOR_WHITE] =
+          score >= options->resignScore ? aheadStreak[COLOR_WHITE] + 1 : 0;
+      aheadStreak[COLOR_BLACK] =
+          score <= -options->resignScore ? aheadStreak[COLOR_BLACK] + 1 : 0;
+      if (aheadStreak[us] >= 2 * options->resignMoves ||
+          aheadStreak[them] >= 2 * options->resignMoves) {
+        bool whiteAhead = aheadStreak[COLOR_WHITE] > 0;
+        outcome.result = whiteAhead ? RESULT_WHITE_WINS : RESULT_BLACK_WINS;
+        outcome.reason = "resignation";
+        break;
+      }
+    }
+
+    MoveUndo undo;
+    outcome.moves[keyCount] = report.lines[0].pv[0];
+    outcome.clocks[keyCount] =
+        clock.type != CLOCK_NONE ? GetClockTime(&clock, us) : PGN_NO_CLOCK;
+    keys[keyCount++] = pos.key;
+    MakeMove(&pos, report.lines[0].pv[0], &undo);
+  }
+
+  outcome.plies = keyCount;
+  return outcome;
+}
+
+//==============================================================================
+// STATISTICS
+//==============================================================================
+
+static double EloToScore(double elo) {
+  return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+static double ScoreToElo(double score) {
+  if (score <= 0.0)
+    return -INFINITY;
+  if (score >= 1.0)
+    return INFINITY;
+  return -400.0 * log10(1.0 / score - 1.0);
+}
+
+// Elo estimate and the GSPRT log-likelihood ratio from the game counts,
+// using the usual normal approximation of the trinomial score
+static void UpdateStatistics(SelfplayResult *result,
+                             const SelfplayOptions *options) {
+  int games = result->wins + result->draws + result->losses;
+  if (games == 0)
+    return;
+
+  // An outcome that has not happened yet counts as half a game, so a run of
+  // identical results still has a spread to test against
+  double counts[3] = {result->wins, result->draws, result->losses};
+  double n = 0.0;
+  for (int i = 0; i < 3; i++) {
+    if (counts[i] == 0.0)
+      counts[i] = 0.5;
+    n += counts[i];
+  }
+  double win = counts[0] / n;
+  double draw = counts[1] / n;
+  double score = win + draw / 2.0;
+  double variance = win + draw / 4.0 - score * score;
+
+  result->elo = ScoreToElo((result->wins + result->draws / 2.0) / games);
+
+  double margin = 1.96 * sqrt(variance / n);
+  double low = ScoreToElo(score - margin);
+  double high = ScoreToElo(score + margin);
+  result->eloError = (high - low) / 2.0;
+
+  double score0 = EloToScore(options->elo0);
+  double score1 = EloToScore(options->elo1);
+  result->llr =
+      (score1 - score0) * (2.0 * score - score0 - score1) / (2.0 * variance) *
+      n;
+}
+
+static const char *RESULT_TEXT[] = {"1/2-1/2", "1-0", "0-1"};
+
+// Replay the game from its opening to write it; called under the mutex
+static void WriteGamePgn(SelfplayMatch *match, int game, PieceColor firstColor,
+                         const ChessPosition *opening,
+                         const GameOutcome *outcome) {
+  const SelfplayOptions *options = match->options;
+  PgnWriter *pgn = match->pgn;
+  char text[FEN_MAX_LENGTH];
+
+  time_t now = time(NULL);
+  strftime(text, sizeof(text), "%Y.%m.%d", localtime(&now));
+  WritePgnTag(pgn, "Event", "Self-play");
+  WritePgnTag(pgn, "Site", "?");
+  WritePgnTag(pgn, "Date", text);
+  snprintf(text, sizeof(text), "%d", game + 1);
+  WritePgnTag(pgn, "Round", text);
+  WritePgnTag(pgn, "White",
+              options->engines[firstColor == COLOR_WHITE ? 0 : 1].name);
+  WritePgnTag(pgn, "Black",
+              options->engines[firstColor == COLOR_WHITE ? 1 : 0].name);
+  WritePgnTag(pgn, "Result", RESULT_TEXT[outcome->result]);
+  if (options->clockType == CLOCK_NONE)
+    snprintf(text, sizeof(text), "-");
+  else
+    snprintf(text, sizeof(text), "%g+%g", options->baseSeconds,
+             options->incrementSeconds);
+  WritePgnTag(pgn, "TimeControl", text);
+  WritePgnTag(pgn, "Termination", outcome->reason);
+
+  ChessPosition pos = *opening;
+  GetPositionFen(&pos, text, sizeof(text));
+  if (strcmp(text, STARTING_FEN) != 0) {
+    WritePgnTag(pgn, "SetUp", "1");
+    WritePgnTag(pgn, "FEN", text);
+  }
+
+  BeginPgnMovetext(pgn, pos.fullmoveNumber, pos.sideToMove);
+  for (int i = 0; i < outcome->plies; i++) {
+    char san[MOVE_NOTATION_LEN];
+    MoveUndo undo;
+    FormatSanMove(&pos, outcome->moves[i], san);
+    WritePgnMove(pgn, san, outcome->clocks[i]);
+    MakeMove(&pos, outcome->moves[i], &undo);
+  }
+  EndPgnGame(pgn, RESULT_TEXT[outcome->result]);
+}
+
+static void RecordGame(SelfplayMatch *match, int game, PieceColor firstColor,
+                       const ChessPosition *opening,
+                       const GameOutcome *outcome) {
+  const SelfplayOptions *options = match->options;
+  SelfplayResult *result = &match->result;
+
+  pthread_mutex_lock(&match->mutex);
+  GameResult firstWins =
+      firstColor == COLOR_WHITE ? RESULT_WHITE_WINS : RESULT_BLACK_WINS;
+  if (outcome->result == RESULT_DRAW)
+    result->draws++;
+  else if (outcome->result == firstWins)
+    result->wins++;
+  else
+    result->losses++;
+  UpdateStatistics(result, options);
+
+  double lower = log(options->beta / (1.0 - options->alpha));
+  double upper = log((1.0 - options->beta) / options->alpha);
+  if (options->sprt && result->decision == 0) {
+    if (result->llr >= upper)
+      result->decision = 1;
+    else if (result->llr <= lower)
+      result->decision = -1;
+    if (result->decision != 0)
+      match->stopped = true;
+  }
+
+  if (match->pgn != NULL)
+    WriteGamePgn(match, game, firstColor, opening, outcome);
+
+  const char *white = options->engines[firstColor == COLOR_WHITE ? 0 : 1].name;
+  const char *black = options->engines[firstColor == COLOR_WHITE ? 1 : 0].name;
+  fprintf(options->output,
+          "Game %d: %s - %s %s (%s, %d plies) | +%d =%d -%d | Elo %.1f "
+          "+/- %.1f",
+          game + 1, white, black, RESULT_TEXT[outcome->result],
+          outcome->reason, outcome->plies, result->wins, result->draws,
+          result->losses, result->elo, result->eloError);
+  if (options->sprt)
+    fprintf(options->output, " | LLR %.2f [%.2f, %.2f]", result->llr, lower,
+            upper);
+  fprintf(options->output, "\n");
+  fflush(options->output);
+  pthread_mutex_unlock(&match->mutex);
+}
+
+//==============================================================================
+// WORKERS
+//==============================================================================
+
+static void *SelfplayWorkerMain(void *arg) {
+  SelfplayWorker *worker = arg;
+  SelfplayMatch *match = worker->match;
+
+  for (;;) {
+    pthread_mutex_lock(&match->mutex);
+    if (match->nextGame >= match->options->games)
+      match->stopped = true;
+    int game = match->stopped ? -1 : match->nextGame++;
+    pthread_mutex_unlock(&match->mutex);
+    if (game < 0)
+      break;
+
+    // Each opening is played twice, with the engines swapping colors
+    const ChessPosition *opening =
+        &match->openings[(game / 2) % match->openingCount];
+    PieceColor firstColor = game % 2 == 0 ? COLOR_WHITE : COLOR_BLACK;
+    GameOutcome outcome = PlayGame(worker, opening, firstColor);
+    RecordGame(match, game, firstColor, opening, &outcome);
+  }
+  return NULL;
+}
+
+static bool StartSelfplayWorker(SelfplayWorker *worker) {
+  const SelfplayOptions *options = worker->match->options;
+  for (int i = 0; i < 2; i++) {
+    if (!ResizeTranspositionTable(&worker->tables[i],
+                                  options->engines[i].hashMb))
+      return false;
+    InitSearcher(&worker->searchers[i], &worker->tables[i], 1);
+  }
+  return pthread_create(&worker->thread, NULL, SelfplayWorkerMain, worker) ==
+         0;
+}
+
+//==============================================================================
+// SELF-PLAY INTERFACE
+//==============================================================================
+
+bool RunSelfplay(const SelfplayOptions *options, SelfplayResult *result) {
+  memset(result, 0, sizeof(*result));
+
+  SelfplayMatch match = {0};
+  match.options = options;
+  if (!LoadOpenings(&match, options->openingsPath)) {
+    free(match.openings);
+    return false;
+  }
+
+  int workerCount = options->workers;
+  if (workerCount < 1)
+    workerCount = 1;
+  if (workerCount > SEARCH_MAX_THREADS)
+    workerCount = SEARCH_MAX_THREADS;
+  SelfplayWorker *workers = calloc((size_t)workerCount, sizeof(SelfplayWorker));
+  if (workers == NULL) {
+    free(match.openings);
+    return false;
+  }
+
+  // Games are written as they finish, in the order they finish
+  PgnWriter pgn;
+  if (options->pgn != NULL) {
+    InitPgnWriter(&pgn, options->pgn);
+    match.pgn = &pgn;
+  }
+
+  pthread_mutex_init(&match.mutex, NULL);
+  match.startTime = GetTimeMilliseconds();
+
+  int started = 0;
+  for (int i = 0; i < workerCount; i++) {
+    workers[i].match = &match;
+    if (!StartSelfplayWorker(&workers[i])) {
+      FreeTranspositionTable(&workers[i].tables[0]);
+      FreeTranspositionTable(&workers[i].tables[1]);
+      break;
+    }
+    started++;
+  }
+
+  for (int i = 0; i < started; i++) {
+    pthread_join(workers[i].thread, NULL);
+    FreeTranspositionTable(&workers[i].tables[0]);
+    FreeTranspositionTable(&workers[i].tables[1]);
+  }
+
+  match.result.timeMs = GetTimeMilliseconds() - match.startTime;
+  *result = match.result;
+  if (match.pgn != NULL)
+    FlushPgnWriter(match.pgn);
+
+  pthread_mutex_destroy(&match.mutex);
+  free(workers);
+  free(match.openings);
+  return started > 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * Chess Game - Self-Play
+ * Engine-vs-engine matches on worker threads, with a sequential probability
+ * ratio test to stop as soon as the result is clear.
+ */
+
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include "clock.h"
+#include "search.h"
+#include <stdio.h>
+
+//==============================================================================
+// SELF-PLAY CONSTANTS
+//==============================================================================
+
+#define SELFPLAY_MAX_PLIES 600 // Longer games are adjudicated drawn
+#define SELFPLAY_NAME_LEN 16
+
+//==============================================================================
+// SELF-PLAY TYPES
+//==============================================================================
+
+// One side of the match; both run the engine in this process, so they
+// differ only in their limits and table size
+typedef struct {
+  char name[SELFPLAY_NAME_LEN];
+  size_t hashMb;
+  int depth;      // Fixed depth per move, 0 to play by the clock
+  uint64_t nodes; // Node limit per move, 0 for none
+} SelfplayEngine;
+
+typedef struct {
+  SelfplayEngine engines[2]; // The first one is the engine under test
+
+  // Time control; every game has its own clock, advanced by the time each
+  // search actually took
+  ClockType clockType;
+  float baseSeconds;
+  float incrementSeconds;
+
+  const char *openingsPath; // FEN/EPD file, NULL for the starting position
+  int games;                // Games to play (each opening twice, colors swapped)
+  int workers;              // Games played at once, one per thread
+
+  // Adjudication: a side keeps losing by resignScore or more for
+  // resignMoves moves of both players (0 disables)
+  int resignScore;
+  int resignMoves;
+
+  // SPRT: H0 elo0 against H1 elo1, with error rates alpha and beta
+  bool sprt;
+  double elo0;
+  double elo1;
+  double alpha;
+  double beta;
+
+  FILE *output; // Receives one progress line per game
+  FILE *pgn;    // Receives every finished game in PGN (may be NULL)
+} SelfplayOptions;
+
+typedef struct {
+  int wins; // From the first engine's point of view
+  int draws;
+  int losses;
+  double elo;      // Estimated difference, first engine minus second
+  double eloError; // 95% confidence half-width
+  double llr;      // SPRT log-likelihood ratio
+  int decision;    // SPRT outcome: 1 for H1, -1 for H0, 0 if undecided
+  int64_t timeMs;
+} SelfplayResult;
+
+//==============================================================================
+// SELF-PLAY FUNCTIONS
+//==============================================================================
+
+/**
+ * Set the defaults: 10+0.1 Fischer, 16 MB per engine, 1000 games, one
+ * worker, resign at 10 pawns for 4 moves, SPRT [0, 5] at 5%/5%.
+ */
+void InitSelfplayOptions(SelfplayOptions *options);
+
+/**
+ * Play the match. Returns once the game count is reached or the SPRT
+ * decides; games already running then finish and are counted.
+ * @return false if the openings could not be read or no worker started
+ */
+bool RunSelfplay(const SelfplayOptions *options, SelfplayResult *result);
+
+#endif // SELFPLAY_H
@@ -0,0 +1,1480 @@
+/**
+ * Chess Game - Endgame Tablebases
+ * Syzygy WDL/DTZ tablebase probing over memory-mapped files.
+ *
+ * The table format and index encoding follow the reference Syzygy prober.
+ * Inside this file squares use the Syzygy numbering (a1 = 0, h8 = 63), which
+ * is the ChessPosition square number XOR 56.
+ */
+
+#include "tbprobe.h"
+#include "mapfile.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// TABLE FORMAT CONSTANTS
+//==============================================================================
+
+static const unsigned char WDL_MAGIC[4] = {0x71, 0xE8, 0x23, 0x5D};
+static const unsigned char DTZ_MAGIC[4] = {0xD7, 0x66, 0x0C, 0xA5};
+
+// Flags stored per sub-table
+enum {
+  TB_FLAG_STM = 1,
+  TB_FLAG_MAPPED = 2,
+  TB_FLAG_WIN_PLIES = 4,
+  TB_FLAG_LOSS_PLIES = 8,
+  TB_FLAG_WIDE = 16,
+  TB_FLAG_SINGLE_VALUE = 128
+};
+
+// Piece codes used inside the files: white pawn..king are 1..6, black +8
+static const int TB_PIECE_OF_TYPE[7] = {0, 6, 5, 3, 2, 4, 1};
+static const char TB_PIECE_CHARS[] = " PNBRQK";
+
+#define TB_KING 6
+
+typedef enum {
+  PROBE_FAIL = 0,
+  PROBE_OK = 1,
+  PROBE_CHANGE_STM = -1,       // DTZ table only stores the other side to move
+  PROBE_ZEROING_BEST_MOVE = 2  // Best move is a capture or pawn move
+} ProbeState;
+
+//==============================================================================
+// TABLE TYPES
+//==============================================================================
+
+// One compressed sub-table: per side to move and, with pawns, per lead file
+typedef struct {
+  uint8_t flags;
+  uint8_t maxSymLen;
+  uint8_t minSymLen;
+  uint32_t numBlocks;
+  size_t blockSize;
+  size_t span;                 // Positions between sparse index entries
+  const uint8_t *lowestSym;    // Little-endian uint16 per symbol length
+  const uint8_t *btree;        // 3 bytes per symbol: left and right children
+  const uint8_t *blockLength;  // Little-endian uint16 per block
+  uint32_t blockLengthSize;
+  const uint8_t *sparseIndex;  // 6 bytes per entry: block and offset
+  size_t sparseIndexSize;
+  const uint8_t *data;         // Huffman-coded blocks
+  uint64_t *base64;            // Lowest 64-bit padded code per symbol length
+  uint8_t *symlen;             // Values represented by each symbol, minus one
+  int symbolCount;
+  int pieces[TB_MAX_PIECES];
+  uint64_t groupIdx[TB_MAX_PIECES + 1];
+  int groupLen[TB_MAX_PIECES + 1];
+  uint16_t mapIdx[4];          // DTZ value maps per WDL outcome
+} PairsData;
+
+typedef struct {
+  MappedFile file;
+  atomic_bool ready;           // Set once a mapping attempt has finished
+  bool loaded;                 // Mapping succeeded and headers are parsed
+  PairsData items[2][4];       // [side to move][lead pawn file]
+  const uint8_t *dtzMap;
+} TableData;
+
+typedef struct {
+  uint64_t key;                // Material key with the first side as white
+  uint64_t key2;               // Material key with the first side as black
+  char name[TB_MAX_PIECES + 2];
+  int pieceCount;
+  bool hasPawns;
+  bool hasUniquePieces;
+  int pawnCount[2];            // Leading color first
+  TableData wdl;
+  TableData dtz;
+} TablebaseEntry;
+
+//==============================================================================
+// TABLEBASE STATE
+//==============================================================================
+
+static char *pathBuffer = NULL;
+static char **directories = NULL;
+static int directoryCount = 0;
+
+static TablebaseEntry *entries = NULL;
+static int entryCount = 0;
+static int entryCapacity = 0;
+
+static int *entryHash = NULL; // Entry index + 1, 0 when empty
+static size_t hashMask = 0;
+
+static int maxPieces = 0;
+
+static pthread_mutex_t mapMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Background mapping of the tables a position can lead to
+static pthread_mutex_t prefetchMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t prefetchThread;
+static bool prefetchStarted = false; // prefetchThread still has to be joined
+static bool prefetchRunning = false;
+static bool prefetchPending = false;
+static uint64_t prefetchKey = 0;     // Material of the latest request
+
+//==============================================================================
+// INDEX ENCODING TABLES
+//==============================================================================
+
+static int mapPawns[64];
+static int mapB1H1H7[64];
+static int mapA1D1D4[64];
+static int mapKK[10][64];
+static uint64_t binomial[6][64];
+static int leadPawnIdx[6][64];
+static int leadPawnsSize[6][4];
+static bool tablesReady = false;
+
+static int FileOf(int s) { return s & 7; }
+static int RankOf(int s) { return s >> 3; }
+static int OffA1H8(int s) { return RankOf(s) - FileOf(s); }
+
+static void InitEncodingTables(void) {
+  if (tablesReady)
+    return;
+
+  // Squares below the a1-h8 diagonal
+  int code = 0;
+  for (int s = 0; s < 64; s++) {
+    if (OffA1H8(s) < 0)
+      mapB1H1H7[s] = code++;
+  }
+
+  // The a1-d1-d4 triangle, diagonal squares last
+  int diagonal[4];
+  int diagonalCount = 0;
+  code = 0;
+  for (int s = 0; s <= 27; s++) {
+    if (OffA1H8(s) < 0 && FileOf(s) <= 3)
+      mapA1D1D4[s] = code++;
+    else if (OffA1H8(s) == 0 && FileOf(s) <= 3)
+      diagonal[diagonalCount++] = s;
+  }
+  for (int i = 0; i < diagonalCount; i++)
+    mapA1D1D4[diagonal[i]] = code++;
+
+  // The 462 legal placements of two kings with the first in the triangle;
+  // placements with both kings on the diagonal come last
+  int bothIdx[64];
+  int bothSquare[64];
+  int bothCount = 0;
+  code = 0;
+  for (int idx = 0; idx < 10; idx++) {
+    for (int s1 = 0; s1 <= 27; s1++) {
+      if (mapA1D1D4[s1] != idx || (idx == 0 && s1 != 1))
+        continue;
+      for (int s2 = 0; s2 < 64; s2++) {
+        if (abs(FileOf(s1) - FileOf(s2)) <= 1 &&
+            abs(RankOf(s1) - RankOf(s2)) <= 1)
+          continue; // Kings touching or on the same square
+        if (OffA1H8(s1) == 0 && OffA1H8(s2) > 0)
+          continue; // First on the diagonal, second above it
+        if (OffA1H8(s1) == 0 && OffA1H8(s2) == 0) {
+          bothIdx[bothCount] = idx;
+          bothSquare[bothCount++] = s2;
+        } else {
+          mapKK[idx][s2] = code++;
+        }
+      }
+    }
+  }
+  for (int i = 0; i < bothCount; i++)
+    mapKK[bothIdx[i]][bothSquare[i]] = code++;
+
+  // binomial[k][n]: ways to choose k of n squares
+  binomial[0][0] = 1;
+  for (int n = 1; n < 64; n++) {
+    for (int k = 0; k < 6 && k <= n; k++) {
+      binomial[k][n] = (k > 0 ? binomial[k - 1][n - 1] : 0) +
+                       (k < n ? binomial[k][n - 1] : 0);
+    }
+  }
+
+  // Pawn squares a2-h7 numbered so that the leading pawn (nearest the edge,
+  // lowest rank) has the highest value
+  int availableSquares = 47;
+  for (int leadCount = 1; leadCount <= 5; leadCount++) {
+    for (int file = 0; file < 4; file++) {
+      int idx = 0;
+      for (int rank = 1; rank <= 6; rank++) {
+        int sq = rank * 8 + file;
+        if (leadCount == 1) {
+          mapPawns[sq] = availableSquares--;
+          mapPawns[sq ^ 7] = availableSquares--;
+        }
+        leadPawnIdx[leadCount][sq] = idx;
+        idx += (int)binomial[leadCount - 1][mapPawns[sq]];
+      }
+      leadPawnsSize[leadCount][file] = idx;
+    }
+  }
+
+  tablesReady = true;
+}
+
+//==============================================================================
+// BYTE ACCESS
+//==============================================================================
+
+static uint32_t ReadLE16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+
+static uint32_t ReadLE32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static uint32_t ReadBE32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t ReadBE64(const uint8_t *p) {
+  return ((uint64_t)ReadBE32(p) << 32) | ReadBE32(p + 4);
+}
+
+static int SymbolLeft(const PairsData *d, int sym) {
+  const uint8_t *lr = d->btree + 3 * sym;
+  return ((lr[1] & 0xF) << 8) | lr[0];
+}
+
+static int SymbolRight(const PairsData *d, int sym) {
+  const uint8_t *lr = d->btree + 3 * sym;
+  return (lr[2] << 4) | (lr[1] >> 4);
+}
+
+//==============================================================================
+// MATERIAL KEYS
+//==============================================================================
+
+// Pawn..queen counts of both colors packed four bits each; kings are implied
+static uint64_t MaterialKey(const int white[7], const int black[7]) {
+  uint64_t key = 0;
+  for (int tb = 1; tb <= 5; tb++) {
+    key |= (uint64_t)white[tb] << (4 * (tb - 1));
+    key |= (uint64_t)black[tb] << (4 * (tb - 1) + 20);
+  }
+  return key;
+}
+
+static uint64_t PositionMaterialKey(const ChessPosition *pos) {
+  int white[7] = {0};
+  int black[7] = {0};
+  for (int type = PIECE_QUEEN; type <= PIECE_PAWN; type++) {
+    white[TB_PIECE_OF_TYPE[type]] = pos->pieceCount[COLOR_WHITE][type];
+    black[TB_PIECE_OF_TYPE[type]] = pos->pieceCount[COLOR_BLACK][type];
+  }
+  return MaterialKey(white, black);
+}
+
+static size_t HashSlot(uint64_t key) {
+  return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & hashMask;
+}
+
+static TablebaseEntry *FindEntry(uint64_t key) {
+  if (entryHash == NULL)
+    return NULL;
+  for (size_t slot = HashSlot(key);; slot = (slot + 1) & hashMask) {
+    int index = entryHash[slot];
+    if (index == 0)
+      return NULL;
+    TablebaseEntry *entry = &entries[index - 1];
+    if (entry->key == key || entry->key2 == key)
+      return entry;
+  }
+}
+
+static void InsertEntry(uint64_t key, int index) {
+  size_t slot = HashSlot(key);
+  while (entryHash[slot] != 0) {
+    if (entryHash[slot] == index + 1)
+      return; // Symmetric tables have key == key2
+    slot = (slot + 1) & hashMask;
+  }
+  entryHash[slot] = index + 1;
+}
+
+//==============================================================================
+// TABLE REGISTRATION
+//==============================================================================
+
+// Build "<dir>/<name><extension>" into buffer
+static void TablePath(char *buffer, size_t size, int directory,
+                      const char *name, const char *extension) {
+  snprintf(buffer, size, "%s/%s%s", directories[directory], name, extension);
+}
+
+static bool FileExists(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    return false;
+  fclose(file);
+  return true;
+}
+
+// Register a table given its pieces, strongest side first, each side
+// starting with its king: {KING, QUEEN, KING} is KQvK
+static void AddTable(const int *pieces, int count) {
+  char name[TB_MAX_PIECES + 2];
+  int length = 0;
+  int counts[2][7] = {{0}};
+  int side = 0;
+
+  for (int i = 0; i < count; i++) {
+    if (i > 0 && pieces[i] == TB_KING) {
+      name[length++] = 'v';
+      side = 1;
+    }
+    name[length++] = TB_PIECE_CHARS[pieces[i]];
+    counts[side][pieces[i]]++;
+  }
+  name[length] = '\0';
+
+  // Only the WDL file is checked; DTZ files are optional
+  char path[1024];
+  bool found = false;
+  for (int d = 0; d < directoryCount && !found; d++) {
+    TablePath(path, sizeof(path), d, name, ".rtbw");
+    found = FileExists(path);
+  }
+  if (!found)
+    return;
+
+  if (entryCount == entryCapacity) {
+    int capacity = entryCapacity ? entryCapacity * 2 : 64;
+    TablebaseEntry *grown = realloc(entries, capacity * sizeof(*entries));
+    if (grown == NULL)
+      return;
+    entries = grown;
+    entryCapacity = capacity;
+  }
+
+  TablebaseEntry *entry = &entries[entryCount++];
+  memset(entry, 0, sizeof(*entry));
+  atomic_init(&entry->wdl.ready, false);
+  atomic_init(&entry->dtz.ready, false);
+  memcpy(entry->name, name, length + 1);
+
+  entry->key = MaterialKey(counts[0], counts[1]);
+  entry->key2 = MaterialKey(counts[1], counts[0]);
+  entry->pieceCount = count;
+  entry->hasPawns = counts[0][1] + counts[1][1] > 0;
+  for (int c = 0; c < 2; c++) {
+    for (int tb = 1; tb <= 5; tb++) {
+      if (counts[c][tb] == 1)
+        entry->hasUniquePieces = true;
+    }
+  }
+
+  // With pawns on both sides the side with fewer pawns leads, which
+  // compresses better
+  bool firstLeads = counts[1][1] == 0 ||
+                    (counts[0][1] > 0 && counts[1][1] >= counts[0][1]);
+  entry->pawnCount[0] = firstLeads ? counts[0][1] : counts[1][1];
+  entry->pawnCount[1] = firstLeads ? counts[1][1] : counts[0][1];
+
+  if (count > maxPieces)
+    maxPieces = count;
+}
+
+#define ADD_TABLE(...)                                                         \
+  AddTable((const int[]){__VA_ARGS__},                                         \
+           (int)(sizeof((const int[]){__VA_ARGS__}) / sizeof(int)))
+
+// Every material combination with up to seven pieces, in the canonical
+// "stronger side first" naming used by the table files
+static void RegisterTables(void) {
+  const int K = TB_KING;
+  for (int p1 = 1; p1 < K; p1++) {
+    ADD_TABLE(K, p1, K);
+
+    for (int p2 = 1; p2 <= p1; p2++) {
+      ADD_TABLE(K, p1, p2, K);
+      ADD_TABLE(K, p1, K, p2);
+
+      for (int p3 = 1; p3 < K; p3++)
+        ADD_TABLE(K, p1, p2, K, p3);
+
+      for (int p3 = 1; p3 <= p2; p3++) {
+        ADD_TABLE(K, p1, p2, p3, K);
+
+        for (int p4 = 1; p4 <= p3; p4++) {
+          ADD_TABLE(K, p1, p2, p3, p4, K);
+
+          for (int p5 = 1; p5 <= p4; p5++)
+            ADD_TABLE(K, p1, p2, p3, p4, p5, K);
+
+          for (int p5 = 1; p5 < K; p5++)
+            ADD_TABLE(K, p1, p2, p3, p4, K, p5);
+        }
+
+        for (int p4 = 1; p4 < K; p4++) {
+          ADD_TABLE(K, p1, p2, p3, K, p4);
+
+          for (int p5 = 1; p5 <= p4; p5++)
+            ADD_TABLE(K, p1, p2, p3, K, p4, p5);
+        }
+      }
+
+      for (int p3 = 1; p3 <= p1; p3++) {
+        for (int p4 = 1; p4 <= (p1 == p3 ? p2 : p3); p4++)
+          ADD_TABLE(K, p1, p2, K, p3, p4);
+      }
+    }
+  }
+}
+
+//==============================================================================
+// TABLE PARSING
+//==============================================================================
+
+static PairsData *GetPairs(TablebaseEntry *entry, TableData *table, int stm,
+                           int file) {
+  int sides = (table == &entry->dtz) ? 1 : 2;
+  return &table->items[stm % sides][entry->hasPawns ? file : 0];
+}
+
+static uint8_t SetSymbolLength(PairsData *d, int sym, bool *visited) {
+  visited[sym] = true; // The tree is acyclic
+  int right = SymbolRight(d, sym);
+  if (right == 0xFFF)
+    return 0;
+
+  int left = SymbolLeft(d, sym);
+  if (!visited[left])
+    d->symlen[left] = SetSymbolLength(d, left, visited);
+  if (!visited[right])
+    d->symlen[right] = SetSymbolLength(d, right, visited);
+
+  return (uint8_t)(d->symlen[left] + d->symlen[right] + 1);
+}
+
+static void SetGroups(TablebaseEntry *entry, PairsData *d, const int order[2],
+                      int file) {
+  int n = 0;
+  int firstLen = entry->hasPawns ? 0 : entry->hasUniquePieces ? 3 : 2;
+  d->groupLen[n] = 1;
+
+  // Consecutive equal pieces form a group; the leading group holds the
+  // first pieces (kings and one unique piece, or the leading pawns)
+  for (int i = 1; i < entry->pieceCount; i++) {
+    if (--firstLen > 0 || d->pieces[i] == d->pieces[i - 1])
+      d->groupLen[n]++;
+    else
+      d->groupLen[++n] = 1;
+  }
+  d->groupLen[++n] = 0;
+
+  // The order in which groups are multiplied into the index is a per-table
+  // parameter: order[0] is the leading group, order[1] the remaining pawns
+  bool bothPawns = entry->hasPawns && entry->pawnCount[1];
+  int next = bothPawns ? 2 : 1;
+  int freeSquares = 64 - d->groupLen[0] - (bothPawns ? d->groupLen[1] : 0);
+  uint64_t idx = 1;
+
+  for (int k = 0; next < n || k == order[0] || k == order[1]; k++) {
+    if (k == order[0]) {
+      d->groupIdx[0] = idx;
+      idx *= entry->hasPawns          ? leadPawnsSize[d->groupLen[0]][file]
+             : entry->hasUniquePieces ? 31332
+                                      : 462;
+    } else if (k == order[1]) {
+      d->groupIdx[1] = idx;
+      idx *= binomial[d->groupLen[1]][48 - d->groupLen[0]];
+    } else {
+      d->groupIdx[next] = idx;
+      idx *= binomial[d->groupLen[next]][freeSquares];
+      freeSquares -= d->groupLen[next++];
+    }
+  }
+
+  d->groupIdx[n] = idx;
+}
+
+static const uint8_t *SetSizes(PairsData *d, const uint8_t *data) {
+  d->flags = *data++;
+
+  if (d->flags & TB_FLAG_SINGLE_VALUE) {
+    d->numBlocks = 0;
+    d->span = d->blockLengthSize = d->sparseIndexSize = 0;
+    d->minSymLen = *data++; // The single value
+    return data;
+  }
+
+  // groupLen[] is zero-terminated and the matching groupIdx[] holds the
+  // number of positions in the table
+  int groups = 0;
+  while (d->groupLen[groups] != 0)
+    groups++;
+  uint64_t tableSize = d->groupIdx[groups];
+
+  d->blockSize = (size_t)1 << *data++;
+  d->span = (size_t)1 << *data++;
+  d->sparseIndexSize = (size_t)((tableSize + d->span - 1) / d->span);
+  int padding = *data++;
+  d->numBlocks = ReadLE32(data);
+  data += 4;
+  d->blockLengthSize = d->numBlocks + padding;
+  d->maxSymLen = *data++;
+  d->minSymLen = *data++;
+  d->lowestSym = data;
+
+  // Canonical Huffman code: longer symbols have lower values, so base64[]
+  // is decreasing and a code's length is found by comparing against it
+  int lengths = d->maxSymLen - d->minSymLen + 1;
+  d->base64 = calloc(lengths, sizeof(uint64_t));
+  for (int i = lengths - 2; i >= 0; i--) {
+    d->base64[i] = (d->base64[i + 1] + ReadLE16(d->lowestSym + 2 * i) -
+                    ReadLE16(d->lowestSym + 2 * (i + 1))) /
+                   2;
+  }
+  for (int i = 0; i < lengths; i++)
+    d->base64[i] <<= 64 - i - d->minSymLen;
+
+  data += lengths * 2;
+  d->symbolCount = (int)ReadLE16(data);
+  data += 2;
+  d->btree = data;
+
+  // Recursive pairing: each symbol expands into a pair of smaller symbols
+  d->symlen = calloc(d->symbolCount, 1);
+  bool *visited = calloc(d->symbolCount, sizeof(bool));
+  for (int sym = 0; sym < d->symbolCount; sym++) {
+    if (!visited[sym])
+      d->symlen[sym] = SetSymbolLength(d, sym, visited);
+  }
+  free(visited);
+
+  return data + d->symbolCount * 3 + (d->symbolCount & 1);
+}
+
+static const uint8_t *SetDtzMap(TablebaseEntry *entry, const uint8_t *base,
+                                const uint8_t *data, int maxFile) {
+  TableData *table = &entry->dtz;
+  table->dtzMap = data;
+
+  for (int file = 0; file <= maxFile; file++) {
+    PairsData *d = GetPairs(entry, table, 0, file);
+    if (!(d->flags & TB_FLAG_MAPPED))
+      continue;
+
+    if (d->flags & TB_FLAG_WIDE) {
+      data += (data - base) & 1; // Word alignment
+      for (int i = 0; i < 4; i++) {
+        d->mapIdx[i] = (uint16_t)((data - table->dtzMap) / 2 + 1);
+        data += 2 * ReadLE16(data) + 2;
+      }
+    } else {
+      for (int i = 0; i < 4; i++) {
+        d->mapIdx[i] = (uint16_t)(data - table->dtzMap + 1);
+        data += *data + 1;
+      }
+    }
+  }
+
+  return data + ((data - base) & 1);
+}
+
+static void ParseTable(TablebaseEntry *entry, TableData *table,
+                       const uint8_t *base) {
+  bool isDtz = (table == &entry->dtz);
+  const uint8_t *data = base + 4; // Skip the magic
+  data++;                         // Split and pawn flags, known from the name
+
+  int sides = (!isDtz && entry->key != entry->key2) ? 2 : 1;
+  int maxFile = entry->hasPawns ? 3 : 0;
+  bool bothPawns = entry->hasPawns && entry->pawnCount[1];
+
+  for (int file = 0; file <= maxFile; file++) {
+    int order[2][2] = {
+        {data[0] & 0xF, bothPawns ? data[1] & 0xF : 0xF},
+        {data[0] >> 4, bothPawns ? data[1] >> 4 : 0xF},
+    };
+    data += 1 + bothPawns;
+
+    for (int k = 0; k < entry->pieceCount; k++, data++) {
+      for (int i = 0; i < sides; i++)
+        GetPairs(entry, table, i, file)->pieces[k] =
+            i ? *data >> 4 : *data & 0xF;
+    }
+
+    for (int i = 0; i < sides; i++)
+      SetGroups(entry, GetPairs(entry, table, i, file), order[i], file);
+  }
+
+  data += (data - base) & 1;
+
+  for (int file = 0; file <= maxFile; file++) {
+    for (int i = 0; i < sides; i++)
+      data = SetSizes(GetPairs(entry, table, i, file), data);
+  }
+
+  if (isDtz)
+    data = SetDtzMap(entry, base, data, maxFile);
+
+  for (int file = 0; file <= maxFile; file++) {
+    for (int i = 0; i < sides; i++) {
+      PairsData *d = GetPairs(entry, table, i, file);
+      d->sparseIndex = data;
+      data += d->sparseIndexSize * 6;
+    }
+  }
+
+  for (int file = 0; file <= maxFile; file++) {
+    for (int i = 0; i < sides; i++) {
+      PairsData *d = GetPairs(entry, table, i, file);
+      d->blockLength = data;
+      data += d->blockLengthSize * 2;
+    }
+  }
+
+  for (int file = 0; file <= maxFile; file++) {
+    for (int i = 0; i < sides; i++) {
+      PairsData *d = GetPairs(entry, table, i, file);
+      data = base + (((data - base) + 63) & ~(ptrdiff_t)63);
+      d->data = data;
+      data += (size_t)d->numBlocks * d->blockSize;
+    }
+  }
+}
+
+static bool OpenTable(TablebaseEntry *entry, TableData *table) {
+  bool isDtz = (table == &entry->dtz);
+  const char *extension = isDtz ? ".rtbz" : ".rtbw";
+  const unsigned char *magic = isDtz ? DTZ_MAGIC : WDL_MAGIC;
+  char path[1024];
+
+  for (int d = 0; d < directoryCount; d++) {
+    TablePath(path, sizeof(path), d, entry->name, extension);
+    if (!MapFile(&table->file, path, MAP_ACCESS_RANDOM))
+      continue;
+
+    // Valid files are a multiple of 64 bytes plus a 16-byte trailer
+    if (table->file.size % 64 != 16 ||
+        memcmp(table->file.data, magic, 4) != 0) {
+#ifndef CHESS_HEADLESS
+      TraceLog(LOG_WARNING, "Corrupted tablebase file: %s", path);
+#endif
+      UnmapFile(&table->file);
+      return false;
+    }
+
+    ParseTable(entry, table, table->file.data);
+    return true;
+  }
+
+  return false;
+}
+
+// Map and parse a table the first time it is needed. Double-checked locking
+// keeps the common already-mapped path lock-free for search threads.
+static bool EnsureTableMapped(TablebaseEntry *entry, TableData *table) {
+  if (atomic_load_explicit(&table->ready, memory_order_acquire))
+    return table->loaded;
+
+  pthread_mutex_lock(&mapMutex);
+  if (!atomic_load_explicit(&table->ready, memory_order_relaxed)) {
+    table->loaded = OpenTable(entry, table);
+    atomic_store_explicit(&table->ready, true, memory_order_release);
+  }
+  pthread_mutex_unlock(&mapMutex);
+
+  return table->loaded;
+}
+
+static void ReleaseTable(TableData *table) {
+  for (int i = 0; i < 2; i++) {
+    for (int f = 0; f < 4; f++) {
+      free(table->items[i][f].base64);
+      free(table->items[i][f].symlen);
+    }
+  }
+  UnmapFile(&table->file);
+}
+
+//==============================================================================
+// PREFETCHING
+//==============================================================================
+
+// Can captures and promotions turn the first material into the second?
+// Pawns never come back, and each new piece needs a pawn that is gone.
+static bool CanReachMaterial(uint64_t from, uint64_t to) {
+  for (int shift = 0; shift <= 20; shift += 20) {
+    int pawnsFrom = (int)((from >> shift) & 15);
+    int pawnsTo = (int)((to >> shift) & 15);
+    if (pawnsTo > pawnsFrom)
+      return false;
+
+    int promoted = 0;
+    for (int tb = 2; tb <= 5; tb++) {
+      int before = (int)((from >> (shift + 4 * (tb - 1))) & 15);
+      int after = (int)((to >> (shift + 4 * (tb - 1))) & 15);
+      if (after > before)
+        promoted += after - before;
+    }
+    if (promoted > pawnsFrom - pawnsTo)
+      return false;
+  }
+  return true;
+}
+
+static bool IsEntryReachable(uint64_t key, const TablebaseEntry *entry) {
+  return CanReachMaterial(key, entry->key) ||
+         CanReachMaterial(key, entry->key2);
+}
+
+static void MapReachableTables(uint64_t key) {
+  for (int i = 0; i < entryCount; i++) {
+    if (IsEntryReachable(key, &entries[i]))
+      EnsureTableMapped(&entries[i], &entries[i].wdl);
+  }
+}
+
+static void *PrefetchMain(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&prefetchMutex);
+  while (prefetchPending) {
+    uint64_t key = prefetchKey;
+    prefetchPending = false;
+    pthread_mutex_unlock(&prefetchMutex);
+    MapReachableTables(key);
+    pthread_mutex_lock(&prefetchMutex);
+  }
+  prefetchRunning = false;
+  pthread_mutex_unlock(&prefetchMutex);
+  return NULL;
+}
+
+// Let a running prefetch finish before the tables go away
+static void WaitForPrefetch(void) {
+  pthread_mutex_lock(&prefetchMutex);
+  prefetchPending = false;
+  bool started = prefetchStarted;
+  prefetchStarted = false;
+  pthread_mutex_unlock(&prefetchMutex);
+
+  if (started)
+    pthread_join(prefetchThread, NULL);
+}
+
+//==============================================================================
+// DECOMPRESSION
+//==============================================================================
+
+static int DecompressPairs(const PairsData *d, uint64_t idx) {
+  if (d->flags & TB_FLAG_SINGLE_VALUE)
+    return d->minSymLen;
+
+  // The sparse index entry k points at position k * span + span / 2; walk
+  // from there to the block holding idx
+  uint32_t k = (uint32_t)(idx / d->span);
+  const uint8_t *sparse = d->sparseIndex + 6 * (size_t)k;
+  uint32_t block = ReadLE32(sparse);
+  int offset = (int)ReadLE16(sparse + 4);
+
+  offset += (int)(idx % d->span) - (int)(d->span / 2);
+
+  while (offset < 0)
+    offset += (int)ReadLE16(d->blockLength + 2 * (size_t)--block) + 1;
+
+  while (offset > (int)ReadLE16(d->blockLength + 2 * (size_t)block))
+    offset -= (int)ReadLE16(d->blockLength + 2 * (size_t)block++) + 1;
+
+  // Decode Huffman symbols from the start of the block until the one that
+  // covers our offset
+  const uint8_t *ptr = d->data + (uint64_t)block * d->blockSize;
+  uint64_t buf64 = ReadBE64(ptr);
+  ptr += 8;
+  int buf64Size = 64;
+  int sym;
+
+  for (;;) {
+    int len = 0;
+    while (buf64 < d->base64[len])
+      len++;
+
+    sym = (int)((buf64 - d->base64[len]) >> (64 - len - d->minSymLen));
+    sym += (int)ReadLE16(d->lowestSym + 2 * len);
+
+    if (offset < d->symlen[sym] + 1)
+      break;
+
+    offset -= d->symlen[sym] + 1;
+    len += d->minSymLen;
+    buf64 <<= len;
+    buf64Size -= len;
+
+    if (buf64Size <= 32) {
+      buf64Size += 32;
+      buf64 |= (uint64_t)ReadBE32(ptr) << (64 - buf64Size);
+      ptr += 4;
+    }
+  }
+
+  // Expand the pair tree down to the single value at our offset
+  while (d->symlen[sym] != 0) {
+    int left = SymbolLeft(d, sym);
+    if (offset < d->symlen[left] + 1) {
+      sym = left;
+    } else {
+      offset -= d->symlen[left] + 1;
+      sym = SymbolRight(d, sym);
+    }
+  }
+
+  return SymbolLeft(d, sym);
+}
+
+//==============================================================================
+// POSITION ENCODING
+//==============================================================================
+
+static void SortSquares(int *squares, int count, bool byPawnMap) {
+  for (int i = 1; i < count; i++) {
+    int value = squares[i];
+    int key = byPawnMap ? mapPawns[value] : value;
+    int j = i - 1;
+    while (j >= 0 && (byPawnMap ? mapPawns[squares[j]] : squares[j]) > key) {
+      squares[j + 1] = squares[j];
+      j--;
+    }
+    squares[j + 1] = value;
+  }
+}
+
+static int TablePieceCode(PieceCode code) {
+  return TB_PIECE_OF_TYPE[CODE_TYPE(code)] +
+         (CODE_COLOR(code) == COLOR_BLACK ? 8 : 0);
+}
+
+static bool DtzStoresSide(TablebaseEntry *entry, int stm, int file) {
+  int flags = GetPairs(entry, &entry->dtz, stm, file)->flags;
+  return (flags & TB_FLAG_STM) == stm ||
+         (entry->key == entry->key2 && !entry->hasPawns);
+}
+
+static int MapDtzScore(TablebaseEntry *entry, int file, int value,
+                       TablebaseWdl wdl) {
+  static const int WDL_MAP[] = {1, 3, 0, 2, 0};
+  const PairsData *d = GetPairs(entry, &entry->dtz, 0, file);
+  const uint8_t *map = entry->dtz.dtzMap;
+  int idx = d->mapIdx[WDL_MAP[wdl + 2]];
+
+  if (d->flags & TB_FLAG_MAPPED) {
+    if (d->flags & TB_FLAG_WIDE)
+      value = (int)ReadLE16(map + 2 * (size_t)(idx + value));
+    else
+      value = map[idx + value];
+  }
+
+  // Tables store moves or plies; always answer in plies
+  if ((wdl == TB_WIN && !(d->flags & TB_FLAG_WIN_PLIES)) ||
+      (wdl == TB_LOSS && !(d->flags & TB_FLAG_LOSS_PLIES)) ||
+      wdl == TB_CURSED_WIN || wdl == TB_BLESSED_LOSS)
+    value *= 2;
+
+  return value + 1;
+}
+
+// Turn the position into the table index and decode the stored value
+static int ProbeTable(const ChessPosition *pos, TablebaseEntry *entry,
+                      TableData *table, TablebaseWdl wdl, ProbeState *result) {
+  int squares[TB_MAX_PIECES];
+  int pieces[TB_MAX_PIECES];
+  int size = 0;
+  int leadPawnsCount = 0;
+  int tbFile = 0;
+  uint64_t leadPawns = 0;
+  bool blackToMove = pos->sideToMove == COLOR_BLACK;
+
+  // Tables are stored with the stronger side as white; symmetric tables
+  // only for white to move. Otherwise swap colors and mirror the ranks.
+  bool symmetricBlackToMove = entry->key == entry->key2 && blackToMove;
+  bool blackStronger = PositionMaterialKey(pos) != entry->key;
+  bool flip = symmetricBlackToMove || blackStronger;
+  int flipColor = flip ? 8 : 0;
+  int flipSquares = flip ? 56 : 0;
+  int stm = flip ^ blackToMove;
+
+  // With pawns there is one table per file of the leading pawn
+  if (entry->hasPawns) {
+    int pawnCode = table->items[0][0].pieces[0] ^ flipColor;
+    PieceColor pawnColor = (pawnCode & 8) ? COLOR_BLACK : COLOR_WHITE;
+    PieceCode leadPawn = PIECE_CODE(PIECE_PAWN, pawnColor);
+
+    for (int s = 0; s < 64; s++) {
+      if (pos->squares[s ^ 56] == leadPawn) {
+        leadPawns |= 1ULL << s;
+        squares[size++] = s ^ flipSquares;
+      }
+    }
+    leadPawnsCount = size;
+
+    int best = 0;
+    for (int i = 1; i < leadPawnsCount; i++) {
+      if (mapPawns[squares[i]] > mapPawns[squares[best]])
+        best = i;
+    }
+    int swap = squares[0];
+    squares[0] = squares[best];
+    squares[best] = swap;
+
+    tbFile = FileOf(squares[0]);
+    if (tbFile > 3)
+      tbFile = 7 - tbFile;
+  }
+
+  if (table == &entry->dtz && !DtzStoresSide(entry, stm, tbFile)) {
+    *result = PROBE_CHANGE_STM;
+    return 0;
+  }
+
+  for (int s = 0; s < 64; s++) {
+    PieceCode code = pos->squares[s ^ 56];
+    if (code == NO_PIECE || (leadPawns >> s) & 1)
+      continue;
+    squares[size] = s ^ flipSquares;
+    pieces[size++] = TablePieceCode(code) ^ flipColor;
+  }
+
+  PairsData *d = GetPairs(entry, table, stm, tbFile);
+
+  // Reorder the pieces to match the sequence stored in the table
+  for (int i = leadPawnsCount; i < size - 1; i++) {
+    for (int j = i + 1; j < size; j++) {
+      if (d->pieces[i] == pieces[j]) {
+        int t = pieces[i];
+        pieces[i] = pieces[j];
+        pieces[j] = t;
+        t = squares[i];
+        squares[i] = squares[j];
+        squares[j] = t;
+        break;
+      }
+    }
+  }
+
+  // Mirror so that the leading piece is on files a-d
+  if (FileOf(squares[0]) > 3) {
+    for (int i = 0; i < size; i++)
+      squares[i] ^= 7;
+  }
+
+  uint64_t idx;
+  if (entry->hasPawns) {
+    idx = leadPawnIdx[leadPawnsCount][squares[0]];
+    SortSquares(squares + 1, leadPawnsCount - 1, true);
+    for (int i = 1; i < leadPawnsCount; i++)
+      idx += binomial[i][mapPawns[squares[i]]];
+  } else {
+    // Without pawns, also mirror into ranks 1-4...
+    if (RankOf(squares[0]) > 3) {
+      for (int i = 0; i < size; i++)
+        squares[i] ^= 56;
+    }
+
+    // ...and below the a1-h8 diagonal, judged by the first leading piece
+    // that is not on it
+    for (int i = 0; i < d->groupLen[0]; i++) {
+      if (OffA1H8(squares[i]) == 0)
+        continue;
+      if (OffA1H8(squares[i]) > 0) {
+        for (int j = i; j < size; j++)
+          squares[j] = ((squares[j] >> 3) | (squares[j] << 3)) & 63;
+      }
+      break;
+    }
+
+    if (entry->hasUniquePieces) {
+      // Kings plus one unique piece encoded together (31332 placements)
+      int adjust1 = squares[1] > squares[0];
+      int adjust2 = (squares[2] > squares[0]) + (squares[2] > squares[1]);
+
+      if (OffA1H8(squares[0]))
+        idx = ((uint64_t)mapA1D1D4[squares[0]] * 63 + (squares[1] - adjust1)) *
+                  62 +
+              squares[2] - adjust2;
+      else if (OffA1H8(squares[1]))
+        idx = ((uint64_t)6 * 63 + RankOf(squares[0]) * 28 +
+               mapB1H1H7[squares[1]]) *
+                  62 +
+              squares[2] - adjust2;
+      else if (OffA1H8(squares[2]))
+        idx = 6 * 63 * 62 + 4 * 28 * 62 + RankOf(squares[0]) * 7 * 28 +
+              (RankOf(squares[1]) - adjust1) * 28 + mapB1H1H7[squares[2]];
+      else
+        idx = 6 * 63 * 62 + 4 * 28 * 62 + 4 * 7 * 28 +
+              RankOf(squares[0]) * 7 * 6 + (RankOf(squares[1]) - adjust1) * 6 +
+              (RankOf(squares[2]) - adjust2);
+    } else {
+      idx = mapKK[mapA1D1D4[squares[0]]][squares[1]];
+    }
+  }
+
+  // Remaining groups: each group's squares in ascending order, skipping
+  // squares already taken by earlier groups
+  idx *= d->groupIdx[0];
+  int *groupSq = squares + d->groupLen[0];
+  bool remainingPawns = entry->hasPawns && entry->pawnCount[1];
+
+  for (int next = 1; d->groupLen[next] != 0; next++) {
+    SortSquares(groupSq, d->groupLen[next], false);
+    uint64_t n = 0;
+
+    for (int i = 0; i < d->groupLen[next]; i++) {
+      int adjust = 0;
+      for (int *s = squares; s < groupSq; s++) {
+        if (groupSq[i] > *s)
+          adjust++;
+      }
+      n += binomial[i + 1][groupSq[i] - adjust - 8 * remainingPawns];
+    }
+
+    remainingPawns = false;
+    idx += n * d->groupIdx[next];
+    groupSq += d->groupLen[next];
+  }
+
+  int value = DecompressPairs(d, idx);
+  if (table == &entry->wdl)
+    return value - 2;
+  return MapDtzScore(entry, tbFile, value, wdl);
+}
+
+static int ProbeTableForPosition(const ChessPosition *pos, bool dtz,
+                                 TablebaseWdl wdl, ProbeState *result) {
+  if (CountPieces(pos) == 2)
+    return TB_DRAW; // Bare kings
+
+  TablebaseEntry *entry = FindEntry(PositionMaterialKey(pos));
+  TableData *table = entry ? (dtz ? &entry->dtz : &entry->wdl) : NULL;
+  if (table == NULL || !EnsureTableMapped(entry, table)) {
+    *result = PROBE_FAIL;
+    return 0;
+  }
+
+  return ProbeTable(pos, entry, table, wdl, result);
+}
+
+//==============================================================================
+// PROBING
+//==============================================================================
+
+static bool IsCapture(const ChessPosition *pos, Move move) {
+  int to = MOVE_TO(move);
+  return pos->squares[to] != NO_PIECE ||
+         (CODE_TYPE(pos->squares[MOVE_FROM(move)]) == PIECE_PAWN &&
+          to == pos->enPassantSquare);
+}
+
+static bool IsZeroing(const ChessPosition *pos, Move move) {
+  return IsCapture(pos, move) ||
+         CODE_TYPE(pos->squares[MOVE_FROM(move)]) == PIECE_PAWN;
+}
+
+static bool IsMated(ChessPosition *pos) {
+  MoveList list;
+  if (!IsKingInCheck(pos, pos->sideToMove))
+    return false;
+  GenerateLegalMoves(pos, &list);
+  return list.count == 0;
+}
+
+static int DtzBeforeZeroing(TablebaseWdl wdl) {
+  switch (wdl) {
+  case TB_WIN:
+    return 1;
+  case TB_CURSED_WIN:
+    return 101;
+  case TB_BLESSED_LOSS:
+    return -101;
+  case TB_LOSS:
+    return -1;
+  default:
+    return 0;
+  }
+}
+
+static int Sign(int value) { return (value > 0) - (value < 0); }
+
+// Tables do not store en passant rights and may store "don't care" values
+// where a capture (or, for DTZ, a pawn move) is best, so those moves are
+// searched explicitly before trusting the table
+static TablebaseWdl SearchWdl(ChessPosition *pos, ProbeState *result,
+                              bool checkZeroingMoves) {
+  MoveList list;
+  GenerateLegalMoves(pos, &list);
+  TablebaseWdl bestValue = TB_LOSS;
+  TablebaseWdl value;
+  int moveCount = 0;
+
+  for (int i = 0; i < list.count; i++) {
+    Move move = list.moves[i];
+    if (!IsCapture(pos, move) &&
+        (!checkZeroingMoves ||
+         CODE_TYPE(pos->squares[MOVE_FROM(move)]) != PIECE_PAWN))
+      continue;
+
+    moveCount++;
+
+    MoveUndo undo;
+    MakeMove(pos, move, &undo);
+    value = (TablebaseWdl)-SearchWdl(pos, result, false);
+    UnmakeMove(pos, move, &undo);
+
+    if (*result == PROBE_FAIL)
+      return TB_DRAW;
+
+    if (value > bestValue) {
+      bestValue = value;
+      if (value >= TB_WIN) {
+        *result = PROBE_ZEROING_BEST_MOVE;
+        return value;
+      }
+    }
+  }
+
+  bool noMoreMoves = moveCount > 0 && moveCount == list.count;
+  if (noMoreMoves) {
+    value = bestValue;
+  } else {
+    value = (TablebaseWdl)ProbeTableForPosition(pos, false, TB_DRAW, result);
+    if (*result == PROBE_FAIL)
+      return TB_DRAW;
+  }
+
+  if (bestValue >= value) {
+    *result = (bestValue > TB_DRAW || noMoreMoves) ? PROBE_ZEROING_BEST_MOVE
+                                                   : PROBE_OK;
+    return bestValue;
+  }
+
+  *result = PROBE_OK;
+  return value;
+}
+
+static int SearchDtz(ChessPosition *pos, ProbeState *result) {
+  *result = PROBE_OK;
+  TablebaseWdl wdl = SearchWdl(pos, result, true);
+
+  if (*result == PROBE_FAIL || wdl == TB_DRAW)
+    return 0; // DTZ tables do not store draws
+
+  if (*result == PROBE_ZEROING_BEST_MOVE)
+    return DtzBeforeZeroing(wdl);
+
+  int dtz = ProbeTableForPosition(pos, true, wdl, result);
+  if (*result == PROBE_FAIL)
+    return 0;
+
+  if (*result != PROBE_CHANGE_STM) {
+    bool cursed = wdl == TB_BLESSED_LOSS || wdl == TB_CURSED_WIN;
+    return (dtz + (cursed ? 100 : 0)) * Sign(wdl);
+  }
+
+  // The table stores the other side to move: search one ply and take the
+  // best DTZ among the moves that keep our result
+  MoveList list;
+  GenerateLegalMoves(pos, &list);
+  int minDtz = 0xFFFF;
+
+  for (int i = 0; i < list.count; i++) {
+    Move move = list.moves[i];
+    bool zeroing = IsZeroing(pos, move);
+
+    MoveUndo undo;
+    MakeMove(pos, move, &undo);
+
+    // After a zeroing move the DTZ counts from before it
+    if (zeroing)
+      dtz = -DtzBeforeZeroing(SearchWdl(pos, result, false));
+    else
+      dtz = -SearchDtz(pos, result);
+
+    if (dtz == 1 && IsMated(pos))
+      minDtz = 1;
+
+    if (!zeroing)
+      dtz += Sign(dtz);
+
+    if (dtz < minDtz && Sign(dtz) == Sign(wdl))
+      minDtz = dtz;
+
+    UnmakeMove(pos, move, &undo);
+
+    if (*result == PROBE_FAIL)
+      return 0;
+  }
+
+  // No legal moves: we are mated
+  return minDtz == 0xFFFF ? -1 : minDtz;
+}
+
+//==============================================================================
+// PUBLIC INTERFACE
+//==============================================================================
+
+int InitTablebases(const char *paths) {
+  ShutdownTablebases();
+  InitEncodingTables();
+
+  if (paths == NULL || paths[0] == '\0')
+    return 0;
+
+  // Split the path list in place
+  size_t length = strlen(paths);
+  pathBuffer = malloc(length + 1);
+  directories = malloc((length / 2 + 1) * sizeof(char *));
+  if (pathBuffer == NULL || directories == NULL) {
+    ShutdownTablebases();
+    return 0;
+  }
+  memcpy(pathBuffer, paths, length + 1);
+
+  char *start = pathBuffer;
+  for (char *p = pathBuffer;; p++) {
+    if (*p == TB_PATH_SEPARATOR || *p == '\0') {
+      bool last = (*p == '\0');
+      *p = '\0';
+      if (*start != '\0')
+        directories[directoryCount++] = start;
+      if (last)
+        break;
+      start = p + 1;
+    }
+  }
+
+  RegisterTables();
+
+  if (entryCount == 0) {
+    ShutdownTablebases();
+    return 0;
+  }
+
+  // Each table is reachable from both color assignments of its material
+  size_t hashSize = 1;
+  while (hashSize < (size_t)entryCount * 4)
+    hashSize <<= 1;
+  entryHash = calloc(hashSize, sizeof(int));
+  if (entryHash == NULL) {
+    ShutdownTablebases();
+    return 0;
+  }
+  hashMask = hashSize - 1;
+
+  for (int i = 0; i < entryCount; i++) {
+    InsertEntry(entries[i].key, i);
+    InsertEntry(entries[i].key2, i);
+  }
+
+  return entryCount;
+}
+
+void ShutdownTablebases(void) {
+  WaitForPrefetch();
+
+  for (int i = 0; i < entryCount; i++) {
+    ReleaseTable(&entries[i].wdl);
+    ReleaseTable(&entries[i].dtz);
+  }
+
+  free(entries);
+  free(entryHash);
+  free(directories);
+  free(pathBuffer);
+  entries = NULL;
+  entryHash = NULL;
+  directories = NULL;
+  pathBuffer = NULL;
+  entryCount = entryCapacity = directoryCount = 0;
+  hashMask = 0;
+  maxPieces = 0;
+}
+
+int GetTablebaseMaxPieces(void) { return maxPieces; }
+
+int GetTablebaseCount(void) { return entryCount; }
+
+const char *GetTablebaseName(int table) { return entries[table].name; }
+
+void RandomTablebasePosition(int table, uint64_t *seed, ChessPosition *pos) {
+  static const PieceType TYPE_OF_CHAR[128] = {
+      ['K'] = PIECE_KING,   ['Q'] = PIECE_QUEEN,  ['R'] = PIECE_ROOK,
+      ['B'] = PIECE_BISHOP, ['N'] = PIECE_KNIGHT, ['P'] = PIECE_PAWN};
+  const char *name = entries[table].name;
+
+  for (;;) {
+    // Either side may hold the first half of the name
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint64_t bits = *seed >> 16;
+    PieceColor color = (bits & 1) ? COLOR_BLACK : COLOR_WHITE;
+    PieceColor other = OPPONENT_COLOR(color);
+
+    ClearPosition(pos);
+    pos->sideToMove = (bits & 2) ? COLOR_BLACK : COLOR_WHITE;
+    bool placed = true;
+    for (const char *c = name; *c != '\0' && placed; c++) {
+      if (*c == 'v') {
+        color = other;
+        continue;
+      }
+      PieceType type = TYPE_OF_CHAR[(unsigned char)*c];
+      placed = false;
+      for (int attempt = 0; attempt < 64 && !placed; attempt++) {
+        *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        int sq = (int)((*seed >> 33) & 63);
+        bool backRank = SQ_ROW(sq) == 0 || SQ_ROW(sq) == 7;
+        if (pos->squares[sq] == NO_PIECE &&
+            !(type == PIECE_PAWN && backRank)) {
+          PutPiece(pos, sq, PIECE_CODE(type, color));
+          placed = true;
+        }
+      }
+    }
+
+    // The side that just moved cannot be in check
+    if (placed &&
+        !IsKingInCheck(pos, OPPONENT_COLOR(pos->sideToMove))) {
+      pos->key = ComputePositionKey(pos);
+      return;
+    }
+  }
+}
+
+bool CanProbeTablebases(const ChessPosition *pos) {
+  return maxPieces > 0 && pos->castlingRights == 0 &&
+         CountPieces(pos) <= maxPieces;
+}
+
+void PrefetchTablebases(const ChessPosition *pos) {
+  if (entryCount == 0)
+    return;
+
+  uint64_t key = PositionMaterialKey(pos);
+  pthread_mutex_lock(&prefetchMutex);
+  prefetchKey = key;
+  prefetchPending = true;
+  bool queued = prefetchRunning;
+  if (!queued) {
+    if (prefetchStarted)
+      pthread_join(prefetchThread, NULL); // Finished, only to be reaped
+    prefetchStarted =
+        pthread_create(&prefetchThread, NULL, PrefetchMain, NULL) == 0;
+    prefetchRunning = queued = prefetchStarted;
+    prefetchPending = queued;
+  }
+  pthread_mutex_unlock(&prefetchMutex);
+
+  // Without a thread, map them here rather than never
+  if (!queued)
+    MapReachableTables(key);
+}
+
+bool AreTablebasesReady(const ChessPosition *pos) {
+  uint64_t key = PositionMaterialKey(pos);
+  for (int i = 0; i < entryCount; i++) {
+    if (IsEntryReachable(key, &entries[i]) &&
+        !atomic_load_explicit(&entries[i].wdl.ready, memory_order_acquire))
+      return false;
+  }
+  return true;
+}
+
+bool ProbeWdl(ChessPosition *pos, TablebaseWdl *wdl) {
+  if (!CanProbeTablebases(pos))
+    return false;
+
+  ProbeState result = PROBE_OK;
+  TablebaseWdl value = SearchWdl(pos, &result, false);
+  if (result == PROBE_FAIL)
+    return false;
+
+  *wdl = value;
+  return true;
+}
+
+bool ProbeDtz(ChessPosition *pos, int *dtz) {
+  if (!CanProbeTablebases(pos))
+    return false;
+
+  ProbeState result = PROBE_OK;
+  int value = SearchDtz(pos, &result);
+  if (result == PROBE_FAIL)
+    return false;
+
+  *dtz = value;
+  return true;
+}
+
+bool RankTablebaseRootMoves(ChessPosition *pos, const MoveList *moves,
+                            int *ranks) {
+  if (!CanProbeTablebases(pos))
+    return false;
+
+  int halfmoves = pos->halfmoveClock;
+
+  for (int i = 0; i < moves->count; i++) {
+    Move move = moves->moves[i];
+    ProbeState result = PROBE_OK;
+    int dtz;
+
+    MoveUndo undo;
+    MakeMove(pos, move, &undo);
+
+    if (pos->halfmoveClock == 0) {
+      // Zeroing moves are one of -101/-1/0/1/101
+      dtz = DtzBeforeZeroing((TablebaseWdl)-SearchWdl(pos, &result, false));
+    } else {
+      // Otherwise take the DTZ after the move, one ply further away
+      dtz = -SearchDtz(pos, &result);
+      dtz += Sign(dtz);
+    }
+
+    if (dtz == 2 && IsMated(pos))
+      dtz = 1;
+
+    UnmakeMove(pos, move, &undo);
+
+    if (result == PROBE_FAIL)
+      return false;
+
+    // Wins reachable before the fifty-move rule rank highest, fastest
+    // first; among losses prefer the longest resistance
+    if (dtz > 0)
+      ranks[i] = (dtz + halfmoves <= 99) ? 1000 - dtz
+                                         : 1000 - (dtz + halfmoves);
+    else if (dtz < 0)
+      ranks[i] = -1000 - dtz + halfmoves;
+    else
+      ranks[i] = 0;
+  }
+
+  return true;
+}
+
+Move ProbeTablebaseRootMove(ChessPosition *pos, TablebaseWdl *wdl) {
+  MoveList moves;
+  int ranks[MOVE_LIST_CAPACITY];
+
+  GenerateLegalMoves(pos, &moves);
+  if (moves.count == 0 || !RankTablebaseRootMoves(pos, &moves, ranks))
+    return MOVE_NONE;
+
+  int best = 0;
+  for (int i = 1; i < moves.count; i++) {
+    if (ranks[i] > ranks[best])
+      best = i;
+  }
+
+  if (wdl != NULL && !ProbeWdl(pos, wdl))
+    *wdl = TB_DRAW;
+
+  return moves.moves[best];
+}
@@ -0,0 +1,124 @@
+/**
+ * Chess Game - Endgame Tablebases
+ * Syzygy WDL/DTZ tablebase probing over memory-mapped files.
+ */
+
+#ifndef TBPROBE_H
+#define TBPROBE_H
+
+#include "movegen.h"
+
+//==============================================================================
+// TABLEBASE CONSTANTS
+//==============================================================================
+
+#define TB_DEFAULT_PATH "syzygy"
+#define TB_PATH_ENV "SYZYGY_PATH"
+#define TB_MAX_PIECES 7
+
+#ifdef _WIN32
+#define TB_PATH_SEPARATOR ';'
+#else
+#define TB_PATH_SEPARATOR ':'
+#endif
+
+// Win/draw/loss from the side to move's point of view. Cursed wins and
+// blessed losses are decided by the fifty-move rule.
+typedef enum {
+  TB_LOSS = -2,
+  TB_BLESSED_LOSS = -1,
+  TB_DRAW = 0,
+  TB_CURSED_WIN = 1,
+  TB_WIN = 2
+} TablebaseWdl;
+
+//==============================================================================
+// TABLEBASE FUNCTIONS
+//==============================================================================
+
+/**
+ * Register the tablebase files found in a list of directories separated by
+ * TB_PATH_SEPARATOR. Only file names are checked here: each table is mapped
+ * and parsed the first time a position needs it.
+ * @return Number of WDL tables found
+ */
+int InitTablebases(const char *paths);
+
+/**
+ * Unmap every table and forget the registered files.
+ */
+void ShutdownTablebases(void);
+
+/**
+ * Largest piece count (kings included) covered by the registered tables,
+ * or 0 if none were found.
+ */
+int GetTablebaseMaxPieces(void);
+
+/**
+ * Number of registered WDL tables.
+ */
+int GetTablebaseCount(void);
+
+/**
+ * Name of a registered table, e.g. "KRvKB".
+ */
+const char *GetTablebaseName(int table);
+
+/**
+ * Set up a random legal position with the material of a registered table,
+ * with either color holding the first half of the name.
+ * @param seed Random state, advanced by each call
+ */
+void RandomTablebasePosition(int table, uint64_t *seed, ChessPosition *pos);
+
+/**
+ * Map the WDL tables of a position's material and of every material it can
+ * reach in the background, so that probing it later does not stop to read
+ * table headers. Later requests replace pending ones.
+ */
+void PrefetchTablebases(const ChessPosition *pos);
+
+/**
+ * Check if the WDL tables a position can reach have all been mapped (or
+ * found unreadable), so probing it does not touch the disk.
+ */
+bool AreTablebasesReady(const ChessPosition *pos);
+
+/**
+ * Check if a position is small enough to probe and has no castling rights.
+ */
+bool CanProbeTablebases(const ChessPosition *pos);
+
+/**
+ * Probe the win/draw/loss value of a position. Safe to call from several
+ * threads at once, each with its own position.
+ * @return false if a needed table is missing or unreadable
+ */
+bool ProbeWdl(ChessPosition *pos, TablebaseWdl *wdl);
+
+/**
+ * Probe the distance in plies to the next capture or pawn move (zeroing the
+ * fifty-move counter) with best play. Positive when the side to move wins,
+ * negative when it loses, 0 for draws; +-101 and beyond are cursed/blessed.
+ * @return false if a needed table is missing or unreadable
+ */
+bool ProbeDtz(ChessPosition *pos, int *dtz);
+
+/**
+ * Rank the legal root moves by their tablebase outcome: positive for wins
+ * (higher is faster), 0 for draws, negative for losses (higher resists
+ * longer). Takes the position's halfmove clock into account.
+ * @return false if any probe failed
+ */
+bool RankTablebaseRootMoves(ChessPosition *pos, const MoveList *moves,
+                            int *ranks);
+
+/**
+ * Pick the best root move using DTZ, so that wins are converted without
+ * running into the fifty-move rule.
+ * @return MOVE_NONE if the position cannot be probed
+ */
+Move ProbeTablebaseRootMove(ChessPosition *pos, TablebaseWdl *wdl);
+
+#endif // TBPROBE_H
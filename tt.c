@@ -0,0 +1,161 @@
+/**
+ * Chess Game - Transposition Table
+ * Shared hash table of search results, safe for concurrent search threads.
+ */
+
+#include "tt.h"
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// GLOBAL STATE DEFINITIONS
+//==============================================================================
+
+TranspositionTable transpositionTable = {0};
+
+//==============================================================================
+// ENTRY PACKING
+//==============================================================================
+
+// data bits: move (0-15), score (16-31), eval (32-47), depth (48-55),
+// bound (56-57), generation (58-63)
+#define GENERATION_MASK 63
+
+static uint64_t PackEntry(Move move, int score, int eval, int depth,
+                          TTBound bound, uint8_t generation) {
+  return (uint64_t)move | ((uint64_t)(uint16_t)(int16_t)score << 16) |
+         ((uint64_t)(uint16_t)(int16_t)eval << 32) |
+         ((uint64_t)(uint8_t)depth << 48) | ((uint64_t)bound << 56) |
+         ((uint64_t)(generation & GENERATION_MASK) << 58);
+}
+
+static Move EntryMove(uint64_t data) { return (Move)(data & 0xFFFF); }
+static int EntryScore(uint64_t data) { return (int16_t)(data >> 16); }
+static int EntryEval(uint64_t data) { return (int16_t)(data >> 32); }
+static int EntryDepth(uint64_t data) { return (uint8_t)(data >> 48); }
+static TTBound EntryBound(uint64_t data) { return (TTBound)((data >> 56) & 3); }
+static int EntryGeneration(uint64_t data) { return (int)(data >> 58); }
+
+static TTCluster *ClusterFor(const TranspositionTable *table, uint64_t key) {
+#ifdef __SIZEOF_INT128__
+  // Multiply-shift maps the key onto any cluster count without a division
+  return &table->clusters[(size_t)(((unsigned __int128)key *
+                                    table->clusterCount) >>
+                                   64)];
+#else
+  return &table->clusters[(size_t)(key % table->clusterCount)];
+#endif
+}
+
+//==============================================================================
+// TABLE MANAGEMENT
+//==============================================================================
+
+bool ResizeTranspositionTable(TranspositionTable *table, size_t megabytes) {
+  FreeTranspositionTable(table);
+
+  size_t count = megabytes * 1024 * 1024 / sizeof(TTCluster);
+  table->clusters = calloc(count, sizeof(TTCluster));
+  if (table->clusters == NULL)
+    return false;
+
+  table->clusterCount = count;
+  table->generation = 0;
+  return true;
+}
+
+void FreeTranspositionTable(TranspositionTable *table) {
+  free(table->clusters);
+  table->clusters = NULL;
+  table->clusterCount = 0;
+}
+
+void ClearTranspositionTable(TranspositionTable *table) {
+  if (table->clusters != NULL)
+    memset(table->clusters, 0, table->clusterCount * sizeof(TTCluster));
+  table->generation = 0;
+}
+
+void AgeTranspositionTable(TranspositionTable *table) {
+  table->generation = (uint8_t)((table->generation + 1) & GENERATION_MASK);
+}
+
+//==============================================================================
+// PROBE AND STORE
+//==============================================================================
+
+bool ProbeTranspositionTable(const TranspositionTable *table, uint64_t key,
+                             TTData *data) {
+  if (table->clusters == NULL)
+    return false;
+
+  const TTCluster *cluster = ClusterFor(table, key);
+  for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
+    uint64_t stored = cluster->entries[i].data;
+    if ((cluster->entries[i].check ^ stored) != key || stored == 0)
+      continue;
+
+    data->move = EntryMove(stored);
+    data->score = EntryScore(stored);
+    data->eval = EntryEval(stored);
+    data->depth = EntryDepth(stored);
+    data->bound = EntryBound(stored);
+    return true;
+  }
+
+  return false;
+}
+
+void StoreTranspositionTable(TranspositionTable *table, uint64_t key,
+                             Move move, int score, int eval, int depth,
+                             TTBound bound) {
+  if (table->clusters == NULL)
+    return;
+
+  TTCluster *cluster = ClusterFor(table, key);
+  TTEntry *replace = &cluster->entries[0];
+  int worstValue = 1 << 30;
+
+  for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
+    TTEntry *entry = &cluster->entries[i];
+    uint64_t stored = entry->data;
+
+    // Same position: overwrite, keeping the old best move if we have none
+    if ((entry->check ^ stored) == key || stored == 0) {
+      if (move == MOVE_NONE && stored != 0)
+        move = EntryMove(stored);
+      replace = entry;
+      break;
+    }
+
+    // Otherwise evict the shallowest entry, preferring old generations
+    int age = (table->generation - EntryGeneration(stored)) & GENERATION_MASK;
+    int value = EntryDepth(stored) - 8 * age;
+    if (value < worstValue) {
+      worstValue = value;
+      replace = entry;
+    }
+  }
+
+  if (depth < 0)
+    depth = 0;
+  uint64_t data = PackEntry(move, score, eval, depth, bound, table->generation);
+  replace->data = data;
+  replace->check = key ^ data;
+}
+
+int TranspositionTableUsage(const TranspositionTable *table) {
+  if (table->clusterCount == 0)
+    return 0;
+
+  size_t samples = table->clusterCount < 1000 ? table->clusterCount : 1000;
+  int used = 0;
+  for (size_t c = 0; c < samples; c++) {
+    for (int i = 0; i < TT_CLUSTER_SIZE; i++) {
+      uint64_t stored = table->clusters[c].entries[i].data;
+      if (stored != 0 && EntryGeneration(stored) == table->generation)
+        used++;
+    }
+  }
+  return (int)(used * 1000 / (samples * TT_CLUSTER_SIZE));
+}
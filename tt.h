@@ -0,0 +1,108 @@
+/**
+ * Chess Game - Transposition Table
+ * Shared hash table of search results, safe for concurrent search threads.
+ */
+
+#ifndef TT_H
+#define TT_H
+
+#include "position.h"
+#include <stddef.h>
+
+//==============================================================================
+// TRANSPOSITION TABLE CONSTANTS
+//==============================================================================
+
+#define TT_DEFAULT_MB 16
+#define TT_MIN_MB 1
+#define TT_MAX_MB 4096
+#define TT_CLUSTER_SIZE 4 // Entries sharing one 64-byte cache line
+
+typedef enum {
+  TT_BOUND_NONE = 0,
+  TT_BOUND_UPPER = 1, // Fail-low: score is at most the stored value
+  TT_BOUND_LOWER = 2, // Fail-high: score is at least the stored value
+  TT_BOUND_EXACT = 3
+} TTBound;
+
+//==============================================================================
+// TRANSPOSITION TABLE TYPES
+//==============================================================================
+
+// Each entry stores key ^ data next to data, so a torn write from another
+// thread fails the key check instead of returning mixed-up fields
+typedef struct {
+  uint64_t check;
+  uint64_t data;
+} TTEntry;
+
+typedef struct {
+  TTEntry entries[TT_CLUSTER_SIZE];
+} TTCluster;
+
+typedef struct {
+  TTCluster *clusters;
+  size_t clusterCount;
+  uint8_t generation; // Bumped per search so old entries are replaced first
+} TranspositionTable;
+
+// Unpacked entry contents
+typedef struct {
+  Move move;
+  int score;
+  int eval;
+  int depth;
+  TTBound bound;
+} TTData;
+
+//==============================================================================
+// GLOBAL TABLE (defined in tt.c)
+//==============================================================================
+
+extern TranspositionTable transpositionTable;
+
+//==============================================================================
+// TRANSPOSITION TABLE FUNCTIONS
+//==============================================================================
+
+/**
+ * Allocate a table of the given size in megabytes, discarding old contents.
+ * @return false if the allocation failed (the table is left empty)
+ */
+bool ResizeTranspositionTable(TranspositionTable *table, size_t megabytes);
+
+/**
+ * Free the table's memory.
+ */
+void FreeTranspositionTable(TranspositionTable *table);
+
+/**
+ * Forget every stored position.
+ */
+void ClearTranspositionTable(TranspositionTable *table);
+
+/**
+ * Start a new search generation; call once before each search.
+ */
+void AgeTranspositionTable(TranspositionTable *table);
+
+/**
+ * Look up a position.
+ * @return false if the position is not stored
+ */
+bool ProbeTranspositionTable(const TranspositionTable *table, uint64_t key,
+                             TTData *data);
+
+/**
+ * Store a search result, replacing the least useful entry of its cluster.
+ */
+void StoreTranspositionTable(TranspositionTable *table, uint64_t key,
+                             Move move, int score, int eval, int depth,
+                             TTBound bound);
+
+/**
+ * Approximate fill rate in permille, sampled from the start of the table.
+ */
+int TranspositionTableUsage(const TranspositionTable *table);
+
+#endif // TT_H
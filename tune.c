@@ -0,0 +1,461 @@
+/**
+ * Chess Game - Evaluation Tuner
+ * Texel-style tuning of the material and piece-square tables on labeled
+ * positions.
+ *
+ * The evaluation is linear in its parameters: every piece adds its value and
+ * square bonus for both phases, blended by the game phase exactly as
+ * Evaluate does. So each position is reduced once to its phase, result and
+ * a list of (parameter, sign) entries, and the tuner never touches a board
+ * again. The loss is the mean squared difference between the result and
+ * sigmoid(K * eval); it and its gradient are summed over chunks of the
+ * position array on worker threads, and Adam takes the steps.
+ */
+
+#include "tune.h"
+#include "mapfile.h"
+#include "movegen.h"
+#include "search.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// TUNER PARAMETERS
+//==============================================================================
+
+// Per phase and piece type: 64 square bonuses, then the material value
+#define TUNE_TYPE_PARAMS (SQUARE_COUNT + 1)
+#define TUNE_VALUE_OFFSET SQUARE_COUNT
+#define TUNE_STAGE_PARAMS (7 * TUNE_TYPE_PARAMS)
+#define TUNE_PARAM_COUNT (2 * TUNE_STAGE_PARAMS)
+
+#define TUNE_MAX_PIECES 32
+#define TUNE_BLACK_PIECE 0x8000 // Set in a piece entry that counts negative
+#define TUNE_LINE_LENGTH 256
+#define TUNE_LOG_INTERVAL 10
+
+#define TUNE_K_MIN 0.1
+#define TUNE_K_MAX 4.0
+#define TUNE_K_STEPS 40
+
+#define ADAM_BETA1 0.9
+#define ADAM_BETA2 0.999
+#define ADAM_EPSILON 1e-8
+
+//==============================================================================
+// TUNER TYPES
+//==============================================================================
+
+// One position, reduced to what the linear evaluation needs
+typedef struct {
+  uint8_t result; // White's score: 0 loss, 1 draw, 2 win
+  uint8_t phase;  // GamePhase, 0 to PHASE_TOTAL
+  uint8_t pieceCount;
+  uint8_t padding;
+  uint16_t pieces[TUNE_MAX_PIECES]; // Parameter index within a phase
+} TunePosition;
+
+typedef struct {
+  TunePosition *positions;
+  int count;
+  int capacity;
+} TuneData;
+
+// One worker's share of a pass over the data
+typedef struct {
+  const TuneData *data;
+  const double *params;
+  double k;
+  bool wantGradient;
+  int begin;
+  int end;
+  double loss;
+  double gradient[TUNE_PARAM_COUNT];
+  pthread_t thread;
+} TuneChunk;
+
+//==============================================================================
+// OPTIONS
+//==============================================================================
+
+void InitTuneOptions(TuneOptions *options) {
+  memset(options, 0, sizeof(*options));
+  options->outputPath = TUNE_DEFAULT_OUTPUT;
+  options->iterations = TUNE_DEFAULT_ITERATIONS;
+  options->workers = 1;
+  options->rate = TUNE_DEFAULT_RATE;
+  options->log = stdout;
+}
+
+//==============================================================================
+// LOADING
+//==============================================================================
+
+// 0, 1 or 2 for a loss, draw or win by white; -1 if the line has no result
+static int ParseResult(const char *line) {
+  if (strstr(line, "1/2-1/2") != NULL || strstr(line, "[0.5]") != NULL)
+    return 1;
+  if (strstr(line, "1-0") != NULL || strstr(line, "[1.0]") != NULL)
+    return 2;
+  if (strstr(line, "0-1") != NULL || strstr(line, "[0.0]") != NULL)
+    return 0;
+  return -1;
+}
+
+static bool PackPosition(const ChessPosition *pos, int result,
+                         TunePosition *packed) {
+  memset(packed, 0, sizeof(*packed));
+  packed->result = (uint8_t)result;
+  packed->phase = (uint8_t)GamePhase(pos);
+
+  for (int sq = 0; sq < SQUARE_COUNT; sq++) {
+    PieceCode code = pos->squares[sq];
+    if (code == NO_PIECE)
+      continue;
+    if (packed->pieceCount == TUNE_MAX_PIECES)
+      return false;
+
+    bool white = CODE_COLOR(code) == COLOR_WHITE;
+    int tableSq = white ? sq : sq ^ 56; // Mirror ranks for black, as Evaluate
+    int index = CODE_TYPE(code) * TUNE_TYPE_PARAMS + tableSq;
+    packed->pieces[packed->pieceCount++] =
+        (uint16_t)(index | (white ? 0 : TUNE_BLACK_PIECE));
+  }
+  return true;
+}
+
+static bool AddPosition(TuneData *data, const TunePosition *packed) {
+  if (data->count == data->capacity) {
+    int capacity = data->capacity > 0 ? data->capacity * 2 : 65536;
+    TunePosition *grown =
+        realloc(data->positions, (size_t)capacity * sizeof(TunePosition));
+    if (grown == NULL)
+      return false;
+    data->positions = grown;
+    data->capacity = capacity;
+  }
+  data->positions[data->count++] = *packed;
+  return true;
+}
+
+// One pass over the mapped file; only the packed records stay in memory
+static bool LoadTuneData(const char *path, TuneData *data, int *skipped) {
+  MappedFile file;
+  if (!MapFile(&file, path, MAP_ACCESS_SEQUENTIAL))
+    return false;
+
+  const char *cursor = (const char *)file.data;
+  const char *end = cursor + file.size;
+  bool ok = true;
+  *skipped = 0;
+
+  while (cursor < end && ok) {
+    const char *newline = memchr(cursor, '\n', (size_t)(end - cursor));
+    const char *lineEnd = newline != NULL ? newline : end;
+    size_t length = (size_t)(lineEnd - cursor);
+
+    char line[TUNE_LINE_LENGTH];
+    ChessPosition pos;
+    TunePosition packed;
+    int result = -1;
+    if (length < sizeof(line)) {
+      memcpy(line, cursor, length);
+      line[length] = '\0';
+      result = ParseResult(line);
+    }
+
+    // Quiet positions only: a side in check is about to change material
+    if (result >= 0 && SetPositionFromFen(&pos, line) &&
+        !IsKingInCheck(&pos, pos.sideToMove) &&
+        PackPosition(&pos, result, &packed)) {
+      ok = AddPosition(data, &packed);
+    } else if (length > 0) {
+      (*skipped)++;
+    }
+    cursor = lineEnd + 1;
+  }
+
+  UnmapFile(&file);
+  return ok && data->count > 0;
+}
+
+//==============================================================================
+// LOSS AND GRADIENT
+//==============================================================================
+
+static double Sigmoid(double k, double eval) {
+  return 1.0 / (1.0 + pow(10.0, -k * eval / 400.0));
+}
+
+static void *TuneChunkMain(void *arg) {
+  TuneChunk *chunk = arg;
+  const double *params = chunk->params;
+  chunk->loss = 0.0;
+  if (chunk->wantGradient)
+    memset(chunk->gradient, 0, sizeof(chunk->gradient));
+
+  for (int i = chunk->begin; i < chunk->end; i++) {
+    const TunePosition *pos = &chunk->data->positions[i];
+    double midgame = (double)pos->phase / PHASE_TOTAL;
+    double endgame = 1.0 - midgame;
+
+    // White's evaluation, as Evaluate computes it before rounding
+    double eval = 0.0;
+    for (int j = 0; j < pos->pieceCount; j++) {
+      int index = pos->pieces[j] & ~TUNE_BLACK_PIECE;
+      int valueIndex = index - index % TUNE_TYPE_PARAMS + TUNE_VALUE_OFFSET;
+      double sign = (pos->pieces[j] & TUNE_BLACK_PIECE) ? -1.0 : 1.0;
+      eval += sign * (midgame * (params[index] + params[valueIndex]) +
+                      endgame * (params[TUNE_STAGE_PARAMS + index] +
+                                 params[TUNE_STAGE_PARAMS + valueIndex]));
+    }
+
+    double target = pos->result / 2.0;
+    double predicted = Sigmoid(chunk->k, eval);
+    double error = target - predicted;
+    chunk->loss += error * error;
+    if (!chunk->wantGradient)
+      continue;
+
+    // d(error^2)/d(eval), then spread over the parameters each piece uses
+    double slope = -2.0 * error * predicted * (1.0 - predicted) * chunk->k *
+                   log(10.0) / 400.0;
+    for (int j = 0; j < pos->pieceCount; j++) {
+      int index = pos->pieces[j] & ~TUNE_BLACK_PIECE;
+      int valueIndex = index - index % TUNE_TYPE_PARAMS + TUNE_VALUE_OFFSET;
+      double sign = (pos->pieces[j] & TUNE_BLACK_PIECE) ? -1.0 : 1.0;
+      chunk->gradient[index] += slope * sign * midgame;
+      chunk->gradient[valueIndex] += slope * sign * midgame;
+      chunk->gradient[TUNE_STAGE_PARAMS + index] += slope * sign * endgame;
+      chunk->gradient[TUNE_STAGE_PARAMS + valueIndex] += slope * sign * endgame;
+    }
+  }
+  return NULL;
+}
+
+// Mean loss over the data, and its gradient if one is given; chunks are
+// fixed by the worker count, so results do not depend on thread timing
+static double ComputeLoss(const TuneData *data, TuneChunk *chunks,
+                          int workers, const double *params, double k,
+                          double *gradient) {
+  for (int i = 0; i < workers; i++) {
+    TuneChunk *chunk = &chunks[i];
+    chunk->data = data;
+    chunk->params = params;
+    chunk->k = k;
+    chunk->wantGradient = gradient != NULL;
+    chunk->begin = (int)((int64_t)data->count * i / workers);
+    chunk->end = (int)((int64_t)data->count * (i + 1) / workers);
+  }
+
+  // The calling thread takes the first chunk itself
+  int started = 1;
+  for (int i = 1; i < workers; i++) {
+    if (pthread_create(&chunks[i].thread, NULL, TuneChunkMain, &chunks[i]) !=
+        0)
+      break;
+    started++;
+  }
+  TuneChunkMain(&chunks[0]);
+  for (int i = started; i < workers; i++)
+    TuneChunkMain(&chunks[i]);
+  for (int i = 1; i < started; i++)
+    pthread_join(chunks[i].thread, NULL);
+
+  double loss = 0.0;
+  if (gradient != NULL)
+    memset(gradient, 0, sizeof(double) * TUNE_PARAM_COUNT);
+  for (int i = 0; i < workers; i++) {
+    loss += chunks[i].loss;
+    if (gradient == NULL)
+      continue;
+    for (int p = 0; p < TUNE_PARAM_COUNT; p++)
+      gradient[p] += chunks[i].gradient[p] / data->count;
+  }
+  return loss / data->count;
+}
+
+// K turns centipawns into expected score; pick the one that best explains
+// the results with the current tables (the loss is unimodal in K)
+static double FitK(const TuneData *data, TuneChunk *chunks, int workers,
+                   const double *params) {
+  double low = TUNE_K_MIN;
+  double high = TUNE_K_MAX;
+  for (int step = 0; step < TUNE_K_STEPS; step++) {
+    double a = low + (high - low) / 3.0;
+    double b = high - (high - low) / 3.0;
+    if (ComputeLoss(data, chunks, workers, params, a, NULL) <
+        ComputeLoss(data, chunks, workers, params, b, NULL))
+      high = b;
+    else
+      low = a;
+  }
+  return (low + high) / 2.0;
+}
+
+//==============================================================================
+// PARAMETERS
+//==============================================================================
+
+static void LoadParams(double *params) {
+  for (int stage = EVAL_MIDGAME; stage <= EVAL_ENDGAME; stage++) {
+    for (int type = 0; type < 7; type++) {
+      double *typeParams =
+          params + stage * TUNE_STAGE_PARAMS + type * TUNE_TYPE_PARAMS;
+      for (int sq = 0; sq < SQUARE_COUNT; sq++)
+        typeParams[sq] = PIECE_SQUARE_TABLES[stage][type][sq];
+      typeParams[TUNE_VALUE_OFFSET] = PIECE_VALUES[stage][type];
+    }
+  }
+}
+
+static void RoundParams(const double *params, int values[2][7],
+                        int tables[2][7][SQUARE_COUNT]) {
+  for (int stage = EVAL_MIDGAME; stage <= EVAL_ENDGAME; stage++) {
+    for (int type = 0; type < 7; type++) {
+      const double *typeParams =
+          params + stage * TUNE_STAGE_PARAMS + type * TUNE_TYPE_PARAMS;
+      for (int sq = 0; sq < SQUARE_COUNT; sq++)
+        tables[stage][type][sq] = (int)lround(typeParams[sq]);
+      values[stage][type] = (int)lround(typeParams[TUNE_VALUE_OFFSET]);
+    }
+  }
+}
+
+//==============================================================================
+// OUTPUT
+//==============================================================================
+
+static const char *TYPE_NAMES[7] = {"None",   "King", "Queen", "Bishop",
+                                    "Knight", "Rook", "Pawn"};
+
+bool WriteEvalTables(const char *path, const int values[2][7],
+                     const int tables[2][7][SQUARE_COUNT]) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL)
+    return false;
+
+  fprintf(file, "/**\n"
+                " * Chess Game - Evaluation Tables\n"
+                " * Material values and piece-square tables used by eval.c.\n"
+                " *\n"
+                " * Generated by the tuner (\"chess-uci tune\", see tune.c). "
+                "Hand edits are\n"
+                " * fine as a starting point for the next tuning run.\n"
+                " */\n\n"
+                "#include \"eval.h\"\n\n");
+
+  fprintf(file, "const int PIECE_VALUES[2][7] = {\n"
+                "    // None, King, Queen, Bishop, Knight, Rook, Pawn\n");
+  for (int stage = EVAL_MIDGAME; stage <= EVAL_ENDGAME; stage++) {
+    fprintf(file, "    {");
+    for (int type = 0; type < 7; type++)
+      fprintf(file, "%s%d", type > 0 ? ", " : "", values[stage][type]);
+    fprintf(file, "},\n");
+  }
+  fprintf(file, "};\n\n");
+
+  fprintf(file, "// Indexed [phase][PieceType][square] from white's side: "
+                "a8 first, h1 last\n"
+                "// clang-format off\n"
+                "const int PIECE_SQUARE_TABLES[2][7][SQUARE_COUNT] = {\n");
+  for (int stage = EVAL_MIDGAME; stage <= EVAL_ENDGAME; stage++) {
+    fprintf(file, "  { // %s\n",
+            stage == EVAL_MIDGAME ? "Middlegame" : "Endgame");
+    fprintf(file, "    {0}, // %s\n", TYPE_NAMES[0]);
+    for (int type = 1; type < 7; type++) {
+      fprintf(file, "    { // %s\n", TYPE_NAMES[type]);
+      for (int row = 0; row < 8; row++) {
+        fprintf(file, "     ");
+        for (int col = 0; col < 8; col++)
+          fprintf(file, " %4d,", tables[stage][type][row * 8 + col]);
+        fprintf(file, "\n");
+      }
+      fprintf(file, "    },\n");
+    }
+    fprintf(file, "  },\n");
+  }
+  fprintf(file, "};\n// clang-format on\n");
+
+  return fclose(file) == 0;
+}
+
+//==============================================================================
+// TUNER INTERFACE
+//==============================================================================
+
+bool RunTuner(const TuneOptions *options, TuneSummary *summary) {
+  memset(summary, 0, sizeof(*summary));
+  int64_t start = GetTimeMilliseconds();
+
+  TuneData data = {0};
+  if (!LoadTuneData(options->dataPath, &data, &summary->skipped)) {
+    free(data.positions);
+    return false;
+  }
+  summary->positions = data.count;
+
+  int workers = options->workers;
+  if (workers < 1)
+    workers = 1;
+  if (workers > SEARCH_MAX_THREADS)
+    workers = SEARCH_MAX_THREADS;
+
+  // Parameters, gradient and the two Adam moments share one block
+  TuneChunk *chunks = calloc((size_t)workers, sizeof(TuneChunk));
+  double *params = calloc(4 * TUNE_PARAM_COUNT, sizeof(double));
+  if (chunks == NULL || params == NULL) {
+    free(chunks);
+    free(params);
+    free(data.positions);
+    return false;
+  }
+  double *gradient = params + TUNE_PARAM_COUNT;
+  double *moment1 = gradient + TUNE_PARAM_COUNT;
+  double *moment2 = moment1 + TUNE_PARAM_COUNT;
+
+  LoadParams(params);
+  summary->k = options->k > 0.0 ? options->k
+                                 : FitK(&data, chunks, workers, params);
+  summary->startLoss =
+      ComputeLoss(&data, chunks, workers, params, summary->k, NULL);
+  fprintf(options->log, "Positions %d (%d skipped), K %.4f, loss %.6f\n",
+          data.count, summary->skipped, summary->k, summary->startLoss);
+  fflush(options->log);
+
+  double loss = summary->startLoss;
+  for (int iteration = 1; iteration <= options->iterations; iteration++) {
+    loss = ComputeLoss(&data, chunks, workers, params, summary->k, gradient);
+
+    double correction1 = 1.0 - pow(ADAM_BETA1, iteration);
+    double correction2 = 1.0 - pow(ADAM_BETA2, iteration);
+    for (int p = 0; p < TUNE_PARAM_COUNT; p++) {
+      moment1[p] = ADAM_BETA1 * moment1[p] + (1.0 - ADAM_BETA1) * gradient[p];
+      moment2[p] = ADAM_BETA2 * moment2[p] +
+                   (1.0 - ADAM_BETA2) * gradient[p] * gradient[p];
+      double step = moment1[p] / correction1 /
+                    (sqrt(moment2[p] / correction2) + ADAM_EPSILON);
+      params[p] -= options->rate * step;
+    }
+
+    if (iteration % TUNE_LOG_INTERVAL == 0 ||
+        iteration == options->iterations) {
+      fprintf(options->log, "Iteration %d: loss %.6f\n", iteration, loss);
+      fflush(options->log);
+    }
+  }
+  summary->finalLoss =
+      ComputeLoss(&data, chunks, workers, params, summary->k, NULL);
+
+  int values[2][7];
+  int tables[2][7][SQUARE_COUNT];
+  RoundParams(params, values, tables);
+  bool written = WriteEvalTables(options->outputPath, values, tables);
+
+  free(chunks);
+  free(params);
+  free(data.positions);
+  summary->timeMs = GetTimeMilliseconds() - start;
+  return written;
+}
@@ -0,0 +1,71 @@
+/**
+ * Chess Game - Evaluation Tuner
+ * Texel-style tuning of the material and piece-square tables on labeled
+ * positions.
+ */
+
+#ifndef TUNE_H
+#define TUNE_H
+
+#include "eval.h"
+#include <stdio.h>
+
+//==============================================================================
+// TUNER CONSTANTS
+//==============================================================================
+
+#define TUNE_DEFAULT_ITERATIONS 500
+#define TUNE_DEFAULT_RATE 1.0 // Adam step size in centipawns
+#define TUNE_DEFAULT_OUTPUT "evaltables.c"
+
+//==============================================================================
+// TUNER TYPES
+//==============================================================================
+
+typedef struct {
+  const char *dataPath;   // FEN/EPD lines, each with a game result
+  const char *outputPath; // Generated C source for the tables
+  int iterations;
+  int workers;
+  double k;    // Sigmoid scale; 0 to fit it to the data first
+  double rate; // Adam step size
+  FILE *log;   // Receives progress lines
+} TuneOptions;
+
+typedef struct {
+  int positions;
+  int skipped; // Lines without a position, a result, or in check
+  double k;
+  double startLoss;
+  double finalLoss;
+  int64_t timeMs;
+} TuneSummary;
+
+//==============================================================================
+// TUNER FUNCTIONS
+//==============================================================================
+
+/**
+ * Set the defaults: TUNE_DEFAULT_ITERATIONS steps at TUNE_DEFAULT_RATE,
+ * one worker, K fitted, output to TUNE_DEFAULT_OUTPUT.
+ */
+void InitTuneOptions(TuneOptions *options);
+
+/**
+ * Tune the tables on a data file and write them as C source. The file is
+ * memory-mapped and packed into one array of small fixed-size records; the
+ * result of each line is read from "1-0", "0-1", "1/2-1/2" (as in an EPD
+ * c9 operation) or "[1.0]", "[0.5]", "[0.0]".
+ * @return false if the data could not be read or the output written
+ */
+bool RunTuner(const TuneOptions *options, TuneSummary *summary);
+
+/**
+ * Write material values and piece-square tables in the layout of
+ * evaltables.c, ready to compile into the engine.
+ * @return false if the file could not be written
+ */
+bool WriteEvalTables(const char *path, const int values[2][7],
+                     const int tables[2][7][SQUARE_COUNT]);
+
+#endif // TUNE_H
@@ -6,7 +6,11 @@
 #ifndef TYPES_H
 #define TYPES_H
 
+// Headless builds (the UCI engine) compile the rules and engine modules
+// without raylib; only the drawing-related declarations depend on it
+#ifndef CHESS_HEADLESS
 #include "raylib.h"
+#endif
 #include <stdbool.h>
 
 //==============================================================================
@@ -26,8 +30,11 @@
 // MOVE HISTORY CONSTANTS
 //==============================================================================
 
-#define MAX_MOVES 256
+#define HISTORY_CHUNK_MOVES 64 // Records per history arena chunk
+#define HISTORY_KEYFRAME_PLIES 16 // Plies between stored positions for seeking
 #define MOVE_NOTATION_LEN 12
+#define PGN_ARCHIVE_PATH "games.pgn" // Every finished game is appended here
+#define PGN_EXPORT_PATH "game.pgn"   // The current game, on request
 
 //==============================================================================
 // SPRITE CONFIGURATION
@@ -53,6 +60,16 @@
 #define MENU_BUTTON_HEIGHT 50
 #define MENU_BUTTON_Y_START 380
 #define MENU_BUTTON_Y_SPACING 70
+#define ANALYSIS_ROW_HEIGHT 18
+#define ANALYSIS_SCORE_WIDTH 52
+#define EXPLORER_ROWS 5 // Most played moves listed by the opening explorer
+#define HINT_ARROW_WIDTH 10.0f
+#define HINT_ARROW_HEAD 28.0f
+#define HINT_THREAT_WIDTH 3.0f
+#define EVAL_BAR_WIDTH 16
+#define EVAL_BAR_GAP 8
+#define EVAL_BAR_SCALE 0.004f // Logistic slope per centipawn
+#define EVAL_BAR_EASING 0.15f // Fraction of the distance covered per frame
 
 // Clock display constants
 #define CLOCK_PANEL_WIDTH 200
@@ -64,12 +81,18 @@
 // COLOR PALETTE (defined in constants.c)
 //==============================================================================
 
+#ifndef CHESS_HEADLESS
 extern const Color COLOR_LIGHT_SQUARE;
 extern const Color COLOR_DARK_SQUARE;
 extern const Color COLOR_SELECTED;
 extern const Color COLOR_CHECK_HIGHLIGHT;
 extern const Color COLOR_VALID_MOVE;
 extern const Color COLOR_CAPTURE;
+extern const Color COLOR_HINT_ARROW;
+extern const Color COLOR_THREAT;
+extern const Color COLOR_REVIEW_MOVE;
+extern const Color COLOR_EVAL_WHITE;
+extern const Color COLOR_EVAL_BLACK;
 extern const Color COLOR_BACKGROUND;
 extern const Color COLOR_OVERLAY_DARK;
 extern const Color COLOR_OVERLAY_DARKER;
@@ -78,6 +101,7 @@ extern const Color COLOR_BUTTON_BG;
 extern const Color COLOR_BUTTON_HOVER;
 extern const Color COLOR_TITLE_GOLD;
 extern const Color COLOR_TITLE_SHADOW;
+#endif
 
 //==============================================================================
 // PIECE TYPES AND ENUMS
@@ -112,7 +136,8 @@ typedef enum {
   GAME_CHECKMATE,
   GAME_STALEMATE,
   GAME_TIMEOUT,
-  GAME_PROMOTING
+  GAME_PROMOTING,
+  GAME_ADJUDICATED // Result decided by the endgame tablebases
 } GameState;
 
 typedef enum {
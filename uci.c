@@ -0,0 +1,1471 @@
+/**
+ * Chess Game - UCI Engine
+ * Headless entry point speaking the Universal Chess Interface on stdin and
+ * stdout, for engine matches, testing and benchmarking without a display.
+ */
+
+#include "batch.h"
+#include "bookbuild.h"
+#include "eval.h"
+#include "explorer.h"
+#include "ingest.h"
+#include "mapfile.h"
+#include "mate.h"
+#include "movegen.h"
+#include "search.h"
+#include "selfplay.h"
+#include "tbprobe.h"
+#include "tt.h"
+#include "tune.h"
+#include <ctype.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//==============================================================================
+// ENGINE CONSTANTS
+//==============================================================================
+
+#define ENGINE_NAME "C-hess"
+#define ENGINE_AUTHOR "C-hess developers"
+#define UCI_LINE_LENGTH 16384
+#define BENCH_DEFAULT_DEPTH 10
+#define IMPORT_REPORTED_ERRORS 10 // Invalid games listed one by one
+#define FIND_DEFAULT_GAMES 10
+#define FIND_MAX_NEXT_MOVES (MOVE_LIST_CAPACITY + 1) // Game ends count too
+
+// Positions searched by "bench"; the node total is a quick functional check
+static const char *BENCH_POSITIONS[] = {
+    STARTING_FEN,
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "rnbqkb1r/pp3ppp/4pn2/2pp4/3P4/2PBPN2/PP3PPP/RNBQK2R b KQkq - 0 5",
+    "2r3k1/pp3ppp/2n1b3/3p4/3P4/2N1B3/PP3PPP/2R3K1 w - - 0 20",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+    "4k3/8/8/8/8/8/4P3/4K3 w - - 0 1",
+};
+
+//==============================================================================
+// ENGINE STATE
+//==============================================================================
+
+typedef struct {
+  ChessPosition position;
+  uint64_t history[SEARCH_HISTORY_KEYS]; // Keys before the current position
+  int historyCount;
+  Searcher searcher;
+  int threadCount;
+  int multiPv;
+  MateSolver mateSolver; // Allocated on the first mate search
+
+  // go mate runs on its own thread, like the alpha-beta search
+  pthread_t mateThread;
+  bool mateThreadActive;
+  atomic_bool mateStop;
+  ChessPosition mateRoot;
+  int mateMoves;
+  uint64_t mateNodes;
+  int64_t mateTime;
+} UciEngine;
+
+static UciEngine engine;
+
+//==============================================================================
+// OUTPUT
+//==============================================================================
+
+static void PrintReport(const SearchReport *report, void *userData) {
+  (void)userData;
+  char move[UCI_MOVE_LENGTH];
+  int64_t elapsed = report->timeMs > 0 ? report->timeMs : 1;
+  uint64_t nps = report->nodes * 1000 / (uint64_t)elapsed;
+
+  for (int i = 0; i < report->lineCount; i++) {
+    const SearchLine *line = &report->lines[i];
+
+    printf("info depth %d seldepth %d multipv %d score ", report->depth,
+           report->selDepth, i + 1);
+    if (IsMateScore(line->score))
+      printf("mate %d", MateInMoves(line->score));
+    else
+      printf("cp %d", line->score);
+    printf(" nodes %llu nps %llu time %lld hashfull %d tbhits %llu pv",
+           (unsigned long long)report->nodes, (unsigned long long)nps,
+           (long long)report->timeMs, report->hashfull,
+           (unsigned long long)report->tbHits);
+    for (int j = 0; j < line->pvLength; j++) {
+      FormatUciMove(line->pv[j], move);
+      printf(" %s", move);
+    }
+    printf("\n");
+  }
+  fflush(stdout);
+}
+
+static void PrintBestMove(const SearchReport *result, void *userData) {
+  (void)userData;
+  char move[UCI_MOVE_LENGTH];
+  const SearchLine *best = &result->lines[0];
+  FormatUciMove(result->lineCount > 0 ? best->pv[0] : MOVE_NONE, move);
+  printf("bestmove %s", move);
+  if (result->lineCount > 0 && best->pvLength > 1) {
+    FormatUciMove(best->pv[1], move);
+    printf(" ponder %s", move);
+  }
+  printf("\n");
+  fflush(stdout);
+}
+
+//==============================================================================
+// PARSING HELPERS
+//==============================================================================
+
+// Split off the next space-separated word, returning NULL at the end
+static char *NextToken(char **cursor) {
+  char *s = *cursor;
+  while (*s != '\0' && isspace((unsigned char)*s))
+    s++;
+  if (*s == '\0') {
+    *cursor = s;
+    return NULL;
+  }
+  char *start = s;
+  while (*s != '\0' && !isspace((unsigned char)*s))
+    s++;
+  if (*s != '\0')
+    *s++ = '\0';
+  *cursor = s;
+  return start;
+}
+
+static int64_t ParseNumber(char **cursor) {
+  char *token = NextToken(cursor);
+  return token != NULL ? strtoll(token, NULL, 10) : 0;
+}
+
+//==============================================================================
+// MATE SEARCH
+//==============================================================================
+
+static bool EnsureMateSolver(void) {
+  if (engine.mateSolver.entries != NULL)
+    return true;
+  if (InitMateSolver(&engine.mateSolver, MATE_DEFAULT_MB)) {
+    engine.mateSolver.stop = &engine.mateStop;
+    return true;
+  }
+  printf("info string Could not allocate the mate solver table\n");
+  fflush(stdout);
+  return false;
+}
+
+static void *MateThreadMain(void *arg) {
+  (void)arg;
+  MateResult result;
+  char move[UCI_MOVE_LENGTH];
+
+  FindMate(&engine.mateSolver, &engine.mateRoot, engine.mateMoves,
+           engine.mateNodes, engine.mateTime, &result);
+  if (result.mateIn > 0) {
+    printf("info depth %d score mate %d nodes %llu time %lld pv",
+           2 * result.mateIn - 1, result.mateIn,
+           (unsigned long long)result.nodes, (long long)result.timeMs);
+    for (int i = 0; i < result.pvLength; i++) {
+      FormatUciMove(result.pv[i], move);
+      printf(" %s", move);
+    }
+    printf("\n");
+  } else {
+    printf("info string No mate in %d%s, %llu nodes\n", engine.mateMoves,
+           result.complete ? "" : " found before the limit",
+           (unsigned long long)result.nodes);
+  }
+
+  FormatUciMove(result.mateIn > 0 ? result.pv[0] : MOVE_NONE, move);
+  printf("bestmove %s\n", move);
+  fflush(stdout);
+  return NULL;
+}
+
+// go mate <n>: the proof-number solver instead of the alpha-beta search
+static void StartMateSearch(int maxMoves, uint64_t nodes, int64_t moveTime) {
+  if (!EnsureMateSolver()) {
+    printf("bestmove 0000\n");
+    fflush(stdout);
+    return;
+  }
+
+  engine.mateRoot = engine.position;
+  engine.mateMoves = maxMoves;
+  engine.mateNodes = nodes;
+  engine.mateTime = moveTime;
+  // Cleared before the thread exists so an early stop is not lost
+  atomic_store(&engine.mateStop, false);
+  engine.mateThreadActive =
+      pthread_create(&engine.mateThread, NULL, MateThreadMain, NULL) == 0;
+  if (!engine.mateThreadActive) {
+    printf("bestmove 0000\n");
+    fflush(stdout);
+  }
+}
+
+static void StopMateSearch(void) {
+  atomic_store(&engine.mateStop, true);
+  if (engine.mateThreadActive) {
+    pthread_join(engine.mateThread, NULL);
+    engine.mateThreadActive = false;
+  }
+}
+
+// mates <file> [moves] [nodes]: solve every FEN or EPD line of a file. EPD
+// "dm" (mate length) and "bm" (key move) operations are checked when given.
+static void HandleMates(char *args) {
+  char *cursor = args;
+  char *path = NextToken(&cursor);
+  if (path == NULL) {
+    printf("info string Usage: mates <file> [moves] [nodes]\n");
+    fflush(stdout);
+    return;
+  }
+  int maxMoves = (int)ParseNumber(&cursor);
+  uint64_t nodeLimit = (uint64_t)ParseNumber(&cursor);
+  if (maxMoves < 1)
+    maxMoves = 5;
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    printf("info string Cannot open %s\n", path);
+    fflush(stdout);
+    return;
+  }
+  if (!EnsureMateSolver()) {
+    fclose(file);
+    return;
+  }
+  // The batch runs on this thread, so no stop can arrive during it
+  atomic_store(&engine.mateStop, false);
+
+  int positions = 0, solved = 0, failed = 0;
+  uint64_t nodes = 0;
+  int64_t start = GetTimeMilliseconds();
+  char line[UCI_LINE_LENGTH];
+
+  while (fgets(line, sizeof(line), file) != NULL) {
+    ChessPosition pos;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#' || !SetPositionFromFen(&pos, line))
+      continue;
+    positions++;
+
+    // A stated mate length bounds the search; otherwise use the default
+    char value[64];
+    int expected = 0;
+    if (GetEpdOperation(line, "dm", value, sizeof(value)))
+      expected = atoi(value);
+    Move keyMove = MOVE_NONE;
+    if (GetEpdOperation(line, "bm", value, sizeof(value)))
+      keyMove = ParseSanMove(&pos, value);
+
+    MateResult result;
+    FindMate(&engine.mateSolver, &pos, expected > 0 ? expected : maxMoves,
+             nodeLimit, 0, &result);
+    nodes += result.nodes;
+
+    const char *verdict = "ok";
+    if (result.mateIn == 0) {
+      verdict = result.complete ? "no mate" : "unsolved";
+    } else if ((expected > 0 && result.mateIn != expected) ||
+               (keyMove != MOVE_NONE && result.pv[0] != keyMove)) {
+      // A mate, but not the one the puzzle states
+      verdict = "differs";
+    }
+    if (result.mateIn > 0)
+      solved++;
+    if (strcmp(verdict, "ok") != 0)
+      failed++;
+
+    char san[MOVE_NOTATION_LEN] = "-";
+    if (result.mateIn > 0)
+      FormatSanMove(&pos, result.pv[0], san);
+    printf("%d: %s mate %d %s %llu nodes\n", positions, verdict,
+           result.mateIn, san, (unsigned long long)result.nodes);
+    fflush(stdout);
+
+    // Every puzzle starts from an empty table so its node count is repeatable
+    ClearMateSolver(&engine.mateSolver);
+  }
+  fclose(file);
+
+  int64_t elapsed = GetTimeMilliseconds() - start;
+  printf("\nPositions : %d\nSolved    : %d\nFlagged   : %d\n", positions,
+         solved, failed);
+  printf("Nodes     : %llu\nTime (ms) : %lld\n", (unsigned long long)nodes,
+         (long long)elapsed);
+  fflush(stdout);
+}
+
+//==============================================================================
+// TABLEBASE CHECK
+//==============================================================================
+
+static int WdlSign(TablebaseWdl wdl) { return wdl > 0 ? 1 : wdl < 0 ? -1 : 0; }
+
+// Check one position against its own moves and the mate solver. The
+// fifty-move rule is left out: only win, draw or loss is compared.
+static bool CheckTablebasePosition(ChessPosition *pos, int mateMoves,
+                                   uint64_t mateNodes, bool *mateConfirmed,
+                                   char *reason, size_t size) {
+  TablebaseWdl wdl;
+  int dtz;
+  *mateConfirmed = false;
+  if (!ProbeWdl(pos, &wdl) || !ProbeDtz(pos, &dtz)) {
+    snprintf(reason, size, "probe failed");
+    return false;
+  }
+  if (WdlSign(wdl) != (dtz > 0 ? 1 : dtz < 0 ? -1 : 0)) {
+    snprintf(reason, size, "wdl %d but dtz %d", wdl, dtz);
+    return false;
+  }
+
+  // The side to move wins if a move loses for the opponent, and so on
+  MoveList list;
+  GenerateLegalMoves(pos, &list);
+  int best = IsKingInCheck(pos, pos->sideToMove) ? -1 : 0;
+  for (int i = 0; i < list.count; i++) {
+    MoveUndo undo;
+    TablebaseWdl child;
+    MakeMove(pos, list.moves[i], &undo);
+    bool probed = ProbeWdl(pos, &child);
+    UnmakeMove(pos, list.moves[i], &undo);
+    if (!probed) {
+      snprintf(reason, size, "probe failed after a move");
+      return false;
+    }
+    if (i == 0 || -WdlSign(child) > best)
+      best = -WdlSign(child);
+  }
+  if (best != WdlSign(wdl)) {
+    snprintf(reason, size, "wdl %d but the best move leads to %d", wdl, best);
+    return false;
+  }
+
+  MateResult result;
+  FindMate(&engine.mateSolver, pos, mateMoves, mateNodes, 0, &result);
+  if (result.mateIn > 0 && wdl <= TB_DRAW) {
+    snprintf(reason, size, "wdl %d but mate in %d", wdl, result.mateIn);
+    return false;
+  }
+  *mateConfirmed = result.mateIn > 0;
+  return true;
+}
+
+// tbcheck [positions n] [mate n] [nodes n]: probe random positions of every
+// table and check each value against the values after every move and
+// against the mate solver
+static void HandleTablebaseCheck(char *args) {
+  char *cursor = args;
+  int positions = 1000;
+  int mateMoves = 3;
+  uint64_t mateNodes = 20000;
+  const char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "positions") == 0)
+      positions = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "mate") == 0)
+      mateMoves = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "nodes") == 0)
+      mateNodes = (uint64_t)ParseNumber(&cursor);
+  }
+  if (GetTablebaseCount() == 0) {
+    printf("info string No tablebases found (set %s)\n", TB_PATH_ENV);
+    fflush(stdout);
+    return;
+  }
+  if (!EnsureMateSolver())
+    return;
+  atomic_store(&engine.mateStop, false);
+
+  int tables = 0, flaggedTables = 0;
+  int64_t start = GetTimeMilliseconds();
+  for (int t = 0; t < GetTablebaseCount(); t++) {
+    uint64_t seed = (uint64_t)t + 1; // Repeatable from run to run
+    int mismatches = 0, mates = 0;
+    for (int i = 0; i < positions; i++) {
+      ChessPosition pos;
+      bool mateConfirmed;
+      char reason[96];
+      RandomTablebasePosition(t, &seed, &pos);
+      if (!CheckTablebasePosition(&pos, mateMoves, mateNodes, &mateConfirmed,
+                                  reason, sizeof(reason))) {
+        // The first few are enough to reproduce with "position fen"
+        if (mismatches++ < 5) {
+          char fen[FEN_MAX_LENGTH];
+          GetPositionFen(&pos, fen, sizeof(fen));
+          printf("info string %s: %s: %s\n", GetTablebaseName(t), fen,
+                 reason);
+        }
+      }
+      if (mateConfirmed)
+        mates++;
+    }
+    ClearMateSolver(&engine.mateSolver);
+
+    printf("info string %s: %d positions, %d mismatches, %d mates found\n",
+           GetTablebaseName(t), positions, mismatches, mates);
+    fflush(stdout);
+    tables++;
+    if (mismatches > 0)
+      flaggedTables++;
+  }
+
+  printf("info string %d tables checked, %d flagged in %lld ms\n", tables,
+         flaggedTables, (long long)(GetTimeMilliseconds() - start));
+  fflush(stdout);
+}
+
+//==============================================================================
+// COMMANDS
+//==============================================================================
+
+static void SetThreadCount(int threads) {
+  engine.threadCount = threads < 1                    ? 1
+                       : threads > SEARCH_MAX_THREADS ? SEARCH_MAX_THREADS
+                                                      : threads;
+  InitSearcher(&engine.searcher, &transpositionTable, engine.threadCount);
+  engine.searcher.onReport = PrintReport;
+  engine.searcher.onFinish = PrintBestMove;
+}
+
+static void StopAndWait(void) {
+  StopSearch(&engine.searcher);
+  WaitForSearch(&engine.searcher, NULL);
+  StopMateSearch();
+}
+
+static void HandleUci(void) {
+  printf("id name %s\n", ENGINE_NAME);
+  printf("id author %s\n", ENGINE_AUTHOR);
+  printf("option name Hash type spin default %d min %d max %d\n", TT_DEFAULT_MB,
+         TT_MIN_MB, TT_MAX_MB);
+  printf("option name Threads type spin default 1 min 1 max %d\n",
+         SEARCH_MAX_THREADS);
+  printf("option name MultiPV type spin default 1 min 1 max %d\n",
+         SEARCH_MAX_MULTIPV);
+  printf("option name SyzygyPath type string default <empty>\n");
+  printf("uciok\n");
+  fflush(stdout);
+}
+
+// setoption name <name> [value <value>]; names may contain spaces
+static void HandleSetOption(char *args) {
+  char *name = strstr(args, "name ");
+  if (name == NULL)
+    return;
+  name += 5;
+
+  char *value = strstr(name, " value ");
+  if (value != NULL) {
+    *value = '\0';
+    value += 7;
+  } else {
+    value = "";
+  }
+  while (*value == ' ')
+    value++;
+
+  if (strcmp(name, "Hash") == 0) {
+    long megabytes = strtol(value, NULL, 10);
+    if (megabytes < TT_MIN_MB)
+      megabytes = TT_MIN_MB;
+    if (megabytes > TT_MAX_MB)
+      megabytes = TT_MAX_MB;
+    StopAndWait();
+    if (!ResizeTranspositionTable(&transpositionTable, (size_t)megabytes)) {
+      printf("info string Could not allocate %ld MB hash\n", megabytes);
+      fflush(stdout);
+    }
+  } else if (strcmp(name, "Threads") == 0) {
+    StopAndWait();
+    SetThreadCount((int)strtol(value, NULL, 10));
+  } else if (strcmp(name, "MultiPV") == 0) {
+    int lines = (int)strtol(value, NULL, 10);
+    engine.multiPv = lines < 1                    ? 1
+                     : lines > SEARCH_MAX_MULTIPV ? SEARCH_MAX_MULTIPV
+                                                  : lines;
+  } else if (strcmp(name, "SyzygyPath") == 0) {
+    StopAndWait();
+    ShutdownTablebases();
+    if (*value != '\0' && strcmp(value, "<empty>") != 0) {
+      int found = InitTablebases(value);
+      printf("info string Tablebases found: %d (up to %d pieces)\n", found,
+             GetTablebaseMaxPieces());
+      fflush(stdout);
+    }
+  }
+}
+
+// position [startpos | fen <fen>] [moves <move>...]
+static void HandlePosition(char *args) {
+  char *movesPart = strstr(args, "moves");
+  if (movesPart != NULL)
+    *movesPart++ = '\0';
+
+  char *cursor = args;
+  char *kind = NextToken(&cursor);
+  bool ok = false;
+  if (kind != NULL && strcmp(kind, "startpos") == 0)
+    ok = SetPositionFromFen(&engine.position, STARTING_FEN);
+  else if (kind != NULL && strcmp(kind, "fen") == 0)
+    ok = SetPositionFromFen(&engine.position, cursor);
+
+  if (!ok) {
+    SetPositionFromFen(&engine.position, STARTING_FEN);
+    printf("info string Invalid position, using the starting position\n");
+    fflush(stdout);
+  }
+  engine.historyCount = 0;
+
+  if (movesPart == NULL)
+    return;
+
+  cursor = movesPart + 4; // Skip the rest of "moves"
+  char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    Move move = ParseUciMove(&engine.position, token);
+    if (move == MOVE_NONE) {
+      printf("info string Illegal move %s\n", token);
+      fflush(stdout);
+      break;
+    }
+
+    // Keep the most recent keys; older ones cannot repeat past a reset
+    if (engine.historyCount == SEARCH_HISTORY_KEYS) {
+      memmove(engine.history, engine.history + 1,
+              sizeof(uint64_t) * (SEARCH_HISTORY_KEYS - 1));
+      engine.historyCount--;
+    }
+    engine.history[engine.historyCount++] = engine.position.key;
+
+    MoveUndo undo;
+    MakeMove(&engine.position, move, &undo);
+  }
+}
+
+static void HandleGo(char *args) {
+  SearchLimits limits = {0};
+  limits.multiPv = engine.multiPv;
+  int mateMoves = 0;
+  char *cursor = args;
+  char *token;
+
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "depth") == 0)
+      limits.depth = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "nodes") == 0)
+      limits.nodes = (uint64_t)ParseNumber(&cursor);
+    else if (strcmp(token, "movetime") == 0)
+      limits.moveTime = ParseNumber(&cursor);
+    else if (strcmp(token, "wtime") == 0)
+      limits.time[COLOR_WHITE] = ParseNumber(&cursor);
+    else if (strcmp(token, "btime") == 0)
+      limits.time[COLOR_BLACK] = ParseNumber(&cursor);
+    else if (strcmp(token, "winc") == 0)
+      limits.increment[COLOR_WHITE] = ParseNumber(&cursor);
+    else if (strcmp(token, "binc") == 0)
+      limits.increment[COLOR_BLACK] = ParseNumber(&cursor);
+    else if (strcmp(token, "movestogo") == 0)
+      limits.movesToGo = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "infinite") == 0)
+      limits.infinite = true;
+    else if (strcmp(token, "mate") == 0)
+      mateMoves = (int)ParseNumber(&cursor);
+  }
+
+  StopAndWait();
+  if (mateMoves > 0) {
+    StartMateSearch(mateMoves, limits.nodes, limits.moveTime);
+    return;
+  }
+  if (!StartSearch(&engine.searcher, &engine.position, engine.history,
+                   engine.historyCount, &limits)) {
+    printf("bestmove 0000\n");
+    fflush(stdout);
+  }
+}
+
+// perft <depth>: move counts per root move, then the total
+static void HandlePerft(char *args) {
+  int depth = (int)strtol(args, NULL, 10);
+  if (depth < 1)
+    depth = 1;
+
+  ChessPosition pos = engine.position;
+  MoveList list;
+  GenerateLegalMoves(&pos, &list);
+
+  int64_t start = GetTimeMilliseconds();
+  uint64_t total = 0;
+  for (int i = 0; i < list.count; i++) {
+    MoveUndo undo;
+    char move[UCI_MOVE_LENGTH];
+    MakeMove(&pos, list.moves[i], &undo);
+    uint64_t count = Perft(&pos, depth - 1);
+    UnmakeMove(&pos, list.moves[i], &undo);
+    total += count;
+    FormatUciMove(list.moves[i], move);
+    printf("%s: %llu\n", move, (unsigned long long)count);
+  }
+  int64_t elapsed = GetTimeMilliseconds() - start;
+
+  printf("\nNodes searched: %llu\n", (unsigned long long)total);
+  printf("Time: %lld ms\n", (long long)elapsed);
+  fflush(stdout);
+}
+
+// bench [depth]: fixed-depth searches on a fixed set, single-threaded, from
+// an empty table so the node count only changes when the search does
+static void HandleBench(char *args) {
+  int depth = (int)strtol(args, NULL, 10);
+  if (depth < 1)
+    depth = BENCH_DEFAULT_DEPTH;
+
+  StopAndWait();
+
+  Searcher bench;
+  InitSearcher(&bench, &transpositionTable, 1);
+  SearchLimits limits = {0};
+  limits.depth = depth;
+
+  int count = (int)(sizeof(BENCH_POSITIONS) / sizeof(BENCH_POSITIONS[0]));
+  uint64_t nodes = 0;
+  int64_t start = GetTimeMilliseconds();
+
+  for (int i = 0; i < count; i++) {
+    ChessPosition pos;
+    SearchReport result;
+    char move[UCI_MOVE_LENGTH];
+
+    SetPositionFromFen(&pos, BENCH_POSITIONS[i]);
+    ClearTranspositionTable(&transpositionTable);
+    SearchPosition(&bench, &pos, NULL, 0, &limits, &result);
+    nodes += result.nodes;
+
+    FormatUciMove(result.lineCount > 0 ? result.lines[0].pv[0] : MOVE_NONE,
+                  move);
+    printf("Position %2d/%d: %s %10llu nodes\n", i + 1, count, move,
+           (unsigned long long)result.nodes);
+  }
+
+  int64_t elapsed = GetTimeMilliseconds() - start;
+  if (elapsed < 1)
+    elapsed = 1;
+  ClearTranspositionTable(&transpositionTable);
+
+  printf("\n===========================\n");
+  printf("Total time (ms) : %lld\n", (long long)elapsed);
+  printf("Nodes searched  : %llu\n", (unsigned long long)nodes);
+  printf("Nodes/second    : %llu\n",
+         (unsigned long long)(nodes * 1000 / (uint64_t)elapsed));
+  fflush(stdout);
+}
+
+// analyze <file> [depth n] [nodes n] [movetime ms] [workers n] [hash mb]:
+// search every position of a FEN/EPD file in parallel and write annotated
+// EPD to stdout; the summary goes to stderr so the output stays clean
+static void HandleAnalyze(char *args) {
+  char *cursor = args;
+  char *path = NextToken(&cursor);
+  if (path == NULL) {
+    printf("info string Usage: analyze <file> [depth n] [nodes n] "
+           "[movetime ms] [workers n] [hash mb]\n");
+    fflush(stdout);
+    return;
+  }
+
+  BatchOptions options = {0};
+  options.workers = engine.threadCount;
+  options.hashMb = TT_DEFAULT_MB;
+  char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "depth") == 0)
+      options.limits.depth = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "nodes") == 0)
+      options.limits.nodes = (uint64_t)ParseNumber(&cursor);
+    else if (strcmp(token, "movetime") == 0)
+      options.limits.moveTime = ParseNumber(&cursor);
+    else if (strcmp(token, "workers") == 0)
+      options.workers = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "hash") == 0)
+      options.hashMb = (size_t)ParseNumber(&cursor);
+  }
+  if (options.hashMb < TT_MIN_MB)
+    options.hashMb = TT_MIN_MB;
+
+  BatchSummary summary;
+  if (!AnalyzeFile(path, &options, stdout, &summary)) {
+    printf("info string Cannot analyze %s\n", path);
+    fflush(stdout);
+    return;
+  }
+
+  int64_t elapsed = summary.timeMs > 0 ? summary.timeMs : 1;
+  fprintf(stderr, "Positions : %d (%d lines skipped)\n", summary.positions,
+          summary.skipped);
+  fprintf(stderr, "Nodes     : %llu\n", (unsigned long long)summary.nodes);
+  fprintf(stderr, "Time (ms) : %lld (%.1f positions/s)\n",
+          (long long)summary.timeMs, summary.positions * 1000.0 / elapsed);
+}
+
+static double ParseDecimal(char **cursor) {
+  char *token = NextToken(cursor);
+  return token != NULL ? strtod(token, NULL) : 0.0;
+}
+
+// selfplay [games n] [workers n] [tc base+inc] [clock type] [openings file]
+// [depthA|depthB n] [nodesA|nodesB n] [hashA|hashB mb] [resign cp moves]
+// [elo0 x] [elo1 x] [alpha x] [beta x] [nosprt] [pgn file|-]
+static void HandleSelfplay(char *args) {
+  SelfplayOptions options;
+  InitSelfplayOptions(&options);
+  options.workers = engine.threadCount;
+  const char *pgnPath = NULL;
+
+  char *cursor = args;
+  char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    // Per-engine options end in A or B; name is the option without it
+    char name[16] = "";
+    size_t length = strlen(token);
+    SelfplayEngine *config = NULL;
+    if (length > 1 && length <= sizeof(name) &&
+        (token[length - 1] == 'A' || token[length - 1] == 'B')) {
+      config = &options.engines[token[length - 1] - 'A'];
+      memcpy(name, token, length - 1);
+      name[length - 1] = '\0';
+    }
+
+    if (strcmp(token, "games") == 0) {
+      options.games = (int)ParseNumber(&cursor);
+    } else if (strcmp(token, "workers") == 0) {
+      options.workers = (int)ParseNumber(&cursor);
+    } else if (strcmp(token, "tc") == 0) {
+      char *value = NextToken(&cursor);
+      if (value != NULL) {
+        char *end;
+        options.baseSeconds = strtof(value, &end);
+        options.incrementSeconds = *end == '+' ? strtof(end + 1, NULL) : 0.0f;
+      }
+    } else if (strcmp(token, "clock") == 0) {
+      char *value = NextToken(&cursor);
+      if (value == NULL)
+        continue;
+      if (strcmp(value, "none") == 0)
+        options.clockType = CLOCK_NONE;
+      else if (strcmp(value, "sudden") == 0)
+        options.clockType = CLOCK_SUDDEN_DEATH;
+      else if (strcmp(value, "delay") == 0)
+        options.clockType = CLOCK_SIMPLE_DELAY;
+      else if (strcmp(value, "bronstein") == 0)
+        options.clockType = CLOCK_BRONSTEIN;
+      else
+        options.clockType = CLOCK_FISCHER;
+    } else if (strcmp(token, "openings") == 0) {
+      options.openingsPath = NextToken(&cursor);
+    } else if (config != NULL && strcmp(name, "depth") == 0) {
+      config->depth = (int)ParseNumber(&cursor);
+    } else if (config != NULL && strcmp(name, "nodes") == 0) {
+      config->nodes = (uint64_t)ParseNumber(&cursor);
+    } else if (config != NULL && strcmp(name, "hash") == 0) {
+      config->hashMb = (size_t)ParseNumber(&cursor);
+    } else if (strcmp(token, "resign") == 0) {
+      options.resignScore = (int)ParseNumber(&cursor);
+      options.resignMoves = (int)ParseNumber(&cursor);
+    } else if (strcmp(token, "elo0") == 0) {
+      options.elo0 = ParseDecimal(&cursor);
+    } else if (strcmp(token, "elo1") == 0) {
+      options.elo1 = ParseDecimal(&cursor);
+    } else if (strcmp(token, "alpha") == 0) {
+      options.alpha = ParseDecimal(&cursor);
+    } else if (strcmp(token, "beta") == 0) {
+      options.beta = ParseDecimal(&cursor);
+    } else if (strcmp(token, "nosprt") == 0) {
+      options.sprt = false;
+    } else if (strcmp(token, "pgn") == 0) {
+      pgnPath = NextToken(&cursor);
+    }
+  }
+
+  for (int i = 0; i < 2; i++) {
+    if (options.engines[i].hashMb < TT_MIN_MB)
+      options.engines[i].hashMb = TT_MIN_MB;
+  }
+  // Without a clock every move needs some other limit
+  if (options.clockType == CLOCK_NONE) {
+    for (int i = 0; i < 2; i++) {
+      if (options.engines[i].depth == 0 && options.engines[i].nodes == 0)
+        options.engines[i].depth = BENCH_DEFAULT_DEPTH;
+    }
+  }
+  if (options.alpha <= 0.0 || options.alpha >= 1.0)
+    options.alpha = 0.05;
+  if (options.beta <= 0.0 || options.beta >= 1.0)
+    options.beta = 0.05;
+
+  // Games go to stdout with "-", and the progress lines to stderr then
+  if (pgnPath != NULL && strcmp(pgnPath, "-") == 0) {
+    options.pgn = stdout;
+    options.output = stderr;
+  } else if (pgnPath != NULL) {
+    options.pgn = fopen(pgnPath, "a");
+    if (options.pgn == NULL) {
+      printf("info string Cannot write %s\n", pgnPath);
+      fflush(stdout);
+      return;
+    }
+  }
+
+  SelfplayResult result;
+  bool played = RunSelfplay(&options, &result);
+  if (options.pgn != NULL && options.pgn != stdout)
+    fclose(options.pgn);
+  if (!played) {
+    printf("info string Cannot start the match%s%s\n",
+           options.openingsPath != NULL ? " or read " : "",
+           options.openingsPath != NULL ? options.openingsPath : "");
+    fflush(stdout);
+    return;
+  }
+
+  int games = result.wins + result.draws + result.losses;
+  printf("\nGames     : %d (+%d =%d -%d)\n", games, result.wins,
+         result.draws, result.losses);
+  printf("Elo       : %.1f +/- %.1f\n", result.elo, result.eloError);
+  if (options.sprt)
+    printf("SPRT      : %s (LLR %.2f, elo0 %.1f, elo1 %.1f)\n",
+           result.decision > 0   ? "H1 accepted"
+           : result.decision < 0 ? "H0 accepted"
+                                 : "undecided",
+           result.llr, options.elo0, options.elo1);
+  printf("Time (ms) : %lld\n", (long long)result.timeMs);
+  fflush(stdout);
+}
+
+// tune <file> [iterations n] [workers n] [k x] [rate x] [out file]: fit the
+// evaluation tables to labeled positions and write them as C source
+static void HandleTune(char *args) {
+  TuneOptions options;
+  InitTuneOptions(&options);
+  options.workers = engine.threadCount;
+
+  char *cursor = args;
+  options.dataPath = NextToken(&cursor);
+  if (options.dataPath == NULL) {
+    printf("info string Usage: tune <file> [iterations n] [workers n] [k x] "
+           "[rate x] [out file]\n");
+    fflush(stdout);
+    return;
+  }
+
+  char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "iterations") == 0)
+      options.iterations = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "workers") == 0)
+      options.workers = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "k") == 0)
+      options.k = ParseDecimal(&cursor);
+    else if (strcmp(token, "rate") == 0)
+      options.rate = ParseDecimal(&cursor);
+    else if (strcmp(token, "out") == 0 && (token = NextToken(&cursor)) != NULL)
+      options.outputPath = token;
+  }
+
+  TuneSummary summary;
+  if (!RunTuner(&options, &summary)) {
+    printf("info string Cannot tune on %s or write %s\n", options.dataPath,
+           options.outputPath);
+    fflush(stdout);
+    return;
+  }
+  printf("\nLoss      : %.6f -> %.6f\nTables    : %s (rebuild to use them)\n"
+         "Time (ms) : %lld\n",
+         summary.startLoss, summary.finalLoss, options.outputPath,
+         (long long)summary.timeMs);
+  fflush(stdout);
+}
+
+// import <file>: read every game of a PGN file, resolving each move against
+// the position, and report how many were valid and how fast it went
+typedef struct {
+  long games;
+  long invalid;
+
+  // With "verify", one reader goes through the whole file alongside
+  bool verify;
+  MappedFile file;
+  PgnReader reader;
+  PgnGame *whole; // The same game as read by that reader
+  long mismatches;
+} ImportReport;
+
+// Whether a game read from its chunk is the one read from the whole file
+static bool SameGame(const PgnGame *a, const PgnGame *b) {
+  return a->offset == b->offset && a->length == b->length &&
+         a->valid == b->valid && a->result == b->result &&
+         a->plyCount == b->plyCount &&
+         memcmp(a->moves, b->moves, sizeof(Move) * (size_t)a->plyCount) == 0;
+}
+
+static void ReportMismatch(ImportReport *report, const PgnGame *game,
+                           const char *what) {
+  if (++report->mismatches <= IMPORT_REPORTED_ERRORS)
+    printf("info string Game %ld at byte %zu: %s\n", report->games,
+           game->offset, what);
+}
+
+// Report the first invalid games as they come, in file order
+static bool ReportInvalidGame(const PgnGame *game, const uint8_t *encoded,
+                              size_t encodedLength, void *context) {
+  (void)encoded;
+  (void)encodedLength;
+  ImportReport *report = context;
+  report->games++;
+  if (!game->valid && ++report->invalid <= IMPORT_REPORTED_ERRORS)
+    printf("info string Game %ld at byte %zu: %s after %d plies\n",
+           report->games, game->offset, game->error, game->plyCount);
+
+  if (report->verify) {
+    if (!ReadPgnGame(&report->reader, report->whole))
+      ReportMismatch(report, game, "not in a sequential read");
+    else if (!SameGame(game, report->whole))
+      ReportMismatch(report, game, "differs from a sequential read");
+  }
+  return true;
+}
+
+// import <file> [workers n] [chunk bytes] [verify] [db file]: read and
+// check every game of a PGN file, and with "db" store the valid ones in a
+// game database. "verify" reads the file again as a whole, on one reader,
+// and checks that the chunks gave the same games.
+static void HandleImport(char *args) {
+  char *cursor = args;
+  const char *path = NextToken(&cursor);
+  const char *dbPath = NULL;
+  IngestOptions options = {0};
+  options.workers = engine.threadCount;
+  ImportReport report = {0};
+  options.sink = ReportInvalidGame;
+  options.context = &report;
+
+  const char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "workers") == 0)
+      options.workers = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "chunk") == 0)
+      options.chunkBytes = (size_t)ParseNumber(&cursor);
+    else if (strcmp(token, "verify") == 0)
+      report.verify = true;
+    else if (strcmp(token, "db") == 0)
+      dbPath = NextToken(&cursor);
+  }
+
+  if (report.verify && path != NULL && dbPath == NULL) {
+    report.whole = malloc(sizeof(PgnGame));
+    if (report.whole == NULL ||
+        !MapFile(&report.file, path, MAP_ACCESS_SEQUENTIAL)) {
+      free(report.whole);
+      printf("info string Cannot verify %s\n", path);
+      fflush(stdout);
+      return;
+    }
+    InitPgnReader(&report.reader, (const char *)report.file.data,
+                  report.file.size);
+  }
+
+  IngestSummary summary;
+  bool imported =
+      path != NULL &&
+      (dbPath != NULL
+           ? ConvertPgnToGameDb(path, dbPath, options.workers, &summary)
+           : IngestPgnFile(path, &options, &summary));
+  if (!imported) {
+    printf("info string Usage: import <file.pgn> [workers n] [chunk bytes] "
+           "[verify] [db file]%s%s\n",
+           path != NULL ? ", cannot convert " : "", path != NULL ? path : "");
+    fflush(stdout);
+  } else if (report.whole != NULL) {
+    // Games the chunks never produced
+    long missing = 0;
+    while (!summary.stopped && ReadPgnGame(&report.reader, report.whole))
+      missing++;
+    if (report.mismatches == 0 && missing == 0)
+      printf("info string Verify: same games as a sequential read\n");
+    else
+      printf("info string Verify: %ld games differ from a sequential read, "
+             "%ld missing\n",
+             report.mismatches, missing);
+  }
+  if (report.whole != NULL) {
+    UnmapFile(&report.file);
+    free(report.whole);
+  }
+  if (!imported)
+    return;
+
+  double seconds = summary.timeMs > 0 ? summary.timeMs / 1000.0 : 0.001;
+  printf("\nGames     : %llu (%llu valid, %llu invalid)\nPlies     : %llu\n"
+         "Time (ms) : %lld\nMB/s      : %.1f\nGames/s   : %.0f\n",
+         (unsigned long long)summary.games,
+         (unsigned long long)(summary.games - summary.invalid),
+         (unsigned long long)summary.invalid,
+         (unsigned long long)summary.plies, (long long)summary.timeMs,
+         summary.bytes / 1048576.0 / seconds, summary.games / seconds);
+  fflush(stdout);
+}
+
+// export <file.db> [pgn file|-]: write a game database back out as PGN
+static void HandleExport(char *args) {
+  char *cursor = args;
+  const char *path = NextToken(&cursor);
+  const char *pgnPath = "-";
+  const char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "pgn") == 0 && (token = NextToken(&cursor)) != NULL)
+      pgnPath = token;
+  }
+
+  GameDb db;
+  if (path == NULL || !OpenGameDb(&db, path)) {
+    printf("info string Usage: export <file.db> [pgn file|-]%s%s\n",
+           path != NULL ? ", cannot read " : "", path != NULL ? path : "");
+    fflush(stdout);
+    return;
+  }
+
+  bool toStdout = strcmp(pgnPath, "-") == 0;
+  FILE *file = toStdout ? stdout : fopen(pgnPath, "w");
+  bool written = false;
+  uint64_t games = db.gameCount;
+  if (file != NULL) {
+    PgnWriter writer;
+    InitPgnWriter(&writer, file);
+    written = WriteGameDbPgn(&db, &writer);
+    if (!toStdout && fclose(file) != 0)
+      written = false;
+  }
+  CloseGameDb(&db);
+
+  if (!written)
+    printf("info string Could not export %s to %s\n", path, pgnPath);
+  else if (!toStdout)
+    printf("info string Exported %llu games to %s\n",
+           (unsigned long long)games, pgnPath);
+  fflush(stdout);
+}
+
+// index <file.db> <out file> [by position|material|pawns] [memory mb]: list
+// every position of a game database in an index keyed by the position, its
+// material signature or its pawn structure
+static void HandleIndex(char *args) {
+  char *cursor = args;
+  const char *path = NextToken(&cursor);
+  const char *outPath = NextToken(&cursor);
+  PosIndexKind kind = POSINDEX_POSITION;
+  size_t memoryMb = POSINDEX_DEFAULT_MEMORY_MB;
+  const char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "memory") == 0) {
+      memoryMb = (size_t)ParseNumber(&cursor);
+    } else if (strcmp(token, "by") == 0 &&
+               (token = NextToken(&cursor)) != NULL) {
+      kind = strcmp(token, "material") == 0 ? POSINDEX_MATERIAL
+             : strcmp(token, "pawns") == 0  ? POSINDEX_PAWNS
+                                            : POSINDEX_POSITION;
+    }
+  }
+
+  GameDb db;
+  if (path == NULL || outPath == NULL || !OpenGameDb(&db, path)) {
+    printf("info string Usage: index <file.db> <out file> "
+           "[by position|material|pawns] [memory mb]%s%s\n",
+           path != NULL ? ", cannot read " : "", path != NULL ? path : "");
+    fflush(stdout);
+    return;
+  }
+
+  PosIndexSummary summary;
+  if (BuildPositionIndex(&db, outPath, kind, memoryMb, &summary))
+    printf("info string Indexed %llu positions of %llu games in %lld ms "
+           "(%d sorted runs)\n",
+           (unsigned long long)summary.records,
+           (unsigned long long)db.gameCount, (long long)summary.timeMs,
+           summary.runs);
+  else
+    printf("info string Could not index %s to %s\n", path, outPath);
+  fflush(stdout);
+  CloseGameDb(&db);
+}
+
+// find <file.pix> [material sig] [db file] [games n]: the games that reached
+// the current position (or its material or pawn structure, depending on the
+// index), and for a position index the moves played from it
+static void HandleFind(char *args) {
+  char *cursor = args;
+  const char *path = NextToken(&cursor);
+  const char *dbPath = NULL;
+  const char *material = NULL;
+  int gamesShown = FIND_DEFAULT_GAMES;
+  const char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "db") == 0)
+      dbPath = NextToken(&cursor);
+    else if (strcmp(token, "games") == 0)
+      gamesShown = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "material") == 0)
+      material = NextToken(&cursor);
+  }
+
+  PositionIndex index;
+  GameDb db;
+  bool withDb = dbPath != NULL && OpenGameDb(&db, dbPath);
+  if (path == NULL || !OpenPositionIndex(&index, path)) {
+    printf("info string Usage: find <file.pix> [material KRvKB] [db file] "
+           "[games n]%s%s\n",
+           path != NULL ? ", cannot read " : "", path != NULL ? path : "");
+    fflush(stdout);
+    if (withDb)
+      CloseGameDb(&db);
+    return;
+  }
+
+  uint64_t key = PositionIndexKey(index.kind, &engine.position);
+  if (material != NULL && (index.kind != POSINDEX_MATERIAL ||
+                           !ParseMaterialSignature(material, &key))) {
+    printf("info string material needs an index built by material and a "
+           "signature like KRvKB\n");
+    fflush(stdout);
+    ClosePositionIndex(&index);
+    if (withDb)
+      CloseGameDb(&db);
+    return;
+  }
+
+  int64_t start = GetTimeMilliseconds();
+  const PosIndexRecord *records;
+  uint64_t count = FindPositionRecords(&index, key, &records);
+
+  // Tally the moves played next, most frequent first
+  Move moves[FIND_MAX_NEXT_MOVES];
+  uint64_t counts[FIND_MAX_NEXT_MOVES];
+  int moveCount = 0;
+  for (uint64_t i = 0; i < count && index.kind == POSINDEX_POSITION; i++) {
+    int m = 0;
+    while (m < moveCount && moves[m] != records[i].next)
+      m++;
+    if (m == moveCount) {
+      if (moveCount == FIND_MAX_NEXT_MOVES)
+        continue;
+      moves[moveCount] = records[i].next;
+      counts[moveCount++] = 0;
+    }
+    counts[m]++;
+  }
+  int64_t elapsed = GetTimeMilliseconds() - start;
+
+  printf("info string %llu occurrences, found in %lld ms\n",
+         (unsigned long long)count, (long long)elapsed);
+  for (int shown = 0; shown < moveCount; shown++) {
+    int best = shown;
+    for (int m = shown + 1; m < moveCount; m++) {
+      if (counts[m] > counts[best])
+        best = m;
+    }
+    Move move = moves[best];
+    uint64_t moveTotal = counts[best];
+    moves[best] = moves[shown];
+    counts[best] = counts[shown];
+    moves[shown] = move;
+    counts[shown] = moveTotal;
+
+    char san[MOVE_NOTATION_LEN] = "(end)";
+    if (move != MOVE_NONE) {
+      ChessPosition pos = engine.position;
+      FormatSanMove(&pos, move, san);
+    }
+    printf("info string %-7s %llu (%.1f%%)\n", san,
+           (unsigned long long)moveTotal, 100.0 * moveTotal / count);
+  }
+
+  for (uint64_t i = 0; i < count && i < (uint64_t)gamesShown; i++) {
+    if (withDb && records[i].game < db.gameCount) {
+      const GameDbEntry *entry = GetGameDbEntry(&db, records[i].game);
+      printf("info string Game %u ply %u: %s - %s %s\n", records[i].game,
+             records[i].ply, GetGameDbString(&db, entry->white),
+             GetGameDbString(&db, entry->black),
+             GetPgnResultText((PgnResult)entry->result));
+    } else {
+      printf("info string Game %u ply %u\n", records[i].game,
+             records[i].ply);
+    }
+  }
+  fflush(stdout);
+  ClosePositionIndex(&index);
+  if (withDb)
+    CloseGameDb(&db);
+}
+
+// openings <file.pix> <file.db> <out file> [plies n] [min n]: move statistics
+// for the opening explorer, from a position index and its game database
+static void HandleOpenings(char *args) {
+  char *cursor = args;
+  const char *indexPath = NextToken(&cursor);
+  const char *dbPath = NextToken(&cursor);
+  const char *outPath = NextToken(&cursor);
+  int maxPly = EXPLORER_DEFAULT_PLIES;
+  uint32_t minGames = EXPLORER_DEFAULT_MIN_GAMES;
+  const char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "plies") == 0)
+      maxPly = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "min") == 0)
+      minGames = (uint32_t)ParseNumber(&cursor);
+  }
+
+  PositionIndex index;
+  GameDb db;
+  bool withIndex = indexPath != NULL && OpenPositionIndex(&index, indexPath);
+  bool withDb = dbPath != NULL && OpenGameDb(&db, dbPath);
+  ExplorerSummary summary;
+  if (!withIndex || !withDb || outPath == NULL) {
+    printf("info string Usage: openings <file.pix> <file.db> <out file> "
+           "[plies n] [min n]\n");
+  } else if (BuildExplorerStats(&index, &db, outPath, maxPly, minGames,
+                                &summary)) {
+    printf("info string %llu moves from %llu positions written to %s in "
+           "%lld ms\n",
+           (unsigned long long)summary.entries,
+           (unsigned long long)summary.positions, outPath,
+           (long long)summary.timeMs);
+  } else {
+    printf("info string Could not write %s (the index must be built by "
+           "position)\n",
+           outPath);
+  }
+  fflush(stdout);
+  if (withIndex)
+    ClosePositionIndex(&index);
+  if (withDb)
+    CloseGameDb(&db);
+}
+
+// makebook <file.pgn> <out file> [plies n] [min n] [workers n] [memory mb]:
+// a Polyglot opening book of the moves played in a PGN collection
+static void HandleMakeBook(char *args) {
+  char *cursor = args;
+  const char *path = NextToken(&cursor);
+  const char *outPath = NextToken(&cursor);
+  BookBuildOptions options = {engine.threadCount, BOOKBUILD_DEFAULT_PLIES,
+                              BOOKBUILD_DEFAULT_MIN_GAMES,
+                              BOOKBUILD_DEFAULT_MEMORY_MB};
+  const char *token;
+  while ((token = NextToken(&cursor)) != NULL) {
+    if (strcmp(token, "plies") == 0)
+      options.maxPly = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "min") == 0)
+      options.minGames = (uint32_t)ParseNumber(&cursor);
+    else if (strcmp(token, "workers") == 0)
+      options.workers = (int)ParseNumber(&cursor);
+    else if (strcmp(token, "memory") == 0)
+      options.memoryMb = (size_t)ParseNumber(&cursor);
+  }
+
+  BookBuildSummary summary;
+  if (path == NULL || outPath == NULL) {
+    printf("info string Usage: makebook <file.pgn> <out file> [plies n] "
+           "[min n] [workers n] [memory mb]\n");
+  } else if (BuildBookFromPgn(path, outPath, &options, &summary)) {
+    printf("info string %llu games, %llu moves collected, %d sorted runs\n"
+           "info string %llu entries for %llu positions written to %s in "
+           "%lld ms\n",
+           (unsigned long long)summary.gamesUsed,
+           (unsigned long long)summary.tuples, summary.runs,
+           (unsigned long long)summary.entries,
+           (unsigned long long)summary.positions, outPath,
+           (long long)summary.timeMs);
+  } else {
+    printf("info string Could not build %s from %s\n", outPath, path);
+  }
+  fflush(stdout);
+}
+
+// explore [file]: the explorer's moves for the current position
+static void HandleExplore(char *args) {
+  char *cursor = args;
+  const char *path = NextToken(&cursor);
+  if (path == NULL)
+    path = EXPLORER_DEFAULT_PATH;
+
+  OpeningExplorer explorer;
+  if (!OpenExplorer(&explorer, path)) {
+    printf("info string Cannot read opening statistics from %s\n", path);
+    fflush(stdout);
+    return;
+  }
+
+  const ExplorerEntry *entries;
+  int count = FindExplorerMoves(&explorer, engine.position.key, &entries);
+  printf("info string %d moves\n", count);
+  for (int i = 0; i < count; i++) {
+    char san[MOVE_NOTATION_LEN];
+    ChessPosition pos = engine.position;
+    FormatSanMove(&pos, entries[i].move, san);
+    printf("info string %-7s %u games +%u =%u -%u *%u avg elo %u\n", san,
+           entries[i].games, entries[i].whiteWins, entries[i].draws,
+           entries[i].blackWins, entries[i].unfinished,
+           entries[i].averageElo);
+  }
+  fflush(stdout);
+  CloseExplorer(&explorer);
+}
+
+static void HandleEval(void) {
+  printf("Static eval: %d (side to move), phase %d/%d\n",
+         Evaluate(&engine.position), GamePhase(&engine.position), PHASE_TOTAL);
+  fflush(stdout);
+}
+
+//==============================================================================
+// MAIN LOOP
+//==============================================================================
+
+// Returns false on "quit"
+static bool HandleCommand(char *line) {
+  line[strcspn(line, "\r\n")] = '\0';
+  while (isspace((unsigned char)*line))
+    line++;
+
+  char *cursor = line;
+  char *command = NextToken(&cursor);
+  if (command == NULL)
+    return true;
+
+  if (strcmp(command, "uci") == 0) {
+    HandleUci();
+  } else if (strcmp(command, "isready") == 0) {
+    printf("readyok\n");
+    fflush(stdout);
+  } else if (strcmp(command, "ucinewgame") == 0) {
+    StopAndWait();
+    ClearTranspositionTable(&transpositionTable);
+    SetPositionFromFen(&engine.position, STARTING_FEN);
+    engine.historyCount = 0;
+  } else if (strcmp(command, "setoption") == 0) {
+    HandleSetOption(cursor);
+  } else if (strcmp(command, "position") == 0) {
+    StopAndWait();
+    HandlePosition(cursor);
+  } else if (strcmp(command, "go") == 0) {
+    HandleGo(cursor);
+  } else if (strcmp(command, "stop") == 0) {
+    StopAndWait();
+  } else if (strcmp(command, "ponderhit") == 0) {
+    // Pondering is not supported; nothing to switch over
+  } else if (strcmp(command, "quit") == 0) {
+    return false;
+  } else if (strcmp(command, "perft") == 0) {
+    StopAndWait();
+    HandlePerft(cursor);
+  } else if (strcmp(command, "bench") == 0) {
+    HandleBench(cursor);
+  } else if (strcmp(command, "analyze") == 0) {
+    StopAndWait();
+    HandleAnalyze(cursor);
+  } else if (strcmp(command, "selfplay") == 0) {
+    StopAndWait();
+    HandleSelfplay(cursor);
+  } else if (strcmp(command, "tune") == 0) {
+    StopAndWait();
+    HandleTune(cursor);
+  } else if (strcmp(command, "import") == 0) {
+    StopAndWait();
+    HandleImport(cursor);
+  } else if (strcmp(command, "export") == 0) {
+    StopAndWait();
+    HandleExport(cursor);
+  } else if (strcmp(command, "index") == 0) {
+    StopAndWait();
+    HandleIndex(cursor);
+  } else if (strcmp(command, "find") == 0) {
+    HandleFind(cursor);
+  } else if (strcmp(command, "openings") == 0) {
+    StopAndWait();
+    HandleOpenings(cursor);
+  } else if (strcmp(command, "makebook") == 0) {
+    StopAndWait();
+    HandleMakeBook(cursor);
+  } else if (strcmp(command, "explore") == 0) {
+    HandleExplore(cursor);
+  } else if (strcmp(command, "mates") == 0) {
+    StopAndWait();
+    HandleMates(cursor);
+  } else if (strcmp(command, "tbcheck") == 0) {
+    StopAndWait();
+    HandleTablebaseCheck(cursor);
+  } else if (strcmp(command, "eval") == 0) {
+    HandleEval();
+  } else if (strcmp(command, "d") == 0) {
+    char fen[FEN_MAX_LENGTH];
+    GetPositionFen(&engine.position, fen, sizeof(fen));
+    printf("Fen: %s\nKey: %016llx\n", fen,
+           (unsigned long long)engine.position.key);
+    fflush(stdout);
+  } else {
+    printf("info string Unknown command: %s\n", command);
+    fflush(stdout);
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  setvbuf(stdin, NULL, _IONBF, 0);
+
+  if (!ResizeTranspositionTable(&transpositionTable, TT_DEFAULT_MB)) {
+    fprintf(stderr, "Could not allocate the transposition table\n");
+    return 1;
+  }
+  SetThreadCount(1);
+  engine.multiPv = 1;
+  SetPositionFromFen(&engine.position, STARTING_FEN);
+
+  const char *tbPath = getenv(TB_PATH_ENV);
+  if (tbPath != NULL)
+    InitTablebases(tbPath);
+
+  // Commands given on the command line run once, e.g. "chess-uci bench"
+  if (argc > 1) {
+    char line[UCI_LINE_LENGTH] = "";
+    for (int i = 1; i < argc; i++) {
+      strncat(line, argv[i], sizeof(line) - strlen(line) - 2);
+      strcat(line, " ");
+    }
+    HandleCommand(line);
+  } else {
+    char line[UCI_LINE_LENGTH];
+    while (fgets(line, sizeof(line), stdin) != NULL) {
+      if (!HandleCommand(line))
+        break;
+    }
+  }
+
+  StopAndWait();
+  ShutdownTablebases();
+  FreeMateSolver(&engine.mateSolver);
+  FreeTranspositionTable(&transpositionTable);
+  return 0;
+}
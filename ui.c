@@ -4,13 +4,22 @@
  */
 
 #include "ui.h"
+#include "analysis.h"
 #include "board.h"
 #include "check.h"
 #include "clock.h"
+#include "explorer.h"
 #include "history.h"
+#include "journal.h"
+#include "movegen.h"
 #include "moves.h"
 #include "multiplayer.h"
+#include "rlgl.h"
+#include "variation.h"
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 //==============================================================================
 // GLOBAL TEXTURE
@@ -31,6 +40,60 @@ void LoadPiecesTexture(void) {
 
 void UnloadPiecesTexture(void) { UnloadTexture(piecesTexture); }
 
+//==============================================================================
+// LAYER CACHES
+//==============================================================================
+
+static LayerCache boardLayer = {0};   // Squares and border
+static LayerCache historyLayer = {0}; // Visible rows of the move list
+
+bool BeginLayerCache(LayerCache *cache, int width, int height) {
+  cache->valid = false;
+  if (cache->failed)
+    return false;
+  if (cache->target.id != 0 && (cache->target.texture.width != width ||
+                                cache->target.texture.height != height))
+    UnloadLayerCache(cache);
+  if (cache->target.id == 0) {
+    cache->target = LoadRenderTexture(width, height);
+    if (cache->target.id == 0) {
+      TraceLog(LOG_WARNING, "Could not create a %dx%d layer texture", width,
+               height);
+      cache->failed = true;
+      return false;
+    }
+  }
+  BeginTextureMode(cache->target);
+  return true;
+}
+
+void EndLayerCache(LayerCache *cache) {
+  EndTextureMode();
+  cache->valid = true;
+}
+
+void DrawLayerCache(const LayerCache *cache, int x, int y) {
+  // Render textures are stored bottom-up. Translucent drawing inside the
+  // layer lowered its alpha, which a plain copy ignores.
+  Texture2D texture = cache->target.texture;
+  Rectangle source = {0, 0, (float)texture.width, (float)-texture.height};
+  rlSetBlendFactors(RL_ONE, RL_ZERO, RL_FUNC_ADD);
+  BeginBlendMode(BLEND_CUSTOM);
+  DrawTextureRec(texture, source, (Vector2){x, y}, WHITE);
+  EndBlendMode();
+}
+
+void UnloadLayerCache(LayerCache *cache) {
+  if (cache->target.id != 0)
+    UnloadRenderTexture(cache->target);
+  memset(cache, 0, sizeof(*cache));
+}
+
+void UnloadUiLayers(void) {
+  UnloadLayerCache(&boardLayer);
+  UnloadLayerCache(&historyLayer);
+}
+
 //==============================================================================
 // SPRITE HELPERS
 //==============================================================================
@@ -56,16 +119,42 @@ PanelLayout GetPromotionPanelLayout(void) {
 // BOARD DRAWING
 //==============================================================================
 
-void DrawBoard(void) {
+// Squares and border, with the top left square at (x, y)
+static void DrawBoardSquares(int x, int y) {
   for (int row = 0; row < BOARD_SIZE; row++) {
     for (int col = 0; col < BOARD_SIZE; col++) {
-      int x = BOARD_OFFSET_X + col * TILE_SIZE;
-      int y = BOARD_OFFSET_Y + row * TILE_SIZE;
-
       // Alternating square colors
       Color squareColor =
           ((row + col) % 2 == 0) ? COLOR_LIGHT_SQUARE : COLOR_DARK_SQUARE;
-      DrawRectangle(x, y, TILE_SIZE, TILE_SIZE, squareColor);
+      DrawRectangle(x + col * TILE_SIZE, y + row * TILE_SIZE, TILE_SIZE,
+                    TILE_SIZE, squareColor);
+    }
+  }
+
+  // Board border
+  DrawRectangleLines(x - 2, y - 2, BOARD_SIZE * TILE_SIZE + 4,
+                     BOARD_SIZE * TILE_SIZE + 4, WHITE);
+}
+
+void DrawBoard(void) {
+  // The squares never change, so they are drawn once
+  int size = BOARD_SIZE * TILE_SIZE + 4;
+  if (!boardLayer.valid) {
+    if (BeginLayerCache(&boardLayer, size, size)) {
+      ClearBackground(COLOR_BACKGROUND);
+      DrawBoardSquares(2, 2);
+      EndLayerCache(&boardLayer);
+    }
+  }
+  if (boardLayer.valid)
+    DrawLayerCache(&boardLayer, BOARD_OFFSET_X - 2, BOARD_OFFSET_Y - 2);
+  else
+    DrawBoardSquares(BOARD_OFFSET_X, BOARD_OFFSET_Y);
+
+  for (int row = 0; row < BOARD_SIZE; row++) {
+    for (int col = 0; col < BOARD_SIZE; col++) {
+      int x = BOARD_OFFSET_X + col * TILE_SIZE;
+      int y = BOARD_OFFSET_Y + row * TILE_SIZE;
 
       // Highlight selected square
       if (row == selectedPos.row && col == selectedPos.col) {
@@ -80,11 +169,6 @@ void DrawBoard(void) {
       }
     }
   }
-
-  // Board border
-  DrawRectangleLines(BOARD_OFFSET_X - 2, BOARD_OFFSET_Y - 2,
-                     BOARD_SIZE * TILE_SIZE + 4, BOARD_SIZE * TILE_SIZE + 4,
-                     WHITE);
 }
 
 void DrawValidMoves(void) {
@@ -111,11 +195,160 @@ void DrawValidMoves(void) {
   }
 }
 
+//==============================================================================
+// HINT DRAWING
+//==============================================================================
+
+static Vector2 SquareCenter(int sq) {
+  return (Vector2){BOARD_OFFSET_X + (sq % BOARD_SIZE) * TILE_SIZE +
+                       TILE_SIZE / 2.0f,
+                   BOARD_OFFSET_Y + (sq / BOARD_SIZE) * TILE_SIZE +
+                       TILE_SIZE / 2.0f};
+}
+
+void DrawHint(void) {
+  if (IsReviewing())
+    return;
+
+  // Outline pieces of the side to move that are hanging
+  for (int row = 0; row < BOARD_SIZE; row++) {
+    for (int col = 0; col < BOARD_SIZE; col++) {
+      if (!IsSquareThreatened(row, col))
+        continue;
+      Rectangle square = {BOARD_OFFSET_X + col * TILE_SIZE,
+                          BOARD_OFFSET_Y + row * TILE_SIZE, TILE_SIZE,
+                          TILE_SIZE};
+      DrawRectangleLinesEx(square, HINT_THREAT_WIDTH, COLOR_THREAT);
+    }
+  }
+
+  Move move;
+  if (!GetHintMove(&move))
+    return;
+
+  // Arrow from the center of the source square to the target square
+  Vector2 from = SquareCenter(MOVE_FROM(move));
+  Vector2 to = SquareCenter(MOVE_TO(move));
+  Vector2 dir = {to.x - from.x, to.y - from.y};
+  float length = sqrtf(dir.x * dir.x + dir.y * dir.y);
+  dir.x /= length;
+  dir.y /= length;
+
+  Vector2 base = {to.x - dir.x * HINT_ARROW_HEAD, to.y - dir.y * HINT_ARROW_HEAD};
+  Vector2 side = {-dir.y * HINT_ARROW_HEAD / 2, dir.x * HINT_ARROW_HEAD / 2};
+  DrawLineEx(from, base, HINT_ARROW_WIDTH, COLOR_HINT_ARROW);
+  // Counter-clockwise on screen, as raylib expects
+  DrawTriangle(to, (Vector2){base.x - side.x, base.y - side.y},
+               (Vector2){base.x + side.x, base.y + side.y}, COLOR_HINT_ARROW);
+}
+
+//==============================================================================
+// EVALUATION BAR
+//==============================================================================
+
+// White's share of the bar for a score from white's point of view: a
+// logistic curve, so a pawn or two moves it visibly and big leads saturate
+static float EvalBarShare(const AnalysisLine *line) {
+  if (line->isMate)
+    return line->mateIn > 0 ? 1.0f : 0.0f;
+  return 1.0f / (1.0f + expf(-EVAL_BAR_SCALE * (float)line->score));
+}
+
+void DrawEvalBar(void) {
+  // Eased toward the target so the bar slides instead of jumping
+  static float shown = 0.5f;
+  float target = shown;
+
+  // Until the first iteration of a new position, and after a timeout or
+  // adjudication, the last evaluation stays
+  AnalysisLine line;
+  if (gameState == GAME_CHECKMATE) {
+    target = currentTurn == COLOR_WHITE ? 0.0f : 1.0f;
+  } else if (gameState == GAME_STALEMATE) {
+    target = 0.5f;
+  } else if (!IsGameOver() && GetEvaluation(&line)) {
+    target = EvalBarShare(&line);
+  }
+  shown += (target - shown) * EVAL_BAR_EASING;
+
+  // White fills from the bottom, matching the board's orientation
+  int x = BOARD_OFFSET_X - EVAL_BAR_GAP - EVAL_BAR_WIDTH;
+  int height = BOARD_SIZE * TILE_SIZE;
+  int whiteHeight = (int)(shown * height + 0.5f);
+  DrawRectangle(x, BOARD_OFFSET_Y, EVAL_BAR_WIDTH, height - whiteHeight,
+                COLOR_EVAL_BLACK);
+  DrawRectangle(x, BOARD_OFFSET_Y + height - whiteHeight, EVAL_BAR_WIDTH,
+                whiteHeight, COLOR_EVAL_WHITE);
+  DrawLine(x, BOARD_OFFSET_Y + height / 2, x + EVAL_BAR_WIDTH,
+           BOARD_OFFSET_Y + height / 2, GRAY);
+}
+
+//==============================================================================
+// GAME REVIEW
+//==============================================================================
+
+// Ply picked in the move history, -1 while the live game is shown
+static int reviewPly = -1;
+static int reviewMoveCount = 0; // Moves in the game when it was picked
+static ChessPosition reviewPosition;
+
+bool IsReviewing(void) {
+  // Any move played or taken back since brings the live game back
+  if (reviewPly >= 0 && reviewMoveCount != GetMoveCount())
+    reviewPly = -1;
+  return reviewPly >= 0;
+}
+
+// Show the position after a number of moves; the last one is the live game
+static void SeekToPly(int ply) {
+  reviewPly = -1;
+  if (ply < 0 || ply >= GetMoveCount() ||
+      !GetPositionAtPly(ply, &reviewPosition))
+    return;
+  reviewPly = ply;
+  reviewMoveCount = GetMoveCount();
+  isDragging = false;
+  selectedPos = INVALID_POS;
+  ClearValidMoves();
+}
+
+static void HandleReviewKeys(void) {
+  int shown = IsReviewing() ? reviewPly : GetMoveCount();
+  if (IsKeyPressed(KEY_LEFT) && shown > 0)
+    SeekToPly(shown - 1);
+  else if (IsKeyPressed(KEY_RIGHT) && IsReviewing())
+    SeekToPly(shown + 1);
+  else if (IsKeyPressed(KEY_HOME) && GetMoveCount() > 0)
+    SeekToPly(0);
+  else if (IsKeyPressed(KEY_END))
+    SeekToPly(GetMoveCount());
+}
+
 //==============================================================================
 // PIECE DRAWING
 //==============================================================================
 
+static void DrawPieceSprite(PieceType type, PieceColor color, int row,
+                            int col) {
+  Rectangle src = GetSpriteRect(type, color);
+  int x = BOARD_OFFSET_X + col * TILE_SIZE + (TILE_SIZE - SPRITE_SIZE) / 2;
+  int y = BOARD_OFFSET_Y + row * TILE_SIZE + (TILE_SIZE - SPRITE_SIZE) / 2;
+  Rectangle dest = {x, y, SPRITE_SIZE, SPRITE_SIZE};
+  DrawTexturePro(piecesTexture, src, dest, (Vector2){0, 0}, 0, WHITE);
+}
+
 void DrawPieces(void) {
+  // A position picked in the history replaces the live board
+  if (IsReviewing()) {
+    for (int sq = 0; sq < SQUARE_COUNT; sq++) {
+      PieceCode code = reviewPosition.squares[sq];
+      if (code != NO_PIECE)
+        DrawPieceSprite(CODE_TYPE(code), CODE_COLOR(code), SQ_ROW(sq),
+                        SQ_COL(sq));
+    }
+    return;
+  }
+
   // Draw all pieces on the board (skip dragged piece)
   for (int row = 0; row < BOARD_SIZE; row++) {
     for (int col = 0; col < BOARD_SIZE; col++) {
@@ -124,13 +357,7 @@ void DrawPieces(void) {
       if (isDragging && row == dragStartPos.row && col == dragStartPos.col)
         continue;
 
-      Rectangle src =
-          GetSpriteRect(board[row][col].type, board[row][col].color);
-      int x = BOARD_OFFSET_X + col * TILE_SIZE + (TILE_SIZE - SPRITE_SIZE) / 2;
-      int y = BOARD_OFFSET_Y + row * TILE_SIZE + (TILE_SIZE - SPRITE_SIZE) / 2;
-      Rectangle dest = {x, y, SPRITE_SIZE, SPRITE_SIZE};
-
-      DrawTexturePro(piecesTexture, src, dest, (Vector2){0, 0}, 0, WHITE);
+      DrawPieceSprite(board[row][col].type, board[row][col].color, row, col);
     }
   }
 
@@ -182,6 +409,17 @@ void DrawUI(void) {
                                              : " - TIME! White wins!";
     stateColor = RED;
     break;
+  case GAME_ADJUDICATED:
+    if (adjudicatedWinner == COLOR_NONE) {
+      stateText = " - TABLEBASE DRAW!";
+      stateColor = GRAY;
+    } else {
+      stateText = (adjudicatedWinner == COLOR_WHITE)
+                      ? " - TABLEBASE! White wins!"
+                      : " - TABLEBASE! Black wins!";
+      stateColor = RED;
+    }
+    break;
   default:
     break;
   }
@@ -189,67 +427,436 @@ void DrawUI(void) {
   DrawText(stateText, BOARD_OFFSET_X + MeasureText(turnText, FONT_SIZE_MEDIUM),
            y, FONT_SIZE_MEDIUM, stateColor);
 
-  if ((gameState == GAME_CHECKMATE || gameState == GAME_STALEMATE ||
-       gameState == GAME_TIMEOUT) && !isMultiplayerGame) {
+  if (IsReviewing()) {
+    char reviewText[48];
+    snprintf(reviewText, sizeof(reviewText), "Move %d of %d - End to return",
+             reviewPly, GetMoveCount());
+    DrawText(reviewText,
+             BOARD_OFFSET_X + BOARD_SIZE * TILE_SIZE -
+                 MeasureText(reviewText, FONT_SIZE_SMALL),
+             y, FONT_SIZE_SMALL, COLOR_TITLE_GOLD);
+  } else if (IsGameOver() && !isMultiplayerGame) {
     DrawText("Press R to restart",
              BOARD_OFFSET_X + BOARD_SIZE * TILE_SIZE - 180, y, FONT_SIZE_SMALL,
              GRAY);
   }
 }
 
-void DrawMoveHistory(void) {
-  // Panel position and dimensions - leave room for clocks at top and bottom
-  int clockSpace = IsClockEnabled() ? CLOCK_PANEL_HEIGHT + 10 : 0;
-  int panelX = BOARD_OFFSET_X + BOARD_SIZE * TILE_SIZE + 20;
-  int panelY = BOARD_OFFSET_Y + clockSpace;
-  int panelWidth = HISTORY_PANEL_WIDTH - 30;
-  int panelHeight = BOARD_SIZE * TILE_SIZE - (2 * clockSpace);
+// Shorten a line of moves at a word boundary until it fits the width
+static void FitTextToWidth(char *text, int fontSize, int maxWidth) {
+  while (MeasureText(text, fontSize) > maxWidth) {
+    char *lastSpace = strrchr(text, ' ');
+    if (lastSpace == NULL)
+      return;
+    *lastSpace = '\0';
+  }
+}
 
-  // Draw panel background
-  DrawRectangle(panelX, panelY, panelWidth, panelHeight, COLOR_PANEL_BG);
-  DrawRectangleLinesEx((Rectangle){panelX, panelY, panelWidth, panelHeight}, 2,
-                       WHITE);
+// Engine lines under the move list: score, then the line in SAN
+static void DrawAnalysisLines(int x, int y, int width, const char *title,
+                              const AnalysisLine *lines, int lineCount) {
+  int fontSize = FONT_SIZE_SMALL - 4;
+  DrawText(title, x, y, fontSize, COLOR_TITLE_GOLD);
 
-  // Draw title
-  const char *title = "Move History";
-  int titleWidth = MeasureText(title, FONT_SIZE_SMALL);
-  DrawText(title, panelX + (panelWidth - titleWidth) / 2, panelY + 10,
-           FONT_SIZE_SMALL, WHITE);
+  for (int i = 0; i < lineCount; i++) {
+    char score[16];
+    char text[ANALYSIS_TEXT_LEN];
+    int lineY = y + (i + 1) * ANALYSIS_ROW_HEIGHT;
 
-  // Draw moves in PGN format
-  int lineHeight = 22;
-  int startY = panelY + 40;
-  int maxVisibleLines = (panelHeight - 50) / lineHeight;
-  int totalMoveCount = GetMoveCount();
+    FormatAnalysisScore(&lines[i], score, sizeof(score));
+    DrawText(score, x, lineY, fontSize, lines[i].score >= 0 ? WHITE : GRAY);
 
-  // Calculate number of full moves (pairs)
-  int fullMoves = (totalMoveCount + 1) / 2;
+    snprintf(text, sizeof(text), "%s", lines[i].text);
+    FitTextToWidth(text, fontSize, width - ANALYSIS_SCORE_WIDTH);
+    DrawText(text, x + ANALYSIS_SCORE_WIDTH, lineY, fontSize, LIGHTGRAY);
+  }
+}
 
-  // Handle mouse wheel scrolling when hovering over the panel
-  Vector2 mouse = GetMousePosition();
-  Rectangle panelRect = {panelX, panelY, panelWidth, panelHeight};
-  if (CheckCollisionPointRec(mouse, panelRect)) {
-    float wheel = GetMouseWheelMove();
-    if (wheel != 0) {
-      historyScrollOffset -= (int)wheel;
+//==============================================================================
+// OPENING EXPLORER
+//==============================================================================
+
+typedef struct {
+  char san[MOVE_NOTATION_LEN];
+  uint32_t games;
+  int score;      // Percent for the side to move, -1 if no game finished
+  int averageElo; // 0 if the games were unrated
+} ExplorerRow;
+
+static bool explorerShown = false;
+static uint64_t explorerKey = 0; // Position the rows were looked up for
+static bool explorerCached = false;
+static ExplorerRow explorerRows[EXPLORER_ROWS];
+static int explorerRowCount = 0;
+
+static bool IsExplorerShown(void) {
+  return explorerShown && !isMultiplayerGame && IsExplorerOpen(&openingExplorer);
+}
+
+// Look the position up only when it changed, not every frame
+static void RefreshExplorerRows(void) {
+  ChessPosition pos;
+  LoadPositionFromBoard(&pos);
+  if (explorerCached && pos.key == explorerKey)
+    return;
+  explorerKey = pos.key;
+  explorerCached = true;
+
+  const ExplorerEntry *entries;
+  int count = FindExplorerMoves(&openingExplorer, pos.key, &entries);
+  MoveList legal;
+  GenerateLegalMoves(&pos, &legal);
+  explorerRowCount = 0;
+  for (int i = 0; i < count && explorerRowCount < EXPLORER_ROWS; i++) {
+    const ExplorerEntry *entry = &entries[i];
+    int m = 0;
+    while (m < legal.count && legal.moves[m] != entry->move)
+      m++;
+    if (m == legal.count)
+      continue; // A key collision
+    ExplorerRow *row = &explorerRows[explorerRowCount++];
+    FormatSanMove(&pos, entry->move, row->san);
+    uint32_t wins = pos.sideToMove == COLOR_WHITE ? entry->whiteWins
+                                                  : entry->blackWins;
+    // Unfinished games count as played but have no result to score
+    uint64_t finished = (uint64_t)entry->games - entry->unfinished;
+    row->games = entry->games;
+    row->score =
+        finished > 0
+            ? (int)((200 * (uint64_t)wins + 100 * (uint64_t)entry->draws) /
+                    (2 * finished))
+            : -1;
+    row->averageElo = entry->averageElo;
+  }
+}
+
+static void DrawExplorer(int x, int y, int width) {
+  int fontSize = FONT_SIZE_SMALL - 4;
+  RefreshExplorerRows();
+  DrawText("Opening explorer", x, y, fontSize, COLOR_TITLE_GOLD);
+  if (explorerRowCount == 0) {
+    DrawText("No games from here", x, y + ANALYSIS_ROW_HEIGHT, fontSize, GRAY);
+    return;
+  }
+
+  for (int i = 0; i < explorerRowCount; i++) {
+    const ExplorerRow *row = &explorerRows[i];
+    int rowY = y + (i + 1) * ANALYSIS_ROW_HEIGHT;
+    char text[48];
+
+    DrawText(row->san, x, rowY, fontSize, WHITE);
+    char score[16] = "-";
+    if (row->score >= 0)
+      snprintf(score, sizeof(score), "%d%%", row->score);
+    if (row->averageElo > 0)
+      snprintf(text, sizeof(text), "%u  %s  %d", (unsigned)row->games, score,
+               row->averageElo);
+    else
+      snprintf(text, sizeof(text), "%u  %s", (unsigned)row->games, score);
+    DrawText(text, x + width - MeasureText(text, fontSize), rowY, fontSize,
+             LIGHTGRAY);
+  }
+}
+
+//==============================================================================
+// VARIATIONS
+//==============================================================================
+
+// Side lines are listed under the row of the move they replace, wrapped to
+// the panel, with nested lines indented under the move they branch from.
+// The layout only changes with the tree, so it is rebuilt on its version.
+typedef struct {
+  int node; // The move, or the folded line for a "(+n)" item
+  int x;
+  int width;
+  char text[11 + 3 + MOVE_NOTATION_LEN]; // Move number, "..." and the SAN
+} VariationItem;
+
+typedef struct {
+  int depth;  // Nesting, for the indent
+  int toggle; // Line folded by the row's box, VARIATION_NONE on wrapped rows
+  int firstItem;
+  int itemCount;
+} VariationRow;
+
+static VariationItem *variationItems = NULL;
+static int variationItemCount = 0;
+static int variationItemCapacity = 0;
+static VariationRow *variationRows = NULL;
+static int variationRowCount = 0;
+static int variationRowCapacity = 0;
+
+// Rows of the list in order: a full move of the game when >= 0, otherwise
+// variation row -(value + 1)
+static int *historyRows = NULL;
+static int historyRowCount = 0;
+static int historyRowCapacity = 0;
+
+static bool variationsCached = false;
+static uint32_t variationsVersion = 0;
+static int variationsMoveCount = 0;
+static int variationsWidth = 0;
+
+// Make room for one more element of a growable array
+static bool ReserveArray(void **array, int *capacity, int count,
+                         size_t size) {
+  if (count < *capacity)
+    return true;
+  int grown = *capacity > 0 ? *capacity * 2 : 64;
+  void *items = realloc(*array, size * (size_t)grown);
+  if (items == NULL)
+    return false;
+  *array = items;
+  *capacity = grown;
+  return true;
+}
+
+static bool AddHistoryRow(int value) {
+  if (!ReserveArray((void **)&historyRows, &historyRowCapacity,
+                    historyRowCount, sizeof(int)))
+    return false;
+  historyRows[historyRowCount++] = value;
+  return true;
+}
+
+static VariationRow *AddVariationRow(int depth, int toggle) {
+  if (!ReserveArray((void **)&variationRows, &variationRowCapacity,
+                    variationRowCount, sizeof(VariationRow)) ||
+      !AddHistoryRow(-(variationRowCount + 1)))
+    return NULL;
+  VariationRow *row = &variationRows[variationRowCount++];
+  row->depth = depth;
+  row->toggle = toggle;
+  row->firstItem = variationItemCount;
+  row->itemCount = 0;
+  return row;
+}
+
+static int VariationIndent(int depth) {
+  return 14 + (depth < 4 ? depth : 4) * 12;
+}
+
+// Lay out one line from its first move, which is played at the given ply;
+// lines branching off it are added where they branch
+static void AddVariationLine(const ChessPosition *start, int first, int ply,
+                             int depth, int width) {
+  int fontSize = FONT_SIZE_SMALL - 4;
+  VariationRow *row = AddVariationRow(depth, first);
+  if (row == NULL)
+    return;
+  int x = VariationIndent(depth) + 12;
+  bool numbered = true; // Black's move needs its number at a line's start
+  bool folded = GetVariationNode(first)->flags & VARIATION_COLLAPSED;
+  ChessPosition pos = *start;
+
+  for (int node = first; node != VARIATION_NONE; ply++) {
+    const VariationNode *entry = GetVariationNode(node);
+    VariationItem item = {.node = node};
+    char san[MOVE_NOTATION_LEN];
+    FormatSanMove(&pos, entry->move, san);
+    if (ply % 2 == 0)
+      snprintf(item.text, sizeof(item.text), "%d.%s", ply / 2 + 1, san);
+    else if (numbered)
+      snprintf(item.text, sizeof(item.text), "%d...%s", ply / 2 + 1, san);
+    else
+      snprintf(item.text, sizeof(item.text), "%s", san);
+    numbered = false;
+
+    // A folded line shows its first move and how many follow
+    int rest = 0;
+    if (folded) {
+      for (int next = entry->firstChild; next != VARIATION_NONE;
+           next = GetVariationNode(next)->firstChild)
+        rest++;
     }
+
+    for (int part = 0; part < (folded && rest > 0 ? 2 : 1); part++) {
+      if (part == 1)
+        snprintf(item.text, sizeof(item.text), "(+%d)", rest);
+      item.width = MeasureText(item.text, fontSize);
+      if (row->itemCount > 0 && x + item.width > width) {
+        row = AddVariationRow(depth, VARIATION_NONE);
+        if (row == NULL)
+          return;
+        x = VariationIndent(depth) + 12;
+      }
+      if (!ReserveArray((void **)&variationItems, &variationItemCapacity,
+                        variationItemCount, sizeof(VariationItem)))
+        return;
+      item.x = x;
+      variationItems[variationItemCount++] = item;
+      row->itemCount++;
+      x += item.width + 6;
+    }
+    if (folded)
+      return;
+
+    // The line goes on with the first reply; the other replies branch off
+    // after it, from the same position
+    if (node != first && entry->nextSibling != VARIATION_NONE) {
+      for (int side = entry->nextSibling; side != VARIATION_NONE;
+           side = GetVariationNode(side)->nextSibling)
+        AddVariationLine(&pos, side, ply, depth + 1, width);
+      if (entry->firstChild == VARIATION_NONE)
+        return;
+      row = AddVariationRow(depth, VARIATION_NONE);
+      if (row == NULL)
+        return;
+      x = VariationIndent(depth) + 12;
+      numbered = true;
+    }
+
+    MoveUndo undo;
+    MakeMove(&pos, entry->move, &undo);
+    node = entry->firstChild;
+  }
+}
+
+static void RefreshVariationRows(int width) {
+  int moves = GetMoveCount();
+  if (variationsCached && variationsVersion == GetVariationVersion() &&
+      variationsMoveCount == moves && variationsWidth == width)
+    return;
+  variationsCached = true;
+  variationsVersion = GetVariationVersion();
+  variationsMoveCount = moves;
+  variationsWidth = width;
+  variationItemCount = 0;
+  variationRowCount = 0;
+  historyRowCount = 0;
+
+  // Nodes of the game's own line, by ply
+  int fullMoves = (moves + 1) / 2;
+  int *line = malloc(sizeof(int) * (size_t)(moves + 1));
+  int current = GetCurrentVariation();
+  bool following = line != NULL && current != VARIATION_NONE &&
+                   GetVariationDepth(current) == moves;
+  for (int ply = moves, node = current; following && ply >= 0; ply--) {
+    line[ply] = node;
+    node = GetVariationNode(node)->parent;
+  }
+
+  // Lines replacing a move come after its row; those from the position on
+  // the board after the last row
+  int rowsAdded = 0;
+  for (int ply = 0; following && ply <= moves; ply++) {
+    int anchor = ply / 2 < fullMoves ? ply / 2 : fullMoves - 1;
+    for (; rowsAdded <= anchor; rowsAdded++)
+      AddHistoryRow(rowsAdded);
+
+    const VariationNode *node = GetVariationNode(line[ply]);
+    int played = ply < moves ? line[ply + 1] : VARIATION_NONE;
+    if (node->firstChild == VARIATION_NONE ||
+        (node->firstChild == played &&
+         GetVariationNode(played)->nextSibling == VARIATION_NONE))
+      continue;
+
+    ChessPosition pos;
+    if (!GetPositionAtPly(ply, &pos))
+      continue;
+    for (int side = node->firstChild; side != VARIATION_NONE;
+         side = GetVariationNode(side)->nextSibling) {
+      if (side != played)
+        AddVariationLine(&pos, side, ply, 0, width);
+    }
+  }
+  for (; rowsAdded < fullMoves; rowsAdded++)
+    AddHistoryRow(rowsAdded);
+  free(line);
+}
+
+// Clicking a move switches the game to it, clicking the box folds the line.
+// Sets the item under the mouse; true if a click changed the rows.
+static bool HandleVariationRowInput(const VariationRow *row, int panelX,
+                                    int y, int lineHeight, Vector2 mouse,
+                                    int *hoveredItem) {
+  bool click = IsMouseButtonPressed(MOUSE_LEFT_BUTTON);
+  if (row->toggle != VARIATION_NONE) {
+    int boxX = panelX + VariationIndent(row->depth);
+    if (click && CheckCollisionPointRec(mouse, (Rectangle){boxX - 3, y, 15,
+                                                           lineHeight - 4})) {
+      ToggleVariationCollapsed(row->toggle);
+      return true;
+    }
+  }
+
+  for (int i = 0; i < row->itemCount; i++) {
+    const VariationItem *item = &variationItems[row->firstItem + i];
+    Rectangle rect = {panelX + item->x - 2, y - 2, item->width + 4,
+                      lineHeight - 2};
+    if (!CheckCollisionPointRec(mouse, rect))
+      continue;
+    *hoveredItem = row->firstItem + i;
+    if (click) {
+      reviewPly = -1;
+      GoToVariation(item->node);
+      return true;
+    }
+  }
+  return false;
+}
+
+static void DrawVariationRow(const VariationRow *row, int panelX, int y,
+                             int lineHeight, int hoveredItem) {
+  int fontSize = FONT_SIZE_SMALL - 4;
+  if (row->toggle != VARIATION_NONE) {
+    bool folded = GetVariationNode(row->toggle)->flags & VARIATION_COLLAPSED;
+    int boxX = panelX + VariationIndent(row->depth);
+    Rectangle box = {boxX, y + 3, 9, 9};
+    DrawRectangleLinesEx(box, 1, GRAY);
+    DrawLine(boxX + 2, y + 7, boxX + 7, y + 7, LIGHTGRAY);
+    if (folded)
+      DrawLine(boxX + 4, y + 5, boxX + 4, y + 10, LIGHTGRAY);
+  }
+
+  for (int i = 0; i < row->itemCount; i++) {
+    const VariationItem *item = &variationItems[row->firstItem + i];
+    if (row->firstItem + i == hoveredItem)
+      DrawRectangleRec((Rectangle){panelX + item->x - 2, y - 2,
+                                   item->width + 4, lineHeight - 2},
+                       (Color){70, 70, 70, 255});
+    DrawText(item->text, panelX + item->x, y + 1, fontSize, GRAY);
   }
+}
 
-  // Clamp scroll offset
-  int maxScroll = fullMoves - maxVisibleLines;
+//==============================================================================
+// MOVE LIST
+//==============================================================================
+
+// Where black's move starts in the row of a full move
+static int HistoryRowSplit(int panelX, int fullMove) {
+  char whitePart[32];
+  snprintf(whitePart, sizeof(whitePart), "%d. %-8s", fullMove + 1,
+           GetMoveRecord(fullMove * 2)->notation);
+  return panelX + 10 + MeasureText(whitePart, FONT_SIZE_SMALL);
+}
+
+static int ClampHistoryScroll(int rowCount, int visibleRows) {
+  int maxScroll = rowCount - visibleRows;
   if (maxScroll < 0)
     maxScroll = 0;
   if (historyScrollOffset < 0)
     historyScrollOffset = 0;
   if (historyScrollOffset > maxScroll)
     historyScrollOffset = maxScroll;
+  return maxScroll;
+}
 
-  // Draw visible moves
+// The visible rows, from the scroll offset
+static void DrawHistoryRows(int panelX, int startY, int panelWidth,
+                            int lineHeight, int visibleRows, int hoveredItem) {
+  int totalMoveCount = GetMoveCount();
   int visibleLine = 0;
-  for (int i = historyScrollOffset;
-       i < fullMoves && visibleLine < maxVisibleLines; i++) {
+  for (int r = historyScrollOffset;
+       r < historyRowCount && visibleLine < visibleRows; r++, visibleLine++) {
     int y = startY + visibleLine * lineHeight;
     char lineBuffer[64];
+    int i = historyRows[r];
+    if (i < 0) {
+      DrawVariationRow(&variationRows[-i - 1], panelX, y, lineHeight,
+                       hoveredItem);
+      continue;
+    }
 
     // Move number
     int moveNum = i + 1;
@@ -257,12 +864,12 @@ void DrawMoveHistory(void) {
     // White's move (even indices: 0, 2, 4, ...)
     int whiteIdx = i * 2;
     const char *whiteMove =
-        (whiteIdx < totalMoveCount) ? moveHistory[whiteIdx].notation : "";
+        (whiteIdx < totalMoveCount) ? GetMoveRecord(whiteIdx)->notation : "";
 
     // Black's move (odd indices: 1, 3, 5, ...)
     int blackIdx = i * 2 + 1;
     const char *blackMove =
-        (blackIdx < totalMoveCount) ? moveHistory[blackIdx].notation : "";
+        (blackIdx < totalMoveCount) ? GetMoveRecord(blackIdx)->notation : "";
 
     // Format: "1. e4     e5" or "1. e4" if black hasn't moved
     // Using %-8s for fixed width to improve spacing between moves
@@ -279,12 +886,153 @@ void DrawMoveHistory(void) {
                     (Color){50, 50, 50, 255});
     }
 
+    // The move whose position is shown
+    if (reviewPly - 1 == whiteIdx || reviewPly - 1 == blackIdx) {
+      int split = HistoryRowSplit(panelX, i);
+      bool white = reviewPly - 1 == whiteIdx;
+      int left = white ? panelX + 5 : split - 4;
+      int right = white ? split - 4 : panelX + panelWidth - 5;
+      DrawRectangle(left, y - 2, right - left, lineHeight, COLOR_REVIEW_MOVE);
+    }
+
     DrawText(lineBuffer, panelX + 10, y, FONT_SIZE_SMALL, LIGHTGRAY);
-    visibleLine++;
   }
+}
+
+// Everything the cached rows were drawn from
+typedef struct {
+  uint32_t version; // Of the variation tree, which follows every move
+  int moveCount;
+  int scroll;
+  int reviewPly;
+  int hoveredItem;
+  int width;
+  int visibleRows;
+} HistoryLayerKey;
+
+static HistoryLayerKey historyLayerKey;
+
+// Text is the costliest thing on screen, so the rows are only drawn again
+// when a move, the scroll position, the reviewed move or the hover changes
+static void DrawHistoryList(int panelX, int startY, int panelWidth,
+                            int lineHeight, int visibleRows, int hoveredItem) {
+  if (visibleRows <= 0)
+    return;
+  HistoryLayerKey key = {GetVariationVersion(), GetMoveCount(),
+                         historyScrollOffset,   reviewPly,
+                         hoveredItem,           panelWidth,
+                         visibleRows};
+  if (!historyLayer.valid ||
+      memcmp(&key, &historyLayerKey, sizeof(key)) != 0) {
+    if (!BeginLayerCache(&historyLayer, panelWidth - 10,
+                         visibleRows * lineHeight)) {
+      DrawHistoryRows(panelX, startY, panelWidth, lineHeight, visibleRows,
+                      hoveredItem);
+      return;
+    }
+    // The texture's corner is at (panelX + 5, startY - 2)
+    ClearBackground(COLOR_PANEL_BG);
+    DrawHistoryRows(-5, 2, panelWidth, lineHeight, visibleRows, hoveredItem);
+    EndLayerCache(&historyLayer);
+    historyLayerKey = key;
+  }
+  DrawLayerCache(&historyLayer, panelX + 5, startY - 2);
+}
+
+void DrawMoveHistory(void) {
+  // Panel position and dimensions - leave room for clocks at top and bottom
+  int clockSpace = IsClockEnabled() ? CLOCK_PANEL_HEIGHT + 10 : 0;
+  int panelX = BOARD_OFFSET_X + BOARD_SIZE * TILE_SIZE + 20;
+  int panelY = BOARD_OFFSET_Y + clockSpace;
+  int panelWidth = HISTORY_PANEL_WIDTH - 30;
+  int panelHeight = BOARD_SIZE * TILE_SIZE - (2 * clockSpace);
+
+  // Draw panel background
+  DrawRectangle(panelX, panelY, panelWidth, panelHeight, COLOR_PANEL_BG);
+  DrawRectangleLinesEx((Rectangle){panelX, panelY, panelWidth, panelHeight}, 2,
+                       WHITE);
+
+  // Draw title
+  const char *title = "Move History";
+  int titleWidth = MeasureText(title, FONT_SIZE_SMALL);
+  DrawText(title, panelX + (panelWidth - titleWidth) / 2, panelY + 10,
+           FONT_SIZE_SMALL, WHITE);
+
+  // Engine lines take the bottom of the panel while analysis is on
+  int analysisHeight =
+      IsAnalysisShown() ? (ANALYSIS_LINES + 1) * ANALYSIS_ROW_HEIGHT + 12 : 0;
+  // The opening explorer sits above them
+  int explorerHeight =
+      IsExplorerShown() ? (EXPLORER_ROWS + 1) * ANALYSIS_ROW_HEIGHT + 12 : 0;
+  analysisHeight += explorerHeight;
+  int listBottom = panelY + panelHeight - analysisHeight;
+
+  // Draw moves in PGN format
+  int lineHeight = 22;
+  int startY = panelY + 40;
+  int maxVisibleLines = (panelHeight - analysisHeight - 50) / lineHeight;
+  int totalMoveCount = GetMoveCount();
+  int hoveredMove = -1;
+
+  // Full moves of the game, with the side lines tried in between
+  RefreshVariationRows(panelWidth - 10);
+  int rowCount = historyRowCount;
+
+  // Step through the game with the arrow keys, Home and End
+  HandleReviewKeys();
+
+  // Handle mouse wheel scrolling when hovering over the panel
+  Vector2 mouse = GetMousePosition();
+  Rectangle panelRect = {panelX, panelY, panelWidth, panelHeight};
+  if (CheckCollisionPointRec(mouse, panelRect)) {
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0) {
+      historyScrollOffset -= (int)wheel;
+    }
+  }
+
+  ClampHistoryScroll(rowCount, maxVisibleLines);
+
+  // Hovering a move shows the engine's lines from before it was played,
+  // clicking it shows the position after it
+  int hoveredItem = -1; // Move of a side line under the mouse
+  int visibleLine = 0;
+  for (int r = historyScrollOffset;
+       r < rowCount && visibleLine < maxVisibleLines; r++, visibleLine++) {
+    int y = startY + visibleLine * lineHeight;
+    int i = historyRows[r];
+    if (i < 0) {
+      if (HandleVariationRowInput(&variationRows[-i - 1], panelX, y,
+                                  lineHeight, mouse, &hoveredItem))
+        break;
+      continue;
+    }
+
+    Rectangle rowRect = {panelX + 5, y - 2, panelWidth - 10, lineHeight};
+    if (!CheckCollisionPointRec(mouse, rowRect))
+      continue;
+    int blackIdx = i * 2 + 1;
+    int pointed =
+        (blackIdx < totalMoveCount && mouse.x >= HistoryRowSplit(panelX, i))
+            ? blackIdx
+            : i * 2;
+    if (IsAnalysisShown())
+      hoveredMove = pointed;
+    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+      SeekToPly(pointed + 1);
+      break;
+    }
+  }
+
+  // A click may have changed the rows
+  RefreshVariationRows(panelWidth - 10);
+  rowCount = historyRowCount;
+  int maxScroll = ClampHistoryScroll(rowCount, maxVisibleLines);
+  DrawHistoryList(panelX, startY, panelWidth, lineHeight, maxVisibleLines,
+                  hoveredItem);
 
   // Draw scroll indicators
-  if (fullMoves > maxVisibleLines) {
+  if (rowCount > maxVisibleLines) {
     // Show up arrow if we can scroll up
     if (historyScrollOffset > 0) {
       DrawText("^", panelX + panelWidth - 20, panelY + 35, FONT_SIZE_SMALL,
@@ -292,20 +1040,60 @@ void DrawMoveHistory(void) {
     }
     // Show down arrow if we can scroll down
     if (historyScrollOffset < maxScroll) {
-      DrawText("v", panelX + panelWidth - 20, panelY + panelHeight - 25,
+      DrawText("v", panelX + panelWidth - 20, listBottom - 25,
                FONT_SIZE_SMALL, GRAY);
     }
     // Show scroll position
     char scrollText[48];
     snprintf(scrollText, sizeof(scrollText), "%d-%d/%d",
              historyScrollOffset + 1,
-             historyScrollOffset + maxVisibleLines > fullMoves
-                 ? fullMoves
+             historyScrollOffset + maxVisibleLines > rowCount
+                 ? rowCount
                  : historyScrollOffset + maxVisibleLines,
-             fullMoves);
+             rowCount);
     int scrollWidth = MeasureText(scrollText, FONT_SIZE_SMALL - 4);
     DrawText(scrollText, panelX + (panelWidth - scrollWidth) / 2,
-             panelY + panelHeight - 18, FONT_SIZE_SMALL - 4, GRAY);
+             listBottom - 18, FONT_SIZE_SMALL - 4, GRAY);
+  }
+
+  int boxX = panelX + 10;
+  int boxY = listBottom + 4;
+  int boxWidth = panelWidth - 20;
+  char boxTitle[48];
+  if (explorerHeight > 0 || IsAnalysisShown())
+    DrawLine(panelX + 5, listBottom, panelX + panelWidth - 5, listBottom, GRAY);
+  if (explorerHeight > 0) {
+    DrawExplorer(boxX, boxY, boxWidth);
+    boxY += explorerHeight;
+  }
+
+  if (!IsAnalysisShown())
+    return;
+
+  if (hoveredMove >= 0) {
+    const MoveRecord *move = GetMoveRecord(hoveredMove);
+    snprintf(boxTitle, sizeof(boxTitle), "Instead of %d%s%s", hoveredMove / 2 + 1,
+             move->color == COLOR_WHITE ? ". " : "...", move->notation);
+    AnalysisSnapshot alternatives;
+    if (!GetMoveAlternatives(hoveredMove, &alternatives)) {
+      DrawText(boxTitle, boxX, boxY, FONT_SIZE_SMALL - 4, COLOR_TITLE_GOLD);
+      DrawText("Not analyzed", boxX, boxY + ANALYSIS_ROW_HEIGHT,
+               FONT_SIZE_SMALL - 4, GRAY);
+    } else {
+      DrawAnalysisLines(boxX, boxY, boxWidth, boxTitle, alternatives.lines,
+                        alternatives.lineCount);
+    }
+    return;
+  }
+
+  AnalysisSnapshot snapshot;
+  if (GetAnalysis(&snapshot)) {
+    snprintf(boxTitle, sizeof(boxTitle), "Analysis (depth %d)", snapshot.depth);
+    DrawAnalysisLines(boxX, boxY, boxWidth, boxTitle, snapshot.lines,
+                      snapshot.lineCount);
+  } else {
+    DrawText(IsGameOver() ? "Analysis" : "Analyzing...", boxX, boxY,
+             FONT_SIZE_SMALL - 4, COLOR_TITLE_GOLD);
   }
 }
 
@@ -419,6 +1207,16 @@ void DrawGameOverScreen(void) {
     titleText = "CHECKMATE!";
     subtitleText = (currentTurn == COLOR_WHITE) ? "Black Wins!" : "White Wins!";
     titleColor = RED;
+  } else if (gameState == GAME_ADJUDICATED) {
+    titleText = "TABLEBASE";
+    if (adjudicatedWinner == COLOR_NONE) {
+      subtitleText = "Theoretical Draw!";
+      titleColor = GRAY;
+    } else {
+      subtitleText =
+          (adjudicatedWinner == COLOR_WHITE) ? "White Wins!" : "Black Wins!";
+      titleColor = RED;
+    }
   } else {
     titleText = "STALEMATE!";
     subtitleText = "It's a Draw!";
@@ -448,12 +1246,56 @@ void HandleInput(void) {
     InitBoard();
     InitClock();
     StartClock();
+    JournalGameStart();
     isDragging = false;
     return;
   }
 
-  if (gameState == GAME_CHECKMATE || gameState == GAME_STALEMATE ||
-      gameState == GAME_TIMEOUT) {
+  // Take back and redo moves (local games only)
+  if (IsKeyPressed(KEY_Z) && !isMultiplayerGame) {
+    TakeBackMove();
+    return;
+  }
+  if (IsKeyPressed(KEY_Y) && !isMultiplayerGame) {
+    RedoMove();
+    return;
+  }
+
+  if (IsGameOver()) {
+    return;
+  }
+
+  // Save the game so far as PGN
+  if (IsKeyPressed(KEY_P)) {
+    if (ExportGamePgn(PGN_EXPORT_PATH, false))
+      TraceLog(LOG_INFO, "Game saved to %s", PGN_EXPORT_PATH);
+    else
+      TraceLog(LOG_WARNING, "Could not save the game to %s", PGN_EXPORT_PATH);
+  }
+
+  // Engine analysis of the current position (local games only)
+  if (IsKeyPressed(KEY_A) && !isMultiplayerGame) {
+    ToggleAnalysis();
+  }
+
+  // Best-move arrow and hanging pieces (local games only)
+  if (IsKeyPressed(KEY_H) && !isMultiplayerGame) {
+    ToggleHint();
+  }
+
+  // Move statistics of the current position (local games only)
+  if (IsKeyPressed(KEY_E) && !isMultiplayerGame) {
+    explorerShown = !explorerShown;
+  }
+
+  // The board shows a past position; moves are made on the live one
+  if (IsReviewing())
+    return;
+
+  // Let the opening book play for the side to move (local games only)
+  if (IsKeyPressed(KEY_B) && !isMultiplayerGame) {
+    isDragging = false;
+    PlayBookMove();
     return;
   }
 
@@ -526,34 +1368,7 @@ void HandlePromotion(void) {
 
     if (mouse.x >= x && mouse.x < x + TILE_SIZE && mouse.y >= y &&
         mouse.y < y + TILE_SIZE) {
-      // Promote the piece
-      board[promotionPos.row][promotionPos.col].type = options[i];
-
-      // Record the promotion move (pawn promotion)
-      PieceColor pieceColor = board[promotionPos.row][promotionPos.col].color;
-      RecordMove(promotionFromPos.row, promotionFromPos.col, promotionPos.row,
-                 promotionPos.col, PIECE_PAWN, pieceColor, promotionWasCapture,
-                 false, false, false, true, options[i]);
-
-      // Send move to remote player in multiplayer (with promotion piece type)
-      HandleLocalMove(promotionFromPos.row, promotionFromPos.col,
-                      promotionPos.row, promotionPos.col, options[i]);
-
-      // Switch clock before changing turn (applies increment to player who
-      // moved)
-      SwitchClock(pieceColor);
-
-      // Switch turns and update game state
-      currentTurn = OPPONENT_COLOR(currentTurn);
-      gameState = GAME_PLAYING;
-      promotionPos = INVALID_POS;
-      promotionFromPos = INVALID_POS;
-      UpdateGameState();
-
-      // Update move history with check/checkmate status
-      UpdateLastMoveStatus(gameState == GAME_CHECK ||
-                               gameState == GAME_CHECKMATE,
-                           gameState == GAME_CHECKMATE);
+      CompletePromotion(options[i]);
       break;
     }
   }
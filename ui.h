@@ -14,6 +14,47 @@
 
 extern Texture2D piecesTexture;
 
+//==============================================================================
+// LAYER CACHES
+//==============================================================================
+
+// A part of the screen drawn once into a texture and copied to the screen
+// every frame, until what it shows changes
+typedef struct {
+  RenderTexture2D target;
+  bool valid;  // The texture holds the layer as last drawn
+  bool failed; // No texture could be created; the layer is drawn directly
+} LayerCache;
+
+/**
+ * Start drawing a layer into its cache, creating the texture, or creating it
+ * again when the size changed. Coordinates are relative to the texture's
+ * top left corner until EndLayerCache.
+ * @return false if no texture could be created; draw the layer directly
+ */
+bool BeginLayerCache(LayerCache *cache, int width, int height);
+
+/**
+ * Finish drawing a layer into its cache.
+ */
+void EndLayerCache(LayerCache *cache);
+
+/**
+ * Copy a cached layer to the screen. Layers are opaque, so they replace
+ * what is under them without blending.
+ */
+void DrawLayerCache(const LayerCache *cache, int x, int y);
+
+/**
+ * Release a cached layer's texture.
+ */
+void UnloadLayerCache(LayerCache *cache);
+
+/**
+ * Release the board and move list caches.
+ */
+void UnloadUiLayers(void);
+
 //==============================================================================
 // DRAWING FUNCTIONS
 //==============================================================================
@@ -29,7 +70,8 @@ void LoadPiecesTexture(void);
 void UnloadPiecesTexture(void);
 
 /**
- * Draw the chessboard with square highlighting.
+ * Draw the chessboard with square highlighting. The squares come from a
+ * cache drawn once; only the highlights are drawn every frame.
  */
 void DrawBoard(void);
 
@@ -38,6 +80,18 @@ void DrawBoard(void);
  */
 void DrawValidMoves(void);
 
+/**
+ * Draw the evaluation bar to the left of the board, from the background
+ * search of the current position.
+ */
+void DrawEvalBar(void);
+
+/**
+ * Draw the hint: an arrow for the engine's best move and outlines around
+ * pieces of the side to move that can be won.
+ */
+void DrawHint(void);
+
 /**
  * Draw all pieces on the board (including dragged piece).
  */
@@ -59,10 +113,17 @@ void DrawPromotionUI(void);
 void DrawGameOverScreen(void);
 
 /**
- * Draw the move history panel on the right side of the board.
+ * Draw the move history panel on the right side of the board. Clicking a
+ * move (or the arrow keys, Home and End) shows the position after it.
  */
 void DrawMoveHistory(void);
 
+/**
+ * Check if a position picked in the move history is shown instead of the
+ * live game. Playing or taking back a move returns to the live game.
+ */
+bool IsReviewing(void);
+
 /**
  * Draw the chess clocks for both players.
  */
@@ -0,0 +1,189 @@
+/**
+ * Chess Game - Variation Tree
+ * Every line tried in a local game, sharing common prefixes.
+ */
+
+#include "variation.h"
+#include <stdlib.h>
+
+//==============================================================================
+// NODE POOL
+//==============================================================================
+
+// Chunk i holds nodes i * VARIATION_CHUNK_NODES onwards. Nodes refer to each
+// other by index, so growing the chunk directory never invalidates them.
+static VariationNode **nodeChunks = NULL;
+static int chunkCount = 0;
+static int chunkCapacity = 0;
+static int nodesUsed = 0;               // Nodes handed out from the chunks
+static int32_t freeList = VARIATION_NONE; // Dropped nodes, linked by sibling
+
+static int32_t currentNode = VARIATION_NONE;
+static uint32_t version = 0;
+
+static VariationNode *NodeAt(int32_t index) {
+  return &nodeChunks[index / VARIATION_CHUNK_NODES]
+                    [index % VARIATION_CHUNK_NODES];
+}
+
+// A fresh node, or VARIATION_NONE if memory ran out
+static int32_t AllocateNode(Move move, int32_t parent) {
+  int32_t index = freeList;
+  if (index != VARIATION_NONE) {
+    freeList = NodeAt(index)->nextSibling;
+  } else {
+    if (nodesUsed == chunkCount * VARIATION_CHUNK_NODES) {
+      if (chunkCount == chunkCapacity) {
+        int capacity = chunkCapacity > 0 ? chunkCapacity * 2 : 8;
+        VariationNode **chunks =
+            realloc(nodeChunks, sizeof(VariationNode *) * (size_t)capacity);
+        if (chunks == NULL)
+          return VARIATION_NONE;
+        nodeChunks = chunks;
+        chunkCapacity = capacity;
+      }
+      VariationNode *chunk =
+          malloc(sizeof(VariationNode) * VARIATION_CHUNK_NODES);
+      if (chunk == NULL)
+        return VARIATION_NONE;
+      nodeChunks[chunkCount++] = chunk;
+    }
+    index = nodesUsed++;
+  }
+
+  VariationNode *node = NodeAt(index);
+  node->move = move;
+  node->flags = 0;
+  node->reserved = 0;
+  node->parent = parent;
+  node->firstChild = VARIATION_NONE;
+  node->nextSibling = VARIATION_NONE;
+  return index;
+}
+
+// Return a list of siblings and all their lines to the pool. Children are
+// spliced in ahead of the rest of the list, so no stack is needed.
+static void FreeNodeList(int32_t index) {
+  while (index != VARIATION_NONE) {
+    VariationNode *node = NodeAt(index);
+    int32_t next = node->nextSibling;
+    if (node->firstChild != VARIATION_NONE) {
+      int32_t last = node->firstChild;
+      while (NodeAt(last)->nextSibling != VARIATION_NONE)
+        last = NodeAt(last)->nextSibling;
+      NodeAt(last)->nextSibling = next;
+      next = node->firstChild;
+    }
+    node->nextSibling = freeList;
+    freeList = index;
+    index = next;
+  }
+}
+
+//==============================================================================
+// TREE MANAGEMENT
+//==============================================================================
+
+void ResetVariations(void) {
+  nodesUsed = 0;
+  freeList = VARIATION_NONE;
+  currentNode = AllocateNode(MOVE_NONE, VARIATION_NONE);
+  version++;
+}
+
+void FreeVariations(void) {
+  for (int i = 0; i < chunkCount; i++)
+    free(nodeChunks[i]);
+  free(nodeChunks);
+  nodeChunks = NULL;
+  chunkCount = 0;
+  chunkCapacity = 0;
+  nodesUsed = 0;
+  freeList = VARIATION_NONE;
+  currentNode = VARIATION_NONE;
+  version++;
+}
+
+void VariationMovePlayed(Move move, bool keepSideLines) {
+  version++;
+  if (currentNode == VARIATION_NONE)
+    return;
+
+  VariationNode *current = NodeAt(currentNode);
+  int32_t *link = &current->firstChild;
+  while (*link != VARIATION_NONE) {
+    if (NodeAt(*link)->move == move) {
+      currentNode = *link;
+      return;
+    }
+    link = &NodeAt(*link)->nextSibling;
+  }
+
+  if (!keepSideLines) {
+    FreeNodeList(current->firstChild);
+    current->firstChild = VARIATION_NONE;
+    link = &current->firstChild;
+  }
+
+  // The pool may grow, but the link points into a chunk that stays put
+  int32_t child = AllocateNode(move, currentNode);
+  *link = child;
+  currentNode = child; // Stops following the game if memory ran out
+}
+
+void VariationMoveTakenBack(void) {
+  version++;
+  if (currentNode != VARIATION_NONE)
+    currentNode = NodeAt(currentNode)->parent;
+}
+
+//==============================================================================
+// QUERIES
+//==============================================================================
+
+int GetCurrentVariation(void) { return currentNode; }
+
+const VariationNode *GetVariationNode(int index) {
+  return index == VARIATION_NONE ? NULL : NodeAt(index);
+}
+
+int GetVariationDepth(int index) {
+  int depth = 0;
+  for (int32_t node = index; node != VARIATION_ROOT;
+       node = NodeAt(node)->parent)
+    depth++;
+  return depth;
+}
+
+int FindCommonVariation(int a, int b) {
+  int depthA = GetVariationDepth(a);
+  int depthB = GetVariationDepth(b);
+  for (; depthA > depthB; depthA--)
+    a = NodeAt(a)->parent;
+  for (; depthB > depthA; depthB--)
+    b = NodeAt(b)->parent;
+  while (a != b) {
+    a = NodeAt(a)->parent;
+    b = NodeAt(b)->parent;
+  }
+  return a;
+}
+
+int GetVariationPath(int index, Move *moves, int maxMoves) {
+  int depth = GetVariationDepth(index);
+  if (depth > maxMoves)
+    return -1;
+  int32_t node = index;
+  for (int i = depth - 1; i >= 0; i--) {
+    moves[i] = NodeAt(node)->move;
+    node = NodeAt(node)->parent;
+  }
+  return depth;
+}
+
+void ToggleVariationCollapsed(int index) {
+  NodeAt(index)->flags ^= VARIATION_COLLAPSED;
+  version++;
+}
+
+uint32_t GetVariationVersion(void) { return version; }
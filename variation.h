@@ -0,0 +1,108 @@
+/**
+ * Chess Game - Variation Tree
+ * Every line tried in a local game, as a tree of moves sharing their common
+ * prefixes.
+ *
+ * The move history stays the line on the board; the tree follows it as
+ * moves are played and taken back. While analysis is on, a move that
+ * differs from one already tried in the position starts a side line instead
+ * of replacing it, so exploring costs one node per new ply. Nodes are
+ * 16 bytes and come from a pool of fixed-size chunks with a free list.
+ */
+
+#ifndef VARIATION_H
+#define VARIATION_H
+
+#include "position.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+//==============================================================================
+// VARIATION CONSTANTS
+//==============================================================================
+
+#define VARIATION_CHUNK_NODES 1024 // Nodes per pool chunk
+#define VARIATION_NONE -1
+#define VARIATION_ROOT 0 // The starting position
+
+// Node flags
+#define VARIATION_COLLAPSED 1 // The line starting here is shown folded
+
+//==============================================================================
+// VARIATION TYPES
+//==============================================================================
+
+typedef struct {
+  Move move; // The move leading to this node
+  uint8_t flags;
+  uint8_t reserved;
+  int32_t parent;
+  int32_t firstChild; // Children in the order they were first played
+  int32_t nextSibling;
+} VariationNode;
+
+//==============================================================================
+// VARIATION FUNCTIONS
+//==============================================================================
+
+/**
+ * Start over from the starting position. The pool chunks are kept for the
+ * next game.
+ */
+void ResetVariations(void);
+
+/**
+ * Release the memory of the tree.
+ */
+void FreeVariations(void);
+
+/**
+ * Follow a move played on the board. A move already tried from the current
+ * node is followed again; otherwise it is added, and unless keepSideLines
+ * is set the moves tried before from here are dropped with their lines.
+ */
+void VariationMovePlayed(Move move, bool keepSideLines);
+
+/**
+ * Follow a takeback: the current node becomes its parent.
+ */
+void VariationMoveTakenBack(void);
+
+/**
+ * Node after the moves on the board.
+ */
+int GetCurrentVariation(void);
+
+/**
+ * Node of the tree, or NULL for VARIATION_NONE.
+ */
+const VariationNode *GetVariationNode(int index);
+
+/**
+ * Number of moves from the starting position to a node.
+ */
+int GetVariationDepth(int index);
+
+/**
+ * Last node the lines to two nodes have in common.
+ */
+int FindCommonVariation(int a, int b);
+
+/**
+ * Write the moves leading to a node, first move first.
+ * @return Number of moves, or -1 if they do not fit in maxMoves
+ */
+int GetVariationPath(int index, Move *moves, int maxMoves);
+
+/**
+ * Fold or unfold the line starting at a node.
+ */
+void ToggleVariationCollapsed(int index);
+
+/**
+ * Counter that changes whenever the tree or the current node changes, for
+ * caches built from the tree.
+ */
+uint32_t GetVariationVersion(void);
+
+#endif // VARIATION_H
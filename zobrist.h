@@ -0,0 +1,66 @@
+/**
+ * Chess Game - Zobrist Keys
+ * Polyglot-compatible random keys for position hashing.
+ */
+
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "position.h"
+#include <stdint.h>
+
+//==============================================================================
+// KEY LAYOUT
+//==============================================================================
+
+#define ZOBRIST_KEY_COUNT 781
+#define ZOBRIST_CASTLE_OFFSET 768
+#define ZOBRIST_EN_PASSANT_OFFSET 772
+#define ZOBRIST_TURN_OFFSET 780
+
+//==============================================================================
+// KEY TABLES (defined in zobrist.c)
+//==============================================================================
+
+extern const uint64_t ZOBRIST_KEYS[ZOBRIST_KEY_COUNT];
+extern const int ZOBRIST_PIECE_KIND[PIECE_CODE_COUNT];
+
+//==============================================================================
+// KEY HELPERS
+//==============================================================================
+
+/**
+ * Key for a piece standing on a square.
+ * Polyglot counts ranks from white's side, hence the row flip (sq ^ 56).
+ */
+static inline uint64_t ZobristPiece(PieceCode code, int sq) {
+  return ZOBRIST_KEYS[64 * ZOBRIST_PIECE_KIND[code] + (sq ^ 56)];
+}
+
+/**
+ * Key for a set of castling rights (CASTLE_* bit mask).
+ */
+static inline uint64_t ZobristCastling(int rights) {
+  uint64_t key = 0;
+  for (int i = 0; i < 4; i++) {
+    if (rights & (1 << i))
+      key ^= ZOBRIST_KEYS[ZOBRIST_CASTLE_OFFSET + i];
+  }
+  return key;
+}
+
+/**
+ * Key for an en passant file.
+ */
+static inline uint64_t ZobristEnPassant(int col) {
+  return ZOBRIST_KEYS[ZOBRIST_EN_PASSANT_OFFSET + col];
+}
+
+/**
+ * Key toggled when white is to move.
+ */
+static inline uint64_t ZobristTurn(void) {
+  return ZOBRIST_KEYS[ZOBRIST_TURN_OFFSET];
+}
+
+#endif // ZOBRIST_H